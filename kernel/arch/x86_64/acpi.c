@@ -0,0 +1,142 @@
+/**
+ * ACPI Table Implementation
+ */
+
+#include <kernel/acpi.h>
+#include <kernel/multiboot.h>
+#include <kernel/vmm.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// BIOS areas searched for the RSDP
+#define ACPI_EBDA_PTR       0x40E       // Real-mode segment of the EBDA
+#define ACPI_BIOS_START     0xE0000
+#define ACPI_BIOS_END       0x100000
+
+// Root table (RSDT with 32-bit or XSDT with 64-bit entries)
+static const acpi_sdt_header_t *root_table = NULL;
+static bool root_is_xsdt = false;
+
+/**
+ * Sum bytes modulo 256 (valid tables sum to zero)
+ */
+static uint8_t acpi_checksum(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+/**
+ * Check an RSDP candidate
+ */
+static bool acpi_rsdp_valid(const acpi_rsdp_t *rsdp) {
+    if (memcmp(rsdp->signature, "RSD PTR ", 8) != 0) {
+        return false;
+    }
+    return acpi_checksum(rsdp, 20) == 0;
+}
+
+/**
+ * Scan a physical range for the RSDP (16-byte aligned)
+ */
+static const acpi_rsdp_t *acpi_scan(uint64_t start, uint64_t end) {
+    for (uint64_t addr = start; addr + sizeof(acpi_rsdp_t) <= end; addr += 16) {
+        const acpi_rsdp_t *rsdp = (const acpi_rsdp_t *)vmm_phys_to_virt(addr);
+        if (acpi_rsdp_valid(rsdp)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Map a table and validate its checksum
+ */
+static const acpi_sdt_header_t *acpi_map_table(uint64_t phys) {
+    if (phys == 0 || vmm_map_mmio(phys, sizeof(acpi_sdt_header_t)) == 0) {
+        return NULL;
+    }
+
+    const acpi_sdt_header_t *hdr = (const acpi_sdt_header_t *)vmm_phys_to_virt(phys);
+    if (hdr->length < sizeof(acpi_sdt_header_t) || vmm_map_mmio(phys, hdr->length) == 0) {
+        return NULL;
+    }
+
+    if (acpi_checksum(hdr, hdr->length) != 0) {
+        return NULL;
+    }
+    return hdr;
+}
+
+/**
+ * Locate the ACPI tables
+ */
+int acpi_init(void) {
+    const acpi_rsdp_t *rsdp = (const acpi_rsdp_t *)multiboot_get_rsdp();
+
+    if (!rsdp || !acpi_rsdp_valid(rsdp)) {
+        uint64_t ebda = (uint64_t)(*(const uint16_t *)vmm_phys_to_virt(ACPI_EBDA_PTR)) << 4;
+        rsdp = ebda ? acpi_scan(ebda, ebda + 1024) : NULL;
+        if (!rsdp) {
+            rsdp = acpi_scan(ACPI_BIOS_START, ACPI_BIOS_END);
+        }
+    }
+
+    if (!rsdp) {
+        return -1;
+    }
+
+    if (rsdp->revision >= 2 && rsdp->xsdt_address) {
+        root_table = acpi_map_table(rsdp->xsdt_address);
+        root_is_xsdt = (root_table != NULL);
+    }
+    if (!root_table) {
+        root_table = acpi_map_table(rsdp->rsdt_address);
+    }
+    if (!root_table) {
+        return -1;
+    }
+
+    vga_printf("  ACPI: %s at 0x%x, OEM '%c%c%c%c%c%c'\n",
+               root_is_xsdt ? "XSDT" : "RSDT", vmm_virt_to_phys((uint64_t)root_table),
+               rsdp->oem_id[0], rsdp->oem_id[1], rsdp->oem_id[2],
+               rsdp->oem_id[3], rsdp->oem_id[4], rsdp->oem_id[5]);
+    return 0;
+}
+
+/**
+ * Find a system description table by signature
+ */
+const acpi_sdt_header_t *acpi_find_table(const char *signature) {
+    if (!root_table) {
+        return NULL;
+    }
+
+    size_t entry_size = root_is_xsdt ? 8 : 4;
+    size_t count = (root_table->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    const uint8_t *entries = (const uint8_t *)root_table + sizeof(acpi_sdt_header_t);
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t phys;
+        if (root_is_xsdt) {
+            memcpy(&phys, entries + i * 8, 8);      // Entries are unaligned
+        } else {
+            uint32_t phys32;
+            memcpy(&phys32, entries + i * 4, 4);
+            phys = phys32;
+        }
+
+        const acpi_sdt_header_t *hdr = acpi_map_table(phys);
+        if (hdr && memcmp(hdr->signature, signature, 4) == 0) {
+            return hdr;
+        }
+    }
+
+    return NULL;
+}
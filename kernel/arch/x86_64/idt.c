@@ -4,6 +4,7 @@
 
 #include <kernel/idt.h>
 #include <kernel/isr.h>
+#include <kernel/tss.h>
 #include <kernel/string.h>
 #include <kernel/vga.h>
 #include <stdint.h>
@@ -27,6 +28,13 @@ void idt_set_gate(uint8_t num, uint64_t handler, uint8_t type_attr) {
     idt[num].reserved = 0;
 }
 
+/**
+ * Run an IDT gate on an Interrupt Stack Table stack
+ */
+void idt_set_ist(uint8_t num, uint8_t ist) {
+    idt[num].ist = ist & 0x7;
+}
+
 /**
  * Initialize IDT
  */
@@ -41,8 +49,14 @@ void idt_init(void) {
     // Install ISRs
     isr_init();
 
+    // A double fault usually means the stack is gone, and NMI and #MC can
+    // arrive at any instruction, so all three switch to known-good stacks
+    idt_set_ist(EXCEPTION_DOUBLE_FAULT, IST_DOUBLE_FAULT);
+    idt_set_ist(EXCEPTION_NMI, IST_NMI);
+    idt_set_ist(EXCEPTION_MACHINE_CHECK, IST_MACHINE_CHECK);
+
     // Load IDT
     __asm__ volatile("lidt %0" : : "m"(idt_ptr));
 
-    vga_printf("  IDT: Initialized %u interrupt gates\n", 256);
+    vga_printf("  IDT: Initialized %u interrupt gates (%u on IST stacks)\n", 256, IST_COUNT);
 }
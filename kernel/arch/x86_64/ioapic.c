@@ -0,0 +1,131 @@
+/**
+ * I/O APIC Implementation
+ */
+
+#include <kernel/apic.h>
+#include <kernel/vmm.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Registered I/O APIC
+ */
+typedef struct ioapic {
+    volatile uint32_t *base;    // Mapped register window
+    uint8_t id;
+    uint32_t gsi_base;          // First GSI
+    uint32_t gsi_count;         // Number of redirection entries
+} ioapic_t;
+
+static ioapic_t ioapics[IOAPIC_MAX];
+static uint32_t ioapic_num = 0;
+
+/**
+ * Read an I/O APIC register
+ */
+static uint32_t ioapic_read(const ioapic_t *io, uint32_t reg) {
+    io->base[IOAPIC_REGSEL / 4] = reg;
+    return io->base[IOAPIC_WINDOW / 4];
+}
+
+/**
+ * Write an I/O APIC register
+ */
+static void ioapic_write(const ioapic_t *io, uint32_t reg, uint32_t value) {
+    io->base[IOAPIC_REGSEL / 4] = reg;
+    io->base[IOAPIC_WINDOW / 4] = value;
+}
+
+/**
+ * Find the I/O APIC that handles a GSI
+ */
+static ioapic_t *ioapic_for_gsi(uint32_t gsi) {
+    for (uint32_t i = 0; i < ioapic_num; i++) {
+        if (gsi >= ioapics[i].gsi_base && gsi < ioapics[i].gsi_base + ioapics[i].gsi_count) {
+            return &ioapics[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Register an I/O APIC
+ */
+int ioapic_add(uint8_t id, uint64_t phys, uint32_t gsi_base) {
+    if (ioapic_num >= IOAPIC_MAX) {
+        return -1;
+    }
+
+    uint64_t virt = vmm_map_mmio(phys, 0x1000);
+    if (virt == 0) {
+        return -1;
+    }
+
+    ioapic_t *io = &ioapics[ioapic_num];
+    io->base = (volatile uint32_t *)virt;
+    io->id = id;
+    io->gsi_base = gsi_base;
+    io->gsi_count = ((ioapic_read(io, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+    for (uint32_t i = 0; i < io->gsi_count; i++) {
+        ioapic_write(io, IOAPIC_REG_REDTBL + i * 2, IOAPIC_RTE_MASKED);
+        ioapic_write(io, IOAPIC_REG_REDTBL + i * 2 + 1, 0);
+    }
+
+    ioapic_num++;
+    vga_printf("  IOAPIC: ID %u at 0x%x, GSIs %u-%u\n", id, phys,
+               gsi_base, gsi_base + io->gsi_count - 1);
+    return 0;
+}
+
+/**
+ * Program the redirection entry of a GSI
+ */
+int ioapic_route(uint32_t gsi, uint8_t vector, uint32_t apic_id, uint32_t flags) {
+    ioapic_t *io = ioapic_for_gsi(gsi);
+    if (!io) {
+        return -1;
+    }
+
+    uint32_t index = gsi - io->gsi_base;
+    ioapic_write(io, IOAPIC_REG_REDTBL + index * 2 + 1, apic_id << (IOAPIC_RTE_DEST_SHIFT - 32));
+    ioapic_write(io, IOAPIC_REG_REDTBL + index * 2, vector | flags);
+    return 0;
+}
+
+/**
+ * Mask or unmask a GSI
+ */
+void ioapic_set_masked(uint32_t gsi, bool masked) {
+    ioapic_t *io = ioapic_for_gsi(gsi);
+    if (!io) {
+        return;
+    }
+
+    uint32_t reg = IOAPIC_REG_REDTBL + (gsi - io->gsi_base) * 2;
+    uint32_t low = ioapic_read(io, reg);
+    low = masked ? (low | IOAPIC_RTE_MASKED) : (low & ~IOAPIC_RTE_MASKED);
+    ioapic_write(io, reg, low);
+}
+
+/**
+ * Change the destination CPU of a GSI
+ */
+int ioapic_set_destination(uint32_t gsi, uint32_t apic_id) {
+    ioapic_t *io = ioapic_for_gsi(gsi);
+    if (!io) {
+        return -1;
+    }
+
+    uint32_t reg = IOAPIC_REG_REDTBL + (gsi - io->gsi_base) * 2 + 1;
+    ioapic_write(io, reg, apic_id << (IOAPIC_RTE_DEST_SHIFT - 32));
+    return 0;
+}
+
+/**
+ * Get the number of registered I/O APICs
+ */
+uint32_t ioapic_count(void) {
+    return ioapic_num;
+}
@@ -0,0 +1,360 @@
+/**
+ * Interrupt Controller Abstraction Implementation
+ */
+
+#include <kernel/irq.h>
+#include <kernel/acpi.h>
+#include <kernel/apic.h>
+#include <kernel/idt.h>
+#include <kernel/pic.h>
+#include <kernel/percpu.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+static irq_mode_t irq_mode = IRQ_MODE_PIC;
+
+// GSI and redirection flags per IRQ
+static uint32_t irq_gsi[IRQ_COUNT];
+static uint32_t irq_flags[IRQ_COUNT];
+static bool irq_routed[IRQ_COUNT];
+
+// Dynamic vectors in use, and system vectors never handed out (bit per vector)
+static uint64_t vector_used[4];
+static uint64_t vector_reserved[4];
+
+// CPUs from the MADT
+static uint32_t cpu_apic_ids[MAX_CPUS];
+static uint32_t cpu_count = 1;
+
+/**
+ * APIC spurious interrupts need no EOI
+ */
+static void irq_spurious_handler(registers_t *regs) {
+    (void)regs;
+}
+
+/**
+ * Convert MPS INTI flags to redirection entry bits
+ */
+static uint32_t irq_inti_to_rte(uint16_t inti, uint32_t defaults) {
+    uint32_t flags = defaults;
+
+    switch (inti & MADT_ISO_POLARITY_MASK) {
+        case 0x1: flags &= ~IOAPIC_RTE_LOW_ACTIVE; break;
+        case MADT_ISO_POLARITY_LOW: flags |= IOAPIC_RTE_LOW_ACTIVE; break;
+        default: break;     // Conforms to the bus
+    }
+
+    switch (inti & MADT_ISO_TRIGGER_MASK) {
+        case 0x4: flags &= ~IOAPIC_RTE_LEVEL; break;
+        case MADT_ISO_TRIGGER_LEVEL: flags |= IOAPIC_RTE_LEVEL; break;
+        default: break;
+    }
+
+    return flags;
+}
+
+/**
+ * Walk the MADT: CPUs, I/O APICs and ISA overrides
+ *
+ * @return Local APIC physical address, or 0 if the MADT is unusable
+ */
+static uint64_t irq_parse_madt(const acpi_madt_t *madt) {
+    uint64_t lapic_phys = madt->lapic_address;
+    const uint8_t *p = madt->entries;
+    const uint8_t *end = (const uint8_t *)madt + madt->header.length;
+
+    cpu_count = 0;
+
+    while (p + sizeof(madt_entry_header_t) <= end) {
+        const madt_entry_header_t *entry = (const madt_entry_header_t *)p;
+        if (entry->length < sizeof(madt_entry_header_t) || p + entry->length > end) {
+            break;
+        }
+
+        switch (entry->type) {
+            case MADT_ENTRY_LAPIC: {
+                const madt_lapic_t *lapic = (const madt_lapic_t *)p;
+                if ((lapic->flags & MADT_LAPIC_ENABLED) && cpu_count < MAX_CPUS) {
+                    cpu_apic_ids[cpu_count++] = lapic->apic_id;
+                }
+                break;
+            }
+
+            case MADT_ENTRY_IOAPIC: {
+                const madt_ioapic_t *io = (const madt_ioapic_t *)p;
+                ioapic_add(io->ioapic_id, io->address, io->gsi_base);
+                break;
+            }
+
+            case MADT_ENTRY_ISO: {
+                const madt_iso_t *iso = (const madt_iso_t *)p;
+                if (iso->bus == 0 && iso->source < IRQ_ISA_COUNT) {
+                    irq_gsi[iso->source] = iso->gsi;
+                    irq_flags[iso->source] = irq_inti_to_rte(iso->flags, 0);
+                }
+                break;
+            }
+
+            case MADT_ENTRY_LAPIC_OVERRIDE: {
+                const madt_lapic_override_t *ovr = (const madt_lapic_override_t *)p;
+                lapic_phys = ovr->address;
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        p += entry->length;
+    }
+
+    if (cpu_count == 0) {
+        cpu_count = 1;      // At least the boot CPU
+    }
+    return lapic_phys;
+}
+
+/**
+ * Bring up the local APIC and I/O APICs
+ */
+static int irq_init_apic(void) {
+    if (acpi_init() != 0) {
+        return -1;
+    }
+
+    const acpi_madt_t *madt = (const acpi_madt_t *)acpi_find_table("APIC");
+    if (!madt) {
+        return -1;
+    }
+
+    // ISA IRQs are identity-mapped, edge-triggered, active-high by default
+    for (uint32_t irq = 0; irq < IRQ_COUNT; irq++) {
+        irq_gsi[irq] = irq;
+        irq_flags[irq] = (irq < IRQ_ISA_COUNT) ? 0 : (IOAPIC_RTE_LEVEL | IOAPIC_RTE_LOW_ACTIVE);
+        irq_routed[irq] = false;
+    }
+
+    uint64_t lapic_phys = irq_parse_madt(madt);
+    if (ioapic_count() == 0 || lapic_init(lapic_phys) != 0) {
+        return -1;
+    }
+
+    // GSIs taken over by an override (e.g. the PIT on GSI 2) are not
+    // also routed for the ISA IRQ of the same number
+    uint32_t claimed = 0;
+    for (uint32_t irq = 0; irq < IRQ_ISA_COUNT; irq++) {
+        if (irq_gsi[irq] != irq && irq_gsi[irq] < IRQ_ISA_COUNT) {
+            claimed |= 1u << irq_gsi[irq];
+        }
+    }
+
+    // Point every ISA IRQ at its vector on the boot CPU, masked
+    uint32_t boot_apic = lapic_id();
+    for (uint32_t irq = 0; irq < IRQ_ISA_COUNT; irq++) {
+        if (irq == IRQ_CASCADE || (claimed & (1u << irq))) {
+            continue;
+        }
+        if (ioapic_route(irq_gsi[irq], IRQ_BASE + irq, boot_apic,
+                         irq_flags[irq] | IOAPIC_RTE_MASKED) == 0) {
+            irq_routed[irq] = true;
+        }
+    }
+
+    isr_register_handler(LAPIC_SPURIOUS_VECTOR, irq_spurious_handler);
+    return 0;
+}
+
+/**
+ * Keep a vector out of irq_alloc_vectors()
+ */
+static void irq_reserve_vector(uint32_t vector) {
+    vector_reserved[vector / 64] |= 1ULL << (vector % 64);
+}
+
+/**
+ * Initialize interrupt routing
+ */
+irq_mode_t irq_init(void) {
+    // System vectors inside the dynamic window belong to their own stubs
+    irq_reserve_vector(INT_SYSCALL);
+    irq_reserve_vector(INT_RESCHED);
+
+    // Remap the PIC even if it will be disabled, so its spurious
+    // interrupts cannot land on exception vectors
+    pic_init(IRQ_BASE, IRQ_BASE + 8);
+
+    if (irq_init_apic() == 0) {
+        pic_disable();
+        irq_mode = IRQ_MODE_APIC;
+        vga_printf("  IRQ: APIC mode, %u CPU(s), PIC disabled\n", cpu_count);
+    } else {
+        irq_mode = IRQ_MODE_PIC;
+        cpu_count = 1;
+        vga_printf("  IRQ: No usable MADT, staying on the 8259 PIC\n");
+    }
+
+    return irq_mode;
+}
+
+/**
+ * Get the interrupt controller in use
+ */
+irq_mode_t irq_get_mode(void) {
+    return irq_mode;
+}
+
+/**
+ * Install the handler for an IRQ
+ */
+void irq_register_handler(uint8_t irq, isr_handler_t handler) {
+    if (irq < IRQ_COUNT) {
+        isr_register_handler(IRQ_BASE + irq, handler);
+    }
+}
+
+/**
+ * Acknowledge an IRQ
+ */
+void irq_eoi(uint8_t irq) {
+    if (irq_mode == IRQ_MODE_APIC) {
+        lapic_eoi();
+    } else {
+        pic_send_eoi(irq);
+    }
+}
+
+/**
+ * Mask an IRQ
+ */
+void irq_mask(uint8_t irq) {
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+
+    if (irq_mode == IRQ_MODE_APIC) {
+        if (irq_routed[irq]) {
+            ioapic_set_masked(irq_gsi[irq], true);
+        }
+    } else if (irq < IRQ_ISA_COUNT) {
+        pic_mask_irq(irq);
+    }
+}
+
+/**
+ * Unmask an IRQ
+ */
+void irq_unmask(uint8_t irq) {
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+
+    if (irq_mode == IRQ_MODE_PIC) {
+        if (irq < IRQ_ISA_COUNT) {
+            pic_unmask_irq(irq);
+        }
+        return;
+    }
+
+    // GSIs beyond the ISA range are routed on first use
+    if (!irq_routed[irq]) {
+        if (ioapic_route(irq_gsi[irq], IRQ_BASE + irq, lapic_id(), irq_flags[irq]) != 0) {
+            return;
+        }
+        irq_routed[irq] = true;
+        return;
+    }
+
+    ioapic_set_masked(irq_gsi[irq], false);
+}
+
+/**
+ * Steer an IRQ to a CPU
+ */
+int irq_set_affinity(uint8_t irq, uint32_t cpu) {
+    if (irq_mode != IRQ_MODE_APIC || irq >= IRQ_COUNT || cpu >= cpu_count) {
+        return -1;
+    }
+
+    if (!irq_routed[irq]) {
+        if (ioapic_route(irq_gsi[irq], IRQ_BASE + irq, cpu_apic_ids[cpu],
+                         irq_flags[irq] | IOAPIC_RTE_MASKED) != 0) {
+            return -1;
+        }
+        irq_routed[irq] = true;
+        return 0;
+    }
+
+    return ioapic_set_destination(irq_gsi[irq], cpu_apic_ids[cpu]);
+}
+
+/**
+ * Check whether a dynamic vector can be handed out
+ */
+static bool irq_vector_free(uint32_t vector) {
+    uint64_t bit = 1ULL << (vector % 64);
+    return !((vector_used[vector / 64] | vector_reserved[vector / 64]) & bit);
+}
+
+/**
+ * Allocate a block of interrupt vectors
+ */
+uint8_t irq_alloc_vectors(uint32_t count, uint32_t align) {
+    if (irq_mode != IRQ_MODE_APIC || count == 0 || align == 0 || (align & (align - 1))) {
+        return 0;
+    }
+
+    uint64_t flags = interrupts_save();
+
+    uint32_t first = (IRQ_VECTOR_DYN_FIRST + align - 1) & ~(align - 1);
+    for (; first + count - 1 <= IRQ_VECTOR_DYN_LAST; first += align) {
+        uint32_t n = 0;
+        while (n < count && irq_vector_free(first + n)) {
+            n++;
+        }
+        if (n < count) {
+            continue;
+        }
+
+        for (n = 0; n < count; n++) {
+            vector_used[(first + n) / 64] |= 1ULL << ((first + n) % 64);
+        }
+        interrupts_restore(flags);
+        return (uint8_t)first;
+    }
+
+    interrupts_restore(flags);
+    return 0;
+}
+
+/**
+ * Release vectors from irq_alloc_vectors
+ */
+void irq_free_vectors(uint8_t first, uint32_t count) {
+    uint64_t flags = interrupts_save();
+
+    for (uint32_t v = first; v < (uint32_t)first + count && v <= IRQ_VECTOR_DYN_LAST; v++) {
+        if (v >= IRQ_VECTOR_DYN_FIRST &&
+            !(vector_reserved[v / 64] & (1ULL << (v % 64)))) {
+            isr_unregister_handler(v);
+            vector_used[v / 64] &= ~(1ULL << (v % 64));
+        }
+    }
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Get the number of usable CPUs
+ */
+uint32_t irq_cpu_count(void) {
+    return cpu_count;
+}
+
+/**
+ * Get the local APIC ID of a CPU
+ */
+uint32_t irq_cpu_apic_id(uint32_t cpu) {
+    return cpu < cpu_count ? cpu_apic_ids[cpu] : 0;
+}
@@ -3,15 +3,42 @@
  */
 
 #include <kernel/isr.h>
+#include <kernel/printk.h>
+#include <kernel/serial.h>
 #include <kernel/idt.h>
+#include <kernel/softirq.h>
 #include <kernel/vga.h>
 #include <kernel/process.h>
+#include <kernel/vmm.h>
+#include <kernel/percpu.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 // ISR handler table
 static isr_handler_t interrupt_handlers[256] = {0};
 
+/**
+ * Per-CPU accounting for one vector
+ */
+typedef struct isr_counter {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t max_cycles;
+    uint64_t max_latency;
+    uint64_t last_entry;        // TSC at the previous entry (periodic vectors)
+} isr_counter_t;
+
+static isr_counter_t isr_counters[MAX_CPUS][256];
+
+// Expected TSC cycles between entries, 0 if not periodic
+static uint64_t isr_periods[256];
+
+// TSC when accounting started, for the IRQ share of CPU time
+static uint64_t isr_stats_start = 0;
+
 // Exception messages
 static const char *exception_messages[] = {
     "Division By Zero",
@@ -62,20 +89,99 @@ void isr_unregister_handler(uint8_t num) {
     interrupt_handlers[num] = NULL;
 }
 
+/**
+ * Declare a vector periodic
+ */
+void isr_set_period(uint8_t num, uint64_t cycles) {
+    isr_periods[num] = cycles;
+}
+
+/**
+ * Charge one handler run to a vector
+ *
+ * @param vector Interrupt number
+ * @param entry TSC at dispatch
+ * @param timed Whether the handler time is meaningful
+ */
+static inline void isr_account(uint32_t vector, uint64_t entry, bool timed) {
+    isr_counter_t *c = &isr_counters[cpu_id()][vector];
+    c->count++;
+
+    if (isr_periods[vector]) {
+        if (c->last_entry) {
+            uint64_t gap = entry - c->last_entry;
+            if (gap > isr_periods[vector] && gap - isr_periods[vector] > c->max_latency) {
+                c->max_latency = gap - isr_periods[vector];
+            }
+        }
+        c->last_entry = entry;
+    }
+
+    if (timed) {
+        uint64_t cycles = rdtsc() - entry;
+        c->cycles += cycles;
+        if (cycles > c->max_cycles) {
+            c->max_cycles = cycles;
+        }
+    }
+}
+
+/**
+ * Hardware interrupt handler
+ *
+ * Called from irq_common_stub with a partial frame: the callee-saved
+ * register slots are not filled in.
+ *
+ * @return 0 to take the fast exit, nonzero if the stub must complete the
+ *         frame and call hardirq_exit()
+ */
+int irq_common_handler(registers_t *regs) {
+    uint64_t entry = rdtsc();
+    uint32_t vector = (uint32_t)regs->int_no;
+
+    hardirq_enter();
+    if (interrupt_handlers[vector] != NULL) {
+        interrupt_handlers[vector](regs);
+    } else {
+        vga_printf("Unhandled interrupt: %u\n", vector);
+    }
+    isr_account(vector, entry, true);
+
+    return hardirq_exit_fast() ? 0 : 1;
+}
+
 /**
  * Common interrupt handler
  *
  * Called from assembly ISR stubs.
  */
 void isr_common_handler(registers_t *regs) {
+    uint64_t entry = rdtsc();
+    uint32_t vector = (uint32_t)regs->int_no;
+
     // Check if we have a custom handler
-    if (interrupt_handlers[regs->int_no] != NULL) {
-        interrupt_handlers[regs->int_no](regs);
+    if (interrupt_handlers[vector] != NULL) {
+        interrupt_handlers[vector](regs);
+        isr_account(vector, entry, vector != INT_SYSCALL);
         return;
     }
 
+    // Pages the VMM can bring back (swapped out) are not errors
+    if (vector == EXCEPTION_PAGE_FAULT) {
+        uint64_t faulting_address;
+        __asm__ volatile("mov %%cr2, %0" : "=r"(faulting_address));
+        if (vmm_handle_page_fault(faulting_address, regs->err_code) == 0) {
+            isr_account(vector, entry, true);
+            return;
+        }
+    }
+
     // Handle CPU exceptions
     if (regs->int_no < 32) {
+        // Get buffered log messages out before the machine stops
+        serial_enter_polled_mode(SERIAL_PANIC_BAUD);
+        printk_flush();
+
         vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_RED << 4));
         vga_printf("\n\n*** CPU EXCEPTION: %s ***\n", exception_messages[regs->int_no]);
         vga_printf("Interrupt: %u, Error Code: 0x%x\n", regs->int_no, regs->err_code);
@@ -153,9 +259,79 @@ void isr_init(void) {
     idt_set_gate(46, (uint64_t)irq14, IDT_TYPE_INTERRUPT);
     idt_set_gate(47, (uint64_t)irq15, IDT_TYPE_INTERRUPT);
 
+    // Install generic stubs (48-255) for APIC, MSI and IPI vectors
+    for (int vec = ISR_VECTOR_STUB_BASE; vec < 256; vec++) {
+        uint64_t stub = vector_stub_table[vec - ISR_VECTOR_STUB_BASE];
+        if (stub) {
+            idt_set_gate((uint8_t)vec, stub, IDT_TYPE_INTERRUPT);
+        }
+    }
+
     // Install syscall handler
     idt_set_gate(0x80, (uint64_t)isr128, IDT_TYPE_USER_INT);
 
     vga_printf("  ISR: Registered %u exception handlers\n", 32);
     vga_printf("  ISR: Registered %u IRQ handlers\n", 16);
+    vga_printf("  ISR: Registered %u generic vector stubs\n", 256 - ISR_VECTOR_STUB_BASE - 1);
+
+    isr_stats_start = rdtsc();
+}
+
+/**
+ * Copy statistics for every vector that has fired
+ */
+uint32_t isr_get_stats(isr_stat_t *buf, uint32_t max) {
+    uint32_t n = 0;
+
+    for (uint32_t vector = 0; vector < 256 && n < max; vector++) {
+        isr_stat_t stat = { .vector = vector };
+
+        for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+            const isr_counter_t *c = &isr_counters[cpu][vector];
+            stat.count += c->count;
+            stat.cycles += c->cycles;
+            if (c->max_cycles > stat.max_cycles) stat.max_cycles = c->max_cycles;
+            if (c->max_latency > stat.max_latency) stat.max_latency = c->max_latency;
+        }
+
+        if (stat.count) {
+            buf[n++] = stat;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Print interrupt statistics
+ */
+void isr_print_stats(void) {
+    static isr_stat_t stats[256];
+    uint32_t n = isr_get_stats(stats, 256);
+
+    uint64_t khz = timer_get_tsc_khz();
+    uint64_t elapsed = rdtsc() - isr_stats_start;
+    uint64_t irq_cycles = 0;
+
+    vga_printf("\nInterrupt Statistics:\n");
+    vga_printf("  Vec  Count       Avg(cyc)  Max(us)  Late(us)\n");
+
+    for (uint32_t i = 0; i < n; i++) {
+        const isr_stat_t *st = &stats[i];
+        uint64_t avg = st->cycles / st->count;
+        uint32_t max_us = khz ? (uint32_t)(st->max_cycles * 1000 / khz) : 0;
+        uint32_t late_us = khz ? (uint32_t)(st->max_latency * 1000 / khz) : 0;
+
+        vga_printf("  %u  %u  %u  %u  %u\n", st->vector, (uint32_t)st->count,
+                   (uint32_t)avg, max_us, late_us);
+
+        if (st->vector >= IRQ_BASE && st->vector != INT_SYSCALL && st->vector != INT_RESCHED) {
+            irq_cycles += st->cycles;
+        }
+    }
+
+    if (elapsed) {
+        uint32_t permille = (uint32_t)(irq_cycles * 1000 / elapsed);
+        vga_printf("  IRQ handlers: %u.%u%% of CPU time\n", permille / 10, permille % 10);
+    }
 }
@@ -0,0 +1,189 @@
+/**
+ * Local APIC Implementation
+ */
+
+#include <kernel/apic.h>
+#include <kernel/msr.h>
+#include <kernel/vmm.h>
+#include <kernel/vga.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// CPUID.1 feature bits
+#define CPUID_EDX_APIC      (1 << 9)
+#define CPUID_ECX_X2APIC    (1 << 21)
+
+// Register window (xAPIC mode)
+static volatile uint32_t *lapic_base = NULL;
+
+static bool x2apic = false;
+static bool enabled = false;
+
+/**
+ * Read a local APIC register
+ */
+static inline uint32_t lapic_read(uint32_t reg) {
+    if (x2apic) {
+        return (uint32_t)rdmsr(X2APIC_MSR_BASE + (reg >> 4));
+    }
+    return lapic_base[reg / 4];
+}
+
+/**
+ * Write a local APIC register
+ */
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    if (x2apic) {
+        wrmsr(X2APIC_MSR_BASE + (reg >> 4), value);
+        return;
+    }
+    lapic_base[reg / 4] = value;
+}
+
+/**
+ * Initialize the local APIC of the current CPU
+ */
+int lapic_init(uint64_t phys) {
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_EDX_APIC)) {
+        return -1;
+    }
+
+    uint64_t base = rdmsr(MSR_IA32_APIC_BASE);
+    if (phys == 0) {
+        phys = base & APIC_BASE_ADDR_MASK;
+    }
+
+    // xAPIC must be enabled before switching to x2APIC
+    base |= APIC_BASE_ENABLE;
+    wrmsr(MSR_IA32_APIC_BASE, base);
+
+    if (ecx & CPUID_ECX_X2APIC) {
+        // x2APIC: registers become MSRs, EOI is a single wrmsr
+        wrmsr(MSR_IA32_APIC_BASE, base | APIC_BASE_X2APIC);
+        x2apic = true;
+    } else {
+        uint64_t virt = vmm_map_mmio(phys, 0x1000);
+        if (virt == 0) {
+            return -1;
+        }
+        lapic_base = (volatile uint32_t *)virt;
+    }
+
+    // Accept all priorities, mask the local interrupt pins
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+
+    // Clear stale errors (ESR needs a write before it can be read)
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_ESR, 0);
+
+    // Software-enable with the spurious vector
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_eoi();
+
+    enabled = true;
+    vga_printf("  LAPIC: ID %u, version 0x%x, %s mode\n", lapic_id(),
+               lapic_read(LAPIC_REG_VERSION) & 0xFF, x2apic ? "x2APIC" : "xAPIC");
+    return 0;
+}
+
+/**
+ * Check whether the local APIC is up
+ */
+bool lapic_enabled(void) {
+    return enabled;
+}
+
+/**
+ * Check for x2APIC mode
+ */
+bool lapic_x2apic(void) {
+    return x2apic;
+}
+
+/**
+ * Get the APIC ID of the current CPU
+ */
+uint32_t lapic_id(void) {
+    uint32_t id = lapic_read(LAPIC_REG_ID);
+    return x2apic ? id : id >> 24;
+}
+
+/**
+ * Signal end of interrupt
+ */
+void lapic_eoi(void) {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/**
+ * Program a local vector table entry
+ */
+void lapic_set_lvt(uint32_t reg, uint32_t value) {
+    lapic_write(reg, value);
+}
+
+/**
+ * Measure the local APIC timer rate against the TSC
+ */
+uint32_t lapic_timer_calibrate(void) {
+    uint64_t tsc_khz = timer_get_tsc_khz();
+    if (!enabled || tsc_khz == 0) {
+        return 0;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFF);
+
+    // Count down for 10 ms of TSC time
+    uint64_t end = rdtsc() + tsc_khz * 10;
+    while (rdtsc() < end) {
+        __asm__ volatile("pause");
+    }
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_REG_TIMER_CURRENT);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    return elapsed / 10;
+}
+
+/**
+ * Start the local APIC timer
+ */
+void lapic_timer_start(uint8_t vector, uint32_t count, bool periodic) {
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, vector | (periodic ? LAPIC_LVT_PERIODIC : 0));
+    lapic_write(LAPIC_REG_TIMER_INIT, count);
+}
+
+/**
+ * Stop the local APIC timer
+ */
+void lapic_timer_stop(void) {
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+}
+
+/**
+ * Send an inter-processor interrupt
+ */
+void lapic_send_ipi(uint32_t apic_id, uint32_t icr) {
+    if (x2apic) {
+        // One 64-bit write: destination in the high half
+        wrmsr(X2APIC_MSR_BASE + (LAPIC_REG_ICR_LOW >> 4), ((uint64_t)apic_id << 32) | icr);
+        return;
+    }
+
+    lapic_write(LAPIC_REG_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, icr);
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING) {
+        __asm__ volatile("pause");
+    }
+}
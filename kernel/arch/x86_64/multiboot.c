@@ -0,0 +1,177 @@
+/**
+ * Multiboot2 Boot Information Implementation
+ */
+
+#include <kernel/multiboot.h>
+#include <kernel/memblock.h>
+#include <kernel/vmm.h>
+#include <kernel/string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Saved framebuffer
+static multiboot_framebuffer_t framebuffer;
+static bool have_framebuffer = false;
+
+// Saved command line
+static char cmdline[MULTIBOOT_CMDLINE_MAX];
+
+// Saved ACPI RSDP
+static uint8_t rsdp[MULTIBOOT_RSDP_MAX];
+static bool have_rsdp = false;
+
+/**
+ * Save the framebuffer tag if it describes a direct RGB framebuffer
+ */
+static void multiboot_parse_framebuffer(const multiboot_tag_framebuffer_t *tag) {
+    if (tag->fb_type != MULTIBOOT_FB_TYPE_RGB || tag->bpp != 32) {
+        return;     // Only 32bpp direct color is supported
+    }
+
+    framebuffer.addr = tag->addr;
+    framebuffer.pitch = tag->pitch;
+    framebuffer.width = tag->width;
+    framebuffer.height = tag->height;
+    framebuffer.bpp = tag->bpp;
+    framebuffer.red_pos = tag->red_pos;
+    framebuffer.red_size = tag->red_size;
+    framebuffer.green_pos = tag->green_pos;
+    framebuffer.green_size = tag->green_size;
+    framebuffer.blue_pos = tag->blue_pos;
+    framebuffer.blue_size = tag->blue_size;
+    have_framebuffer = true;
+}
+
+/**
+ * Hand the usable ranges of the memory map to memblock
+ */
+static void multiboot_parse_mmap(const multiboot_tag_mmap_t *tag) {
+    const uint8_t *entry = (const uint8_t *)tag + sizeof(multiboot_tag_mmap_t);
+    const uint8_t *end = (const uint8_t *)tag + tag->size;
+
+    if (tag->entry_size < sizeof(multiboot_mmap_entry_t)) {
+        return;
+    }
+
+    for (; entry + tag->entry_size <= end; entry += tag->entry_size) {
+        const multiboot_mmap_entry_t *range = (const multiboot_mmap_entry_t *)entry;
+        if (range->type == MULTIBOOT_MEMORY_AVAILABLE) {
+            memblock_add(range->addr, range->len);
+        }
+    }
+}
+
+/**
+ * Parse the multiboot2 information structure
+ */
+int multiboot_init(uint64_t info_phys, uint32_t magic) {
+    if (magic != MULTIBOOT2_BOOTLOADER_MAGIC || info_phys == 0) {
+        return -1;
+    }
+
+    // Fixed part: total_size, reserved; tags follow 8-byte aligned
+    const uint8_t *info = (const uint8_t *)vmm_phys_to_virt(info_phys);
+    uint32_t total_size = *(const uint32_t *)info;
+    const uint8_t *end = info + total_size;
+    const uint8_t *p = info + 8;
+
+    while (p + sizeof(multiboot_tag_t) <= end) {
+        const multiboot_tag_t *tag = (const multiboot_tag_t *)p;
+        if (tag->type == MULTIBOOT_TAG_END) {
+            break;
+        }
+
+        switch (tag->type) {
+            case MULTIBOOT_TAG_CMDLINE:
+                strncpy(cmdline, (const char *)(p + 8), MULTIBOOT_CMDLINE_MAX - 1);
+                cmdline[MULTIBOOT_CMDLINE_MAX - 1] = '\0';
+                break;
+
+            case MULTIBOOT_TAG_ACPI_OLD:
+            case MULTIBOOT_TAG_ACPI_NEW: {
+                // Prefer the ACPI 2.0 copy when both are present
+                if (have_rsdp && tag->type == MULTIBOOT_TAG_ACPI_OLD) {
+                    break;
+                }
+                uint32_t len = tag->size - 8;
+                if (len > MULTIBOOT_RSDP_MAX) len = MULTIBOOT_RSDP_MAX;
+                memcpy(rsdp, p + 8, len);
+                have_rsdp = true;
+                break;
+            }
+
+            case MULTIBOOT_TAG_MMAP:
+                multiboot_parse_mmap((const multiboot_tag_mmap_t *)p);
+                break;
+
+            case MULTIBOOT_TAG_FRAMEBUFFER:
+                multiboot_parse_framebuffer((const multiboot_tag_framebuffer_t *)p);
+                break;
+
+            default:
+                break;
+        }
+
+        p += (tag->size + 7) & ~7u;
+    }
+
+    return 0;
+}
+
+/**
+ * Get the linear framebuffer
+ */
+const multiboot_framebuffer_t *multiboot_get_framebuffer(void) {
+    return have_framebuffer ? &framebuffer : NULL;
+}
+
+/**
+ * Get the ACPI RSDP copy
+ */
+const void *multiboot_get_rsdp(void) {
+    return have_rsdp ? rsdp : NULL;
+}
+
+/**
+ * Get the kernel command line
+ */
+const char *multiboot_get_cmdline(void) {
+    return cmdline;
+}
+
+/**
+ * Look up a command line option
+ */
+bool multiboot_cmdline_option(const char *name, char *value, size_t size) {
+    size_t len = strlen(name);
+    const char *p = cmdline;
+
+    while (*p) {
+        while (*p == ' ') {
+            p++;
+        }
+
+        const char *word = p;
+        while (*p && *p != ' ') {
+            p++;
+        }
+
+        if (strncmp(word, name, len) != 0 || (word + len != p && word[len] != '=')) {
+            continue;
+        }
+
+        if (value && size) {
+            const char *v = (word + len == p) ? p : word + len + 1;
+            size_t n = (size_t)(p - v);
+            if (n >= size) {
+                n = size - 1;
+            }
+            memcpy(value, v, n);
+            value[n] = '\0';
+        }
+        return true;
+    }
+
+    return false;
+}
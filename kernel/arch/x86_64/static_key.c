@@ -0,0 +1,84 @@
+/**
+ * Static Key Patching
+ *
+ * Rewrites static_key_false() sites between a 5-byte NOP and a
+ * "jmp rel32". Kernel text is identity-mapped writable, so sites are
+ * patched in place; the JMP always fits because the whole kernel image
+ * lies within the first gigabyte.
+ */
+
+#include <kernel/static_key.h>
+#include <kernel/idt.h>
+#include <kernel/string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Recorded patch sites, collected by the linker
+extern jump_entry_t _jump_table_start[];
+extern jump_entry_t _jump_table_end[];
+
+#define OPCODE_JMP_REL32 0xE9
+
+static const uint8_t nop5[STATIC_KEY_INSN_SIZE] = { 0x0F, 0x1F, 0x44, 0x00, 0x00 };
+
+/**
+ * Serialize instruction fetch after modifying code
+ */
+static inline void sync_core(void) {
+    uint32_t eax = 0, ebx, ecx = 0, edx;
+    __asm__ volatile("cpuid"
+                     : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx)
+                     :
+                     : "memory");
+}
+
+/**
+ * Point every site of a key at its target or back at the NOP
+ */
+static void static_key_patch(static_key_t *key, bool enable) {
+    uint64_t flags = interrupts_save();
+
+    for (jump_entry_t *entry = _jump_table_start; entry < _jump_table_end; entry++) {
+        if (entry->key != (uint64_t)key) {
+            continue;
+        }
+
+        uint8_t insn[STATIC_KEY_INSN_SIZE];
+        if (enable) {
+            int32_t rel = (int32_t)(entry->target - (entry->code + STATIC_KEY_INSN_SIZE));
+            insn[0] = OPCODE_JMP_REL32;
+            memcpy(&insn[1], &rel, sizeof(rel));
+        } else {
+            memcpy(insn, nop5, sizeof(insn));
+        }
+
+        memcpy((void *)entry->code, insn, sizeof(insn));
+    }
+
+    sync_core();
+    interrupts_restore(flags);
+}
+
+/**
+ * Turn a key on
+ */
+void static_key_enable(static_key_t *key) {
+    if (key->enabled) {
+        return;
+    }
+
+    key->enabled = 1;
+    static_key_patch(key, true);
+}
+
+/**
+ * Turn a key off
+ */
+void static_key_disable(static_key_t *key) {
+    if (!key->enabled) {
+        return;
+    }
+
+    key->enabled = 0;
+    static_key_patch(key, false);
+}
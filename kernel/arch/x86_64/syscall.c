@@ -13,6 +13,8 @@
 #include <kernel/vga.h>
 #include <kernel/string.h>
 #include <kernel/vfs.h>
+#include <kernel/pipe.h>
+#include <kernel/trace.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -37,6 +39,8 @@ void syscall_register(uint32_t num, syscall_handler_t handler) {
 void syscall_dispatcher(registers_t *regs) {
     uint64_t syscall_num = regs->rax;
 
+    trace_syscall_enter(syscall_num, regs->rdi, regs->rsi, regs->rdx);
+
     // Check if syscall number is valid
     if (syscall_num >= SYSCALL_COUNT) {
         regs->rax = (uint64_t)-1;  // Return -1 for invalid syscall
@@ -52,6 +56,8 @@ void syscall_dispatcher(registers_t *regs) {
     // Call the syscall handler
     int64_t result = syscall_table[syscall_num](regs);
 
+    trace_syscall_exit(syscall_num, result);
+
     // Store result in rax
     regs->rax = (uint64_t)result;
 }
@@ -82,20 +88,13 @@ static int64_t sys_exit_handler(registers_t *regs) {
  * Returns: Number of bytes written, or -1 on error
  */
 int64_t sys_write(int fd, const char *buf, size_t count) {
-    // For now, only support stdout (fd 1) and stderr (fd 2)
-    if (fd != 1 && fd != 2) {
-        return -1;  // Invalid file descriptor
-    }
-
     // TODO: Validate user pointer
-    // For now, assume it's valid
-
-    // Write to VGA console
-    for (size_t i = 0; i < count; i++) {
-        vga_putchar(buf[i]);
+    if (!buf) {
+        return -1;
     }
 
-    return (int64_t)count;
+    // stdout and stderr are /dev/console descriptors opened at boot
+    return (int64_t)vfs_write(fd, buf, count);
 }
 
 static int64_t sys_write_handler(registers_t *regs) {
@@ -246,13 +245,16 @@ static int64_t sys_putchar_handler(registers_t *regs) {
 }
 
 /**
- * sys_getchar - Read single character from keyboard
+ * sys_getchar - Read single character from stdin
  *
  * Returns: Character code, or -1 if no input
  */
 int64_t sys_getchar(void) {
-    // TODO: Implement keyboard input buffer
-    return -1;
+    char c;
+    if (vfs_read(0, &c, 1) != 1) {
+        return -1;
+    }
+    return (int64_t)(uint8_t)c;
 }
 
 static int64_t sys_getchar_handler(registers_t *regs) {
@@ -260,6 +262,96 @@ static int64_t sys_getchar_handler(registers_t *regs) {
     return sys_getchar();
 }
 
+/**
+ * sys_getdents - Read directory entries in bulk
+ *
+ * Arguments:
+ *   rdi = fd (open directory)
+ *   rsi = buf (receives packed vfs_dirent64_t records)
+ *   rdx = count (buffer size in bytes)
+ *
+ * Returns: Bytes written, 0 at end of directory, or -1 on error
+ */
+int64_t sys_getdents(int fd, void *buf, size_t count) {
+    // TODO: Validate user pointer
+    if (!buf) {
+        return -1;
+    }
+
+    return (int64_t)vfs_getdents(fd, buf, count);
+}
+
+static int64_t sys_getdents_handler(registers_t *regs) {
+    return sys_getdents((int)regs->rdi, (void *)regs->rsi, (size_t)regs->rdx);
+}
+
+/**
+ * sys_pipe - Create an anonymous pipe
+ *
+ * Arguments:
+ *   rdi = fds (int[2], receives read end then write end)
+ *
+ * Returns: 0 on success, -1 on error
+ */
+int64_t sys_pipe(int *fds) {
+    // TODO: Validate user pointer
+    if (!fds) {
+        return -1;
+    }
+
+    return (int64_t)pipe_create(&fds[0], &fds[1]);
+}
+
+static int64_t sys_pipe_handler(registers_t *regs) {
+    return sys_pipe((int *)regs->rdi);
+}
+
+/**
+ * sys_mkfifo - Create a named FIFO
+ *
+ * Arguments:
+ *   rdi = path
+ *
+ * Returns: 0 on success, -1 on error
+ */
+int64_t sys_mkfifo(const char *path) {
+    // TODO: Validate user pointer
+    if (!path) {
+        return -1;
+    }
+
+    return (int64_t)pipe_mkfifo(path);
+}
+
+static int64_t sys_mkfifo_handler(registers_t *regs) {
+    return sys_mkfifo((const char *)regs->rdi);
+}
+
+/**
+ * sys_irqstats - Get per-vector interrupt statistics
+ *
+ * Arguments:
+ *   rdi = buf (isr_stat_t array)
+ *   rsi = count (capacity of buf, in entries)
+ *
+ * Returns: Number of entries written, or -1 on error
+ */
+int64_t sys_irqstats(isr_stat_t *buf, size_t count) {
+    // TODO: Validate user pointer
+    if (!buf) {
+        return -1;
+    }
+
+    if (count > 256) {
+        count = 256;
+    }
+    return (int64_t)isr_get_stats(buf, (uint32_t)count);
+}
+
+static int64_t sys_irqstats_handler(registers_t *regs) {
+    return sys_irqstats((isr_stat_t *)regs->rdi, (size_t)regs->rsi);
+}
+
 /**
  * Initialize system call subsystem
  */
@@ -281,6 +373,10 @@ void syscall_init(void) {
     syscall_register(SYS_TIME, sys_time_handler);
     syscall_register(SYS_PUTCHAR, sys_putchar_handler);
     syscall_register(SYS_GETCHAR, sys_getchar_handler);
+    syscall_register(SYS_GETDENTS, sys_getdents_handler);
+    syscall_register(SYS_PIPE, sys_pipe_handler);
+    syscall_register(SYS_MKFIFO, sys_mkfifo_handler);
+    syscall_register(SYS_IRQSTATS, sys_irqstats_handler);
 
     // Register syscall dispatcher with interrupt 0x80
     isr_register_handler(0x80, syscall_dispatcher);
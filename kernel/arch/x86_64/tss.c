@@ -6,6 +6,8 @@
  * - Interrupt Stack Table (IST) for critical interrupts
  */
 
+#include <kernel/tss.h>
+#include <kernel/percpu.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -22,24 +24,36 @@ typedef struct tss {
     uint16_t iomap_base;    // I/O permission bitmap
 } __attribute__((packed)) tss_t;
 
-// Global TSS
-static tss_t kernel_tss;
+// One TSS per CPU
+static tss_t cpu_tss[MAX_CPUS];
 
-// Kernel stack for interrupt handling (16KB)
-static uint8_t interrupt_stack[16384] __attribute__((aligned(16)));
+// Kernel stack for interrupt handling (16KB per CPU)
+static uint8_t interrupt_stack[MAX_CPUS][16384] __attribute__((aligned(16)));
+
+// Dedicated stacks for #DF, NMI and #MC, indexed by IST slot - 1
+static uint8_t ist_stacks[MAX_CPUS][IST_COUNT][IST_STACK_SIZE] __attribute__((aligned(16)));
 
 /**
  * Initialize TSS
  */
 void tss_init(void) {
     // Clear TSS
-    memset(&kernel_tss, 0, sizeof(tss_t));
+    memset(cpu_tss, 0, sizeof(cpu_tss));
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        tss_t *tss = &cpu_tss[cpu];
 
-    // Set kernel stack pointer (RSP0) - stack grows down
-    kernel_tss.rsp0 = (uint64_t)interrupt_stack + sizeof(interrupt_stack);
+        // Set kernel stack pointer (RSP0) - stack grows down
+        tss->rsp0 = (uint64_t)interrupt_stack[cpu] + sizeof(interrupt_stack[cpu]);
 
-    // Set I/O map base beyond TSS limit (no I/O permission bitmap)
-    kernel_tss.iomap_base = sizeof(tss_t);
+        // IST entries are numbered from 1; slot 0 in a gate means "no switch"
+        for (uint32_t ist = 1; ist <= IST_COUNT; ist++) {
+            tss->ist[ist - 1] = tss_get_ist_stack(cpu, ist);
+        }
+
+        // Set I/O map base beyond TSS limit (no I/O permission bitmap)
+        tss->iomap_base = sizeof(tss_t);
+    }
 
     // Load TSS into GDT and TR register
     // The TSS descriptor should be in the GDT at index 5
@@ -50,14 +64,24 @@ void tss_init(void) {
  * Set kernel stack for interrupts from user mode
  */
 void tss_set_kernel_stack(uint64_t stack) {
-    kernel_tss.rsp0 = stack;
+    cpu_tss[cpu_id()].rsp0 = stack;
+}
+
+/**
+ * Get the top of an IST stack
+ */
+uint64_t tss_get_ist_stack(uint32_t cpu, uint32_t ist) {
+    if (cpu >= MAX_CPUS || ist == 0 || ist > IST_COUNT) {
+        return 0;
+    }
+    return (uint64_t)ist_stacks[cpu][ist - 1] + IST_STACK_SIZE;
 }
 
 /**
  * Get TSS address for GDT
  */
 uint64_t tss_get_address(void) {
-    return (uint64_t)&kernel_tss;
+    return (uint64_t)&cpu_tss[cpu_id()];
 }
 
 /**
@@ -0,0 +1,172 @@
+/**
+ * In-Kernel Benchmark Runner
+ */
+
+#include <kernel/kbench.h>
+#include <kernel/timer.h>
+#include <kernel/serial.h>
+#include <kernel/port.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Case table, collected by the linker
+extern const kbench_case_t _kbench_start[];
+extern const kbench_case_t _kbench_end[];
+
+// Per-iteration cycle counts of the case being run
+static uint64_t samples[KBENCH_MAX_ITERATIONS];
+
+/**
+ * Read the TSC once earlier instructions have completed
+ */
+static inline uint64_t kbench_tsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("lfence; rdtsc" : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Restore the heap property below index i
+ */
+static void kbench_sift_down(uint64_t *a, uint32_t i, uint32_t n) {
+    while (1) {
+        uint32_t largest = i;
+        uint32_t left = 2 * i + 1;
+        uint32_t right = left + 1;
+
+        if (left < n && a[left] > a[largest]) largest = left;
+        if (right < n && a[right] > a[largest]) largest = right;
+        if (largest == i) {
+            return;
+        }
+
+        uint64_t tmp = a[i];
+        a[i] = a[largest];
+        a[largest] = tmp;
+        i = largest;
+    }
+}
+
+/**
+ * Sort samples in ascending order (heapsort, no extra memory)
+ */
+static void kbench_sort(uint64_t *a, uint32_t n) {
+    for (uint32_t i = n / 2; i > 0; i--) {
+        kbench_sift_down(a, i - 1, n);
+    }
+    for (uint32_t end = n; end > 1; end--) {
+        uint64_t tmp = a[0];
+        a[0] = a[end - 1];
+        a[end - 1] = tmp;
+        kbench_sift_down(a, 0, end - 1);
+    }
+}
+
+/**
+ * Measure the cost of the timing itself
+ */
+static uint64_t kbench_overhead(void) {
+    for (uint32_t i = 0; i < KBENCH_MAX_ITERATIONS; i++) {
+        uint64_t start = kbench_tsc();
+        samples[i] = kbench_tsc() - start;
+    }
+    kbench_sort(samples, KBENCH_MAX_ITERATIONS);
+    return samples[KBENCH_MAX_ITERATIONS / 2];
+}
+
+/**
+ * Time one case
+ */
+static void kbench_measure(const kbench_case_t *bench, uint64_t overhead, kbench_result_t *result) {
+    uint32_t n = bench->iterations;
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < KBENCH_WARMUP; i++) {
+        bench->run(i);
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t start = kbench_tsc();
+        bench->run(i);
+        uint64_t cycles = kbench_tsc() - start;
+        samples[i] = cycles > overhead ? cycles - overhead : 0;
+        total += samples[i];
+    }
+
+    kbench_sort(samples, n);
+
+    result->min = samples[0];
+    result->median = samples[n / 2];
+    result->p99 = samples[(n * 99) / 100];
+    result->max = samples[n - 1];
+    result->mean = total / n;
+}
+
+/**
+ * Write one line to the serial port
+ */
+static void kbench_emit(const char *line) {
+    serial_write(line, strlen(line));
+}
+
+/**
+ * Run every registered case
+ */
+uint32_t kbench_run_all(void) {
+    char line[192];
+    uint32_t count = (uint32_t)(_kbench_end - _kbench_start);
+    uint32_t passed = 0;
+    uint32_t skipped = 0;
+
+    uint64_t overhead = kbench_overhead();
+
+    snprintf(line, sizeof(line), "KBENCH-BEGIN {\"tsc_khz\":%lu,\"overhead\":%lu,\"cases\":%u}\n",
+             timer_get_tsc_khz(), overhead, count);
+    kbench_emit(line);
+
+    vga_printf("  %u benchmarks, %u cycles timing overhead removed\n", count, (uint32_t)overhead);
+
+    for (const kbench_case_t *bench = _kbench_start; bench < _kbench_end; bench++) {
+        if (bench->iterations == 0 || bench->iterations > KBENCH_MAX_ITERATIONS ||
+            (bench->setup && bench->setup() != 0)) {
+            snprintf(line, sizeof(line), "KBENCH {\"name\":\"%s\",\"skipped\":true}\n", bench->name);
+            kbench_emit(line);
+            vga_printf("  %s: skipped\n", bench->name);
+            skipped++;
+            continue;
+        }
+
+        kbench_result_t result;
+        kbench_measure(bench, overhead, &result);
+
+        if (bench->teardown) {
+            bench->teardown();
+        }
+
+        snprintf(line, sizeof(line),
+                 "KBENCH {\"name\":\"%s\",\"iterations\":%u,\"min\":%lu,\"median\":%lu,"
+                 "\"p99\":%lu,\"max\":%lu,\"mean\":%lu}\n",
+                 bench->name, bench->iterations, result.min, result.median,
+                 result.p99, result.max, result.mean);
+        kbench_emit(line);
+
+        vga_printf("  %s: min %u, median %u, p99 %u, max %u cycles\n", bench->name,
+                   (uint32_t)result.min, (uint32_t)result.median,
+                   (uint32_t)result.p99, (uint32_t)result.max);
+        passed++;
+    }
+
+    snprintf(line, sizeof(line), "KBENCH-END {\"passed\":%u,\"skipped\":%u}\n", passed, skipped);
+    kbench_emit(line);
+
+    return passed;
+}
+
+/**
+ * Leave QEMU through the isa-debug-exit device
+ */
+void kbench_exit(uint8_t code) {
+    outb(KBENCH_EXIT_PORT, code);
+}
@@ -0,0 +1,284 @@
+/**
+ * In-Kernel Benchmark Cases
+ *
+ * Hot paths of the memory manager, scheduler, syscall and interrupt
+ * entry, block layer, VFS and small-file reads, plus the cost of a
+ * disabled tracepoint.
+ */
+
+#include <kernel/kbench.h>
+#include <kernel/pmm.h>
+#include <kernel/heap.h>
+#include <kernel/vmm.h>
+#include <kernel/memory.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/syscall.h>
+#include <kernel/isr.h>
+#include <kernel/idt.h>
+#include <kernel/block.h>
+#include <kernel/vfs.h>
+#include <kernel/simplefs.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <kernel/trace.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Physical memory: one page in, one page out
+ */
+KBENCH(pmm_alloc_free, 10000, NULL, NULL) {
+    uint64_t page = pmm_alloc_page();
+    if (page) {
+        pmm_free_page(page);
+    }
+}
+
+/**
+ * Kernel heap: small allocation
+ */
+KBENCH(kmalloc_kfree, 10000, NULL, NULL) {
+    kfree(kmalloc(64));
+}
+
+/**
+ * Page tables: map and unmap one 4KB page (includes the invlpg)
+ */
+static uint64_t map_phys;
+
+static int map_setup(void) {
+    map_phys = pmm_alloc_page();
+    return map_phys ? 0 : -1;
+}
+
+static void map_teardown(void) {
+    pmm_free_page(map_phys);
+}
+
+KBENCH(map_unmap, 10000, map_setup, map_teardown) {
+    vmm_map_page(KBENCH_MAP_VIRT, map_phys, PAGE_FLAGS_KERNEL);
+    vmm_unmap_page(KBENCH_MAP_VIRT);
+}
+
+/**
+ * Scheduler: yield to a partner task and back (two switches)
+ */
+static volatile bool partner_running;
+
+static void partner_task(void) {
+    while (partner_running) {
+        scheduler_yield();
+    }
+    process_exit(0);
+}
+
+static int switch_setup(void) {
+    if (!scheduler_is_running()) {
+        return -1;
+    }
+
+    process_t *partner = process_create_kernel_task(partner_task, "kbench-peer", 0);
+    if (!partner) {
+        return -1;
+    }
+
+    partner_running = true;
+    scheduler_add_process(partner);
+    return 0;
+}
+
+static void switch_teardown(void) {
+    partner_running = false;
+    scheduler_yield();
+}
+
+KBENCH(context_switch, 10000, switch_setup, switch_teardown) {
+    scheduler_yield();
+}
+
+/**
+ * System call gate: getpid from ring 0
+ */
+KBENCH(null_syscall, 10000, NULL, NULL) {
+    uint64_t ret = SYS_GETPID;
+    __asm__ volatile("int %1" : "+a"(ret) : "i"(INT_SYSCALL) : "memory");
+}
+
+/**
+ * Interrupt entry: software interrupt through the IRQ stub
+ */
+static void nop_handler(registers_t *regs) {
+    (void)regs;
+}
+
+static int irq_setup(void) {
+    isr_register_handler(INT_NOP, nop_handler);
+    return 0;
+}
+
+static void irq_teardown(void) {
+    isr_unregister_handler(INT_NOP);
+}
+
+KBENCH(irq_roundtrip, 10000, irq_setup, irq_teardown) {
+    __asm__ volatile("int %0" :: "i"(INT_NOP) : "memory");
+}
+
+/**
+ * Block layer: 4KB reads walking the first megabyte of hda
+ */
+#define BLOCK_BENCH_SIZE 4096
+
+static block_device_t *bench_disk;
+static void *bench_buffer;
+
+static int block_setup(void) {
+    bench_disk = block_get_device("hda");
+    if (!bench_disk) {
+        return -1;
+    }
+
+    bench_buffer = kmalloc(BLOCK_BENCH_SIZE);
+    return bench_buffer ? 0 : -1;
+}
+
+static void block_teardown(void) {
+    kfree(bench_buffer);
+}
+
+KBENCH(block_read_4k, 1000, block_setup, block_teardown) {
+    uint64_t offset = (uint64_t)(iteration % 256) * BLOCK_BENCH_SIZE;
+    block_read(bench_disk, offset, BLOCK_BENCH_SIZE, bench_buffer);
+}
+
+/**
+ * VFS: resolve a two-component path on the root filesystem
+ */
+#define LOOKUP_BENCH_DIR  "/kbench"
+#define LOOKUP_BENCH_PATH "/kbench/lookup"
+
+static int lookup_setup(void) {
+    vfs_mkdir(LOOKUP_BENCH_DIR, 0755);     // May already exist
+
+    int fd = vfs_open(LOOKUP_BENCH_PATH, O_WRONLY | O_CREAT);
+    if (fd < 0) {
+        return -1;
+    }
+    vfs_close(fd);
+    return 0;
+}
+
+KBENCH(path_lookup, 10000, lookup_setup, NULL) {
+    vfs_node_t *node = vfs_resolve_path(LOOKUP_BENCH_PATH);
+    if (node && node->close) {
+        node->close(node);
+    }
+}
+
+/**
+ * Small files: open, read and close a file whose inode is not cached
+ *
+ * Files just under and just over the inline threshold, so the second
+ * case pays for one more block read. The inode cache is dropped before
+ * every open, as for a file that was not read recently; a handful of
+ * files read over and over would otherwise only measure the cache.
+ * Each case makes 10k timed reads, cycling through the 16 files.
+ */
+#define SMALL_FILE_DIR      "/kbench"
+#define SMALL_FILE_COUNT    16
+#define SMALL_FILE_INLINE   (SIMPLEFS_INLINE_SIZE / 2)
+#define SMALL_FILE_BLOCK    (SIMPLEFS_INLINE_SIZE + 64)
+
+static simplefs_t *small_file_fs;
+static uint64_t small_file_reads;
+
+static int small_file_setup(const char *prefix, uint32_t size) {
+    filesystem_t *fs = vfs_get_filesystem("simplefs");
+    if (!fs) {
+        return -1;
+    }
+    small_file_fs = (simplefs_t *)fs->fs_data;
+
+    char data[SMALL_FILE_BLOCK];
+    char path[32];
+    memset(data, 'x', sizeof(data));
+    vfs_mkdir(SMALL_FILE_DIR, 0755);       // May already exist
+
+    for (uint32_t i = 0; i < SMALL_FILE_COUNT; i++) {
+        snprintf(path, sizeof(path), SMALL_FILE_DIR "/%s%u", prefix, i);
+        int fd = vfs_open(path, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd < 0) {
+            return -1;
+        }
+        int written = vfs_write(fd, data, size);
+        vfs_close(fd);
+        if (written != (int)size) {
+            return -1;
+        }
+    }
+
+    small_file_reads = small_file_fs->blocks_read;
+    return 0;
+}
+
+static void small_file_read(const char *prefix, uint32_t iteration) {
+    char buffer[SMALL_FILE_BLOCK];
+    char path[32];
+
+    simplefs_drop_inode_cache(small_file_fs);
+    snprintf(path, sizeof(path), SMALL_FILE_DIR "/%s%u", prefix, iteration % SMALL_FILE_COUNT);
+    int fd = vfs_open(path, O_RDONLY);
+    if (fd >= 0) {
+        vfs_read(fd, buffer, sizeof(buffer));
+        vfs_close(fd);
+    }
+}
+
+static void small_file_report(const char *name, uint32_t iterations) {
+    uint64_t reads = small_file_fs->blocks_read - small_file_reads;
+    uint64_t opens = KBENCH_WARMUP + iterations;
+
+    vga_printf("  %s: %u.%u block reads/file\n", name,
+               (uint32_t)(reads / opens), (uint32_t)((reads * 10 / opens) % 10));
+}
+
+#define SMALL_FILE_ITERATIONS KBENCH_MAX_ITERATIONS
+
+static int small_file_inline_setup(void) {
+    return small_file_setup("s", SMALL_FILE_INLINE);
+}
+
+static void small_file_inline_teardown(void) {
+    small_file_report("small_file_inline", SMALL_FILE_ITERATIONS);
+}
+
+KBENCH(small_file_inline, SMALL_FILE_ITERATIONS, small_file_inline_setup,
+       small_file_inline_teardown) {
+    small_file_read("s", iteration);
+}
+
+static int small_file_block_setup(void) {
+    return small_file_setup("b", SMALL_FILE_BLOCK);
+}
+
+static void small_file_block_teardown(void) {
+    small_file_report("small_file_block", SMALL_FILE_ITERATIONS);
+}
+
+KBENCH(small_file_block, SMALL_FILE_ITERATIONS, small_file_block_setup,
+       small_file_block_teardown) {
+    small_file_read("b", iteration);
+}
+
+/**
+ * Tracing: a tracepoint whose key is off should cost one NOP
+ */
+static int tracepoint_setup(void) {
+    return static_key_enabled(&trace_key_syscall_exit) ? -1 : 0;
+}
+
+KBENCH(tracepoint_off, 10000, tracepoint_setup, NULL) {
+    trace_syscall_exit(iteration, 0);
+}
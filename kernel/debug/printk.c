@@ -0,0 +1,284 @@
+/**
+ * Kernel Log (printk) Implementation
+ *
+ * Each CPU owns a ring of fixed-size records. Writers reserve a slot by
+ * advancing head with a compare-and-swap (so an interrupt handler can log
+ * while the interrupted code is mid-record), format directly into the
+ * slot and publish it by storing its sequence number. The console task is
+ * the consumer: it takes committed records in TSC order across CPUs and
+ * advances tail once a record has been written out.
+ */
+
+#include <kernel/printk.h>
+#include <kernel/percpu.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/serial.h>
+#include <kernel/string.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Console task pacing
+#define PRINTK_CONSOLE_PRIORITY 30
+#define PRINTK_CONSOLE_TICKS    1
+
+#define PRINTK_TEXT_SIZE (PRINTK_RECORD_SIZE - 20)
+
+/**
+ * Log record (one ring slot)
+ */
+typedef struct printk_record {
+    uint64_t seq;                   // Ring position + 1 once committed
+    uint64_t tsc;                   // Timestamp (cycles)
+    uint8_t level;                  // LOG_* level
+    uint8_t cpu;                    // Originating CPU
+    uint16_t len;                   // Text length
+    char text[PRINTK_TEXT_SIZE];    // Formatted message
+} printk_record_t;
+
+/**
+ * Per-CPU log ring
+ *
+ * head and tail live on separate cache lines so producers and the
+ * consumer do not bounce the same line.
+ */
+typedef struct printk_ring {
+    uint64_t head;                  // Next position to reserve
+    uint8_t pad0[56];
+    uint64_t tail;                  // Next position to consume
+    uint64_t dropped;               // Messages lost to a full ring
+    uint8_t pad1[48];
+    printk_record_t records[PRINTK_RING_RECORDS];
+} __attribute__((aligned(64))) printk_ring_t;
+
+static printk_ring_t printk_rings[MAX_CPUS];
+
+// Runtime filter
+static volatile int printk_level = PRINTK_DEFAULT_LEVEL;
+
+// Set once klogd owns console output
+static volatile bool printk_deferred = false;
+
+// Held by the consumer while draining
+static volatile int printk_draining = 0;
+
+// Whether the next emitted record starts a new line
+static bool printk_line_start = true;
+
+/**
+ * Initialize the log ring
+ */
+void printk_init(void) {
+    memset(printk_rings, 0, sizeof(printk_rings));
+    printk_level = PRINTK_DEFAULT_LEVEL;
+    printk_deferred = false;
+    printk_line_start = true;
+}
+
+/**
+ * Set the runtime log level
+ */
+void printk_set_level(int level) {
+    printk_level = level;
+}
+
+/**
+ * Get the runtime log level
+ */
+int printk_get_level(void) {
+    return printk_level;
+}
+
+/**
+ * Get the number of dropped messages
+ */
+uint64_t printk_get_dropped(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < MAX_CPUS; i++) {
+        total += __atomic_load_n(&printk_rings[i].dropped, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/**
+ * Write text to every console sink
+ */
+static void printk_console_write(const char *data, size_t size) {
+    vga_write(data, size);
+    serial_write(data, size);
+}
+
+/**
+ * Format a "[seconds.micros] " prefix
+ */
+static size_t printk_format_time(char *buf, uint64_t tsc) {
+    uint64_t khz = timer_get_tsc_khz();
+    uint64_t us = khz ? (tsc * 1000) / khz : 0;
+    uint32_t frac = (uint32_t)(us % 1000000);
+
+    size_t len = snprintf(buf, 16, "[%u.", (uint32_t)(us / 1000000));
+    for (uint32_t div = 100000; div > 0; div /= 10) {
+        buf[len++] = (char)('0' + (frac / div) % 10);
+    }
+    buf[len++] = ']';
+    buf[len++] = ' ';
+    return len;
+}
+
+/**
+ * Emit one record, prefixing a timestamp at the start of each line
+ */
+static void printk_emit(const printk_record_t *rec) {
+    char prefix[24];
+
+    if (rec->len == 0) {
+        return;
+    }
+
+    if (printk_line_start) {
+        printk_console_write(prefix, printk_format_time(prefix, rec->tsc));
+    }
+
+    printk_console_write(rec->text, rec->len);
+    printk_line_start = (rec->text[rec->len - 1] == '\n');
+}
+
+/**
+ * Get the oldest committed record of a ring, or NULL
+ */
+static printk_record_t *printk_peek(printk_ring_t *ring, uint64_t *pos) {
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    printk_record_t *rec = &ring->records[tail % PRINTK_RING_RECORDS];
+    if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+        return NULL;    // Reserved but not yet committed
+    }
+
+    *pos = tail;
+    return rec;
+}
+
+/**
+ * Drain committed records in timestamp order across CPUs
+ *
+ * tail is advanced with a compare-and-swap so a forced drain (panic)
+ * racing an interrupted console task never emits a record twice.
+ */
+static void printk_drain(void) {
+    while (1) {
+        printk_ring_t *oldest_ring = NULL;
+        printk_record_t *oldest = NULL;
+        uint64_t oldest_pos = 0;
+
+        for (int i = 0; i < MAX_CPUS; i++) {
+            uint64_t pos;
+            printk_record_t *rec = printk_peek(&printk_rings[i], &pos);
+            if (rec && (!oldest || rec->tsc < oldest->tsc)) {
+                oldest_ring = &printk_rings[i];
+                oldest = rec;
+                oldest_pos = pos;
+            }
+        }
+
+        if (!oldest) {
+            break;
+        }
+
+        printk_emit(oldest);
+
+        uint64_t expected = oldest_pos;
+        __atomic_compare_exchange_n(&oldest_ring->tail, &expected, oldest_pos + 1,
+                                    false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Drain all committed records synchronously
+ */
+void printk_flush(void) {
+    __atomic_store_n(&printk_draining, 1, __ATOMIC_SEQ_CST);
+    printk_drain();
+    __atomic_store_n(&printk_draining, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Log a formatted message
+ */
+void printk(int level, const char *format, ...) {
+    if (level > printk_level) {
+        return;
+    }
+
+    printk_ring_t *ring = &printk_rings[cpu_id()];
+
+    // Reserve a slot
+    uint64_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    do {
+        uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (pos - tail >= PRINTK_RING_RECORDS) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    // Fill and publish it
+    printk_record_t *rec = &ring->records[pos % PRINTK_RING_RECORDS];
+    rec->tsc = rdtsc();
+    rec->level = (uint8_t)level;
+    rec->cpu = (uint8_t)cpu_id();
+
+    __builtin_va_list args;
+    __builtin_va_start(args, format);
+    rec->len = (uint16_t)vsnprintf(rec->text, PRINTK_TEXT_SIZE, format, args);
+    __builtin_va_end(args);
+
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+
+    // Before klogd runs (and on a crash) output stays synchronous
+    if (!printk_deferred || level <= LOG_CRIT) {
+        if (!__atomic_exchange_n(&printk_draining, 1, __ATOMIC_ACQUIRE)) {
+            printk_drain();
+            __atomic_store_n(&printk_draining, 0, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/**
+ * Console task: drains the rings once per tick
+ */
+static void printk_console_task(void) {
+    while (1) {
+        if (!__atomic_exchange_n(&printk_draining, 1, __ATOMIC_ACQUIRE)) {
+            printk_drain();
+            __atomic_store_n(&printk_draining, 0, __ATOMIC_RELEASE);
+        }
+        process_sleep(PRINTK_CONSOLE_TICKS);
+    }
+}
+
+/**
+ * Start the console task
+ */
+void printk_start_console_task(void) {
+    if (printk_deferred) {
+        return;
+    }
+
+    process_t *task = process_create_kernel_task(printk_console_task, "klogd",
+                                                 PRINTK_CONSOLE_PRIORITY);
+    if (!task) {
+        vga_puts("  printk: failed to create console task, output stays synchronous\n");
+        return;
+    }
+
+    scheduler_add_process(task);
+    printk_deferred = true;
+}
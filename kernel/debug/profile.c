@@ -0,0 +1,425 @@
+/**
+ * Sampling Profiler Implementation
+ */
+
+#include <kernel/profile.h>
+#include <kernel/isr.h>
+#include <kernel/idt.h>
+#include <kernel/apic.h>
+#include <kernel/msr.h>
+#include <kernel/timer.h>
+#include <kernel/serial.h>
+#include <kernel/percpu.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// CPUID leaf for architectural performance monitoring
+#define CPUID_LEAF_PMU      0x0A
+
+// Largest period that fits a legacy (sign-extended 32-bit) PMC write
+#define PMU_MAX_PERIOD      0x7FFFFFFF
+
+/**
+ * Architectural PMU event
+ */
+typedef struct pmu_event {
+    uint8_t select;
+    uint8_t umask;
+    uint8_t cpuid_bit;          // CPUID.0AH:EBX bit set when unsupported
+} pmu_event_t;
+
+static const pmu_event_t pmu_events[] = {
+    [PROFILE_EVENT_CYCLES]       = { 0x3C, 0x00, 0 },
+    [PROFILE_EVENT_INSTRUCTIONS] = { 0xC0, 0x00, 1 },
+    [PROFILE_EVENT_LLC_MISSES]   = { 0x2E, 0x41, 4 },
+};
+
+static const char *event_names[PROFILE_EVENT_COUNT] = {
+    [PROFILE_EVENT_CYCLES]       = "cycles",
+    [PROFILE_EVENT_INSTRUCTIONS] = "instructions",
+    [PROFILE_EVENT_LLC_MISSES]   = "llc",
+    [PROFILE_EVENT_TIMER]        = "timer",
+};
+
+static const char *source_names[] = {
+    [PROFILE_SOURCE_NONE]  = "none",
+    [PROFILE_SOURCE_PMU]   = "pmu-nmi",
+    [PROFILE_SOURCE_LAPIC] = "lapic-timer",
+    [PROFILE_SOURCE_PIT]   = "pit",
+};
+
+/**
+ * Per-CPU sample buffer
+ */
+typedef struct profile_cpu {
+    profile_sample_t samples[PROFILE_SAMPLES];
+    uint32_t count;
+    uint32_t dropped;           // Samples lost to a full buffer
+} profile_cpu_t;
+
+static profile_cpu_t profile_cpus[MAX_CPUS];
+
+static volatile bool active = false;
+static profile_source_t source = PROFILE_SOURCE_NONE;
+static profile_event_t current_event = PROFILE_EVENT_TIMER;
+static uint64_t current_period = 0;
+
+// PMU description from CPUID
+static bool pmu_probed = false;
+static uint32_t pmu_version = 0;
+static uint32_t pmu_counter_bits = 0;
+static uint32_t pmu_event_mask = 0;     // CPUID.0AH:EBX (set = unsupported)
+static uint32_t pmu_event_count = 0;    // Valid bits in pmu_event_mask
+
+static bool nmi_installed = false;
+
+/**
+ * Read the architectural PMU description
+ */
+static void pmu_probe(void) {
+    if (pmu_probed) {
+        return;
+    }
+    pmu_probed = true;
+
+    uint32_t eax = 0, ebx, ecx = 0, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    if (eax < CPUID_LEAF_PMU) {
+        return;
+    }
+
+    eax = CPUID_LEAF_PMU;
+    ecx = 0;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+
+    uint32_t version = eax & 0xFF;
+    uint32_t counters = (eax >> 8) & 0xFF;
+    uint32_t bits = (eax >> 16) & 0xFF;
+    if (version == 0 || counters == 0 || bits < 32) {
+        return;                 // No PMU (typical under emulation)
+    }
+
+    pmu_version = version;
+    pmu_counter_bits = bits;
+    pmu_event_mask = ebx;
+    pmu_event_count = (eax >> 24) & 0xFF;
+}
+
+/**
+ * Check whether an event can be counted on PMC0
+ */
+static bool pmu_supports(profile_event_t event) {
+    if (pmu_version == 0 || event >= PROFILE_EVENT_TIMER || !lapic_enabled()) {
+        return false;
+    }
+
+    uint32_t bit = pmu_events[event].cpuid_bit;
+    return bit < pmu_event_count && !(pmu_event_mask & (1u << bit));
+}
+
+/**
+ * Load PMC0 so it overflows after current_period events
+ */
+static inline void pmu_arm(void) {
+    wrmsr(MSR_IA32_PMC0, (uint64_t)-(int64_t)current_period);
+}
+
+/**
+ * Record the interrupted context
+ *
+ * Follows the RBP chain only while each frame lies above the previous
+ * one and within PROFILE_STACK_WINDOW of the interrupted RSP, so a
+ * garbage RBP (e.g. mid-prologue) ends the walk instead of faulting.
+ */
+static void profile_record(const registers_t *regs, bool walk) {
+    profile_cpu_t *pc = &profile_cpus[cpu_id()];
+
+    if (pc->count >= PROFILE_SAMPLES) {
+        pc->dropped++;
+        return;
+    }
+
+    profile_sample_t *sample = &pc->samples[pc->count];
+    sample->ip[0] = regs->rip;
+    sample->depth = 1;
+    sample->user = (regs->cs & 3) != 0;
+
+    if (walk && !sample->user) {
+        uint64_t low = regs->rsp;
+        uint64_t fp = regs->rbp;
+
+        while (sample->depth < PROFILE_MAX_DEPTH &&
+               fp >= low && fp - regs->rsp < PROFILE_STACK_WINDOW && !(fp & 7)) {
+            const uint64_t *frame = (const uint64_t *)fp;
+            if (frame[1] == 0) {
+                break;
+            }
+            sample->ip[sample->depth++] = frame[1];
+            low = fp + 16;
+            fp = frame[0];
+        }
+    }
+
+    pc->count++;
+}
+
+/**
+ * PMC0 overflow (NMI)
+ */
+static void profile_nmi_handler(registers_t *regs) {
+    if (source != PROFILE_SOURCE_PMU) {
+        return;
+    }
+
+    // The counter runs negative until it wraps, so a clear top bit means
+    // it overflowed; anything else is someone else's NMI
+    if (rdmsr(MSR_IA32_PMC0) & (1ULL << (pmu_counter_bits - 1))) {
+        return;
+    }
+
+    if (active) {
+        profile_record(regs, true);
+        pmu_arm();
+    }
+
+    if (pmu_version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+    }
+
+    // Delivering the PMI masks the LVT entry
+    lapic_set_lvt(LAPIC_REG_LVT_PERF, LAPIC_LVT_NMI);
+}
+
+/**
+ * Local APIC timer sample
+ */
+static void profile_timer_handler(registers_t *regs) {
+    if (active) {
+        profile_record(regs, true);
+    }
+    lapic_eoi();
+}
+
+/**
+ * PIT tick sample
+ *
+ * IRQ frames do not carry RBP, so only RIP is recorded.
+ */
+static void profile_tick_hook(registers_t *regs) {
+    if (active) {
+        profile_record(regs, false);
+    }
+}
+
+/**
+ * Program PMC0 to interrupt through an NMI
+ */
+static void pmu_start(profile_event_t event) {
+    const pmu_event_t *ev = &pmu_events[event];
+
+    if (!nmi_installed) {
+        isr_register_handler(EXCEPTION_NMI, profile_nmi_handler);
+        nmi_installed = true;
+    }
+
+    if (pmu_version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, 0);
+        wrmsr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+    }
+
+    lapic_set_lvt(LAPIC_REG_LVT_PERF, LAPIC_LVT_NMI);
+
+    wrmsr(MSR_IA32_PERFEVTSEL0, 0);
+    pmu_arm();
+    wrmsr(MSR_IA32_PERFEVTSEL0, ev->select | ((uint32_t)ev->umask << 8) |
+                                PERFEVTSEL_USR | PERFEVTSEL_OS |
+                                PERFEVTSEL_INT | PERFEVTSEL_EN);
+
+    if (pmu_version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, 1);
+    }
+}
+
+/**
+ * Stop PMC0
+ */
+static void pmu_stop(void) {
+    wrmsr(MSR_IA32_PERFEVTSEL0, 0);
+    if (pmu_version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, 0);
+    }
+    lapic_set_lvt(LAPIC_REG_LVT_PERF, LAPIC_LVT_NMI | LAPIC_LVT_MASKED);
+}
+
+/**
+ * Start sampling
+ */
+profile_source_t profile_start(profile_event_t event, uint64_t period) {
+    if (active || event >= PROFILE_EVENT_COUNT) {
+        return PROFILE_SOURCE_NONE;
+    }
+
+    if (period == 0) {
+        period = PROFILE_DEFAULT_PERIOD;
+    }
+    if (period > PMU_MAX_PERIOD) {
+        period = PMU_MAX_PERIOD;
+    }
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        profile_cpus[cpu].count = 0;
+        profile_cpus[cpu].dropped = 0;
+    }
+
+    pmu_probe();
+    current_event = event;
+    current_period = period;
+
+    uint32_t lapic_rate = 0;
+
+    if (pmu_supports(event)) {
+        source = PROFILE_SOURCE_PMU;
+        active = true;
+        pmu_start(event);
+        vga_printf("  Profiler: %s, one sample per %u events (NMI)\n",
+                   event_names[event], (uint32_t)period);
+    } else if (lapic_enabled() && (lapic_rate = lapic_timer_calibrate()) != 0) {
+        isr_register_handler(INT_PROFILE, profile_timer_handler);
+        source = PROFILE_SOURCE_LAPIC;
+        active = true;
+        lapic_timer_start(INT_PROFILE, lapic_rate * 1000 / PROFILE_TIMER_HZ, true);
+        vga_printf("  Profiler: %s unavailable, local APIC timer at %u Hz\n",
+                   event_names[event], PROFILE_TIMER_HZ);
+    } else {
+        source = PROFILE_SOURCE_PIT;
+        active = true;
+        timer_register_sample_hook(profile_tick_hook);
+        vga_printf("  Profiler: %s unavailable, sampling PIT ticks (RIP only)\n",
+                   event_names[event]);
+    }
+
+    return source;
+}
+
+/**
+ * Stop sampling
+ */
+void profile_stop(void) {
+    if (!active) {
+        return;
+    }
+
+    active = false;
+
+    switch (source) {
+        case PROFILE_SOURCE_PMU:
+            pmu_stop();
+            break;
+        case PROFILE_SOURCE_LAPIC:
+            lapic_timer_stop();
+            isr_unregister_handler(INT_PROFILE);
+            break;
+        case PROFILE_SOURCE_PIT:
+            timer_register_sample_hook(NULL);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Check whether the profiler is running
+ */
+bool profile_active(void) {
+    return active;
+}
+
+/**
+ * Compare two call chains
+ */
+static bool profile_same_stack(const profile_sample_t *a, const profile_sample_t *b) {
+    if (a->depth != b->depth || a->user != b->user) {
+        return false;
+    }
+    return a->user || memcmp(a->ip, b->ip, a->depth * sizeof(a->ip[0])) == 0;
+}
+
+/**
+ * Write folded stacks to the serial port
+ *
+ * One line per distinct stack, root first, e.g.
+ * "0x101a2c;0x1043f0;0x104411 12". All user-mode samples fold into a
+ * single "[user]" frame since kernel.elf cannot name them. Identical
+ * stacks are merged by clearing the depth of the duplicates.
+ */
+void profile_dump(void) {
+    char line[PROFILE_MAX_DEPTH * 20 + 32];
+    uint32_t total = 0;
+    uint32_t dropped = 0;
+
+    profile_stop();
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        total += profile_cpus[cpu].count;
+        dropped += profile_cpus[cpu].dropped;
+    }
+
+    int len = snprintf(line, sizeof(line),
+                       "=== PROFILE BEGIN event=%s source=%s period=%u samples=%u dropped=%u ===\n",
+                       event_names[current_event], source_names[source],
+                       (uint32_t)current_period, total, dropped);
+    serial_write(line, (size_t)len);
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        profile_cpu_t *pc = &profile_cpus[cpu];
+
+        for (uint32_t i = 0; i < pc->count; i++) {
+            profile_sample_t *sample = &pc->samples[i];
+            if (sample->depth == 0) {
+                continue;
+            }
+
+            uint32_t hits = 1;
+            for (uint32_t j = i + 1; j < pc->count; j++) {
+                if (pc->samples[j].depth && profile_same_stack(sample, &pc->samples[j])) {
+                    pc->samples[j].depth = 0;
+                    hits++;
+                }
+            }
+
+            len = 0;
+            if (sample->user) {
+                len = snprintf(line, sizeof(line), "[user]");
+            } else {
+                for (int d = sample->depth - 1; d >= 0; d--) {
+                    len += snprintf(line + len, sizeof(line) - len, "%s0x%lx",
+                                    d == sample->depth - 1 ? "" : ";", sample->ip[d]);
+                }
+            }
+            len += snprintf(line + len, sizeof(line) - len, " %u\n", hits);
+            serial_write(line, (size_t)len);
+        }
+
+        pc->count = 0;
+        pc->dropped = 0;
+    }
+
+    serial_write("=== PROFILE END ===\n", 20);
+
+    vga_printf("  Profiler: %u samples (%u dropped) written to serial\n", total, dropped);
+}
+
+/**
+ * Parse an event name
+ */
+profile_event_t profile_parse_event(const char *name) {
+    for (uint32_t i = 0; i < PROFILE_EVENT_COUNT; i++) {
+        if (strcmp(name, event_names[i]) == 0) {
+            return (profile_event_t)i;
+        }
+    }
+    return PROFILE_EVENT_COUNT;
+}
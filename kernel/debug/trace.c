@@ -0,0 +1,323 @@
+/**
+ * Kernel Tracepoint Implementation
+ *
+ * Each CPU owns a byte ring of variable-size records. Writers run with
+ * interrupts disabled on their own CPU, so a record is never torn by a
+ * nested tracepoint. A record that would straddle the end of the ring
+ * is preceded by a TRACE_ID_PAD filler and starts again at offset 0;
+ * records are TRACE_RECORD_ALIGN-sized so the filler always has room
+ * for its header. When a ring is full new records are dropped and
+ * counted rather than overwriting unread ones.
+ */
+
+#include <kernel/trace.h>
+#include <kernel/static_key.h>
+#include <kernel/chardev.h>
+#include <kernel/multiboot.h>
+#include <kernel/process.h>
+#include <kernel/serial.h>
+#include <kernel/percpu.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <kernel/idt.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TRACE_BUFFER_MASK (TRACE_BUFFER_SIZE - 1)
+
+/**
+ * Per-CPU ring buffer
+ */
+typedef struct trace_cpu {
+    uint8_t data[TRACE_BUFFER_SIZE] __attribute__((aligned(TRACE_RECORD_ALIGN)));
+    uint32_t head;              // Write position (free running)
+    uint32_t tail;              // Read position (free running)
+    uint32_t dropped;           // Records lost to a full ring
+} trace_cpu_t;
+
+static trace_cpu_t trace_cpus[MAX_CPUS];
+
+/**
+ * Append a record to this CPU's ring
+ *
+ * Fills in the header; the caller has written the payload.
+ */
+static void trace_write(trace_record_t *record, uint16_t id, size_t size) {
+    uint32_t total = (uint32_t)((size + TRACE_RECORD_ALIGN - 1) & ~(size_t)(TRACE_RECORD_ALIGN - 1));
+    uint64_t flags = interrupts_save();
+
+    uint32_t cpu = cpu_id();
+    trace_cpu_t *tc = &trace_cpus[cpu];
+    uint32_t offset = tc->head & TRACE_BUFFER_MASK;
+    uint32_t to_end = TRACE_BUFFER_SIZE - offset;
+    uint32_t pad = to_end < total ? to_end : 0;
+
+    if (TRACE_BUFFER_SIZE - (tc->head - tc->tail) < pad + total) {
+        tc->dropped++;
+        interrupts_restore(flags);
+        return;
+    }
+
+    if (pad) {
+        trace_record_t *filler = (trace_record_t *)&tc->data[offset];
+        memset(filler, 0, sizeof(*filler));
+        filler->id = TRACE_ID_PAD;
+        filler->size = (uint8_t)pad;
+        tc->head += pad;
+        offset = 0;
+    }
+
+    process_t *current = process_get_current();
+    record->tsc = rdtsc();
+    record->id = id;
+    record->size = (uint8_t)total;
+    record->cpu = (uint8_t)cpu;
+    record->pid = current ? current->pid : 0;
+
+    memcpy(&tc->data[offset], record, size);
+    memset(&tc->data[offset + size], 0, total - size);
+    tc->head += total;
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Keys, records and out-of-line emitters for every event
+ */
+#define TRACE_EVENT(name, proto, args, fields, assign)                        \
+    typedef struct trace_entry_##name {                                       \
+        trace_record_t header;                                                \
+        fields                                                                \
+    } trace_entry_##name##_t;                                                 \
+    _Static_assert(sizeof(trace_entry_##name##_t) <= TRACE_RECORD_MAX,        \
+                   "trace record too large: " #name);                         \
+    static_key_t trace_key_##name = STATIC_KEY_INIT_FALSE;                    \
+    void trace_emit_##name(proto) {                                           \
+        trace_entry_##name##_t record;                                        \
+        trace_entry_##name##_t *entry = &record;                              \
+        memset(entry, 0, sizeof(record));                                     \
+        assign                                                                \
+        trace_write(&entry->header, TRACE_ID_##name, sizeof(record));         \
+    }
+#include <kernel/trace_events.h>
+#undef TRACE_EVENT
+
+static const char *event_names[TRACE_ID_COUNT] = {
+#define TRACE_EVENT(name, proto, args, fields, assign) [TRACE_ID_##name] = #name,
+#include <kernel/trace_events.h>
+#undef TRACE_EVENT
+};
+
+static static_key_t *event_keys[TRACE_ID_COUNT] = {
+#define TRACE_EVENT(name, proto, args, fields, assign) [TRACE_ID_##name] = &trace_key_##name,
+#include <kernel/trace_events.h>
+#undef TRACE_EVENT
+};
+
+/**
+ * Enable or disable an event by name
+ */
+int trace_set_event(const char *name, bool enable) {
+    bool all = strcmp(name, "all") == 0;
+    bool found = false;
+
+    for (uint32_t id = TRACE_ID_PAD + 1; id < TRACE_ID_COUNT; id++) {
+        if (!all && strcmp(name, event_names[id]) != 0) {
+            continue;
+        }
+
+        if (enable) {
+            static_key_enable(event_keys[id]);
+        } else {
+            static_key_disable(event_keys[id]);
+        }
+        found = true;
+    }
+
+    return found ? 0 : -1;
+}
+
+/**
+ * Check whether any event is enabled
+ */
+bool trace_active(void) {
+    for (uint32_t id = TRACE_ID_PAD + 1; id < TRACE_ID_COUNT; id++) {
+        if (static_key_enabled(event_keys[id])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Copy whole records out of the buffers, consuming them
+ */
+size_t trace_read(void *buffer, size_t size) {
+    uint8_t *out = (uint8_t *)buffer;
+    size_t copied = 0;
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        trace_cpu_t *tc = &trace_cpus[cpu];
+        uint64_t flags = interrupts_save();
+
+        while (tc->tail != tc->head) {
+            trace_record_t *record = (trace_record_t *)&tc->data[tc->tail & TRACE_BUFFER_MASK];
+            if (record->id == TRACE_ID_PAD) {
+                tc->tail += record->size;
+                continue;
+            }
+
+            if (copied + record->size > size) {
+                interrupts_restore(flags);
+                return copied;
+            }
+
+            memcpy(out + copied, record, record->size);
+            copied += record->size;
+            tc->tail += record->size;
+        }
+
+        interrupts_restore(flags);
+    }
+
+    return copied;
+}
+
+/**
+ * Write the buffered records to the serial port
+ *
+ * Format, one record per line in hex as laid out in memory:
+ *
+ *   === TRACE BEGIN tsc_khz=2400000 dropped=0 ===
+ *   a1b2...
+ *   === TRACE END records=123 ===
+ *
+ * Tracing is switched off first so the dump drains the buffers.
+ */
+void trace_dump(void) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t records[4 * TRACE_RECORD_MAX];
+    char line[TRACE_RECORD_MAX * 2 + 64];
+    uint32_t dropped = 0;
+    uint32_t count = 0;
+    size_t size;
+
+    trace_set_event("all", false);
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        dropped += trace_cpus[cpu].dropped;
+        trace_cpus[cpu].dropped = 0;
+    }
+
+    int len = snprintf(line, sizeof(line), "=== TRACE BEGIN tsc_khz=%lu dropped=%u ===\n",
+                       timer_get_tsc_khz(), dropped);
+    serial_write(line, (size_t)len);
+
+    while ((size = trace_read(records, sizeof(records))) > 0) {
+        for (size_t offset = 0; offset < size; ) {
+            trace_record_t *record = (trace_record_t *)&records[offset];
+            uint8_t *bytes = &records[offset];
+
+            for (uint32_t i = 0; i < record->size; i++) {
+                line[i * 2] = hex[bytes[i] >> 4];
+                line[i * 2 + 1] = hex[bytes[i] & 0xF];
+            }
+            line[record->size * 2] = '\n';
+            serial_write(line, record->size * 2 + 1);
+
+            offset += record->size;
+            count++;
+        }
+    }
+
+    len = snprintf(line, sizeof(line), "=== TRACE END records=%u ===\n", count);
+    serial_write(line, (size_t)len);
+
+    vga_printf("  Trace: %u records (%u dropped) written to serial\n", count, dropped);
+}
+
+/**
+ * Read records from /dev/trace
+ */
+static int trace_dev_read(char_device_t *dev, void *buffer, size_t size) {
+    (void)dev;
+    return (int)trace_read(buffer, size);
+}
+
+/**
+ * Apply "+name", "-name" or "name" words written to /dev/trace
+ */
+static int trace_dev_write(char_device_t *dev, const void *buffer, size_t size) {
+    const char *in = (const char *)buffer;
+    char word[32];
+    size_t pos = 0;
+    int status = 0;
+
+    (void)dev;
+
+    while (pos < size) {
+        while (pos < size && (in[pos] == ' ' || in[pos] == ',' || in[pos] == '\n' || in[pos] == '\t')) {
+            pos++;
+        }
+
+        size_t len = 0;
+        while (pos < size && in[pos] != ' ' && in[pos] != ',' && in[pos] != '\n' && in[pos] != '\t') {
+            if (len < sizeof(word) - 1) {
+                word[len++] = in[pos];
+            }
+            pos++;
+        }
+        word[len] = '\0';
+
+        if (len == 0) {
+            break;
+        }
+
+        bool enable = word[0] != '-';
+        const char *name = (word[0] == '+' || word[0] == '-') ? word + 1 : word;
+        if (trace_set_event(name, enable) != 0) {
+            status = -1;
+        }
+    }
+
+    return status == 0 ? (int)size : -1;
+}
+
+static char_device_t trace_dev = {
+    .name = "trace",
+    .read = trace_dev_read,
+    .write = trace_dev_write,
+    .driver_data = NULL,
+};
+
+/**
+ * Register /dev/trace and apply "trace=" from the command line
+ */
+int trace_init(void) {
+    char events[128];
+
+    memset(trace_cpus, 0, sizeof(trace_cpus));
+
+    if (chardev_register(&trace_dev) != 0) {
+        return -1;
+    }
+
+    if (!multiboot_cmdline_option("trace", events, sizeof(events))) {
+        return 0;
+    }
+
+    if (events[0] == '\0') {
+        strcpy(events, "all");
+    }
+
+    if (trace_dev_write(&trace_dev, events, strlen(events)) < 0) {
+        vga_printf("  Trace: Unknown event in '%s'\n", events);
+    }
+
+    vga_printf("  Trace: %u events, %u KB buffer per CPU\n",
+               (uint32_t)(TRACE_ID_COUNT - 1), (uint32_t)(TRACE_BUFFER_SIZE / 1024));
+    return 0;
+}
@@ -9,6 +9,8 @@
 #include <kernel/string.h>
 #include <kernel/vga.h>
 #include <kernel/heap.h>
+#include <kernel/trace.h>
+#include <kernel/idt.h>
 
 // ATA devices (primary master, primary slave, secondary master, secondary slave)
 static ata_device_t ata_devices[4];
@@ -64,30 +66,70 @@ static int ata_wait_drq(uint16_t base_io, uint8_t timeout_ms) {
     return -1;  // Timeout
 }
 
+/**
+ * Wait for BSY to clear, whatever the other status bits say
+ */
+static int ata_wait_not_busy(uint16_t base_io, uint8_t timeout_ms) {
+    uint32_t timeout = timeout_ms * 1000;
+
+    while (timeout > 0) {
+        if (!(inb(base_io + ATA_REG_STATUS) & ATA_STATUS_BSY)) {
+            return 0;
+        }
+
+        timeout--;
+        for (volatile int i = 0; i < 10; i++);
+    }
+
+    return -1;  // Timeout
+}
+
+/**
+ * Give the drive 400ns to put its status on the bus
+ */
+static void ata_select_delay(uint16_t control) {
+    for (int i = 0; i < 4; i++) {
+        inb(control + ATA_REG_ALT_STATUS);
+    }
+}
+
 /**
  * Identify ATA drive
+ *
+ * Empty positions are turned away without waiting out a timeout: a bus
+ * with nothing on it floats to 0xFF, a missing drive reads 0 after
+ * IDENTIFY, and ATAPI/SATA devices abort the command and leave their
+ * signature in the LBA registers.
  */
 static int ata_identify(ata_device_t *dev) {
     uint16_t base_io = dev->base_io;
     uint8_t drive = dev->drive;
 
+    // Nothing attached to this bus
+    if (inb(base_io + ATA_REG_STATUS) == 0xFF) {
+        return -1;
+    }
+
     // Select drive
     outb(base_io + ATA_REG_DRIVE_SELECT, 0xA0 | (drive << 4));
-
-    // Wait a bit
-    for (volatile int i = 0; i < 1000; i++);
+    ata_select_delay(dev->control);
 
     // Send IDENTIFY command
     outb(base_io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
 
     // Read status
     uint8_t status = inb(base_io + ATA_REG_STATUS);
-    if (status == 0) {
+    if (status == 0 || status == 0xFF) {
         return -1;  // Drive doesn't exist
     }
 
-    // Wait for BSY to clear
-    if (ata_wait_ready(base_io, 100) != 0) {
+    // Wait for BSY to clear (packet devices never set RDY, so do not wait for it)
+    if (ata_wait_not_busy(base_io, 100) != 0) {
+        return -1;
+    }
+
+    // Not an ATA disk: ATAPI or SATA signature
+    if (inb(base_io + ATA_REG_LBA_MID) != 0 || inb(base_io + ATA_REG_LBA_HIGH) != 0) {
         return -1;
     }
 
@@ -206,101 +248,148 @@ ata_device_t *ata_get_device(uint8_t bus, uint8_t drive) {
 }
 
 /**
- * Read sectors from ATA drive
+ * Select a drive and issue a command for up to ATA_MAX_SECTORS sectors
+ *
+ * Both drives on a channel share its registers, so the other drive may
+ * be the one selected: wait for the channel, select, then wait for this
+ * drive before programming the LBA.
  */
-int ata_read_sectors(ata_device_t *dev, uint64_t lba, uint32_t count, uint8_t *buffer) {
-    if (!dev || !buffer || count == 0) {
+static int ata_issue(ata_device_t *dev, uint64_t lba, uint32_t count, uint8_t command) {
+    uint16_t base_io = dev->base_io;
+
+    if (ata_wait_not_busy(base_io, 100) != 0) {
         return -1;
     }
 
-    uint16_t base_io = dev->base_io;
+    // Select drive and set LBA mode
+    outb(base_io + ATA_REG_DRIVE_SELECT, 0xE0 | (dev->drive << 4) | ((lba >> 24) & 0x0F));
+    ata_select_delay(dev->control);
 
-    for (uint32_t i = 0; i < count; i++) {
-        // Wait for drive to be ready
-        if (ata_wait_ready(base_io, 100) != 0) {
-            return -1;
-        }
+    // Wait for drive to be ready
+    if (ata_wait_ready(base_io, 100) != 0) {
+        return -1;
+    }
 
-        // Select drive and set LBA mode
-        outb(base_io + ATA_REG_DRIVE_SELECT, 0xE0 | (dev->drive << 4) | ((lba >> 24) & 0x0F));
+    // Set sector count (ATA_MAX_SECTORS wraps to 0)
+    outb(base_io + ATA_REG_SECTOR_COUNT, (uint8_t)count);
 
-        // Set sector count
-        outb(base_io + ATA_REG_SECTOR_COUNT, 1);
+    // Set LBA
+    outb(base_io + ATA_REG_LBA_LOW, (uint8_t)lba);
+    outb(base_io + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
+    outb(base_io + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 16));
 
-        // Set LBA
-        outb(base_io + ATA_REG_LBA_LOW, (uint8_t)lba);
-        outb(base_io + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
-        outb(base_io + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 16));
+    outb(base_io + ATA_REG_COMMAND, command);
+    return 0;
+}
 
-        // Send READ command
-        outb(base_io + ATA_REG_COMMAND, ATA_CMD_READ_PIO);
+/**
+ * Read up to ATA_MAX_SECTORS sectors with one command (interrupts disabled)
+ *
+ * The drive raises DRQ once per sector as each one becomes ready.
+ */
+static int ata_read_chunk(ata_device_t *dev, uint64_t lba, uint32_t count, uint8_t *buffer) {
+    if (ata_issue(dev, lba, count, ATA_CMD_READ_PIO) != 0) {
+        return -1;
+    }
 
-        // Wait for DRQ
-        if (ata_wait_drq(base_io, 100) != 0) {
+    uint16_t *word_buffer = (uint16_t *)buffer;
+    for (uint32_t i = 0; i < count; i++) {
+        if (ata_wait_drq(dev->base_io, 100) != 0) {
             return -1;
         }
 
         // Read sector data (256 words = 512 bytes)
-        uint16_t *word_buffer = (uint16_t *)(buffer + (i * 512));
         for (int j = 0; j < 256; j++) {
-            word_buffer[j] = inw(base_io + ATA_REG_DATA);
+            *word_buffer++ = inw(dev->base_io + ATA_REG_DATA);
         }
-
-        lba++;
     }
-
     return 0;
 }
 
 /**
- * Write sectors to ATA drive
+ * Write up to ATA_MAX_SECTORS sectors with one command (interrupts disabled)
  */
-int ata_write_sectors(ata_device_t *dev, uint64_t lba, uint32_t count, const uint8_t *buffer) {
-    if (!dev || !buffer || count == 0) {
+static int ata_write_chunk(ata_device_t *dev, uint64_t lba, uint32_t count, const uint8_t *buffer) {
+    if (ata_issue(dev, lba, count, ATA_CMD_WRITE_PIO) != 0) {
         return -1;
     }
 
-    uint16_t base_io = dev->base_io;
-
+    const uint16_t *word_buffer = (const uint16_t *)buffer;
     for (uint32_t i = 0; i < count; i++) {
-        // Wait for drive to be ready
-        if (ata_wait_ready(base_io, 100) != 0) {
+        if (ata_wait_drq(dev->base_io, 100) != 0) {
             return -1;
         }
 
-        // Select drive and set LBA mode
-        outb(base_io + ATA_REG_DRIVE_SELECT, 0xE0 | (dev->drive << 4) | ((lba >> 24) & 0x0F));
+        // Write sector data (256 words = 512 bytes)
+        for (int j = 0; j < 256; j++) {
+            outw(dev->base_io + ATA_REG_DATA, *word_buffer++);
+        }
+    }
+    return 0;
+}
 
-        // Set sector count
-        outb(base_io + ATA_REG_SECTOR_COUNT, 1);
+/**
+ * Read sectors from ATA drive
+ *
+ * The whole transfer runs with interrupts disabled, split into commands
+ * of at most ATA_MAX_SECTORS sectors. Swap I/O can start from kswapd or
+ * a page fault while a task is in the middle of a transfer on the same
+ * channel; it must not find the registers half programmed or take over
+ * the data port mid-command.
+ */
+int ata_read_sectors(ata_device_t *dev, uint64_t lba, uint32_t count, uint8_t *buffer) {
+    if (!dev || !buffer || count == 0) {
+        return -1;
+    }
 
-        // Set LBA
-        outb(base_io + ATA_REG_LBA_LOW, (uint8_t)lba);
-        outb(base_io + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
-        outb(base_io + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 16));
+    trace_ata_read(dev->drive, lba, count);
 
-        // Send WRITE command
-        outb(base_io + ATA_REG_COMMAND, ATA_CMD_WRITE_PIO);
+    uint64_t flags = interrupts_save();
+    int result = 0;
+    while (count > 0 && result == 0) {
+        uint32_t chunk = count < ATA_MAX_SECTORS ? count : ATA_MAX_SECTORS;
+        result = ata_read_chunk(dev, lba, chunk, buffer);
+        lba += chunk;
+        buffer += chunk * 512;
+        count -= chunk;
+    }
+    interrupts_restore(flags);
 
-        // Wait for DRQ
-        if (ata_wait_drq(base_io, 100) != 0) {
-            return -1;
-        }
+    return result;
+}
 
-        // Write sector data (256 words = 512 bytes)
-        const uint16_t *word_buffer = (const uint16_t *)(buffer + (i * 512));
-        for (int j = 0; j < 256; j++) {
-            outw(base_io + ATA_REG_DATA, word_buffer[j]);
-        }
+/**
+ * Write sectors to ATA drive
+ *
+ * Serialized like ata_read_sectors(), with a single cache flush once
+ * every sector has been written.
+ */
+int ata_write_sectors(ata_device_t *dev, uint64_t lba, uint32_t count, const uint8_t *buffer) {
+    if (!dev || !buffer || count == 0) {
+        return -1;
+    }
 
-        // Flush cache
-        outb(base_io + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
-        ata_wait_ready(base_io, 100);
+    uint64_t flags = interrupts_save();
+    int result = 0;
+    while (count > 0 && result == 0) {
+        uint32_t chunk = count < ATA_MAX_SECTORS ? count : ATA_MAX_SECTORS;
+        result = ata_write_chunk(dev, lba, chunk, buffer);
+        lba += chunk;
+        buffer += chunk * 512;
+        count -= chunk;
+    }
 
-        lba++;
+    // Flush cache once the last sector has been accepted
+    if (result == 0) {
+        result = ata_wait_not_busy(dev->base_io, 100);
     }
+    if (result == 0) {
+        outb(dev->base_io + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
+        ata_wait_ready(dev->base_io, 100);
+    }
+    interrupts_restore(flags);
 
-    return 0;
+    return result;
 }
 
 /**
@@ -6,8 +6,6 @@
 #include <kernel/string.h>
 #include <kernel/vga.h>
 
-#define MAX_BLOCK_DEVICES 16
-
 static block_device_t *block_devices[MAX_BLOCK_DEVICES];
 static uint32_t num_block_devices = 0;
 
@@ -46,6 +44,23 @@ block_device_t *block_get_device(const char *name) {
     return NULL;
 }
 
+/**
+ * Get block device by registration order
+ */
+block_device_t *block_get_device_by_index(uint32_t index) {
+    if (index >= num_block_devices) {
+        return NULL;
+    }
+    return block_devices[index];
+}
+
+/**
+ * Get number of registered block devices
+ */
+uint32_t block_get_device_count(void) {
+    return num_block_devices;
+}
+
 /**
  * Read data from block device at byte offset
  */
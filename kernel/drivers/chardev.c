@@ -0,0 +1,130 @@
+/**
+ * Character Device Management
+ *
+ * Keeps the registry of character devices and provides the built-in
+ * console, null and zero devices.
+ */
+
+#include <kernel/chardev.h>
+#include <kernel/serial.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+
+static char_device_t *char_devices[MAX_CHAR_DEVICES];
+static uint32_t num_char_devices = 0;
+
+/**
+ * Console: VGA output, serial input
+ */
+static int console_read(char_device_t *dev, void *buffer, size_t size) {
+    (void)dev;
+    return serial_read((uint8_t *)buffer, size);
+}
+
+static int console_write(char_device_t *dev, const void *buffer, size_t size) {
+    (void)dev;
+    vga_write((const char *)buffer, size);
+    return (int)size;
+}
+
+/**
+ * Null: discards writes, reads return end of file
+ */
+static int null_read(char_device_t *dev, void *buffer, size_t size) {
+    (void)dev;
+    (void)buffer;
+    (void)size;
+    return 0;
+}
+
+static int null_write(char_device_t *dev, const void *buffer, size_t size) {
+    (void)dev;
+    (void)buffer;
+    return (int)size;
+}
+
+/**
+ * Zero: reads return zero bytes, discards writes
+ */
+static int zero_read(char_device_t *dev, void *buffer, size_t size) {
+    (void)dev;
+    memset(buffer, 0, size);
+    return (int)size;
+}
+
+static char_device_t console_dev = {
+    .name = "console",
+    .read = console_read,
+    .write = console_write,
+};
+
+static char_device_t null_dev = {
+    .name = "null",
+    .read = null_read,
+    .write = null_write,
+};
+
+static char_device_t zero_dev = {
+    .name = "zero",
+    .read = zero_read,
+    .write = null_write,
+};
+
+/**
+ * Initialize character device subsystem
+ */
+void chardev_init(void) {
+    memset(char_devices, 0, sizeof(char_devices));
+    num_char_devices = 0;
+
+    chardev_register(&console_dev);
+    chardev_register(&null_dev);
+    chardev_register(&zero_dev);
+
+    vga_printf("  Chardev: Initialized\n");
+}
+
+/**
+ * Register a character device
+ */
+int chardev_register(char_device_t *dev) {
+    if (!dev || num_char_devices >= MAX_CHAR_DEVICES) {
+        return -1;
+    }
+
+    if (chardev_get(dev->name)) {
+        return -1;  // Name already taken
+    }
+
+    char_devices[num_char_devices++] = dev;
+    return 0;
+}
+
+/**
+ * Get character device by name
+ */
+char_device_t *chardev_get(const char *name) {
+    for (uint32_t i = 0; i < num_char_devices; i++) {
+        if (strcmp(char_devices[i]->name, name) == 0) {
+            return char_devices[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get character device by registration order
+ */
+char_device_t *chardev_get_by_index(uint32_t index) {
+    if (index >= num_char_devices) {
+        return NULL;
+    }
+    return char_devices[index];
+}
+
+/**
+ * Get number of registered character devices
+ */
+uint32_t chardev_count(void) {
+    return num_char_devices;
+}
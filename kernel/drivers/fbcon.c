@@ -0,0 +1,360 @@
+/**
+ * Framebuffer Console Implementation
+ */
+
+#include <kernel/fbcon.h>
+#include <kernel/font.h>
+#include <kernel/memory.h>
+#include <kernel/vmm.h>
+#include <kernel/string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bytes per pixel (only 32bpp is supported)
+#define FBCON_BPP_BYTES 4
+
+/**
+ * Glyph row cache slot
+ *
+ * Every possible font row byte expanded into eight pixels of one
+ * foreground/background pair, i.e. four 64-bit stores per glyph row.
+ */
+typedef struct fbcon_cache {
+    uint8_t attr;               // VGA attribute this slot expands
+    bool valid;
+    uint32_t last_use;          // For LRU replacement
+    uint64_t rows[256][PSF1_WIDTH * FBCON_BPP_BYTES / 8];
+} fbcon_cache_t;
+
+// Standard VGA text palette (RGB)
+static const uint32_t vga_palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+// Framebuffer
+static volatile uint8_t *fb_base = NULL;
+static uint32_t fb_pitch = 0;
+static uint32_t palette[16];
+
+// Font
+static const uint8_t *font_glyphs = NULL;
+static uint32_t font_height = 0;
+
+// Text grid and shadow line ring
+static uint32_t cols = 0;
+static uint32_t rows = 0;
+static uint16_t cells[FBCON_MAX_ROWS][FBCON_MAX_COLS];
+static uint32_t top_line = 0;
+static uint32_t cursor_x = 0;
+static uint32_t cursor_y = 0;
+
+// Dirty column range [lo, hi) per screen row; lo >= hi means clean
+static uint16_t dirty_lo[FBCON_MAX_ROWS];
+static uint16_t dirty_hi[FBCON_MAX_ROWS];
+
+// Glyph row cache
+static fbcon_cache_t cache[FBCON_CACHE_SLOTS];
+static uint32_t cache_clock = 0;
+
+static bool active = false;
+
+/**
+ * Pack an RGB color into the framebuffer's pixel format
+ */
+static uint32_t fbcon_pack(uint32_t rgb, const multiboot_framebuffer_t *fb) {
+    uint32_t r = (rgb >> 16) & 0xFF;
+    uint32_t g = (rgb >> 8) & 0xFF;
+    uint32_t b = rgb & 0xFF;
+
+    return ((r >> (8 - fb->red_size)) << fb->red_pos) |
+           ((g >> (8 - fb->green_size)) << fb->green_pos) |
+           ((b >> (8 - fb->blue_size)) << fb->blue_pos);
+}
+
+/**
+ * Load a PSF1 font image
+ */
+static int fbcon_load_font(const uint8_t *psf, size_t size) {
+    const psf1_header_t *hdr = (const psf1_header_t *)psf;
+
+    if (size < sizeof(psf1_header_t) ||
+        hdr->magic[0] != PSF1_MAGIC0 || hdr->magic[1] != PSF1_MAGIC1 ||
+        hdr->charsize == 0 || size < sizeof(psf1_header_t) + 256u * hdr->charsize) {
+        return -1;
+    }
+
+    font_glyphs = psf + sizeof(psf1_header_t);
+    font_height = hdr->charsize;
+    return 0;
+}
+
+/**
+ * Get the expanded glyph rows for a VGA attribute
+ */
+static fbcon_cache_t *fbcon_cache_get(uint8_t attr) {
+    fbcon_cache_t *victim = &cache[0];
+
+    for (int i = 0; i < FBCON_CACHE_SLOTS; i++) {
+        if (cache[i].valid && cache[i].attr == attr) {
+            cache[i].last_use = ++cache_clock;
+            return &cache[i];
+        }
+        if (!cache[i].valid || cache[i].last_use < victim->last_use) {
+            victim = &cache[i];
+        }
+    }
+
+    // Miss: expand all 256 row patterns for this color pair
+    uint64_t fg = palette[attr & 0x0F];
+    uint64_t bg = palette[(attr >> 4) & 0x0F];
+
+    for (uint32_t bits = 0; bits < 256; bits++) {
+        for (uint32_t px = 0; px < PSF1_WIDTH; px += 2) {
+            uint64_t left = (bits & (0x80 >> px)) ? fg : bg;
+            uint64_t right = (bits & (0x40 >> px)) ? fg : bg;
+            victim->rows[bits][px / 2] = left | (right << 32);
+        }
+    }
+
+    victim->attr = attr;
+    victim->valid = true;
+    victim->last_use = ++cache_clock;
+    return victim;
+}
+
+/**
+ * Get the shadow line for a screen row
+ */
+static inline uint16_t *fbcon_line(uint32_t y) {
+    uint32_t line = top_line + y;
+    if (line >= rows) {
+        line -= rows;
+    }
+    return cells[line];
+}
+
+/**
+ * Mark columns of a screen row as needing a render
+ */
+static inline void fbcon_mark_dirty(uint32_t y, uint32_t lo, uint32_t hi) {
+    if (dirty_lo[y] >= dirty_hi[y]) {
+        dirty_lo[y] = lo;
+        dirty_hi[y] = hi;
+        return;
+    }
+    if (lo < dirty_lo[y]) dirty_lo[y] = lo;
+    if (hi > dirty_hi[y]) dirty_hi[y] = hi;
+}
+
+/**
+ * Mark the whole screen dirty
+ */
+static void fbcon_mark_all_dirty(void) {
+    for (uint32_t y = 0; y < rows; y++) {
+        dirty_lo[y] = 0;
+        dirty_hi[y] = cols;
+    }
+}
+
+/**
+ * Render cells [lo, hi) of one text row
+ *
+ * Cells are handled in runs of equal attribute so the glyph row table
+ * is looked up once per run, then scanline by scanline so stores go to
+ * ascending addresses and keep write-combining buffers full.
+ */
+static void fbcon_render_row(uint32_t y, uint32_t lo, uint32_t hi) {
+    const uint16_t *line = fbcon_line(y);
+
+    while (lo < hi) {
+        uint8_t attr = line[lo] >> 8;
+        uint32_t end = lo + 1;
+        while (end < hi && (line[end] >> 8) == attr) {
+            end++;
+        }
+
+        const fbcon_cache_t *table = fbcon_cache_get(attr);
+
+        for (uint32_t r = 0; r < font_height; r++) {
+            volatile uint64_t *dst = (volatile uint64_t *)
+                (fb_base + (y * font_height + r) * fb_pitch + lo * PSF1_WIDTH * FBCON_BPP_BYTES);
+
+            for (uint32_t x = lo; x < end; x++) {
+                uint8_t bits = font_glyphs[(line[x] & 0xFF) * font_height + r];
+                const uint64_t *px = table->rows[bits];
+                dst[0] = px[0];
+                dst[1] = px[1];
+                dst[2] = px[2];
+                dst[3] = px[3];
+                dst += 4;
+            }
+        }
+
+        lo = end;
+    }
+}
+
+/**
+ * Initialize the framebuffer console
+ */
+int fbcon_init(const multiboot_framebuffer_t *fb) {
+    if (!fb || fb->bpp != 32 || (fb->pitch & 7) != 0) {
+        return -1;
+    }
+
+    if (fbcon_load_font(font_default_psf, font_default_psf_size) != 0) {
+        return -1;
+    }
+
+    cols = fb->width / PSF1_WIDTH;
+    rows = fb->height / font_height;
+    if (cols > FBCON_MAX_COLS) cols = FBCON_MAX_COLS;
+    if (rows > FBCON_MAX_ROWS) rows = FBCON_MAX_ROWS;
+    if (cols == 0 || rows == 0) {
+        return -1;
+    }
+
+    // Map the framebuffer
+    uint64_t flags = PAGE_FLAGS_KERNEL | vmm_wc_flags();
+    size_t pages = BYTES_TO_PAGES((uint64_t)fb->pitch * fb->height);
+    if (vmm_map_pages(FBCON_VIRT_BASE, fb->addr, pages, flags) != 0) {
+        return -1;
+    }
+
+    fb_base = (volatile uint8_t *)FBCON_VIRT_BASE;
+    fb_pitch = fb->pitch;
+
+    for (int i = 0; i < 16; i++) {
+        palette[i] = fbcon_pack(vga_palette[i], fb);
+    }
+
+    active = true;
+    fbcon_clear(0x0F);
+    return 0;
+}
+
+/**
+ * Check whether the framebuffer console is up
+ */
+bool fbcon_active(void) {
+    return active;
+}
+
+/**
+ * Scroll up by one line by rotating the shadow ring
+ */
+static void fbcon_scroll(uint8_t color) {
+    uint16_t *recycled = cells[top_line];
+
+    top_line++;
+    if (top_line >= rows) {
+        top_line = 0;
+    }
+
+    uint16_t blank = (uint16_t)' ' | ((uint16_t)color << 8);
+    for (uint32_t x = 0; x < cols; x++) {
+        recycled[x] = blank;
+    }
+
+    fbcon_mark_all_dirty();
+    cursor_y = rows - 1;
+}
+
+/**
+ * Move cursor to next line
+ */
+static void fbcon_newline(uint8_t color) {
+    cursor_x = 0;
+    cursor_y++;
+    if (cursor_y >= rows) {
+        fbcon_scroll(color);
+    }
+}
+
+/**
+ * Put a character into the shadow buffer
+ */
+void fbcon_putchar(char c, uint8_t color) {
+    if (!active) {
+        return;
+    }
+
+    if (c == '\n') {
+        fbcon_newline(color);
+        return;
+    }
+
+    if (c == '\r') {
+        cursor_x = 0;
+        return;
+    }
+
+    if (c == '\t') {
+        cursor_x = (cursor_x + 4) & ~(4u - 1);
+        if (cursor_x >= cols) {
+            fbcon_newline(color);
+        }
+        return;
+    }
+
+    if (c == '\b') {
+        if (cursor_x > 0) {
+            cursor_x--;
+            fbcon_line(cursor_y)[cursor_x] = (uint16_t)' ' | ((uint16_t)color << 8);
+            fbcon_mark_dirty(cursor_y, cursor_x, cursor_x + 1);
+        }
+        return;
+    }
+
+    fbcon_line(cursor_y)[cursor_x] = (uint16_t)(uint8_t)c | ((uint16_t)color << 8);
+    fbcon_mark_dirty(cursor_y, cursor_x, cursor_x + 1);
+    cursor_x++;
+
+    if (cursor_x >= cols) {
+        fbcon_newline(color);
+    }
+}
+
+/**
+ * Render dirty cells to the framebuffer
+ */
+void fbcon_flush(void) {
+    if (!active) {
+        return;
+    }
+
+    for (uint32_t y = 0; y < rows; y++) {
+        if (dirty_lo[y] >= dirty_hi[y]) {
+            continue;
+        }
+
+        fbcon_render_row(y, dirty_lo[y], dirty_hi[y]);
+        dirty_lo[y] = cols;
+        dirty_hi[y] = 0;
+    }
+}
+
+/**
+ * Clear the console
+ */
+void fbcon_clear(uint8_t color) {
+    if (!active) {
+        return;
+    }
+
+    uint16_t blank = (uint16_t)' ' | ((uint16_t)color << 8);
+    for (uint32_t y = 0; y < rows; y++) {
+        for (uint32_t x = 0; x < cols; x++) {
+            cells[y][x] = blank;
+        }
+    }
+
+    top_line = 0;
+    cursor_x = 0;
+    cursor_y = 0;
+
+    fbcon_mark_all_dirty();
+    fbcon_flush();
+}
@@ -0,0 +1,738 @@
+/**
+ * PCI Bus Layer Implementation
+ */
+
+#include <kernel/pci.h>
+#include <kernel/acpi.h>
+#include <kernel/irq.h>
+#include <kernel/idt.h>
+#include <kernel/port.h>
+#include <kernel/vmm.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ECAM regions from the MCFG table
+#define PCI_MAX_ECAM 4
+
+typedef struct pci_ecam {
+    uint64_t base;
+    uint16_t segment;
+    uint8_t start_bus;
+    uint8_t end_bus;
+} pci_ecam_t;
+
+static pci_ecam_t ecam_regions[PCI_MAX_ECAM];
+static uint32_t ecam_count = 0;
+
+// Enumerated functions
+static pci_device_t devices[PCI_MAX_DEVICES];
+static uint32_t device_count = 0;
+
+// Registered drivers
+static pci_driver_t *drivers = NULL;
+
+// Buses already scanned (guards against misconfigured bridges)
+static uint64_t buses_scanned[4];
+
+/**
+ * Map the configuration space page of a function through ECAM
+ *
+ * @return Mapping, or NULL if no ECAM region covers the bus
+ */
+static volatile uint8_t *pci_ecam_map(uint16_t segment, uint8_t bus, uint8_t slot, uint8_t func) {
+    for (uint32_t i = 0; i < ecam_count; i++) {
+        const pci_ecam_t *region = &ecam_regions[i];
+        if (region->segment != segment || bus < region->start_bus || bus > region->end_bus) {
+            continue;
+        }
+
+        uint64_t phys = region->base + ((uint64_t)(bus - region->start_bus) << 20) +
+                        ((uint64_t)slot << 15) + ((uint64_t)func << 12);
+        uint64_t virt = vmm_map_mmio(phys, 4096);
+        return virt ? (volatile uint8_t *)virt : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * Select a register through the legacy address port
+ */
+static inline void pci_cf8_select(const pci_device_t *dev, uint16_t offset) {
+    outl(PCI_CONFIG_ADDRESS, PCI_CONFIG_ENABLE | ((uint32_t)dev->bus << 16) |
+                             ((uint32_t)dev->slot << 11) | ((uint32_t)dev->func << 8) |
+                             (offset & 0xFC));
+}
+
+/**
+ * Read configuration space
+ */
+uint32_t pci_config_read32(pci_device_t *dev, uint16_t offset) {
+    if (dev->ecam) {
+        return *(volatile uint32_t *)(dev->ecam + (offset & ~3u));
+    }
+
+    uint64_t flags = interrupts_save();
+    pci_cf8_select(dev, offset);
+    uint32_t value = inl(PCI_CONFIG_DATA);
+    interrupts_restore(flags);
+    return value;
+}
+
+uint16_t pci_config_read16(pci_device_t *dev, uint16_t offset) {
+    if (dev->ecam) {
+        return *(volatile uint16_t *)(dev->ecam + (offset & ~1u));
+    }
+
+    uint64_t flags = interrupts_save();
+    pci_cf8_select(dev, offset);
+    uint16_t value = inw(PCI_CONFIG_DATA + (offset & 2));
+    interrupts_restore(flags);
+    return value;
+}
+
+uint8_t pci_config_read8(pci_device_t *dev, uint16_t offset) {
+    if (dev->ecam) {
+        return dev->ecam[offset];
+    }
+
+    uint64_t flags = interrupts_save();
+    pci_cf8_select(dev, offset);
+    uint8_t value = inb(PCI_CONFIG_DATA + (offset & 3));
+    interrupts_restore(flags);
+    return value;
+}
+
+/**
+ * Write configuration space
+ */
+void pci_config_write32(pci_device_t *dev, uint16_t offset, uint32_t value) {
+    if (dev->ecam) {
+        *(volatile uint32_t *)(dev->ecam + (offset & ~3u)) = value;
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+    pci_cf8_select(dev, offset);
+    outl(PCI_CONFIG_DATA, value);
+    interrupts_restore(flags);
+}
+
+void pci_config_write16(pci_device_t *dev, uint16_t offset, uint16_t value) {
+    if (dev->ecam) {
+        *(volatile uint16_t *)(dev->ecam + (offset & ~1u)) = value;
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+    pci_cf8_select(dev, offset);
+    outw(PCI_CONFIG_DATA + (offset & 2), value);
+    interrupts_restore(flags);
+}
+
+void pci_config_write8(pci_device_t *dev, uint16_t offset, uint8_t value) {
+    if (dev->ecam) {
+        dev->ecam[offset] = value;
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+    pci_cf8_select(dev, offset);
+    outb(PCI_CONFIG_DATA + (offset & 3), value);
+    interrupts_restore(flags);
+}
+
+/**
+ * Check whether configuration space is accessed through ECAM
+ */
+bool pci_using_ecam(void) {
+    return ecam_count > 0;
+}
+
+/**
+ * Size and record the BARs of a function
+ *
+ * Decoding is switched off while all-ones are written so a half-sized
+ * BAR never claims addresses that belong to something else.
+ */
+static void pci_read_bars(pci_device_t *dev) {
+    uint32_t type = dev->header_type & PCI_HEADER_TYPE_MASK;
+    uint32_t nbars = (type == 0) ? PCI_BAR_COUNT : (type == PCI_HEADER_BRIDGE ? 2 : 0);
+
+    uint16_t cmd = pci_config_read16(dev, PCI_COMMAND);
+    pci_config_write16(dev, PCI_COMMAND, cmd & ~(PCI_COMMAND_IO | PCI_COMMAND_MEMORY));
+
+    for (uint32_t i = 0; i < nbars; i++) {
+        uint16_t off = PCI_BAR0 + i * 4;
+        uint32_t orig = pci_config_read32(dev, off);
+        pci_config_write32(dev, off, 0xFFFFFFFF);
+        uint32_t mask = pci_config_read32(dev, off);
+        pci_config_write32(dev, off, orig);
+
+        if (mask == 0) {
+            continue;       // Unimplemented
+        }
+
+        if (orig & PCI_BAR_IO) {
+            dev->bar_phys[i] = orig & ~3u;
+            dev->bar_size[i] = (uint16_t)(~(mask & ~3u) + 1);
+            dev->bar_flags[i] = orig & 3u;
+            continue;
+        }
+
+        uint64_t phys = orig & ~0xFu;
+        uint64_t size_mask = 0xFFFFFFFF00000000ULL | (mask & ~0xFu);
+
+        if ((orig & PCI_BAR_TYPE_MASK) == PCI_BAR_TYPE_64 && i + 1 < nbars) {
+            uint32_t orig_hi = pci_config_read32(dev, off + 4);
+            pci_config_write32(dev, off + 4, 0xFFFFFFFF);
+            uint32_t mask_hi = pci_config_read32(dev, off + 4);
+            pci_config_write32(dev, off + 4, orig_hi);
+
+            phys |= (uint64_t)orig_hi << 32;
+            size_mask = ((uint64_t)mask_hi << 32) | (mask & ~0xFu);
+        }
+
+        dev->bar_phys[i] = phys;
+        dev->bar_size[i] = ~size_mask + 1;
+        dev->bar_flags[i] = orig & 0xFu;
+
+        if ((orig & PCI_BAR_TYPE_MASK) == PCI_BAR_TYPE_64) {
+            i++;            // Upper half of this BAR
+        }
+    }
+
+    pci_config_write16(dev, PCI_COMMAND, cmd);
+}
+
+/**
+ * Find a capability in the capability list
+ */
+uint8_t pci_find_capability(pci_device_t *dev, uint8_t cap_id) {
+    if (!(pci_config_read16(dev, PCI_STATUS) & PCI_STATUS_CAP_LIST)) {
+        return 0;
+    }
+
+    uint8_t ptr = pci_config_read8(dev, PCI_CAP_PTR) & ~3u;
+
+    // Bounded in case the list loops
+    for (int i = 0; i < 48 && ptr >= 0x40; i++) {
+        if (pci_config_read8(dev, ptr) == cap_id) {
+            return ptr;
+        }
+        ptr = pci_config_read8(dev, ptr + 1) & ~3u;
+    }
+    return 0;
+}
+
+static void pci_scan_bus(uint16_t segment, uint8_t bus);
+
+/**
+ * Record one function, and descend if it is a bridge
+ */
+static void pci_scan_function(uint16_t segment, uint8_t bus, uint8_t slot, uint8_t func) {
+    pci_device_t probe = {
+        .segment = segment, .bus = bus, .slot = slot, .func = func,
+        .ecam = pci_ecam_map(segment, bus, slot, func),
+    };
+
+    if (ecam_count > 0 && !probe.ecam) {
+        return;
+    }
+
+    uint16_t vendor = pci_config_read16(&probe, PCI_VENDOR_ID);
+    if (vendor == 0xFFFF) {
+        return;
+    }
+
+    uint8_t class_code = pci_config_read8(&probe, PCI_CLASS);
+    uint8_t subclass = pci_config_read8(&probe, PCI_SUBCLASS);
+
+    if (device_count < PCI_MAX_DEVICES) {
+        pci_device_t *dev = &devices[device_count++];
+        *dev = probe;
+        dev->vendor_id = vendor;
+        dev->device_id = pci_config_read16(dev, PCI_DEVICE_ID);
+        dev->class_code = class_code;
+        dev->subclass = subclass;
+        dev->prog_if = pci_config_read8(dev, PCI_PROG_IF);
+        dev->revision = pci_config_read8(dev, PCI_REVISION);
+        dev->header_type = pci_config_read8(dev, PCI_HEADER_TYPE);
+        dev->irq_line = pci_config_read8(dev, PCI_INTERRUPT_PIN) ?
+                        pci_config_read8(dev, PCI_INTERRUPT_LINE) : 0xFF;
+        dev->irq_mode = PCI_IRQ_NONE;
+
+        pci_read_bars(dev);
+        dev->msi_cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+        dev->msix_cap = pci_find_capability(dev, PCI_CAP_ID_MSIX);
+    }
+
+    if (class_code == PCI_CLASS_BRIDGE && subclass == PCI_SUBCLASS_PCI_BRIDGE) {
+        pci_scan_bus(segment, pci_config_read8(&probe, PCI_SECONDARY_BUS));
+    }
+}
+
+/**
+ * Scan every slot of a bus
+ */
+static void pci_scan_bus(uint16_t segment, uint8_t bus) {
+    if (buses_scanned[bus / 64] & (1ULL << (bus % 64))) {
+        return;
+    }
+    buses_scanned[bus / 64] |= 1ULL << (bus % 64);
+
+    for (uint8_t slot = 0; slot < 32; slot++) {
+        pci_device_t probe = {
+            .segment = segment, .bus = bus, .slot = slot,
+            .ecam = pci_ecam_map(segment, bus, slot, 0),
+        };
+        if (ecam_count > 0 && !probe.ecam) {
+            continue;
+        }
+        if (pci_config_read16(&probe, PCI_VENDOR_ID) == 0xFFFF) {
+            continue;
+        }
+
+        uint8_t nfuncs = (pci_config_read8(&probe, PCI_HEADER_TYPE) & PCI_HEADER_MULTIFUNC) ? 8 : 1;
+        for (uint8_t func = 0; func < nfuncs; func++) {
+            pci_scan_function(segment, bus, slot, func);
+        }
+    }
+}
+
+/**
+ * Read the ECAM regions from the MCFG table
+ */
+static void pci_load_mcfg(void) {
+    const acpi_mcfg_t *mcfg = (const acpi_mcfg_t *)acpi_find_table("MCFG");
+    if (!mcfg) {
+        return;
+    }
+
+    size_t count = (mcfg->header.length - sizeof(acpi_mcfg_t)) / sizeof(acpi_mcfg_entry_t);
+    for (size_t i = 0; i < count && ecam_count < PCI_MAX_ECAM; i++) {
+        const acpi_mcfg_entry_t *entry = &mcfg->entries[i];
+        ecam_regions[ecam_count].base = entry->base;
+        ecam_regions[ecam_count].segment = entry->segment;
+        ecam_regions[ecam_count].start_bus = entry->start_bus;
+        ecam_regions[ecam_count].end_bus = entry->end_bus;
+        ecam_count++;
+    }
+}
+
+/**
+ * Check that the legacy configuration ports respond
+ */
+static bool pci_cf8_present(void) {
+    uint64_t flags = interrupts_save();
+    uint32_t saved = inl(PCI_CONFIG_ADDRESS);
+    outl(PCI_CONFIG_ADDRESS, PCI_CONFIG_ENABLE);
+    bool present = (inl(PCI_CONFIG_ADDRESS) == PCI_CONFIG_ENABLE);
+    outl(PCI_CONFIG_ADDRESS, saved);
+    interrupts_restore(flags);
+    return present;
+}
+
+/**
+ * Enumerate all PCI buses
+ */
+int pci_init(void) {
+    device_count = 0;
+    for (int i = 0; i < 4; i++) {
+        buses_scanned[i] = 0;
+    }
+
+    pci_load_mcfg();
+    if (ecam_count == 0 && !pci_cf8_present()) {
+        vga_printf("  PCI: No configuration mechanism found\n");
+        return -1;
+    }
+
+    uint16_t segment = ecam_count ? ecam_regions[0].segment : 0;
+    uint8_t first_bus = ecam_count ? ecam_regions[0].start_bus : 0;
+
+    // A multi-function host bridge means one host controller per function
+    pci_device_t host = {
+        .segment = segment, .bus = first_bus,
+        .ecam = pci_ecam_map(segment, first_bus, 0, 0),
+    };
+    if ((ecam_count == 0 || host.ecam) &&
+        (pci_config_read8(&host, PCI_HEADER_TYPE) & PCI_HEADER_MULTIFUNC)) {
+        for (uint8_t func = 0; func < 8; func++) {
+            host.func = func;
+            host.ecam = pci_ecam_map(segment, first_bus, 0, func);
+            if (pci_config_read16(&host, PCI_VENDOR_ID) != 0xFFFF) {
+                pci_scan_bus(segment, first_bus + func);
+            }
+        }
+    } else {
+        pci_scan_bus(segment, first_bus);
+    }
+
+    vga_printf("  PCI: %u functions via %s\n", device_count,
+               ecam_count ? "ECAM" : "port 0xCF8");
+    return (int)device_count;
+}
+
+/**
+ * Check a device against a driver's table
+ */
+static const pci_device_id_t *pci_match(const pci_driver_t *driver, const pci_device_t *dev) {
+    for (const pci_device_id_t *id = driver->id_table; id && id->vendor_id != 0; id++) {
+        if (id->vendor_id != PCI_ANY_ID && id->vendor_id != dev->vendor_id) continue;
+        if (id->device_id != PCI_ANY_ID && id->device_id != dev->device_id) continue;
+        if (id->class_code != PCI_ANY_ID && id->class_code != dev->class_code) continue;
+        if (id->subclass != PCI_ANY_ID && id->subclass != dev->subclass) continue;
+        return id;
+    }
+    return NULL;
+}
+
+/**
+ * Register a driver and probe it against unclaimed devices
+ */
+int pci_register_driver(pci_driver_t *driver) {
+    if (!driver || !driver->probe) {
+        return 0;
+    }
+
+    driver->next = drivers;
+    drivers = driver;
+
+    int bound = 0;
+    for (uint32_t i = 0; i < device_count; i++) {
+        pci_device_t *dev = &devices[i];
+        if (dev->driver) {
+            continue;
+        }
+
+        const pci_device_id_t *id = pci_match(driver, dev);
+        if (id && driver->probe(dev, id) == 0) {
+            dev->driver = driver;
+            bound++;
+        }
+    }
+
+    return bound;
+}
+
+/**
+ * Find the next device of a class
+ */
+pci_device_t *pci_find_class(uint8_t class_code, uint16_t subclass, pci_device_t *from) {
+    uint32_t start = from ? (uint32_t)(from - devices) + 1 : 0;
+
+    for (uint32_t i = start; i < device_count; i++) {
+        if (devices[i].class_code == class_code &&
+            (subclass == PCI_ANY_ID || devices[i].subclass == subclass)) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get a device by index
+ */
+pci_device_t *pci_get_device(uint32_t index) {
+    return index < device_count ? &devices[index] : NULL;
+}
+
+/**
+ * Get the number of enumerated functions
+ */
+uint32_t pci_device_count(void) {
+    return device_count;
+}
+
+/**
+ * Enable decoding and bus mastering
+ */
+void pci_enable_device(pci_device_t *dev) {
+    uint16_t cmd = pci_config_read16(dev, PCI_COMMAND);
+    cmd |= PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER;
+    pci_config_write16(dev, PCI_COMMAND, cmd);
+}
+
+/**
+ * Map a memory BAR
+ */
+volatile void *pci_map_bar(pci_device_t *dev, uint32_t bar) {
+    if (bar >= PCI_BAR_COUNT || dev->bar_size[bar] == 0 || (dev->bar_flags[bar] & PCI_BAR_IO)) {
+        return NULL;
+    }
+
+    uint64_t virt;
+    if (dev->bar_flags[bar] & PCI_BAR_PREFETCH) {
+        virt = vmm_map_mmio_wc(dev->bar_phys[bar], dev->bar_size[bar]);
+    } else {
+        virt = vmm_map_mmio(dev->bar_phys[bar], dev->bar_size[bar]);
+    }
+    return virt ? (volatile void *)virt : NULL;
+}
+
+/**
+ * Compose an MSI message address for a CPU
+ */
+static inline uint32_t pci_msi_address(uint32_t cpu) {
+    return PCI_MSI_ADDR_BASE | (irq_cpu_apic_id(cpu) << PCI_MSI_ADDR_DEST_SHIFT);
+}
+
+/**
+ * Get the MSI-X table entry of an interrupt
+ */
+static inline volatile uint32_t *pci_msix_entry(pci_device_t *dev, uint32_t index, uint32_t reg) {
+    return (volatile uint32_t *)(dev->msix_table + index * PCI_MSIX_ENTRY_SIZE + reg);
+}
+
+/**
+ * Get the MSI mask bits register offset (0 if not maskable)
+ */
+static uint16_t pci_msi_mask_offset(pci_device_t *dev, uint16_t ctrl) {
+    if (!(ctrl & PCI_MSI_CTRL_MASKABLE)) {
+        return 0;
+    }
+    return dev->msi_cap + ((ctrl & PCI_MSI_CTRL_64BIT) ? 0x10 : 0x0C);
+}
+
+/**
+ * Set up MSI-X with one vector per table entry
+ */
+static int pci_setup_msix(pci_device_t *dev, uint32_t min_vecs, uint32_t max_vecs) {
+    uint8_t cap = dev->msix_cap;
+    uint16_t ctrl = pci_config_read16(dev, cap + PCI_MSIX_CTRL);
+    uint32_t table_size = (ctrl & PCI_MSIX_CTRL_SIZE_MASK) + 1;
+
+    uint32_t nvec = max_vecs;
+    if (nvec > table_size) nvec = table_size;
+    if (nvec > PCI_MAX_VECTORS) nvec = PCI_MAX_VECTORS;
+    if (nvec < min_vecs) {
+        return -1;
+    }
+
+    uint32_t table = pci_config_read32(dev, cap + PCI_MSIX_TABLE);
+    uint32_t bir = table & PCI_MSIX_BIR_MASK;
+    if (bir >= PCI_BAR_COUNT || dev->bar_size[bir] == 0 || (dev->bar_flags[bir] & PCI_BAR_IO)) {
+        return -1;
+    }
+
+    // The table is always mapped uncached, even inside a prefetchable BAR
+    uint64_t virt = vmm_map_mmio(dev->bar_phys[bir] + (table & ~PCI_MSIX_BIR_MASK),
+                                 table_size * PCI_MSIX_ENTRY_SIZE);
+    if (virt == 0) {
+        return -1;
+    }
+    dev->msix_table = (volatile uint8_t *)virt;
+
+    uint32_t got = 0;
+    while (got < nvec) {
+        uint8_t vector = irq_alloc_vectors(1, 1);
+        if (vector == 0) {
+            break;
+        }
+        dev->msix_vectors[got++] = vector;
+    }
+    if (got < min_vecs) {
+        for (uint32_t i = 0; i < got; i++) {
+            irq_free_vectors(dev->msix_vectors[i], 1);
+        }
+        dev->msix_table = NULL;
+        return -1;
+    }
+
+    // Program entries with the whole function masked
+    pci_config_write16(dev, cap + PCI_MSIX_CTRL, ctrl | PCI_MSIX_CTRL_ENABLE | PCI_MSIX_CTRL_MASKALL);
+
+    for (uint32_t i = 0; i < table_size; i++) {
+        *pci_msix_entry(dev, i, PCI_MSIX_ENTRY_CTRL) = PCI_MSIX_ENTRY_MASKED;
+    }
+    for (uint32_t i = 0; i < got; i++) {
+        *pci_msix_entry(dev, i, PCI_MSIX_ENTRY_ADDR_LO) = pci_msi_address(0);
+        *pci_msix_entry(dev, i, PCI_MSIX_ENTRY_ADDR_HI) = 0;
+        *pci_msix_entry(dev, i, PCI_MSIX_ENTRY_DATA) = dev->msix_vectors[i];
+    }
+
+    pci_config_write16(dev, cap + PCI_MSIX_CTRL,
+                       (ctrl | PCI_MSIX_CTRL_ENABLE) & ~PCI_MSIX_CTRL_MASKALL);
+
+    dev->irq_mode = PCI_IRQ_MSIX;
+    dev->vector_base = dev->msix_vectors[0];
+    dev->vector_count = (uint8_t)got;
+    return (int)got;
+}
+
+/**
+ * Set up MSI with a contiguous, aligned block of vectors
+ */
+static int pci_setup_msi(pci_device_t *dev, uint32_t min_vecs, uint32_t max_vecs) {
+    uint8_t cap = dev->msi_cap;
+    uint16_t ctrl = pci_config_read16(dev, cap + PCI_MSI_CTRL);
+    uint32_t capable = 1u << ((ctrl >> PCI_MSI_CTRL_MMC_SHIFT) & 7);
+
+    // MSI only supports power-of-two message counts
+    uint32_t log2 = 0;
+    while ((2u << log2) <= max_vecs && (2u << log2) <= capable &&
+           (2u << log2) <= PCI_MAX_VECTORS) {
+        log2++;
+    }
+    uint32_t nvec = 1u << log2;
+    if (nvec < min_vecs) {
+        return -1;
+    }
+
+    uint8_t first = irq_alloc_vectors(nvec, nvec);
+    if (first == 0) {
+        return -1;
+    }
+
+    uint16_t data_off = cap + ((ctrl & PCI_MSI_CTRL_64BIT) ? 0x0C : 0x08);
+    pci_config_write32(dev, cap + PCI_MSI_ADDR_LO, pci_msi_address(0));
+    if (ctrl & PCI_MSI_CTRL_64BIT) {
+        pci_config_write32(dev, cap + PCI_MSI_ADDR_HI, 0);
+    }
+    pci_config_write16(dev, data_off, first);
+
+    // Start with every message masked where the device allows it
+    uint16_t mask_off = pci_msi_mask_offset(dev, ctrl);
+    if (mask_off) {
+        pci_config_write32(dev, mask_off, 0xFFFFFFFF);
+    }
+
+    ctrl &= ~(7u << PCI_MSI_CTRL_MME_SHIFT);
+    ctrl |= (log2 << PCI_MSI_CTRL_MME_SHIFT) | PCI_MSI_CTRL_ENABLE;
+    pci_config_write16(dev, cap + PCI_MSI_CTRL, ctrl);
+
+    dev->irq_mode = PCI_IRQ_MSI;
+    dev->vector_base = first;
+    dev->vector_count = (uint8_t)nvec;
+    return (int)nvec;
+}
+
+/**
+ * Allocate message-signalled interrupt vectors
+ */
+int pci_alloc_irq_vectors(pci_device_t *dev, uint32_t min_vecs, uint32_t max_vecs) {
+    if (!dev || min_vecs == 0 || max_vecs < min_vecs || dev->irq_mode != PCI_IRQ_NONE ||
+        irq_get_mode() != IRQ_MODE_APIC) {
+        return -1;
+    }
+
+    int got = -1;
+    if (dev->msix_cap) {
+        got = pci_setup_msix(dev, min_vecs, max_vecs);
+    }
+    if (got < 0 && dev->msi_cap) {
+        got = pci_setup_msi(dev, min_vecs, max_vecs);
+    }
+    if (got < 0) {
+        return -1;
+    }
+
+    // Messages replace the shared INTx line
+    uint16_t cmd = pci_config_read16(dev, PCI_COMMAND);
+    pci_config_write16(dev, PCI_COMMAND, cmd | PCI_COMMAND_INTX_DISABLE | PCI_COMMAND_MASTER);
+    return got;
+}
+
+/**
+ * Get the CPU vector of an allocated interrupt
+ */
+uint8_t pci_irq_vector(pci_device_t *dev, uint32_t index) {
+    if (index >= dev->vector_count) {
+        return 0;
+    }
+    if (dev->irq_mode == PCI_IRQ_MSIX) {
+        return dev->msix_vectors[index];
+    }
+    return dev->vector_base + index;
+}
+
+/**
+ * Install the handler for an allocated interrupt and unmask it
+ */
+int pci_request_irq(pci_device_t *dev, uint32_t index, isr_handler_t handler) {
+    uint8_t vector = pci_irq_vector(dev, index);
+    if (vector == 0 || !handler) {
+        return -1;
+    }
+
+    isr_register_handler(vector, handler);
+
+    if (dev->irq_mode == PCI_IRQ_MSIX) {
+        volatile uint32_t *ctrl = pci_msix_entry(dev, index, PCI_MSIX_ENTRY_CTRL);
+        *ctrl &= ~PCI_MSIX_ENTRY_MASKED;
+    } else {
+        uint16_t mask_off = pci_msi_mask_offset(dev, pci_config_read16(dev, dev->msi_cap + PCI_MSI_CTRL));
+        if (mask_off) {
+            pci_config_write32(dev, mask_off, pci_config_read32(dev, mask_off) & ~(1u << index));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Steer one interrupt to a CPU
+ */
+int pci_set_irq_affinity(pci_device_t *dev, uint32_t index, uint32_t cpu) {
+    if (index >= dev->vector_count || cpu >= irq_cpu_count()) {
+        return -1;
+    }
+
+    if (dev->irq_mode == PCI_IRQ_MSIX) {
+        volatile uint32_t *ctrl = pci_msix_entry(dev, index, PCI_MSIX_ENTRY_CTRL);
+        uint32_t saved = *ctrl;
+        *ctrl = saved | PCI_MSIX_ENTRY_MASKED;
+        *pci_msix_entry(dev, index, PCI_MSIX_ENTRY_ADDR_LO) = pci_msi_address(cpu);
+        *ctrl = saved;
+        return 0;
+    }
+
+    if (dev->irq_mode == PCI_IRQ_MSI) {
+        pci_config_write32(dev, dev->msi_cap + PCI_MSI_ADDR_LO, pci_msi_address(cpu));
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * Disable MSI/MSI-X and release the vectors
+ */
+void pci_free_irq_vectors(pci_device_t *dev) {
+    if (dev->irq_mode == PCI_IRQ_MSIX) {
+        uint16_t ctrl = pci_config_read16(dev, dev->msix_cap + PCI_MSIX_CTRL);
+        pci_config_write16(dev, dev->msix_cap + PCI_MSIX_CTRL, ctrl & ~PCI_MSIX_CTRL_ENABLE);
+        for (uint32_t i = 0; i < dev->vector_count; i++) {
+            irq_free_vectors(dev->msix_vectors[i], 1);
+        }
+        dev->msix_table = NULL;
+    } else if (dev->irq_mode == PCI_IRQ_MSI) {
+        uint16_t ctrl = pci_config_read16(dev, dev->msi_cap + PCI_MSI_CTRL);
+        pci_config_write16(dev, dev->msi_cap + PCI_MSI_CTRL, ctrl & ~PCI_MSI_CTRL_ENABLE);
+        irq_free_vectors(dev->vector_base, dev->vector_count);
+    } else {
+        return;
+    }
+
+    uint16_t cmd = pci_config_read16(dev, PCI_COMMAND);
+    pci_config_write16(dev, PCI_COMMAND, cmd & ~PCI_COMMAND_INTX_DISABLE);
+
+    dev->irq_mode = PCI_IRQ_NONE;
+    dev->vector_base = 0;
+    dev->vector_count = 0;
+}
+
+/**
+ * Print all enumerated functions
+ */
+void pci_dump(void) {
+    for (uint32_t i = 0; i < device_count; i++) {
+        const pci_device_t *dev = &devices[i];
+        vga_printf("    %x:%x.%u %x:%x class %x/%x%s%s%s\n",
+                   dev->bus, dev->slot, dev->func, dev->vendor_id, dev->device_id,
+                   dev->class_code, dev->subclass,
+                   dev->msix_cap ? " MSI-X" : "", dev->msi_cap ? " MSI" : "",
+                   dev->driver ? " [bound]" : "");
+    }
+}
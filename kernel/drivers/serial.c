@@ -0,0 +1,335 @@
+/**
+ * Serial Port (UART) Implementation
+ */
+
+#include <kernel/serial.h>
+#include <kernel/chardev.h>
+#include <kernel/isr.h>
+#include <kernel/idt.h>
+#include <kernel/irq.h>
+#include <kernel/port.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Set once the UART passed its loopback test
+static int serial_present = 0;
+
+// Output bypasses the rings (panic)
+static volatile bool serial_polled = true;
+
+// Transmit ring, drained by the THRE interrupt
+static char tx_ring[SERIAL_TX_RING_SIZE];
+static volatile uint32_t tx_head = 0;   // Next free slot
+static volatile uint32_t tx_tail = 0;   // Next byte to send
+static volatile bool tx_active = false; // THRE interrupt armed
+
+// Receive ring, filled by the RX interrupt
+static uint8_t rx_ring[SERIAL_RX_RING_SIZE];
+static volatile uint32_t rx_head = 0;
+static volatile uint32_t rx_tail = 0;
+
+/**
+ * ttyS0 character device operations
+ */
+static int ttys0_read(char_device_t *dev, void *buffer, size_t size) {
+    (void)dev;
+    return serial_read((uint8_t *)buffer, size);
+}
+
+static int ttys0_write(char_device_t *dev, const void *buffer, size_t size) {
+    (void)dev;
+    serial_write((const char *)buffer, size);
+    return (int)size;
+}
+
+static char_device_t ttys0_dev = {
+    .name = "ttyS0",
+    .read = ttys0_read,
+    .write = ttys0_write,
+};
+
+/**
+ * Program the baud rate divisor
+ */
+static void serial_set_baud(uint32_t baud) {
+    uint16_t divisor = (uint16_t)(SERIAL_MAX_BAUD / baud);
+    uint8_t lcr = inb(SERIAL_COM1 + SERIAL_REG_LCR);
+
+    outb(SERIAL_COM1 + SERIAL_REG_LCR, lcr | 0x80);     // Enable DLAB
+    outb(SERIAL_COM1 + SERIAL_REG_DLL, divisor & 0xFF);
+    outb(SERIAL_COM1 + SERIAL_REG_DLH, (divisor >> 8) & 0xFF);
+    outb(SERIAL_COM1 + SERIAL_REG_LCR, lcr & ~0x80);
+}
+
+/**
+ * Write one byte once the holding register is free
+ */
+static void serial_poll_byte(uint8_t c) {
+    while (!(inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THR_EMPTY)) {
+        __asm__ volatile("pause");
+    }
+    outb(SERIAL_COM1 + SERIAL_REG_DATA, c);
+}
+
+/**
+ * Move up to one FIFO's worth of bytes from the ring to the UART
+ *
+ * Caller must have interrupts disabled and the THR empty.
+ *
+ * @return true if bytes remain queued
+ */
+static bool serial_tx_fill(void) {
+    for (int i = 0; i < SERIAL_FIFO_SIZE && tx_tail != tx_head; i++) {
+        outb(SERIAL_COM1 + SERIAL_REG_DATA, (uint8_t)tx_ring[tx_tail]);
+        tx_tail = (tx_tail + 1) & (SERIAL_TX_RING_SIZE - 1);
+    }
+    return tx_tail != tx_head;
+}
+
+/**
+ * Arm or disarm the THR-empty interrupt
+ */
+static void serial_set_thre_irq(bool enable) {
+    uint8_t ier = SERIAL_IER_RX | (enable ? SERIAL_IER_THRE : 0);
+    outb(SERIAL_COM1 + SERIAL_REG_IER, ier);
+    tx_active = enable;
+}
+
+/**
+ * Push queued bytes to the UART and arm the THRE interrupt
+ *
+ * Also feeds the FIFO directly whenever it is empty, so output keeps
+ * moving while interrupts are still disabled during boot.
+ * Caller must have interrupts disabled.
+ */
+static void serial_tx_kick(void) {
+    if (tx_tail == tx_head) {
+        return;
+    }
+
+    if (inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THR_EMPTY) {
+        serial_tx_fill();
+    }
+
+    // The UART raises THRE again once the FIFO drains
+    if (!tx_active) {
+        serial_set_thre_irq(true);
+    }
+}
+
+/**
+ * COM1 interrupt handler (IRQ4)
+ */
+static void serial_irq_handler(registers_t *regs) {
+    (void)regs;
+
+    uint8_t iir;
+    while (!((iir = inb(SERIAL_COM1 + SERIAL_REG_IIR)) & SERIAL_IIR_NONE)) {
+        switch (iir & SERIAL_IIR_ID_MASK) {
+            case SERIAL_IIR_THRE:
+                if (!serial_tx_fill()) {
+                    serial_set_thre_irq(false);
+                }
+                break;
+
+            case SERIAL_IIR_RX:
+            case SERIAL_IIR_TIMEOUT:
+                while (inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_DATA_READY) {
+                    uint8_t c = inb(SERIAL_COM1 + SERIAL_REG_DATA);
+                    uint32_t next = (rx_head + 1) & (SERIAL_RX_RING_SIZE - 1);
+                    if (next != rx_tail) {      // Drop on overflow
+                        rx_ring[rx_head] = c;
+                        rx_head = next;
+                    }
+                }
+                break;
+
+            case SERIAL_IIR_LINE:
+                inb(SERIAL_COM1 + SERIAL_REG_LSR);     // Reading LSR clears it
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    irq_eoi(IRQ_COM1);
+}
+
+/**
+ * Initialize serial port
+ */
+void serial_init(void) {
+    uint16_t base = SERIAL_COM1;
+
+    outb(base + SERIAL_REG_IER, 0x00);              // Disable interrupts
+    outb(base + SERIAL_REG_LCR, 0x03);              // 8N1, DLAB off
+    serial_set_baud(SERIAL_BAUD);
+    outb(base + SERIAL_REG_FCR, 0xC7);              // Enable and clear FIFOs, 14-byte RX trigger
+    outb(base + SERIAL_REG_MCR, SERIAL_MCR_LOOPBACK | SERIAL_MCR_OUT2 |
+                                SERIAL_MCR_OUT1 | SERIAL_MCR_RTS);
+
+    // Verify the UART echoes a byte back in loopback mode
+    outb(base + SERIAL_REG_DATA, 0xAE);
+    if (inb(base + SERIAL_REG_DATA) != 0xAE) {
+        vga_printf("  Serial: No UART at 0x%x\n", base);
+        return;
+    }
+
+    outb(base + SERIAL_REG_MCR, SERIAL_MCR_DTR | SERIAL_MCR_RTS |
+                                SERIAL_MCR_OUT1 | SERIAL_MCR_OUT2);
+    serial_present = 1;
+
+    irq_register_handler(IRQ_COM1, serial_irq_handler);
+    outb(base + SERIAL_REG_IER, SERIAL_IER_RX);
+    irq_unmask(IRQ_COM1);
+    serial_polled = false;
+
+    chardev_register(&ttys0_dev);
+    vga_printf("  Serial: COM1 at 0x%x, %u baud, %u byte TX ring on IRQ%u\n",
+               base, SERIAL_BAUD, SERIAL_TX_RING_SIZE, IRQ_COM1);
+}
+
+/**
+ * Queue bytes for transmission
+ */
+static void serial_queue(const char *data, size_t size) {
+    uint64_t flags = interrupts_save();
+
+    for (size_t i = 0; i < size; i++) {
+        uint32_t next = (tx_head + 1) & (SERIAL_TX_RING_SIZE - 1);
+        while (next == tx_tail) {
+            // Ring full: push a FIFO's worth out by hand
+            while (!(inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THR_EMPTY)) {
+                __asm__ volatile("pause");
+            }
+            serial_tx_fill();
+        }
+
+        tx_ring[tx_head] = data[i];
+        tx_head = next;
+    }
+
+    serial_tx_kick();
+    interrupts_restore(flags);
+}
+
+/**
+ * Write a single byte
+ */
+void serial_putchar(char c) {
+    if (!serial_present) {
+        return;
+    }
+
+    if (serial_polled) {
+        serial_poll_byte((uint8_t)c);
+        return;
+    }
+
+    serial_queue(&c, 1);
+}
+
+/**
+ * Write a buffer
+ */
+void serial_write(const char *data, size_t size) {
+    if (!serial_present) {
+        return;
+    }
+
+    size_t start = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != '\n') {
+            continue;
+        }
+
+        // Insert \r before each \n
+        if (serial_polled) {
+            for (size_t j = start; j < i; j++) {
+                serial_poll_byte((uint8_t)data[j]);
+            }
+            serial_poll_byte('\r');
+        } else {
+            serial_queue(data + start, i - start);
+            serial_queue("\r", 1);
+        }
+        start = i;
+    }
+
+    if (serial_polled) {
+        for (size_t j = start; j < size; j++) {
+            serial_poll_byte((uint8_t)data[j]);
+        }
+    } else {
+        serial_queue(data + start, size - start);
+    }
+}
+
+/**
+ * Switch to polled output
+ */
+void serial_enter_polled_mode(uint32_t baud) {
+    if (!serial_present) {
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+
+    irq_mask(IRQ_COM1);
+    outb(SERIAL_COM1 + SERIAL_REG_IER, 0x00);
+    tx_active = false;
+    serial_polled = true;
+
+    // Flush the ring synchronously
+    while (tx_tail != tx_head) {
+        serial_poll_byte((uint8_t)tx_ring[tx_tail]);
+        tx_tail = (tx_tail + 1) & (SERIAL_TX_RING_SIZE - 1);
+    }
+
+    if (baud) {
+        // Let the shift register empty before changing the divisor
+        while (!(inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_TX_IDLE)) {
+            __asm__ volatile("pause");
+        }
+        serial_set_baud(baud);
+    }
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Get the number of bytes waiting in the transmit ring
+ */
+size_t serial_tx_pending(void) {
+    return (tx_head - tx_tail) & (SERIAL_TX_RING_SIZE - 1);
+}
+
+/**
+ * Read available input without blocking
+ */
+int serial_read(uint8_t *buffer, size_t size) {
+    if (!serial_present) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    if (serial_polled) {
+        while (count < size && (inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_DATA_READY)) {
+            buffer[count++] = inb(SERIAL_COM1 + SERIAL_REG_DATA);
+        }
+        return (int)count;
+    }
+
+    uint64_t flags = interrupts_save();
+    while (count < size && rx_tail != rx_head) {
+        buffer[count++] = rx_ring[rx_tail];
+        rx_tail = (rx_tail + 1) & (SERIAL_RX_RING_SIZE - 1);
+    }
+    interrupts_restore(flags);
+
+    return (int)count;
+}
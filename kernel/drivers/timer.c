@@ -4,10 +4,12 @@
 
 #include <kernel/timer.h>
 #include <kernel/isr.h>
-#include <kernel/pic.h>
+#include <kernel/irq.h>
+#include <kernel/softirq.h>
 #include <kernel/idt.h>
 #include <kernel/port.h>
 #include <kernel/vga.h>
+#include <kernel/tsc.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -17,25 +19,66 @@ static volatile uint64_t timer_ticks = 0;
 // Timer frequency in Hz
 static uint32_t timer_frequency = 0;
 
+// TSC frequency measured against the PIT
+static uint64_t tsc_khz = 0;
+
 // Optional callback function
 static void (*timer_callback)(void) = NULL;
 
+// Optional sampling hook (profiler)
+static void (*timer_sample_hook)(registers_t *regs) = NULL;
+
 /**
  * Timer interrupt handler
  */
 static void timer_handler(registers_t *regs) {
-    (void)regs;  // Unused
-
     // Increment tick counter
     timer_ticks++;
 
+    if (timer_sample_hook != NULL) {
+        timer_sample_hook(regs);
+    }
+
     // Call registered callback if any
     if (timer_callback != NULL) {
         timer_callback();
     }
 
-    // Send EOI to PIC
-    pic_send_eoi(IRQ_TIMER);
+    // Everything else happens in the timer softirq
+    softirq_raise(SOFTIRQ_TIMER);
+
+    // Acknowledge at the interrupt controller
+    irq_eoi(IRQ_TIMER);
+}
+
+/**
+ * Calibrate the TSC against PIT channel 2
+ *
+ * Channel 2 is gated through the speaker port and counts down in
+ * one-shot mode without raising an interrupt, so this works before
+ * interrupts are enabled.
+ */
+static void timer_calibrate_tsc(void) {
+    uint32_t count = (PIT_FREQUENCY * TIMER_TSC_CALIBRATE_MS) / 1000;
+
+    // Gate on, speaker off
+    uint8_t speaker = inb(PIT_SPEAKER_PORT);
+    outb(PIT_SPEAKER_PORT, (speaker & ~PIT_SPEAKER_DATA) & ~PIT_SPEAKER_GATE);
+
+    outb(PIT_COMMAND, PIT_CMD_CHAN2 | PIT_CMD_RW_BOTH | PIT_CMD_MODE0 | PIT_CMD_BINARY);
+    outb(PIT_CHANNEL2, count & 0xFF);
+    outb(PIT_CHANNEL2, (count >> 8) & 0xFF);
+
+    // Raising the gate starts the countdown
+    outb(PIT_SPEAKER_PORT, (speaker & ~PIT_SPEAKER_DATA) | PIT_SPEAKER_GATE);
+    uint64_t start = rdtsc();
+    while (!(inb(PIT_SPEAKER_PORT) & PIT_SPEAKER_OUT)) {
+        __asm__ volatile("pause");
+    }
+    uint64_t end = rdtsc();
+
+    outb(PIT_SPEAKER_PORT, speaker);
+    tsc_khz = (end - start) / TIMER_TSC_CALIBRATE_MS;
 }
 
 /**
@@ -43,7 +86,7 @@ static void timer_handler(registers_t *regs) {
  */
 void timer_init(uint32_t frequency) {
     // Register timer interrupt handler
-    isr_register_handler(IRQ_BASE + IRQ_TIMER, timer_handler);
+    irq_register_handler(IRQ_TIMER, timer_handler);
 
     // Calculate divisor
     uint32_t divisor = PIT_FREQUENCY / frequency;
@@ -59,11 +102,18 @@ void timer_init(uint32_t frequency) {
     // Save frequency
     timer_frequency = frequency;
 
+    timer_calibrate_tsc();
+
+    // Track how late ticks arrive, i.e. how long interrupts stay off
+    if (tsc_khz) {
+        isr_set_period(IRQ_BASE + IRQ_TIMER, tsc_khz * 1000 / frequency);
+    }
+
     // Unmask IRQ0 (timer)
-    pic_unmask_irq(IRQ_TIMER);
+    irq_unmask(IRQ_TIMER);
 
-    vga_printf("  Timer: Initialized at %u Hz (%u ms per tick)\n",
-               frequency, 1000 / frequency);
+    vga_printf("  Timer: Initialized at %u Hz (%u ms per tick), TSC %u MHz\n",
+               frequency, 1000 / frequency, (uint32_t)(tsc_khz / 1000));
 }
 
 /**
@@ -100,9 +150,23 @@ void timer_sleep_ms(uint64_t ms) {
     timer_wait_ticks(ticks);
 }
 
+/**
+ * Get the calibrated TSC frequency
+ */
+uint64_t timer_get_tsc_khz(void) {
+    return tsc_khz;
+}
+
 /**
  * Register a timer callback
  */
 void timer_register_callback(void (*callback)(void)) {
     timer_callback = callback;
 }
+
+/**
+ * Register a per-tick sampling hook
+ */
+void timer_register_sample_hook(void (*hook)(registers_t *regs)) {
+    timer_sample_hook = hook;
+}
@@ -1,17 +1,21 @@
 /**
  * VGA Text Mode Driver
- * Provides basic text output functionality
+ * Provides basic text output functionality. Output is composed in a
+ * shadow buffer in RAM and dirty cells are copied to VGA memory once per
+ * call, so scrolling and per-character writes do not touch MMIO.
  */
 
 #include <kernel/vga.h>
+#include <kernel/fbcon.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 25
 #define VGA_MEMORY 0xB8000
 
-// Current cursor position
+// Current cursor position (screen coordinates)
 static uint16_t cursor_x = 0;
 static uint16_t cursor_y = 0;
 
@@ -21,6 +25,19 @@ static uint8_t current_color = VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4);
 // VGA text buffer (initialized in vga_init to avoid issues with static initialization)
 static uint16_t *vga_buffer;
 
+// Shadow of the screen in normal RAM, used as a circular buffer of lines
+static uint16_t shadow[VGA_HEIGHT][VGA_WIDTH] __attribute__((aligned(8)));
+
+// Shadow line shown on screen row 0
+static uint16_t top_line = 0;
+
+// Dirty column range [lo, hi) per screen row; lo >= hi means clean
+static uint8_t dirty_lo[VGA_HEIGHT];
+static uint8_t dirty_hi[VGA_HEIGHT];
+
+// Output is routed to the framebuffer console
+static bool use_fbcon = false;
+
 /**
  * Make VGA entry from character and color
  */
@@ -28,12 +45,90 @@ static inline uint16_t vga_entry(char c, uint8_t color) {
     return (uint16_t)c | ((uint16_t)color << 8);
 }
 
+/**
+ * Get the shadow line for a screen row
+ */
+static inline uint16_t *vga_line(uint16_t y) {
+    uint16_t line = top_line + y;
+    if (line >= VGA_HEIGHT) {
+        line -= VGA_HEIGHT;
+    }
+    return shadow[line];
+}
+
+/**
+ * Mark columns of a screen row as needing a flush
+ */
+static inline void vga_mark_dirty(uint16_t y, uint16_t lo, uint16_t hi) {
+    if (dirty_lo[y] >= dirty_hi[y]) {
+        dirty_lo[y] = lo;
+        dirty_hi[y] = hi;
+        return;
+    }
+    if (lo < dirty_lo[y]) dirty_lo[y] = lo;
+    if (hi > dirty_hi[y]) dirty_hi[y] = hi;
+}
+
+/**
+ * Mark the whole screen dirty
+ */
+static void vga_mark_all_dirty(void) {
+    for (uint16_t y = 0; y < VGA_HEIGHT; y++) {
+        dirty_lo[y] = 0;
+        dirty_hi[y] = VGA_WIDTH;
+    }
+}
+
 /**
  * Set character at position
  */
 static void vga_putentryat(char c, uint8_t color, uint16_t x, uint16_t y) {
-    const uint16_t index = y * VGA_WIDTH + x;
-    vga_buffer[index] = vga_entry(c, color);
+    vga_line(y)[x] = vga_entry(c, color);
+    vga_mark_dirty(y, x, x + 1);
+}
+
+/**
+ * Copy cells to VGA memory, four at a time where aligned
+ */
+static void vga_copy_cells(volatile uint16_t *dst, const uint16_t *src, uint16_t count) {
+    while (count > 0 && ((uint64_t)dst & 7)) {
+        *dst++ = *src++;
+        count--;
+    }
+
+    volatile uint64_t *dst64 = (volatile uint64_t *)dst;
+    const uint64_t *src64 = (const uint64_t *)src;
+    for (; count >= 4; count -= 4) {
+        *dst64++ = *src64++;
+    }
+
+    dst = (volatile uint16_t *)dst64;
+    src = (const uint16_t *)src64;
+    while (count-- > 0) {
+        *dst++ = *src++;
+    }
+}
+
+/**
+ * Write dirty rows of the shadow buffer to VGA memory
+ */
+static void vga_flush(void) {
+    if (use_fbcon) {
+        fbcon_flush();
+        return;
+    }
+
+    for (uint16_t y = 0; y < VGA_HEIGHT; y++) {
+        uint16_t lo = dirty_lo[y];
+        uint16_t hi = dirty_hi[y];
+        if (lo >= hi) {
+            continue;
+        }
+
+        vga_copy_cells(vga_buffer + y * VGA_WIDTH + lo, vga_line(y) + lo, hi - lo);
+        dirty_lo[y] = VGA_WIDTH;
+        dirty_hi[y] = 0;
+    }
 }
 
 /**
@@ -53,13 +148,53 @@ void vga_init(void) {
  * Clear the screen
  */
 void vga_clear(void) {
+    if (use_fbcon) {
+        fbcon_clear(current_color);
+        cursor_x = 0;
+        cursor_y = 0;
+        return;
+    }
+
+    uint16_t blank = vga_entry(' ', current_color);
     for (uint16_t y = 0; y < VGA_HEIGHT; y++) {
         for (uint16_t x = 0; x < VGA_WIDTH; x++) {
-            vga_putentryat(' ', current_color, x, y);
+            shadow[y][x] = blank;
         }
     }
+    top_line = 0;
     cursor_x = 0;
     cursor_y = 0;
+
+    vga_mark_all_dirty();
+    vga_flush();
+}
+
+/**
+ * Route output to the framebuffer console
+ */
+void vga_use_framebuffer(void) {
+    if (use_fbcon || !fbcon_active()) {
+        return;
+    }
+
+    // Replay what was printed so far, dropping trailing blanks
+    for (uint16_t y = 0; y <= cursor_y && y < VGA_HEIGHT; y++) {
+        const uint16_t *line = vga_line(y);
+        uint16_t len = (y == cursor_y) ? cursor_x : VGA_WIDTH;
+        while (len > 0 && (line[len - 1] & 0xFF) == ' ') {
+            len--;
+        }
+
+        for (uint16_t x = 0; x < len; x++) {
+            fbcon_putchar((char)(line[x] & 0xFF), line[x] >> 8);
+        }
+        if (y < cursor_y) {
+            fbcon_putchar('\n', current_color);
+        }
+    }
+
+    use_fbcon = true;
+    vga_flush();
 }
 
 /**
@@ -71,20 +206,25 @@ void vga_setcolor(uint8_t color) {
 
 /**
  * Scroll screen up by one line
+ *
+ * Rotates the shadow line ring and blanks the line that wraps around;
+ * VGA memory is rewritten on the next flush.
  */
 static void vga_scroll(void) {
-    // Move all lines up
-    for (uint16_t y = 0; y < VGA_HEIGHT - 1; y++) {
-        for (uint16_t x = 0; x < VGA_WIDTH; x++) {
-            vga_buffer[y * VGA_WIDTH + x] = vga_buffer[(y + 1) * VGA_WIDTH + x];
-        }
+    uint16_t *recycled = shadow[top_line];
+
+    top_line++;
+    if (top_line >= VGA_HEIGHT) {
+        top_line = 0;
     }
 
     // Clear last line
+    uint16_t blank = vga_entry(' ', current_color);
     for (uint16_t x = 0; x < VGA_WIDTH; x++) {
-        vga_putentryat(' ', current_color, x, VGA_HEIGHT - 1);
+        recycled[x] = blank;
     }
 
+    vga_mark_all_dirty();
     cursor_y = VGA_HEIGHT - 1;
 }
 
@@ -100,9 +240,14 @@ static void vga_newline(void) {
 }
 
 /**
- * Put character at current cursor position
+ * Put character into the shadow buffer
  */
-void vga_putchar(char c) {
+static void vga_emit(char c) {
+    if (use_fbcon) {
+        fbcon_putchar(c, current_color);
+        return;
+    }
+
     if (c == '\n') {
         vga_newline();
         return;
@@ -138,21 +283,38 @@ void vga_putchar(char c) {
 }
 
 /**
- * Put string to screen
+ * Put string into the shadow buffer
  */
-void vga_puts(const char *str) {
+static void vga_emit_str(const char *str) {
     while (*str) {
-        vga_putchar(*str++);
+        vga_emit(*str++);
     }
 }
 
+/**
+ * Put character at current cursor position
+ */
+void vga_putchar(char c) {
+    vga_emit(c);
+    vga_flush();
+}
+
+/**
+ * Put string to screen
+ */
+void vga_puts(const char *str) {
+    vga_emit_str(str);
+    vga_flush();
+}
+
 /**
  * Put string with specific length
  */
 void vga_write(const char *data, size_t size) {
     for (size_t i = 0; i < size; i++) {
-        vga_putchar(data[i]);
+        vga_emit(data[i]);
     }
+    vga_flush();
 }
 
 /**
@@ -201,7 +363,7 @@ void vga_printf(const char *format, ...) {
 
     for (p = format; *p != '\0'; p++) {
         if (*p != '%') {
-            vga_putchar(*p);
+            vga_emit(*p);
             continue;
         }
 
@@ -209,50 +371,51 @@ void vga_printf(const char *format, ...) {
         switch (*p) {
             case 'c':
                 i = __builtin_va_arg(args, int);
-                vga_putchar((char)i);
+                vga_emit((char)i);
                 break;
 
             case 's':
                 s = __builtin_va_arg(args, char *);
-                vga_puts(s);
+                vga_emit_str(s);
                 break;
 
             case 'd':
             case 'i':
                 i = __builtin_va_arg(args, int);
                 itoa(i, buf, 10);
-                vga_puts(buf);
+                vga_emit_str(buf);
                 break;
 
             case 'u':
                 u = __builtin_va_arg(args, unsigned int);
                 itoa(u, buf, 10);
-                vga_puts(buf);
+                vga_emit_str(buf);
                 break;
 
             case 'x':
                 u = __builtin_va_arg(args, unsigned int);
                 itoa(u, buf, 16);
-                vga_puts(buf);
+                vga_emit_str(buf);
                 break;
 
             case 'p':
-                vga_puts("0x");
+                vga_emit_str("0x");
                 u = (unsigned long)__builtin_va_arg(args, void *);
                 itoa(u, buf, 16);
-                vga_puts(buf);
+                vga_emit_str(buf);
                 break;
 
             case '%':
-                vga_putchar('%');
+                vga_emit('%');
                 break;
 
             default:
-                vga_putchar('%');
-                vga_putchar(*p);
+                vga_emit('%');
+                vga_emit(*p);
                 break;
         }
     }
 
     __builtin_va_end(args);
+    vga_flush();
 }
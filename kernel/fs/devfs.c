@@ -0,0 +1,318 @@
+/**
+ * Device Filesystem (devfs) Implementation
+ *
+ * The directory is generated from the character and block device
+ * registries. Character device nodes pass the caller's whole buffer to
+ * the driver; block device nodes translate byte offsets to blocks and
+ * bounce only the partial blocks at either end of a request.
+ */
+
+#include <kernel/devfs.h>
+#include <kernel/chardev.h>
+#include <kernel/block.h>
+#include <kernel/heap.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+
+/**
+ * Cached device node
+ */
+typedef struct devfs_entry {
+    vfs_node_t node;             // Node handed out to the VFS
+    void *device;                // char_device_t or block_device_t
+    int in_use;                  // Is this entry active?
+} devfs_entry_t;
+
+static devfs_entry_t devfs_entries[DEVFS_MAX_NODES];
+static vfs_node_t devfs_root;
+static filesystem_t devfs_fs;
+
+// VFS operations forward declarations
+static int devfs_char_read(vfs_node_t *node, uint64_t offset, uint64_t size, void *buffer);
+static int devfs_char_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer);
+static int devfs_block_read(vfs_node_t *node, uint64_t offset, uint64_t size, void *buffer);
+static int devfs_block_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer);
+static vfs_node_t *devfs_readdir(vfs_node_t *node, uint32_t index);
+static vfs_node_t *devfs_finddir(vfs_node_t *node, const char *name);
+static int devfs_getdents(vfs_node_t *node, uint64_t *cookie, void *buffer, size_t size);
+
+/**
+ * Get (or create) the node for a device
+ */
+static vfs_node_t *devfs_get_node(void *device, int is_block) {
+    for (int i = 0; i < DEVFS_MAX_NODES; i++) {
+        if (devfs_entries[i].in_use && devfs_entries[i].device == device) {
+            return &devfs_entries[i].node;
+        }
+    }
+
+    for (int i = 0; i < DEVFS_MAX_NODES; i++) {
+        if (devfs_entries[i].in_use) {
+            continue;
+        }
+
+        devfs_entry_t *entry = &devfs_entries[i];
+        vfs_node_t *node = &entry->node;
+        memset(entry, 0, sizeof(devfs_entry_t));
+
+        node->inode = i + 1;  // Inode 0 is the root
+        node->type = FILE_TYPE_DEVICE;
+        node->permissions = 0666;
+        node->fs = &devfs_fs;
+        node->fs_data = device;
+
+        if (is_block) {
+            block_device_t *bdev = (block_device_t *)device;
+            strncpy(node->name, bdev->name, sizeof(node->name) - 1);
+            node->size = (uint32_t)bdev->size;
+            node->read = devfs_block_read;
+            node->write = devfs_block_write;
+        } else {
+            char_device_t *cdev = (char_device_t *)device;
+            strncpy(node->name, cdev->name, sizeof(node->name) - 1);
+            node->read = devfs_char_read;
+            node->write = devfs_char_write;
+        }
+
+        entry->device = device;
+        entry->in_use = 1;
+        return node;
+    }
+
+    return NULL;  // Node table full
+}
+
+/**
+ * Character device read
+ */
+static int devfs_char_read(vfs_node_t *node, uint64_t offset, uint64_t size, void *buffer) {
+    (void)offset;  // Character devices are not seekable
+    char_device_t *dev = (char_device_t *)node->fs_data;
+    if (!dev->read) {
+        return -1;
+    }
+    return dev->read(dev, buffer, size);
+}
+
+/**
+ * Character device write
+ */
+static int devfs_char_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer) {
+    (void)offset;
+    char_device_t *dev = (char_device_t *)node->fs_data;
+    if (!dev->write) {
+        return -1;
+    }
+    return dev->write(dev, buffer, size);
+}
+
+/**
+ * Block device read at arbitrary byte offset
+ */
+static int devfs_block_read(vfs_node_t *node, uint64_t offset, uint64_t size, void *buffer) {
+    block_device_t *dev = (block_device_t *)node->fs_data;
+    uint32_t bs = dev->block_size;
+
+    if (offset >= dev->size) {
+        return 0;  // End of device
+    }
+    if (size > dev->size - offset) {
+        size = dev->size - offset;
+    }
+
+    uint8_t *bounce = NULL;
+    uint8_t *out = (uint8_t *)buffer;
+    uint64_t done = 0;
+
+    while (done < size) {
+        uint64_t block = (offset + done) / bs;
+        uint32_t block_off = (offset + done) % bs;
+        uint64_t remaining = size - done;
+
+        // Whole blocks go straight into the caller's buffer
+        if (block_off == 0 && remaining >= bs) {
+            uint32_t count = remaining / bs;
+            if (dev->read_blocks(dev, block, count, out + done) != 0) {
+                break;
+            }
+            done += (uint64_t)count * bs;
+            continue;
+        }
+
+        if (!bounce && !(bounce = (uint8_t *)kmalloc(bs))) {
+            break;
+        }
+        if (dev->read_block(dev, block, bounce) != 0) {
+            break;
+        }
+
+        uint64_t chunk = bs - block_off;
+        if (chunk > remaining) {
+            chunk = remaining;
+        }
+        memcpy(out + done, bounce + block_off, chunk);
+        done += chunk;
+    }
+
+    kfree(bounce);
+    return done > 0 ? (int)done : -1;
+}
+
+/**
+ * Block device write at arbitrary byte offset
+ *
+ * Partial blocks are read, patched and written back.
+ */
+static int devfs_block_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer) {
+    block_device_t *dev = (block_device_t *)node->fs_data;
+    uint32_t bs = dev->block_size;
+
+    if (offset >= dev->size) {
+        return -1;  // No space left on device
+    }
+    if (size > dev->size - offset) {
+        size = dev->size - offset;
+    }
+
+    uint8_t *bounce = NULL;
+    const uint8_t *in = (const uint8_t *)buffer;
+    uint64_t done = 0;
+
+    while (done < size) {
+        uint64_t block = (offset + done) / bs;
+        uint32_t block_off = (offset + done) % bs;
+        uint64_t remaining = size - done;
+
+        if (block_off == 0 && remaining >= bs) {
+            uint32_t count = remaining / bs;
+            if (dev->write_blocks(dev, block, count, in + done) != 0) {
+                break;
+            }
+            done += (uint64_t)count * bs;
+            continue;
+        }
+
+        if (!bounce && !(bounce = (uint8_t *)kmalloc(bs))) {
+            break;
+        }
+        if (dev->read_block(dev, block, bounce) != 0) {
+            break;
+        }
+
+        uint64_t chunk = bs - block_off;
+        if (chunk > remaining) {
+            chunk = remaining;
+        }
+        memcpy(bounce + block_off, in + done, chunk);
+        if (dev->write_block(dev, block, bounce) != 0) {
+            break;
+        }
+        done += chunk;
+    }
+
+    kfree(bounce);
+    return done > 0 ? (int)done : -1;
+}
+
+/**
+ * Get directory entry by index
+ *
+ * Character devices come first, then block devices.
+ */
+static vfs_node_t *devfs_readdir(vfs_node_t *node, uint32_t index) {
+    (void)node;
+
+    uint32_t nchar = chardev_count();
+    if (index < nchar) {
+        return devfs_get_node(chardev_get_by_index(index), 0);
+    }
+
+    block_device_t *bdev = block_get_device_by_index(index - nchar);
+    if (bdev) {
+        return devfs_get_node(bdev, 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * Find device by name
+ */
+static vfs_node_t *devfs_finddir(vfs_node_t *node, const char *name) {
+    (void)node;
+
+    char_device_t *cdev = chardev_get(name);
+    if (cdev) {
+        return devfs_get_node(cdev, 0);
+    }
+
+    block_device_t *bdev = block_get_device(name);
+    if (bdev) {
+        return devfs_get_node(bdev, 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * Read a batch of directory entries
+ *
+ * The cookie is the index of the next device.
+ */
+static int devfs_getdents(vfs_node_t *node, uint64_t *cookie, void *buffer, size_t size) {
+    size_t written = 0;
+
+    while (1) {
+        vfs_node_t *entry = devfs_readdir(node, (uint32_t)*cookie);
+        if (!entry) {
+            break;
+        }
+
+        int reclen = vfs_fill_dirent64((uint8_t *)buffer + written, size - written,
+                                       entry->inode, entry->type, entry->name);
+        if (reclen == 0) {
+            if (written == 0) {
+                return -1;  // Buffer too small for a single entry
+            }
+            break;
+        }
+
+        written += reclen;
+        (*cookie)++;
+    }
+
+    return (int)written;
+}
+
+/**
+ * Get root node
+ */
+static vfs_node_t *devfs_get_root(filesystem_t *fs) {
+    (void)fs;
+    return &devfs_root;
+}
+
+/**
+ * Register devfs and mount it at /dev
+ */
+int devfs_init(void) {
+    memset(devfs_entries, 0, sizeof(devfs_entries));
+    memset(&devfs_fs, 0, sizeof(devfs_fs));
+    memset(&devfs_root, 0, sizeof(devfs_root));
+
+    strcpy(devfs_fs.name, "devfs");
+    devfs_fs.get_root = devfs_get_root;
+
+    strcpy(devfs_root.name, "dev");
+    devfs_root.type = FILE_TYPE_DIRECTORY;
+    devfs_root.fs = &devfs_fs;
+    devfs_root.readdir = devfs_readdir;
+    devfs_root.finddir = devfs_finddir;
+    devfs_root.getdents = devfs_getdents;
+
+    if (vfs_register_filesystem(&devfs_fs) != 0) {
+        return -1;
+    }
+
+    return vfs_mount("/dev", &devfs_fs);
+}
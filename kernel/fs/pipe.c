@@ -0,0 +1,479 @@
+/**
+ * Pipe and FIFO Implementation
+ *
+ * Data lives in a ring of whole physical pages. A write appends to the
+ * last page while it has room and otherwise starts a new page; a read
+ * drains the first page and releases it once empty. Because the unit
+ * of buffering is a page, pipe_give_page() and pipe_take_page() can
+ * move full pages between a pipe and kernel code without copying.
+ */
+
+#include <kernel/pipe.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/heap.h>
+#include <kernel/idt.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+
+/**
+ * Named FIFO table entry
+ */
+typedef struct fifo {
+    char path[256];              // Absolute path
+    vfs_node_t node;             // Node returned by path lookup
+    pipe_t *pipe;                // Backing pipe
+    int in_use;                  // Is this entry active?
+} fifo_t;
+
+static fifo_t fifos[MAX_FIFOS];
+static uint32_t next_pipe_id = 1;
+
+// VFS operations forward declarations
+static int pipe_vfs_read(vfs_node_t *node, uint64_t offset, uint64_t size, void *buffer);
+static int pipe_vfs_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer);
+static void pipe_vfs_close_read(vfs_node_t *node);
+static void pipe_vfs_close_write(vfs_node_t *node);
+
+/**
+ * Initialize pipe subsystem
+ */
+void pipe_init(void) {
+    memset(fifos, 0, sizeof(fifos));
+    next_pipe_id = 1;
+    vga_printf("  Pipe: Initialized (%u KB per pipe)\n", PIPE_RING_PAGES * PAGE_SIZE / 1024);
+}
+
+/**
+ * Allocate and initialize pipe state
+ */
+static pipe_t *pipe_alloc(void) {
+    pipe_t *pipe = (pipe_t *)kzalloc(sizeof(pipe_t));
+    if (!pipe) {
+        return NULL;
+    }
+
+    wait_queue_init(&pipe->read_wait);
+    wait_queue_init(&pipe->write_wait);
+    return pipe;
+}
+
+/**
+ * Release all pages still buffered in a pipe
+ */
+static void pipe_drain(pipe_t *pipe) {
+    while (pipe->count > 0) {
+        pipe_buffer_t *buf = &pipe->bufs[pipe->head];
+        pmm_free_page(buf->page);
+        buf->page = 0;
+        pipe->head = (pipe->head + 1) % PIPE_RING_PAGES;
+        pipe->count--;
+    }
+}
+
+/**
+ * Free a pipe once both ends are closed
+ */
+static void pipe_put(pipe_t *pipe) {
+    if (pipe->readers == 0 && pipe->writers == 0 && !pipe->named) {
+        pipe_drain(pipe);
+        kfree(pipe);
+    }
+}
+
+/**
+ * Create a VFS node for one end of a pipe
+ */
+static vfs_node_t *pipe_make_end(pipe_t *pipe, int write_end) {
+    vfs_node_t *node = (vfs_node_t *)kzalloc(sizeof(vfs_node_t));
+    if (!node) {
+        return NULL;
+    }
+
+    snprintf(node->name, sizeof(node->name), "pipe:[%u]", next_pipe_id);
+    node->inode = next_pipe_id++;
+    node->type = FILE_TYPE_FIFO;
+    node->fs_data = pipe;
+
+    if (write_end) {
+        node->write = pipe_vfs_write;
+        node->close = pipe_vfs_close_write;
+        pipe->writers++;
+        pipe->had_writer = 1;
+    } else {
+        node->read = pipe_vfs_read;
+        node->close = pipe_vfs_close_read;
+        pipe->readers++;
+    }
+
+    return node;
+}
+
+/**
+ * Wait until the pipe has data or no writer can ever supply more
+ *
+ * Returns 0 when data is available, -1 at end of file.
+ * Must be called with interrupts disabled.
+ */
+static int pipe_wait_data(pipe_t *pipe) {
+    while (pipe->count == 0) {
+        if (pipe->writers == 0 && pipe->had_writer) {
+            return -1;  // EOF
+        }
+        if (!wait_queue_sleep(&pipe->read_wait)) {
+            return -1;  // Cannot block without a process
+        }
+    }
+    return 0;
+}
+
+/**
+ * Wait until the pipe ring has a free slot
+ *
+ * Returns 0 when a slot is free, -1 if the read side is gone.
+ * Must be called with interrupts disabled.
+ */
+static int pipe_wait_space(pipe_t *pipe) {
+    while (pipe->count == PIPE_RING_PAGES) {
+        if (pipe->readers == 0) {
+            return -1;  // Broken pipe
+        }
+        if (!wait_queue_sleep(&pipe->write_wait)) {
+            return -1;
+        }
+    }
+    return pipe->readers == 0 ? -1 : 0;
+}
+
+/**
+ * Read from a pipe
+ *
+ * Blocks until at least one byte is available, then returns as much
+ * as is buffered up to size.
+ */
+static int pipe_read(pipe_t *pipe, uint8_t *buffer, uint64_t size) {
+    uint64_t flags = interrupts_save();
+
+    if (size == 0 || pipe_wait_data(pipe) != 0) {
+        interrupts_restore(flags);
+        return 0;
+    }
+
+    uint64_t copied = 0;
+    while (copied < size && pipe->count > 0) {
+        pipe_buffer_t *buf = &pipe->bufs[pipe->head];
+        uint64_t chunk = buf->len;
+        if (chunk > size - copied) {
+            chunk = size - copied;
+        }
+
+        memcpy(buffer + copied, (uint8_t *)vmm_phys_to_virt(buf->page) + buf->offset, chunk);
+        copied += chunk;
+        buf->offset += chunk;
+        buf->len -= chunk;
+
+        if (buf->len == 0) {
+            pmm_free_page(buf->page);
+            buf->page = 0;
+            pipe->head = (pipe->head + 1) % PIPE_RING_PAGES;
+            pipe->count--;
+        }
+    }
+
+    wait_queue_wake_all(&pipe->write_wait);
+    interrupts_restore(flags);
+    return (int)copied;
+}
+
+/**
+ * Write to a pipe
+ *
+ * Appends to the last page while it has room and starts new pages for
+ * the rest, so a large write costs one copy per page. Blocks while the
+ * ring is full. Returns bytes written (0 for an empty write), or -1 if
+ * there are no readers.
+ */
+static int pipe_write(pipe_t *pipe, const uint8_t *buffer, uint64_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    uint64_t flags = interrupts_save();
+    uint64_t written = 0;
+
+    while (written < size) {
+        if (pipe->readers == 0) {
+            break;
+        }
+
+        // Top up the last page if it has room
+        if (pipe->count > 0) {
+            uint32_t tail = (pipe->head + pipe->count - 1) % PIPE_RING_PAGES;
+            pipe_buffer_t *buf = &pipe->bufs[tail];
+            uint32_t end = buf->offset + buf->len;
+
+            if (end < PAGE_SIZE) {
+                uint64_t chunk = PAGE_SIZE - end;
+                if (chunk > size - written) {
+                    chunk = size - written;
+                }
+                memcpy((uint8_t *)vmm_phys_to_virt(buf->page) + end, buffer + written, chunk);
+                buf->len += chunk;
+                written += chunk;
+                wait_queue_wake_all(&pipe->read_wait);
+                continue;
+            }
+        }
+
+        if (pipe_wait_space(pipe) != 0) {
+            break;
+        }
+
+        uint64_t page = pmm_alloc_page();
+        if (page == 0) {
+            break;
+        }
+        pmm_set_owner(page, 1, PAGE_OWNER_PIPE, 0);
+
+        uint64_t chunk = size - written;
+        if (chunk > PAGE_SIZE) {
+            chunk = PAGE_SIZE;
+        }
+        memcpy((void *)vmm_phys_to_virt(page), buffer + written, chunk);
+
+        uint32_t tail = (pipe->head + pipe->count) % PIPE_RING_PAGES;
+        pipe->bufs[tail].page = page;
+        pipe->bufs[tail].offset = 0;
+        pipe->bufs[tail].len = chunk;
+        pipe->count++;
+        written += chunk;
+
+        wait_queue_wake_all(&pipe->read_wait);
+    }
+
+    interrupts_restore(flags);
+    return written > 0 ? (int)written : -1;
+}
+
+/**
+ * Hand a full page to a pipe without copying
+ */
+int pipe_give_page(pipe_t *pipe, uint64_t page, uint32_t len) {
+    if (!pipe || page == 0 || len > PAGE_SIZE) {
+        return -1;
+    }
+
+    uint64_t flags = interrupts_save();
+
+    if (pipe_wait_space(pipe) != 0) {
+        interrupts_restore(flags);
+        return -1;
+    }
+
+    uint32_t tail = (pipe->head + pipe->count) % PIPE_RING_PAGES;
+    pipe->bufs[tail].page = page;
+    pipe->bufs[tail].offset = 0;
+    pipe->bufs[tail].len = len;
+    pipe->count++;
+
+    wait_queue_wake_all(&pipe->read_wait);
+    interrupts_restore(flags);
+    return 0;
+}
+
+/**
+ * Take the next page out of a pipe without copying
+ */
+int pipe_take_page(pipe_t *pipe, uint64_t *page, uint32_t *offset) {
+    if (!pipe || !page || !offset) {
+        return -1;
+    }
+
+    uint64_t flags = interrupts_save();
+
+    if (pipe_wait_data(pipe) != 0) {
+        interrupts_restore(flags);
+        return 0;
+    }
+
+    pipe_buffer_t *buf = &pipe->bufs[pipe->head];
+    int len = (int)buf->len;
+    *page = buf->page;
+    *offset = buf->offset;
+
+    buf->page = 0;
+    pipe->head = (pipe->head + 1) % PIPE_RING_PAGES;
+    pipe->count--;
+
+    wait_queue_wake_all(&pipe->write_wait);
+    interrupts_restore(flags);
+    return len;
+}
+
+/**
+ * VFS read operation (read end)
+ */
+static int pipe_vfs_read(vfs_node_t *node, uint64_t offset, uint64_t size, void *buffer) {
+    (void)offset;  // Pipes are not seekable
+    return pipe_read((pipe_t *)node->fs_data, (uint8_t *)buffer, size);
+}
+
+/**
+ * VFS write operation (write end)
+ */
+static int pipe_vfs_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer) {
+    (void)offset;
+    return pipe_write((pipe_t *)node->fs_data, (const uint8_t *)buffer, size);
+}
+
+/**
+ * VFS close operation (read end)
+ */
+static void pipe_vfs_close_read(vfs_node_t *node) {
+    pipe_t *pipe = (pipe_t *)node->fs_data;
+    uint64_t flags = interrupts_save();
+
+    pipe->readers--;
+    wait_queue_wake_all(&pipe->write_wait);  // Writers see a broken pipe
+    if (pipe->readers == 0 && pipe->named) {
+        pipe_drain(pipe);
+    }
+    pipe_put(pipe);
+
+    interrupts_restore(flags);
+    kfree(node);
+}
+
+/**
+ * VFS close operation (write end)
+ */
+static void pipe_vfs_close_write(vfs_node_t *node) {
+    pipe_t *pipe = (pipe_t *)node->fs_data;
+    uint64_t flags = interrupts_save();
+
+    pipe->writers--;
+    wait_queue_wake_all(&pipe->read_wait);  // Readers see EOF
+    pipe_put(pipe);
+
+    interrupts_restore(flags);
+    kfree(node);
+}
+
+/**
+ * Create an anonymous pipe
+ */
+int pipe_create(int *read_fd, int *write_fd) {
+    if (!read_fd || !write_fd) {
+        return -1;
+    }
+
+    pipe_t *pipe = pipe_alloc();
+    if (!pipe) {
+        return -1;
+    }
+
+    vfs_node_t *read_end = pipe_make_end(pipe, 0);
+    vfs_node_t *write_end = pipe_make_end(pipe, 1);
+    if (!read_end || !write_end) {
+        kfree(read_end);
+        kfree(write_end);
+        kfree(pipe);
+        return -1;
+    }
+
+    int rfd = vfs_alloc_fd(read_end, O_RDONLY);
+    if (rfd < 0) {
+        kfree(read_end);
+        kfree(write_end);
+        kfree(pipe);
+        return -1;
+    }
+
+    int wfd = vfs_alloc_fd(write_end, O_WRONLY);
+    if (wfd < 0) {
+        vfs_free_fd(rfd);
+        kfree(read_end);
+        kfree(write_end);
+        kfree(pipe);
+        return -1;
+    }
+
+    *read_fd = rfd;
+    *write_fd = wfd;
+    return 0;
+}
+
+/**
+ * Create a named FIFO
+ */
+int pipe_mkfifo(const char *path) {
+    if (!path || path[0] != '/' || pipe_lookup_fifo(path)) {
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_FIFOS; i++) {
+        if (fifos[i].in_use) {
+            continue;
+        }
+
+        pipe_t *pipe = pipe_alloc();
+        if (!pipe) {
+            return -1;
+        }
+        pipe->named = 1;
+
+        fifo_t *fifo = &fifos[i];
+        memset(fifo, 0, sizeof(fifo_t));
+        strncpy(fifo->path, path, sizeof(fifo->path) - 1);
+
+        const char *base = strrchr(path, '/');
+        strncpy(fifo->node.name, base + 1, sizeof(fifo->node.name) - 1);
+        fifo->node.inode = next_pipe_id++;
+        fifo->node.type = FILE_TYPE_FIFO;
+        fifo->node.fs_data = pipe;
+        fifo->pipe = pipe;
+        fifo->in_use = 1;
+        return 0;
+    }
+
+    return -1;  // FIFO table full
+}
+
+/**
+ * Look up a named FIFO by path
+ */
+vfs_node_t *pipe_lookup_fifo(const char *path) {
+    for (int i = 0; i < MAX_FIFOS; i++) {
+        if (fifos[i].in_use && strcmp(fifos[i].path, path) == 0) {
+            return &fifos[i].node;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Open one end of a named FIFO
+ */
+vfs_node_t *pipe_open_fifo(vfs_node_t *fifo, uint32_t flags) {
+    if (!fifo || fifo->type != FILE_TYPE_FIFO) {
+        return NULL;
+    }
+
+    pipe_t *pipe = (pipe_t *)fifo->fs_data;
+    uint32_t mode = flags & (O_WRONLY | O_RDWR);
+    if (mode == O_RDWR) {
+        return NULL;  // Each descriptor is one end
+    }
+
+    uint64_t irq_flags = interrupts_save();
+    vfs_node_t *end = pipe_make_end(pipe, mode == O_WRONLY);
+    if (end) {
+        strncpy(end->name, fifo->name, sizeof(end->name) - 1);
+        if (mode == O_WRONLY) {
+            wait_queue_wake_all(&pipe->read_wait);
+        }
+    }
+    interrupts_restore(irq_flags);
+
+    return end;
+}
@@ -3,10 +3,21 @@
  */
 
 #include <kernel/simplefs.h>
+#include <kernel/crc32c.h>
 #include <kernel/heap.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
 #include <kernel/string.h>
 #include <kernel/vga.h>
 
+// Background scrubber pacing
+#define SIMPLEFS_SCRUB_STEP_TICKS   1      // Between inodes (10ms)
+#define SIMPLEFS_SCRUB_PASS_TICKS   6000   // Between passes (60s)
+#define SIMPLEFS_SCRUB_PRIORITY     30     // Just above idle
+
+// Filesystem being scrubbed
+static filesystem_t *scrub_fs = NULL;
+
 // VFS operations forward declarations
 static int simplefs_vfs_open(vfs_node_t *node, uint32_t flags);
 static void simplefs_vfs_close(vfs_node_t *node);
@@ -14,11 +25,94 @@ static int simplefs_vfs_read(vfs_node_t *node, uint64_t offset, uint64_t size, v
 static int simplefs_vfs_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer);
 static vfs_node_t *simplefs_vfs_readdir(vfs_node_t *node, uint32_t index);
 static vfs_node_t *simplefs_vfs_finddir(vfs_node_t *node, const char *name);
+static int simplefs_vfs_getdents(vfs_node_t *node, uint64_t *cookie, void *buffer, size_t size);
 
 // Filesystem operations forward declarations
 static int simplefs_fs_init(filesystem_t *fs, void *device);
 static void simplefs_fs_destroy(filesystem_t *fs);
 static vfs_node_t *simplefs_fs_get_root(filesystem_t *fs);
+static vfs_node_t *simplefs_fs_create_file(filesystem_t *vfs, const char *path, uint32_t permissions);
+static vfs_node_t *simplefs_fs_create_dir(filesystem_t *vfs, const char *path, uint32_t permissions);
+
+/**
+ * Stamp a metadata block with its number and checksum
+ */
+static void simplefs_csum_set(uint8_t *block, uint32_t block_num) {
+    simplefs_block_tail_t *tail = (simplefs_block_tail_t *)(block + SIMPLEFS_META_SIZE);
+    tail->block = block_num;
+    tail->checksum = crc32c(0, block, BLOCK_SIZE - sizeof(uint32_t));
+}
+
+/**
+ * Verify a metadata block's number and checksum
+ */
+static int simplefs_csum_verify(const uint8_t *block, uint32_t block_num) {
+    const simplefs_block_tail_t *tail = (const simplefs_block_tail_t *)(block + SIMPLEFS_META_SIZE);
+    if (tail->block != block_num) {
+        return -1;  // Misdirected write or stale block
+    }
+    return tail->checksum == crc32c(0, block, BLOCK_SIZE - sizeof(uint32_t)) ? 0 : -1;
+}
+
+/**
+ * Read and verify a metadata block
+ */
+static int simplefs_read_meta(simplefs_t *fs, uint32_t block_num, uint8_t *block) {
+    fs->blocks_read++;
+    if (fs->device->read_block(fs->device, block_num, block) != 0) {
+        return -1;
+    }
+
+    if (simplefs_csum_verify(block, block_num) != 0) {
+        fs->csum_errors++;
+        vga_printf("  SimpleFS: Checksum mismatch in block %u\n", block_num);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Checksum and write a metadata block
+ */
+static int simplefs_write_meta(block_device_t *device, uint32_t block_num, uint8_t *block) {
+    simplefs_csum_set(block, block_num);
+    return device->write_block(device, block_num, block);
+}
+
+/**
+ * Write the cached superblock
+ */
+static int simplefs_write_superblock(simplefs_t *fs) {
+    return simplefs_write_meta(fs->device, 0, (uint8_t *)&fs->superblock);
+}
+
+/**
+ * Block bitmap helpers
+ *
+ * Each bitmap block holds SIMPLEFS_META_SIZE bytes of bits, so bit n
+ * lives in bitmap block n / SIMPLEFS_BITS_PER_BITMAP_BLOCK.
+ */
+static inline int bitmap_test(const uint8_t *bitmap, uint32_t bit) {
+    return (bitmap[bit / 8] >> (bit % 8)) & 1;
+}
+
+static inline void bitmap_set(uint8_t *bitmap, uint32_t bit) {
+    bitmap[bit / 8] |= (uint8_t)(1 << (bit % 8));
+}
+
+static inline void bitmap_clear(uint8_t *bitmap, uint32_t bit) {
+    bitmap[bit / 8] &= (uint8_t)~(1 << (bit % 8));
+}
+
+/**
+ * Write one bitmap block from the in-memory bitmap
+ */
+static int simplefs_write_bitmap_block(simplefs_t *fs, uint32_t index) {
+    uint8_t block_data[BLOCK_SIZE];
+    memcpy(block_data, fs->block_bitmap + index * SIMPLEFS_META_SIZE, SIMPLEFS_META_SIZE);
+    return simplefs_write_meta(fs->device, fs->superblock.first_bitmap_block + index, block_data);
+}
 
 /**
  * Format a block device with SimpleFS
@@ -40,60 +134,74 @@ int simplefs_format(block_device_t *device) {
     sb.num_blocks = device->num_blocks;
     sb.num_inodes = SIMPLEFS_MAX_INODES;
     sb.first_inode_block = 1;
-    sb.first_data_block = 1 + SIMPLEFS_INODE_BLOCKS;
+    sb.first_bitmap_block = sb.first_inode_block + SIMPLEFS_INODE_BLOCKS;
+    sb.bitmap_blocks = (sb.num_blocks + SIMPLEFS_BITS_PER_BITMAP_BLOCK - 1) /
+                       SIMPLEFS_BITS_PER_BITMAP_BLOCK;
+    sb.first_data_block = sb.first_bitmap_block + sb.bitmap_blocks;
     sb.free_blocks = sb.num_blocks - sb.first_data_block;
     sb.free_inodes = sb.num_inodes;
+    sb.state = SIMPLEFS_STATE_CLEAN;
+    sb.features = SIMPLEFS_FEATURE_METADATA_CSUM | SIMPLEFS_FEATURE_INLINE_DATA;
+    sb.inode_size = sizeof(simplefs_inode_t);
 
-    // Write superblock to block 0
-    if (device->write_block(device, 0, (uint8_t *)&sb) != 0) {
-        vga_printf("  SimpleFS: Failed to write superblock\n");
+    if (sb.first_data_block >= sb.num_blocks) {
+        vga_printf("  SimpleFS: Device too small\n");
         return -1;
     }
 
-    // Initialize inode table (clear all inodes)
-    simplefs_inode_t empty_inode;
-    memset(&empty_inode, 0, sizeof(empty_inode));
-
-    uint8_t inode_block[BLOCK_SIZE];
-    memset(inode_block, 0, BLOCK_SIZE);
+    // Initialize inode table (clear all inodes, root is inode 0)
+    uint8_t block_data[BLOCK_SIZE];
 
     for (uint32_t i = 0; i < SIMPLEFS_INODE_BLOCKS; i++) {
-        if (device->write_block(device, sb.first_inode_block + i, inode_block) != 0) {
+        memset(block_data, 0, BLOCK_SIZE);
+
+        if (i == 0) {
+            simplefs_inode_t *root_inode = (simplefs_inode_t *)block_data;
+            root_inode->number = 0;
+            root_inode->type = SIMPLEFS_TYPE_DIR;
+            root_inode->size = 0;
+            root_inode->blocks = 1;
+            root_inode->direct[0] = sb.first_data_block;  // First data block for root
+        }
+
+        if (simplefs_write_meta(device, sb.first_inode_block + i, block_data) != 0) {
             vga_printf("  SimpleFS: Failed to write inode block %u\n", i);
             return -1;
         }
     }
 
-    // Create root directory (inode 0)
-    simplefs_inode_t root_inode;
-    memset(&root_inode, 0, sizeof(root_inode));
-    root_inode.number = 0;
-    root_inode.type = SIMPLEFS_TYPE_DIR;
-    root_inode.size = 0;
-    root_inode.blocks = 1;
-    root_inode.direct[0] = sb.first_data_block;  // Allocate first data block for root
+    // Initialize block bitmap: metadata and the root directory block are in use
+    for (uint32_t i = 0; i < sb.bitmap_blocks; i++) {
+        memset(block_data, 0, BLOCK_SIZE);
 
-    // Write root inode
-    memcpy(inode_block, &root_inode, sizeof(root_inode));
-    if (device->write_block(device, sb.first_inode_block, inode_block) != 0) {
-        vga_printf("  SimpleFS: Failed to write root inode\n");
-        return -1;
+        uint32_t first_bit = i * SIMPLEFS_BITS_PER_BITMAP_BLOCK;
+        for (uint32_t bit = 0; bit < SIMPLEFS_BITS_PER_BITMAP_BLOCK; bit++) {
+            uint32_t block = first_bit + bit;
+            if (block <= sb.first_data_block || block >= sb.num_blocks) {
+                bitmap_set(block_data, bit);
+            }
+        }
+
+        if (simplefs_write_meta(device, sb.first_bitmap_block + i, block_data) != 0) {
+            vga_printf("  SimpleFS: Failed to write bitmap block %u\n", i);
+            return -1;
+        }
     }
 
     // Initialize root directory block (empty)
-    uint8_t data_block[BLOCK_SIZE];
-    memset(data_block, 0, BLOCK_SIZE);
-    if (device->write_block(device, sb.first_data_block, data_block) != 0) {
+    memset(block_data, 0, BLOCK_SIZE);
+    if (simplefs_write_meta(device, sb.first_data_block, block_data) != 0) {
         vga_printf("  SimpleFS: Failed to write root directory block\n");
         return -1;
     }
 
-    // Update superblock with allocated resources
+    // Account for allocated resources
     sb.free_inodes--;  // Root inode
     sb.free_blocks--;  // Root directory block
 
-    // Write updated superblock
-    if (device->write_block(device, 0, (uint8_t *)&sb) != 0) {
+    // Write superblock last so a partial format is never mountable
+    if (simplefs_write_meta(device, 0, (uint8_t *)&sb) != 0) {
+        vga_printf("  SimpleFS: Failed to write superblock\n");
         return -1;
     }
 
@@ -104,59 +212,306 @@ int simplefs_format(block_device_t *device) {
 }
 
 /**
- * Read inode from disk
+ * Locate an inode on disk
+ */
+static inline uint32_t simplefs_inode_block(simplefs_t *fs, uint32_t inode_num) {
+    return fs->superblock.first_inode_block + inode_num / SIMPLEFS_INODES_PER_BLOCK;
+}
+
+/**
+ * Get the cached copy of an inode, loading its block on a miss
+ *
+ * Every inode sharing the block is cached at the same time. The
+ * returned pointer stays valid until unmount and is what VFS nodes
+ * point at, so all nodes for a file see the same inode.
+ */
+static simplefs_inode_t *simplefs_get_inode(simplefs_t *fs, uint32_t inode_num) {
+    if (inode_num >= fs->superblock.num_inodes) {
+        return NULL;
+    }
+
+    if (!fs->inode_cached[inode_num]) {
+        uint8_t block_data[BLOCK_SIZE];
+        if (simplefs_read_meta(fs, simplefs_inode_block(fs, inode_num), block_data) != 0) {
+            return NULL;
+        }
+
+        uint32_t first = inode_num - inode_num % SIMPLEFS_INODES_PER_BLOCK;
+        for (uint32_t i = 0; i < SIMPLEFS_INODES_PER_BLOCK; i++) {
+            if (first + i < fs->superblock.num_inodes && !fs->inode_cached[first + i]) {
+                memcpy(&fs->inode_cache[first + i], block_data + i * sizeof(simplefs_inode_t),
+                       sizeof(simplefs_inode_t));
+                fs->inode_cached[first + i] = 1;
+            }
+        }
+    }
+
+    return &fs->inode_cache[inode_num];
+}
+
+/**
+ * Forget cached inodes
+ *
+ * The cache is write-through, so nothing needs writing back. The slots
+ * themselves stay put: open nodes keep their pointers, and the reload
+ * copies the same contents back into them.
+ */
+void simplefs_drop_inode_cache(simplefs_t *fs) {
+    memset(fs->inode_cached, 0, fs->superblock.num_inodes);
+}
+
+/**
+ * Read inode
  */
 int simplefs_read_inode(simplefs_t *fs, uint32_t inode_num, simplefs_inode_t *inode) {
-    if (!fs || !inode || inode_num >= fs->superblock.num_inodes) {
+    if (!fs || !inode) {
         return -1;
     }
 
-    // Calculate which block and offset
-    uint32_t inodes_per_block = BLOCK_SIZE / sizeof(simplefs_inode_t);
-    uint32_t block_num = fs->superblock.first_inode_block + (inode_num / inodes_per_block);
-    uint32_t offset = (inode_num % inodes_per_block) * sizeof(simplefs_inode_t);
-
-    // Read inode block
-    uint8_t block_data[BLOCK_SIZE];
-    if (fs->device->read_block(fs->device, block_num, block_data) != 0) {
+    simplefs_inode_t *cached = simplefs_get_inode(fs, inode_num);
+    if (!cached) {
         return -1;
     }
 
-    // Copy inode data
-    memcpy(inode, block_data + offset, sizeof(simplefs_inode_t));
+    memcpy(inode, cached, sizeof(simplefs_inode_t));
     return 0;
 }
 
 /**
- * Write inode to disk
+ * Write inode (through the cache to disk)
  */
 int simplefs_write_inode(simplefs_t *fs, uint32_t inode_num, const simplefs_inode_t *inode) {
     if (!fs || !inode || inode_num >= fs->superblock.num_inodes) {
         return -1;
     }
 
-    // Calculate which block and offset
-    uint32_t inodes_per_block = BLOCK_SIZE / sizeof(simplefs_inode_t);
-    uint32_t block_num = fs->superblock.first_inode_block + (inode_num / inodes_per_block);
-    uint32_t offset = (inode_num % inodes_per_block) * sizeof(simplefs_inode_t);
+    // Load the block's inodes so the whole block can be rebuilt from cache
+    if (!simplefs_get_inode(fs, inode_num)) {
+        return -1;
+    }
+
+    simplefs_inode_t *cached = &fs->inode_cache[inode_num];
+    if (cached != inode) {
+        memcpy(cached, inode, sizeof(simplefs_inode_t));
+    }
 
-    // Read existing block
     uint8_t block_data[BLOCK_SIZE];
-    if (fs->device->read_block(fs->device, block_num, block_data) != 0) {
+    memset(block_data, 0, BLOCK_SIZE);
+
+    uint32_t first = inode_num - inode_num % SIMPLEFS_INODES_PER_BLOCK;
+    for (uint32_t i = 0; i < SIMPLEFS_INODES_PER_BLOCK; i++) {
+        if (first + i < fs->superblock.num_inodes) {
+            memcpy(block_data + i * sizeof(simplefs_inode_t), &fs->inode_cache[first + i],
+                   sizeof(simplefs_inode_t));
+        }
+    }
+
+    // Write block back with a fresh checksum
+    if (simplefs_write_meta(fs->device, simplefs_inode_block(fs, inode_num), block_data) != 0) {
         return -1;
     }
 
-    // Update inode data
-    memcpy(block_data + offset, inode, sizeof(simplefs_inode_t));
+    return 0;
+}
 
-    // Write block back
-    if (fs->device->write_block(fs->device, block_num, block_data) != 0) {
-        return -1;
+/**
+ * Allocate a data block
+ *
+ * Returns the block number, or 0 if the filesystem is full.
+ */
+uint32_t simplefs_alloc_block(simplefs_t *fs) {
+    if (!fs || fs->superblock.free_blocks == 0) {
+        return 0;
+    }
+
+    for (uint32_t block = fs->superblock.first_data_block; block < fs->superblock.num_blocks; block++) {
+        if (bitmap_test(fs->block_bitmap, block)) {
+            continue;
+        }
+
+        bitmap_set(fs->block_bitmap, block);
+        if (simplefs_write_bitmap_block(fs, block / SIMPLEFS_BITS_PER_BITMAP_BLOCK) != 0) {
+            bitmap_clear(fs->block_bitmap, block);
+            return 0;
+        }
+
+        fs->superblock.free_blocks--;
+        return block;
     }
 
     return 0;
 }
 
+/**
+ * Free a data block
+ */
+void simplefs_free_block(simplefs_t *fs, uint32_t block_num) {
+    if (!fs || block_num < fs->superblock.first_data_block ||
+        block_num >= fs->superblock.num_blocks ||
+        !bitmap_test(fs->block_bitmap, block_num)) {
+        return;
+    }
+
+    bitmap_clear(fs->block_bitmap, block_num);
+    simplefs_write_bitmap_block(fs, block_num / SIMPLEFS_BITS_PER_BITMAP_BLOCK);
+    fs->superblock.free_blocks++;
+}
+
+/**
+ * Allocate an inode
+ *
+ * Scans the inode table for a free slot and claims it on disk.
+ * Returns the inode number, or 0 if none is free (inode 0 is the root).
+ */
+uint32_t simplefs_alloc_inode(simplefs_t *fs) {
+    if (!fs || fs->superblock.free_inodes == 0) {
+        return 0;
+    }
+
+    for (uint32_t num = 1; num < fs->superblock.num_inodes; num++) {
+        simplefs_inode_t *inode = simplefs_get_inode(fs, num);
+        if (!inode || inode->type != 0) {
+            continue;  // In use, or damaged and not safe to reuse
+        }
+
+        memset(inode, 0, sizeof(simplefs_inode_t));
+        inode->number = num;
+        inode->type = SIMPLEFS_TYPE_FILE;  // Claimed; caller sets real type
+
+        if (simplefs_write_inode(fs, num, inode) != 0) {
+            inode->type = 0;
+            return 0;
+        }
+
+        fs->superblock.free_inodes--;
+        return num;
+    }
+
+    return 0;
+}
+
+/**
+ * Free an inode
+ */
+void simplefs_free_inode(simplefs_t *fs, uint32_t inode_num) {
+    if (!fs || inode_num == 0 || inode_num >= fs->superblock.num_inodes) {
+        return;
+    }
+
+    simplefs_inode_t inode;
+    memset(&inode, 0, sizeof(inode));
+    inode.number = inode_num;
+
+    if (simplefs_write_inode(fs, inode_num, &inode) == 0) {
+        fs->superblock.free_inodes++;
+    }
+}
+
+/**
+ * Full consistency check
+ *
+ * Verifies every inode block and directory block checksum, rebuilds
+ * the block bitmap from the blocks inodes actually reference and
+ * recomputes the free counts. Only run when the superblock was not
+ * marked clean, so a normal mount never pays for it.
+ */
+int simplefs_check(simplefs_t *fs) {
+    simplefs_superblock_t *sb = &fs->superblock;
+    uint32_t bitmap_bytes = sb->bitmap_blocks * SIMPLEFS_META_SIZE;
+    uint8_t *bitmap = (uint8_t *)kzalloc(bitmap_bytes);
+    if (!bitmap) {
+        return -1;
+    }
+
+    int problems = 0;
+    uint32_t used_inodes = 0;
+    uint8_t block_data[BLOCK_SIZE];
+    uint8_t dir_data[BLOCK_SIZE];
+
+    // Metadata and blocks past the end of the device are always in use
+    for (uint32_t bit = 0; bit < bitmap_bytes * 8; bit++) {
+        if (bit < sb->first_data_block || bit >= sb->num_blocks) {
+            bitmap_set(bitmap, bit);
+        }
+    }
+
+    for (uint32_t b = 0; b < SIMPLEFS_INODE_BLOCKS; b++) {
+        if (simplefs_read_meta(fs, sb->first_inode_block + b, block_data) != 0) {
+            problems++;
+            continue;
+        }
+
+        simplefs_inode_t *inodes = (simplefs_inode_t *)block_data;
+        for (uint32_t i = 0; i < SIMPLEFS_INODES_PER_BLOCK; i++) {
+            simplefs_inode_t *inode = &inodes[i];
+            if (b * SIMPLEFS_INODES_PER_BLOCK + i >= sb->num_inodes || inode->type == 0) {
+                continue;
+            }
+            used_inodes++;
+
+            if (inode->flags & SIMPLEFS_INODE_INLINE) {
+                continue;  // No blocks to account for
+            }
+
+            for (uint32_t d = 0; d < SIMPLEFS_MAX_FILE_BLOCKS; d++) {
+                uint32_t block = inode->direct[d];
+                if (block == 0) {
+                    continue;
+                }
+
+                if (block < sb->first_data_block || block >= sb->num_blocks) {
+                    vga_printf("  SimpleFS: Inode %u points outside data area (%u)\n",
+                               inode->number, block);
+                    problems++;
+                    continue;
+                }
+
+                if (bitmap_test(bitmap, block)) {
+                    vga_printf("  SimpleFS: Block %u referenced twice\n", block);
+                    problems++;
+                }
+                bitmap_set(bitmap, block);
+
+                if (inode->type == SIMPLEFS_TYPE_DIR &&
+                    simplefs_read_meta(fs, block, dir_data) != 0) {
+                    problems++;
+                }
+            }
+        }
+    }
+
+    // Adopt the rebuilt bitmap and counts
+    uint32_t free_blocks = 0;
+    for (uint32_t block = sb->first_data_block; block < sb->num_blocks; block++) {
+        if (!bitmap_test(bitmap, block)) {
+            free_blocks++;
+        }
+    }
+
+    if (memcmp(bitmap, fs->block_bitmap, bitmap_bytes) != 0) {
+        vga_printf("  SimpleFS: Block bitmap out of date, rebuilding\n");
+        problems++;
+        memcpy(fs->block_bitmap, bitmap, bitmap_bytes);
+        for (uint32_t i = 0; i < sb->bitmap_blocks; i++) {
+            simplefs_write_bitmap_block(fs, i);
+        }
+    }
+
+    sb->free_blocks = free_blocks;
+    sb->free_inodes = sb->num_inodes - used_inodes;
+
+    kfree(bitmap);
+    return problems;
+}
+
+/**
+ * Read a data block, counting it
+ */
+static int simplefs_read_data(simplefs_t *fs, uint32_t block_num, uint8_t *block) {
+    fs->blocks_read++;
+    return fs->device->read_block(fs->device, block_num, block);
+}
+
 /**
  * VFS read operation
  */
@@ -182,6 +537,12 @@ static int simplefs_vfs_read(vfs_node_t *node, uint64_t offset, uint64_t size, v
         to_read = inode->size - offset;
     }
 
+    // Inline data is already in memory with the inode
+    if (inode->flags & SIMPLEFS_INODE_INLINE) {
+        memcpy(buffer, inode->inline_data + offset, to_read);
+        return to_read;
+    }
+
     uint64_t bytes_read = 0;
     uint8_t block_buffer[BLOCK_SIZE];
 
@@ -202,7 +563,7 @@ static int simplefs_vfs_read(vfs_node_t *node, uint64_t offset, uint64_t size, v
         }
 
         // Read block
-        if (fs->device->read_block(fs->device, physical_block, block_buffer) != 0) {
+        if (simplefs_read_data(fs, physical_block, block_buffer) != 0) {
             return -1;
         }
 
@@ -215,28 +576,197 @@ static int simplefs_vfs_read(vfs_node_t *node, uint64_t offset, uint64_t size, v
 }
 
 /**
- * VFS write operation (stub for now)
+ * Move inline data out to a data block
+ *
+ * Called when a write would grow an inline file past the inline area.
+ */
+static int simplefs_uninline(simplefs_t *fs, simplefs_inode_t *inode) {
+    uint32_t block = simplefs_alloc_block(fs);
+    if (block == 0) {
+        return -1;
+    }
+
+    uint8_t block_buffer[BLOCK_SIZE];
+    memset(block_buffer, 0, BLOCK_SIZE);
+    memcpy(block_buffer, inode->inline_data, inode->size);
+
+    if (fs->device->write_block(fs->device, block, block_buffer) != 0) {
+        simplefs_free_block(fs, block);
+        return -1;
+    }
+
+    memset(inode->inline_data, 0, SIMPLEFS_INLINE_SIZE);
+    inode->flags &= ~SIMPLEFS_INODE_INLINE;
+    inode->direct[0] = block;
+    inode->blocks = 1;
+    return 0;
+}
+
+/**
+ * VFS write operation
+ *
+ * Files start out inline and stay inline while they fit; the first
+ * write past SIMPLEFS_INLINE_SIZE moves the data to a block.
  */
 static int simplefs_vfs_write(vfs_node_t *node, uint64_t offset, uint64_t size, const void *buffer) {
-    // TODO: Implement write functionality
-    (void)node; (void)offset; (void)size; (void)buffer;
-    return -1;  // Not implemented yet
+    if (!node || !buffer) {
+        return -1;
+    }
+
+    simplefs_t *fs = (simplefs_t *)node->fs->fs_data;
+    simplefs_inode_t *inode = (simplefs_inode_t *)node->fs_data;
+
+    if (!inode || inode->type != SIMPLEFS_TYPE_FILE) {
+        return -1;  // Can only write files
+    }
+
+    uint64_t max_size = (uint64_t)SIMPLEFS_MAX_FILE_BLOCKS * BLOCK_SIZE;
+    if (offset >= max_size) {
+        return -1;  // Beyond file limits
+    }
+    if (offset + size > max_size) {
+        size = max_size - offset;
+    }
+
+    uint64_t end = offset + size;
+
+    if (inode->flags & SIMPLEFS_INODE_INLINE) {
+        if (end <= SIMPLEFS_INLINE_SIZE) {
+            memcpy(inode->inline_data + offset, buffer, size);
+            if (end > inode->size) {
+                inode->size = end;
+            }
+            node->size = inode->size;
+            return simplefs_write_inode(fs, inode->number, inode) == 0 ? (int)size : -1;
+        }
+
+        if (simplefs_uninline(fs, inode) != 0) {
+            return -1;
+        }
+    }
+
+    uint64_t written = 0;
+    uint8_t block_buffer[BLOCK_SIZE];
+
+    while (written < size) {
+        uint64_t block_index = (offset + written) / BLOCK_SIZE;
+        uint64_t block_offset = (offset + written) % BLOCK_SIZE;
+        uint64_t block_remaining = BLOCK_SIZE - block_offset;
+        uint64_t to_copy = (size - written < block_remaining) ?
+                           size - written : block_remaining;
+
+        uint32_t physical_block = inode->direct[block_index];
+        if (physical_block == 0) {
+            physical_block = simplefs_alloc_block(fs);
+            if (physical_block == 0) {
+                break;  // Filesystem full
+            }
+            inode->direct[block_index] = physical_block;
+            inode->blocks++;
+            memset(block_buffer, 0, BLOCK_SIZE);
+        } else if (to_copy < BLOCK_SIZE) {
+            // Partial block: read-modify-write
+            if (simplefs_read_data(fs, physical_block, block_buffer) != 0) {
+                break;
+            }
+        }
+
+        memcpy(block_buffer + block_offset, (const uint8_t *)buffer + written, to_copy);
+        if (fs->device->write_block(fs->device, physical_block, block_buffer) != 0) {
+            break;
+        }
+        written += to_copy;
+    }
+
+    if (offset + written > inode->size) {
+        inode->size = offset + written;
+    }
+    node->size = inode->size;
+
+    if (simplefs_write_inode(fs, inode->number, inode) != 0) {
+        return -1;
+    }
+
+    return written > 0 ? (int)written : -1;
 }
 
 /**
  * VFS open operation
  */
 static int simplefs_vfs_open(vfs_node_t *node, uint32_t flags) {
-    (void)node; (void)flags;
-    return 0;  // Simple filesystems don't need complex open logic
+    if (!(flags & O_TRUNC) || !(flags & (O_WRONLY | O_RDWR))) {
+        return 0;
+    }
+
+    // Truncate to zero length; an empty file starts inline again
+    simplefs_t *fs = (simplefs_t *)node->fs->fs_data;
+    simplefs_inode_t *inode = (simplefs_inode_t *)node->fs_data;
+    if (!inode || inode->type != SIMPLEFS_TYPE_FILE) {
+        return -1;
+    }
+
+    if (!(inode->flags & SIMPLEFS_INODE_INLINE)) {
+        for (uint32_t i = 0; i < SIMPLEFS_MAX_FILE_BLOCKS; i++) {
+            if (inode->direct[i]) {
+                simplefs_free_block(fs, inode->direct[i]);
+            }
+        }
+    }
+
+    memset(inode->inline_data, 0, SIMPLEFS_INLINE_SIZE);
+    inode->flags |= SIMPLEFS_INODE_INLINE;
+    inode->size = 0;
+    inode->blocks = 0;
+    node->size = 0;
+
+    return simplefs_write_inode(fs, inode->number, inode);
 }
 
 /**
  * VFS close operation
+ *
+ * Nodes other than the mount root are allocated per lookup, so the
+ * last user frees them. The inode itself stays in the inode cache.
  */
 static void simplefs_vfs_close(vfs_node_t *node) {
-    (void)node;
-    // Nothing to do for simple filesystem
+    if (node && node->inode != 0) {
+        kfree(node);
+    }
+}
+
+/**
+ * Create a VFS node for an inode
+ */
+static vfs_node_t *simplefs_make_node(filesystem_t *vfs, uint32_t inode_num, const char *name) {
+    simplefs_t *fs = (simplefs_t *)vfs->fs_data;
+
+    simplefs_inode_t *inode = simplefs_get_inode(fs, inode_num);
+    if (!inode) {
+        return NULL;
+    }
+
+    vfs_node_t *node = (vfs_node_t *)kmalloc(sizeof(vfs_node_t));
+    if (!node) {
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(vfs_node_t));
+    strncpy(node->name, name, sizeof(node->name) - 1);
+    node->inode = inode_num;
+    node->type = inode->type == SIMPLEFS_TYPE_DIR ? FILE_TYPE_DIRECTORY : FILE_TYPE_REGULAR;
+    node->size = inode->size;
+    node->fs = vfs;
+    node->fs_data = inode;
+
+    node->read = simplefs_vfs_read;
+    node->write = simplefs_vfs_write;
+    node->open = simplefs_vfs_open;
+    node->close = simplefs_vfs_close;
+    node->readdir = simplefs_vfs_readdir;
+    node->finddir = simplefs_vfs_finddir;
+    node->getdents = simplefs_vfs_getdents;
+
+    return node;
 }
 
 /**
@@ -254,120 +784,326 @@ static vfs_node_t *simplefs_vfs_readdir(vfs_node_t *node, uint32_t index) {
         return NULL;  // Not a directory
     }
 
-    // Read directory entries from first direct block
-    if (inode->direct[0] == 0) {
-        return NULL;  // Empty directory
+    // Locate the directory block holding this entry
+    uint32_t block_index = index / SIMPLEFS_DIRENTS_PER_BLOCK;
+    if (block_index >= SIMPLEFS_MAX_FILE_BLOCKS || inode->direct[block_index] == 0) {
+        return NULL;  // Past end of directory
     }
 
     uint8_t block_data[BLOCK_SIZE];
-    if (fs->device->read_block(fs->device, inode->direct[0], block_data) != 0) {
+    if (simplefs_read_meta(fs, inode->direct[block_index], block_data) != 0) {
         return NULL;
     }
 
     simplefs_direntry_t *entries = (simplefs_direntry_t *)block_data;
-    uint32_t max_entries = BLOCK_SIZE / sizeof(simplefs_direntry_t);
+    simplefs_direntry_t *entry = &entries[index % SIMPLEFS_DIRENTS_PER_BLOCK];
+    if (entry->inode == 0) {
+        return NULL;  // Empty entry
+    }
 
-    if (index >= max_entries) {
-        return NULL;
+    // On-disk names are not guaranteed to be terminated
+    char name[SIMPLEFS_MAX_FILENAME + 1];
+    memcpy(name, entry->name, SIMPLEFS_MAX_FILENAME);
+    name[SIMPLEFS_MAX_FILENAME] = '\0';
+
+    return simplefs_make_node(node->fs, entry->inode, name);
+}
+
+/**
+ * VFS getdents operation
+ *
+ * Walks the directory's data blocks once, reading each block a single
+ * time and packing every used entry that fits into the caller's buffer.
+ * The cookie is the flat entry index across all direct blocks.
+ */
+static int simplefs_vfs_getdents(vfs_node_t *node, uint64_t *cookie, void *buffer, size_t size) {
+    if (!node || !cookie || !buffer) {
+        return -1;
     }
 
-    simplefs_direntry_t *entry = &entries[index];
-    if (entry->inode == 0) {
-        return NULL;  // Empty entry
+    simplefs_t *fs = (simplefs_t *)node->fs->fs_data;
+    simplefs_inode_t *inode = (simplefs_inode_t *)node->fs_data;
+
+    if (!inode || inode->type != SIMPLEFS_TYPE_DIR) {
+        return -1;  // Not a directory
     }
 
-    // Create VFS node for this entry
-    vfs_node_t *child = (vfs_node_t *)kmalloc(sizeof(vfs_node_t));
-    if (!child) {
-        return NULL;
+    uint32_t entries_per_block = SIMPLEFS_DIRENTS_PER_BLOCK;
+    uint64_t pos = *cookie;
+    size_t written = 0;
+    uint8_t block_data[BLOCK_SIZE];
+
+    while (pos < (uint64_t)SIMPLEFS_MAX_FILE_BLOCKS * entries_per_block) {
+        uint32_t block_index = pos / entries_per_block;
+        if (inode->direct[block_index] == 0) {
+            break;  // End of directory
+        }
+
+        if (simplefs_read_meta(fs, inode->direct[block_index], block_data) != 0) {
+            return -1;
+        }
+
+        simplefs_direntry_t *entries = (simplefs_direntry_t *)block_data;
+
+        for (uint32_t slot = pos % entries_per_block; slot < entries_per_block; slot++) {
+            simplefs_direntry_t *entry = &entries[slot];
+            if (entry->inode != 0) {
+                // On-disk names are not guaranteed to be terminated
+                char name[SIMPLEFS_MAX_FILENAME + 1];
+                memcpy(name, entry->name, SIMPLEFS_MAX_FILENAME);
+                name[SIMPLEFS_MAX_FILENAME] = '\0';
+
+                int reclen = vfs_fill_dirent64((uint8_t *)buffer + written, size - written,
+                                               entry->inode, entry->type, name);
+                if (reclen == 0) {
+                    *cookie = pos;
+                    return written ? (int)written : -1;  // -1: buffer too small
+                }
+                written += reclen;
+            }
+            pos++;
+        }
+    }
+
+    *cookie = pos;
+    return (int)written;
+}
+
+/**
+ * Find a name in a directory
+ *
+ * Reads each directory block once and compares names in place.
+ * Returns the inode number, or 0 if not found.
+ */
+static uint32_t simplefs_dir_lookup(simplefs_t *fs, simplefs_inode_t *dir, const char *name) {
+    uint8_t block_data[BLOCK_SIZE];
+
+    for (uint32_t b = 0; b < SIMPLEFS_MAX_FILE_BLOCKS && dir->direct[b]; b++) {
+        if (simplefs_read_meta(fs, dir->direct[b], block_data) != 0) {
+            return 0;
+        }
+
+        simplefs_direntry_t *entries = (simplefs_direntry_t *)block_data;
+        for (uint32_t i = 0; i < SIMPLEFS_DIRENTS_PER_BLOCK; i++) {
+            if (entries[i].inode != 0 &&
+                strncmp(entries[i].name, name, SIMPLEFS_MAX_FILENAME) == 0) {
+                return entries[i].inode;
+            }
+        }
     }
 
-    memset(child, 0, sizeof(vfs_node_t));
-    strncpy(child->name, entry->name, sizeof(child->name) - 1);
-    child->inode = entry->inode;
-    child->type = entry->type;
-    child->fs = node->fs;
+    return 0;
+}
+
+/**
+ * Add an entry to a directory
+ *
+ * Uses the first free slot, allocating a new directory block if all
+ * existing ones are full.
+ */
+static int simplefs_dir_add(simplefs_t *fs, simplefs_inode_t *dir, const char *name,
+                            uint32_t inode_num, uint32_t type) {
+    uint8_t block_data[BLOCK_SIZE];
+
+    for (uint32_t b = 0; b < SIMPLEFS_MAX_FILE_BLOCKS; b++) {
+        int fresh = 0;
+
+        if (dir->direct[b] == 0) {
+            uint32_t block = simplefs_alloc_block(fs);
+            if (block == 0) {
+                return -1;
+            }
+            dir->direct[b] = block;
+            dir->blocks++;
+            memset(block_data, 0, BLOCK_SIZE);
+            fresh = 1;
+        } else if (simplefs_read_meta(fs, dir->direct[b], block_data) != 0) {
+            continue;  // Never write into a damaged block
+        }
+
+        simplefs_direntry_t *entries = (simplefs_direntry_t *)block_data;
+        for (uint32_t i = 0; i < SIMPLEFS_DIRENTS_PER_BLOCK; i++) {
+            if (entries[i].inode != 0) {
+                continue;
+            }
+
+            memset(&entries[i], 0, sizeof(simplefs_direntry_t));
+            entries[i].inode = inode_num;
+            entries[i].type = type;
+            strncpy(entries[i].name, name, SIMPLEFS_MAX_FILENAME);
+
+            if (simplefs_write_meta(fs->device, dir->direct[b], block_data) != 0) {
+                return -1;
+            }
 
-    // Read child inode for size info
-    simplefs_inode_t child_inode;
-    if (simplefs_read_inode(fs, entry->inode, &child_inode) == 0) {
-        child->size = child_inode.size;
+            dir->size += sizeof(simplefs_direntry_t);
+            return simplefs_write_inode(fs, dir->number, dir);
+        }
+
+        if (fresh) {
+            return -1;  // Cannot happen: a fresh block has free slots
+        }
     }
 
-    child->read = simplefs_vfs_read;
-    child->write = simplefs_vfs_write;
-    child->open = simplefs_vfs_open;
-    child->close = simplefs_vfs_close;
-    child->readdir = simplefs_vfs_readdir;
-    child->finddir = simplefs_vfs_finddir;
+    return -1;  // Directory full
+}
 
-    return child;
+/**
+ * Create an inode and link it into a directory
+ */
+static int simplefs_create_inode(simplefs_t *fs, const char *name, uint32_t parent_inode, uint32_t type) {
+    if (!fs || !name || !*name || strlen(name) > SIMPLEFS_MAX_FILENAME) {
+        return -1;
+    }
+
+    simplefs_inode_t *parent = simplefs_get_inode(fs, parent_inode);
+    if (!parent || parent->type != SIMPLEFS_TYPE_DIR) {
+        return -1;
+    }
+
+    if (simplefs_dir_lookup(fs, parent, name) != 0) {
+        return -1;  // Already exists
+    }
+
+    uint32_t num = simplefs_alloc_inode(fs);
+    if (num == 0) {
+        return -1;
+    }
+
+    simplefs_inode_t *inode = simplefs_get_inode(fs, num);
+    inode->type = type;
+    if (type == SIMPLEFS_TYPE_FILE) {
+        inode->flags = SIMPLEFS_INODE_INLINE;  // Empty files start inline
+    }
+
+    if (simplefs_write_inode(fs, num, inode) != 0 ||
+        simplefs_dir_add(fs, parent, name, num,
+                         type == SIMPLEFS_TYPE_DIR ? FILE_TYPE_DIRECTORY : FILE_TYPE_REGULAR) != 0) {
+        simplefs_free_inode(fs, num);
+        return -1;
+    }
+
+    return (int)num;
+}
+
+/**
+ * Create file
+ */
+int simplefs_create_file(simplefs_t *fs, const char *name, uint32_t parent_inode) {
+    return simplefs_create_inode(fs, name, parent_inode, SIMPLEFS_TYPE_FILE);
+}
+
+/**
+ * Create directory
+ */
+int simplefs_create_dir(simplefs_t *fs, const char *name, uint32_t parent_inode) {
+    return simplefs_create_inode(fs, name, parent_inode, SIMPLEFS_TYPE_DIR);
 }
 
 /**
  * VFS finddir operation
  */
 static vfs_node_t *simplefs_vfs_finddir(vfs_node_t *node, const char *name) {
-    // Linear search through directory entries
-    for (uint32_t i = 0; i < 100; i++) {  // Limit search
-        vfs_node_t *child = simplefs_vfs_readdir(node, i);
-        if (!child) {
-            break;
+    simplefs_t *fs = (simplefs_t *)node->fs->fs_data;
+    simplefs_inode_t *dir = (simplefs_inode_t *)node->fs_data;
+
+    if (!dir || dir->type != SIMPLEFS_TYPE_DIR) {
+        return NULL;  // Not a directory
+    }
+
+    uint32_t num = simplefs_dir_lookup(fs, dir, name);
+    if (num == 0) {
+        return NULL;
+    }
+
+    return simplefs_make_node(node->fs, num, name);
+}
+
+/**
+ * Split a filesystem-relative path into parent inode and final name
+ */
+static int simplefs_resolve_parent(simplefs_t *fs, const char *path, const char **name) {
+    uint32_t dir = 0;  // Root
+    char component[SIMPLEFS_MAX_FILENAME + 1];
+
+    while (*path == '/') {
+        path++;
+    }
+
+    while (1) {
+        const char *end = path;
+        while (*end && *end != '/') {
+            end++;
         }
 
-        if (strcmp(child->name, name) == 0) {
-            return child;
+        if (*end == '\0') {
+            *name = path;
+            return (int)dir;
         }
 
-        kfree(child);
-    }
+        size_t len = end - path;
+        if (len == 0 || len > SIMPLEFS_MAX_FILENAME) {
+            return -1;
+        }
+        memcpy(component, path, len);
+        component[len] = '\0';
+
+        simplefs_inode_t *inode = simplefs_get_inode(fs, dir);
+        if (!inode || (dir = simplefs_dir_lookup(fs, inode, component)) == 0) {
+            return -1;  // Missing parent directory
+        }
 
-    return NULL;
+        path = end;
+        while (*path == '/') {
+            path++;
+        }
+    }
 }
 
 /**
- * Get root node
+ * Filesystem create_file/create_dir operations
  */
-static vfs_node_t *simplefs_fs_get_root(filesystem_t *fs) {
-    if (!fs || !fs->fs_data) {
+static vfs_node_t *simplefs_fs_create(filesystem_t *vfs, const char *path, uint32_t type) {
+    simplefs_t *fs = (simplefs_t *)vfs->fs_data;
+    const char *name = NULL;
+
+    int parent = simplefs_resolve_parent(fs, path, &name);
+    if (parent < 0) {
         return NULL;
     }
 
-    simplefs_t *sfs = (simplefs_t *)fs->fs_data;
-
-    // Read root inode (inode 0)
-    simplefs_inode_t *root_inode = (simplefs_inode_t *)kmalloc(sizeof(simplefs_inode_t));
-    if (!root_inode) {
+    int num = simplefs_create_inode(fs, name, (uint32_t)parent, type);
+    if (num < 0) {
         return NULL;
     }
 
-    if (simplefs_read_inode(sfs, 0, root_inode) != 0) {
-        kfree(root_inode);
+    return simplefs_make_node(vfs, (uint32_t)num, name);
+}
+
+static vfs_node_t *simplefs_fs_create_file(filesystem_t *vfs, const char *path, uint32_t permissions) {
+    (void)permissions;
+    return simplefs_fs_create(vfs, path, SIMPLEFS_TYPE_FILE);
+}
+
+static vfs_node_t *simplefs_fs_create_dir(filesystem_t *vfs, const char *path, uint32_t permissions) {
+    (void)permissions;
+    return simplefs_fs_create(vfs, path, SIMPLEFS_TYPE_DIR);
+}
+
+/**
+ * Get root node
+ */
+static vfs_node_t *simplefs_fs_get_root(filesystem_t *fs) {
+    if (!fs || !fs->fs_data) {
         return NULL;
     }
 
-    // Create VFS node for root
-    vfs_node_t *root = (vfs_node_t *)kmalloc(sizeof(vfs_node_t));
+    vfs_node_t *root = simplefs_make_node(fs, 0, "/");
     if (!root) {
-        kfree(root_inode);
         return NULL;
     }
 
-    memset(root, 0, sizeof(vfs_node_t));
-    strcpy(root->name, "/");
-    root->inode = 0;
     root->type = FILE_TYPE_DIRECTORY;
-    root->size = root_inode->size;
-    root->fs = fs;
-    root->fs_data = root_inode;
-
-    root->read = simplefs_vfs_read;
-    root->write = simplefs_vfs_write;
-    root->open = simplefs_vfs_open;
-    root->close = simplefs_vfs_close;
-    root->readdir = simplefs_vfs_readdir;
-    root->finddir = simplefs_vfs_finddir;
-
     return root;
 }
 
@@ -397,10 +1133,68 @@ static int simplefs_fs_init(filesystem_t *fs, void *device) {
     }
 
     memcpy(&sfs->superblock, block_data, sizeof(simplefs_superblock_t));
+    simplefs_superblock_t *sb = &sfs->superblock;
 
     // Verify magic number
-    if (sfs->superblock.magic != SIMPLEFS_MAGIC) {
-        vga_printf("  SimpleFS: Invalid magic number (0x%x)\n", sfs->superblock.magic);
+    if (sb->magic != SIMPLEFS_MAGIC) {
+        vga_printf("  SimpleFS: Invalid magic number (0x%x)\n", sb->magic);
+        kfree(sfs);
+        return -1;
+    }
+
+    if (sb->version != SIMPLEFS_VERSION) {
+        vga_printf("  SimpleFS: Unsupported version %u\n", sb->version);
+        kfree(sfs);
+        return -1;
+    }
+
+    if (simplefs_csum_verify(block_data, 0) != 0) {
+        vga_printf("  SimpleFS: Superblock checksum mismatch\n");
+        kfree(sfs);
+        return -1;
+    }
+
+    if (sb->inode_size != sizeof(simplefs_inode_t) ||
+        sb->num_inodes > SIMPLEFS_MAX_INODES) {
+        vga_printf("  SimpleFS: Unsupported inode layout (%u bytes)\n", sb->inode_size);
+        kfree(sfs);
+        return -1;
+    }
+
+    // Inode cache (filled on demand) and block bitmap
+    sfs->inode_cache = (simplefs_inode_t *)kzalloc(sb->num_inodes * sizeof(simplefs_inode_t));
+    sfs->inode_cached = (uint8_t *)kzalloc(sb->num_inodes);
+    sfs->block_bitmap = (uint8_t *)kzalloc(sb->bitmap_blocks * SIMPLEFS_META_SIZE);
+    if (!sfs->inode_cache || !sfs->inode_cached || !sfs->block_bitmap) {
+        kfree(sfs->inode_cache);
+        kfree(sfs->inode_cached);
+        kfree(sfs->block_bitmap);
+        kfree(sfs);
+        return -1;
+    }
+
+    int bitmap_ok = 1;
+    for (uint32_t i = 0; i < sb->bitmap_blocks; i++) {
+        if (simplefs_read_meta(sfs, sb->first_bitmap_block + i, block_data) != 0) {
+            bitmap_ok = 0;
+            continue;  // Rebuilt by the full check below
+        }
+        memcpy(sfs->block_bitmap + i * SIMPLEFS_META_SIZE, block_data, SIMPLEFS_META_SIZE);
+    }
+
+    // Only scan everything if the last unmount was not clean
+    if (sb->state != SIMPLEFS_STATE_CLEAN || !bitmap_ok) {
+        vga_printf("  SimpleFS: Not cleanly unmounted, checking...\n");
+        int problems = simplefs_check(sfs);
+        vga_printf("  SimpleFS: Check found %d problem(s)\n", problems);
+    }
+
+    // Stay dirty until a clean unmount writes the superblock back
+    sb->state = SIMPLEFS_STATE_DIRTY;
+    if (simplefs_write_superblock(sfs) != 0) {
+        kfree(sfs->inode_cache);
+        kfree(sfs->inode_cached);
+        kfree(sfs->block_bitmap);
         kfree(sfs);
         return -1;
     }
@@ -408,20 +1202,118 @@ static int simplefs_fs_init(filesystem_t *fs, void *device) {
     fs->fs_data = sfs;
     fs->device = device;
 
-    vga_printf("  SimpleFS: Mounted successfully\n");
+    vga_printf("  SimpleFS: Mounted successfully (CRC32C %s)\n",
+               crc32c_hw_available() ? "SSE4.2" : "slice-by-8");
     return 0;
 }
 
 /**
  * Destroy filesystem
+ *
+ * Writes the free counts back and marks the superblock clean so the
+ * next mount can skip the full check.
  */
 static void simplefs_fs_destroy(filesystem_t *fs) {
     if (fs && fs->fs_data) {
-        kfree(fs->fs_data);
+        simplefs_t *sfs = (simplefs_t *)fs->fs_data;
+
+        sfs->superblock.state = SIMPLEFS_STATE_CLEAN;
+        simplefs_write_superblock(sfs);
+
+        kfree(sfs->inode_cache);
+        kfree(sfs->inode_cached);
+        kfree(sfs->block_bitmap);
+        kfree(sfs);
         fs->fs_data = NULL;
     }
 }
 
+/**
+ * Background scrubber
+ *
+ * Verifies one inode per wakeup: its inode block, the checksums of its
+ * directory blocks, and that its data blocks are still readable. Each
+ * pass ends by re-verifying the superblock and bitmap, then the task
+ * sleeps so scrubbing never competes with real work.
+ */
+static void simplefs_scrub_inode(simplefs_t *sfs, uint32_t inode_num) {
+    uint8_t block_data[BLOCK_SIZE];
+    simplefs_inode_t inode;
+
+    // Read the inode block itself; the inode cache would hide corruption
+    if (simplefs_read_meta(sfs, simplefs_inode_block(sfs, inode_num), block_data) != 0) {
+        return;  // Mismatches are counted by simplefs_read_meta()
+    }
+
+    memcpy(&inode, block_data + (inode_num % SIMPLEFS_INODES_PER_BLOCK) * sizeof(simplefs_inode_t),
+           sizeof(simplefs_inode_t));
+    if (inode.type == 0 || (inode.flags & SIMPLEFS_INODE_INLINE)) {
+        return;  // Inline data was covered by the inode block checksum
+    }
+
+    for (uint32_t d = 0; d < SIMPLEFS_MAX_FILE_BLOCKS; d++) {
+        uint32_t block = inode.direct[d];
+        if (block == 0) {
+            continue;
+        }
+
+        if (inode.type == SIMPLEFS_TYPE_DIR) {
+            simplefs_read_meta(sfs, block, block_data);
+        } else if (simplefs_read_data(sfs, block, block_data) != 0) {
+            sfs->csum_errors++;
+            vga_printf("  SimpleFS: Read error in block %u (inode %u)\n", block, inode_num);
+        }
+    }
+}
+
+static void simplefs_scrub_task(void) {
+    uint8_t block_data[BLOCK_SIZE];
+
+    while (1) {
+        simplefs_t *sfs = scrub_fs ? (simplefs_t *)scrub_fs->fs_data : NULL;
+        if (!sfs) {
+            process_sleep(SIMPLEFS_SCRUB_PASS_TICKS);
+            continue;
+        }
+
+        if (sfs->scrub_inode < sfs->superblock.num_inodes) {
+            simplefs_scrub_inode(sfs, sfs->scrub_inode++);
+            process_sleep(SIMPLEFS_SCRUB_STEP_TICKS);
+            continue;
+        }
+
+        // End of pass: superblock and bitmap
+        simplefs_read_meta(sfs, 0, block_data);
+        for (uint32_t i = 0; i < sfs->superblock.bitmap_blocks; i++) {
+            simplefs_read_meta(sfs, sfs->superblock.first_bitmap_block + i, block_data);
+        }
+
+        sfs->scrub_inode = 0;
+        process_sleep(SIMPLEFS_SCRUB_PASS_TICKS);
+    }
+}
+
+/**
+ * Start the background scrubber
+ */
+void simplefs_start_scrubber(filesystem_t *fs) {
+    if (!fs || !fs->fs_data || scrub_fs) {
+        return;
+    }
+
+    scrub_fs = fs;
+
+    process_t *task = process_create_kernel_task(simplefs_scrub_task, "fsscrub",
+                                                 SIMPLEFS_SCRUB_PRIORITY);
+    if (!task) {
+        scrub_fs = NULL;
+        return;
+    }
+
+    scheduler_add_process(task);
+    vga_printf("  SimpleFS: Scrubber started (PID %u)\n", task->pid);
+}
+
 /**
  * Create SimpleFS filesystem driver
  */
@@ -435,6 +1327,8 @@ filesystem_t *simplefs_create(block_device_t *device) {
     fs->init = simplefs_fs_init;
     fs->destroy = simplefs_fs_destroy;
     fs->get_root = simplefs_fs_get_root;
+    fs->create_file = simplefs_fs_create_file;
+    fs->create_dir = simplefs_fs_create_dir;
     fs->device = device;
 
     // Initialize the filesystem
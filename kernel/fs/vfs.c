@@ -3,6 +3,8 @@
  */
 
 #include <kernel/vfs.h>
+#include <kernel/pipe.h>
+#include <kernel/process.h>
 #include <kernel/heap.h>
 #include <kernel/string.h>
 #include <kernel/vga.h>
@@ -112,6 +114,15 @@ int vfs_mount(const char *path, filesystem_t *fs) {
 int vfs_unmount(const char *path) {
     for (int i = 0; i < MAX_MOUNTS; i++) {
         if (mounts[i].in_use && strcmp(mounts[i].path, path) == 0) {
+            if (mounts[i].root == vfs_root) {
+                vfs_root = NULL;
+            }
+
+            // Let the filesystem flush state (e.g. mark itself clean)
+            if (mounts[i].fs->destroy) {
+                mounts[i].fs->destroy(mounts[i].fs);
+            }
+
             mounts[i].in_use = 0;
             mounts[i].fs = NULL;
             mounts[i].root = NULL;
@@ -121,6 +132,40 @@ int vfs_unmount(const char *path) {
     return -1;
 }
 
+/**
+ * Find the mount covering a path
+ *
+ * Picks the longest mount path that is a prefix of the path on a
+ * component boundary, and returns the remainder of the path after it.
+ */
+static mount_t *vfs_find_mount(const char *path, const char **rest) {
+    mount_t *best = NULL;
+    size_t best_len = 0;
+
+    for (int i = 0; i < MAX_MOUNTS; i++) {
+        if (!mounts[i].in_use) {
+            continue;
+        }
+
+        const char *mpath = mounts[i].path;
+        size_t len = strlen(mpath);
+        if (len == 1) {
+            len = 0;  // "/" covers every path
+        } else if (strncmp(path, mpath, len) != 0 ||
+                   (path[len] != '\0' && path[len] != '/')) {
+            continue;
+        }
+
+        if (!best || len > best_len) {
+            best = &mounts[i];
+            best_len = len;
+        }
+    }
+
+    *rest = path + best_len;
+    return best;
+}
+
 /**
  * Resolve path to VFS node
  * For simplicity, we only support absolute paths and simple resolution
@@ -130,20 +175,34 @@ vfs_node_t *vfs_resolve_path(const char *path) {
         return NULL;  // Only absolute paths supported
     }
 
-    // Special case: root directory
-    if (strcmp(path, "/") == 0) {
-        return vfs_root;
+    // Named FIFOs live outside any mounted filesystem
+    vfs_node_t *fifo = pipe_lookup_fifo(path);
+    if (fifo) {
+        return fifo;
     }
 
-    if (!vfs_root) {
+    const char *rest = path;
+    mount_t *mount = vfs_find_mount(path, &rest);
+    if (!mount) {
         return NULL;
     }
 
+    // Skip separators between the mount point and the first component
+    while (*rest == '/') {
+        rest++;
+    }
+
+    // Path names the mount point itself
+    if (*rest == '\0') {
+        return mount->root;
+    }
+
     // Parse path components
     char path_copy[256];
-    strncpy(path_copy, path + 1, sizeof(path_copy) - 1);  // Skip leading '/'
+    strncpy(path_copy, rest, sizeof(path_copy) - 1);
+    path_copy[sizeof(path_copy) - 1] = '\0';
 
-    vfs_node_t *current = vfs_root;
+    vfs_node_t *current = mount->root;
     char *token = path_copy;
     char *next = NULL;
 
@@ -183,6 +242,8 @@ vfs_node_t *vfs_resolve_path(const char *path) {
  * Allocate a file descriptor
  */
 int vfs_alloc_fd(vfs_node_t *node, uint32_t flags) {
+    process_t *current = process_get_current();
+
     for (int i = 0; i < MAX_OPEN_FILES; i++) {
         if (!file_descriptors[i].in_use) {
             file_descriptors[i].node = node;
@@ -190,6 +251,7 @@ int vfs_alloc_fd(vfs_node_t *node, uint32_t flags) {
             file_descriptors[i].flags = flags;
             file_descriptors[i].ref_count = 1;
             file_descriptors[i].in_use = 1;
+            file_descriptors[i].owner_pid = current ? current->pid : 0;
             return i;
         }
     }
@@ -216,6 +278,7 @@ void vfs_free_fd(int fd) {
         file_descriptors[fd].offset = 0;
         file_descriptors[fd].flags = 0;
         file_descriptors[fd].ref_count = 0;
+        file_descriptors[fd].owner_pid = 0;
     }
 }
 
@@ -225,10 +288,28 @@ void vfs_free_fd(int fd) {
 int vfs_open(const char *path, uint32_t flags) {
     // Resolve path to VFS node
     vfs_node_t *node = vfs_resolve_path(path);
+
+    // Create the file on its mounted filesystem if asked to
+    if (!node && (flags & O_CREAT) && path && path[0] == '/') {
+        const char *rest = path;
+        mount_t *mount = vfs_find_mount(path, &rest);
+        if (mount && mount->fs->create_file) {
+            node = mount->fs->create_file(mount->fs, rest, 0644);
+        }
+    }
+
     if (!node) {
         return -1;  // File not found
     }
 
+    // Each open of a FIFO gets its own read or write end
+    if (node->type == FILE_TYPE_FIFO) {
+        node = pipe_open_fifo(node, flags);
+        if (!node) {
+            return -1;
+        }
+    }
+
     // Call node's open function if available
     if (node->open) {
         int result = node->open(node, flags);
@@ -239,6 +320,9 @@ int vfs_open(const char *path, uint32_t flags) {
 
     // Allocate file descriptor
     int fd = vfs_alloc_fd(node, flags);
+    if (fd < 0 && node->type == FILE_TYPE_FIFO) {
+        node->close(node);  // Drop the FIFO end we just opened
+    }
     return fd;
 }
 
@@ -261,6 +345,17 @@ int vfs_close(int fd) {
     return 0;
 }
 
+/**
+ * Close every file a process opened
+ */
+void vfs_close_all(uint32_t pid) {
+    for (int fd = 0; fd < MAX_OPEN_FILES; fd++) {
+        if (file_descriptors[fd].in_use && file_descriptors[fd].owner_pid == pid) {
+            vfs_close(fd);
+        }
+    }
+}
+
 /**
  * Read from a file
  */
@@ -398,3 +493,93 @@ int vfs_readdir(int fd, dirent_t *dirent, uint32_t index) {
 
     return 0;
 }
+
+/**
+ * Pack one directory entry into a getdents buffer
+ *
+ * Returns the record length, or 0 if the record does not fit.
+ */
+int vfs_fill_dirent64(void *buffer, size_t size, uint32_t inode,
+                      uint32_t type, const char *name) {
+    size_t namelen = strlen(name);
+    if (namelen > 255) {
+        namelen = 255;
+    }
+
+    size_t reclen = VFS_DIRENT64_RECLEN(namelen);
+    if (reclen > size) {
+        return 0;
+    }
+
+    vfs_dirent64_t *d = (vfs_dirent64_t *)buffer;
+    d->inode = inode;
+    d->reclen = (uint16_t)reclen;
+    d->type = (uint8_t)type;
+    d->namelen = (uint8_t)namelen;
+    memcpy(d->name, name, namelen);
+    memset(d->name + namelen, 0, reclen - sizeof(vfs_dirent64_t) - namelen);
+
+    return (int)reclen;
+}
+
+/**
+ * Read a batch of directory entries
+ *
+ * Fills the buffer with as many packed entries as fit. The file offset
+ * is used as an opaque cookie, so repeated calls resume where the last
+ * one stopped. Returns bytes written, 0 at end of directory, or -1.
+ */
+int vfs_getdents(int fd, void *buffer, size_t size) {
+    file_descriptor_t *file = vfs_get_fd(fd);
+    if (!file || !buffer) {
+        return -1;
+    }
+
+    vfs_node_t *dir = file->node;
+    if (!dir) {
+        return -1;
+    }
+
+    if (dir->getdents) {
+        uint64_t cookie = file->offset;
+        int result = dir->getdents(dir, &cookie, buffer, size);
+        if (result >= 0) {
+            file->offset = cookie;
+        }
+        return result;
+    }
+
+    // Fall back to one readdir call per entry
+    if (!dir->readdir) {
+        return -1;  // Not a directory
+    }
+
+    // Each readdir result is a fresh node, released once it is packed
+    size_t written = 0;
+    int overflow = 0;
+    while (1) {
+        vfs_node_t *entry = dir->readdir(dir, (uint32_t)file->offset);
+        if (!entry) {
+            break;  // No more entries
+        }
+
+        int reclen = vfs_fill_dirent64((uint8_t *)buffer + written, size - written,
+                                       entry->inode, entry->type, entry->name);
+        if (entry->close) {
+            entry->close(entry);
+        }
+        if (reclen == 0) {
+            overflow = 1;
+            break;  // Buffer full, resume here next time
+        }
+
+        written += reclen;
+        file->offset++;
+    }
+
+    if (written == 0 && overflow) {
+        return -1;  // Buffer too small for a single entry
+    }
+
+    return (int)written;
+}
@@ -0,0 +1,141 @@
+/**
+ * ACPI Tables
+ *
+ * Locates the RSDP and walks the RSDT/XSDT to find system description
+ * tables. Only the static tables are used (no AML interpreter).
+ */
+
+#ifndef KERNEL_ACPI_H
+#define KERNEL_ACPI_H
+
+#include <stdint.h>
+
+// MADT entry types
+#define MADT_ENTRY_LAPIC            0   // Processor local APIC
+#define MADT_ENTRY_IOAPIC           1   // I/O APIC
+#define MADT_ENTRY_ISO              2   // Interrupt source override
+#define MADT_ENTRY_LAPIC_NMI        4   // Local APIC NMI
+#define MADT_ENTRY_LAPIC_OVERRIDE   5   // 64-bit local APIC address
+
+// MADT flags
+#define MADT_FLAG_PCAT_COMPAT       0x1 // Dual 8259s are present
+#define MADT_LAPIC_ENABLED          0x1 // Processor is usable
+#define MADT_LAPIC_ONLINE_CAPABLE   0x2 // Processor can be enabled
+
+// Interrupt source override flags (MPS INTI flags)
+#define MADT_ISO_POLARITY_MASK      0x3
+#define MADT_ISO_POLARITY_LOW       0x3
+#define MADT_ISO_TRIGGER_MASK       0xC
+#define MADT_ISO_TRIGGER_LEVEL      0xC
+
+/**
+ * Root System Description Pointer
+ */
+typedef struct acpi_rsdp {
+    char signature[8];          // "RSD PTR "
+    uint8_t checksum;           // Covers the first 20 bytes
+    char oem_id[6];
+    uint8_t revision;           // 0 = ACPI 1.0, 2 = ACPI 2.0+
+    uint32_t rsdt_address;
+    // ACPI 2.0+
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t extended_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed)) acpi_rsdp_t;
+
+/**
+ * Common header of every system description table
+ */
+typedef struct acpi_sdt_header {
+    char signature[4];
+    uint32_t length;            // Including the header
+    uint8_t revision;
+    uint8_t checksum;           // Whole table sums to zero
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_header_t;
+
+/**
+ * Multiple APIC Description Table ("APIC")
+ */
+typedef struct acpi_madt {
+    acpi_sdt_header_t header;
+    uint32_t lapic_address;     // Physical address of the local APIC
+    uint32_t flags;             // MADT_FLAG_*
+    uint8_t entries[];          // Variable-length entries
+} __attribute__((packed)) acpi_madt_t;
+
+typedef struct madt_entry_header {
+    uint8_t type;               // MADT_ENTRY_*
+    uint8_t length;
+} __attribute__((packed)) madt_entry_header_t;
+
+typedef struct madt_lapic {
+    madt_entry_header_t header;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;             // MADT_LAPIC_*
+} __attribute__((packed)) madt_lapic_t;
+
+typedef struct madt_ioapic {
+    madt_entry_header_t header;
+    uint8_t ioapic_id;
+    uint8_t reserved;
+    uint32_t address;           // Physical MMIO address
+    uint32_t gsi_base;          // First global system interrupt
+} __attribute__((packed)) madt_ioapic_t;
+
+typedef struct madt_iso {
+    madt_entry_header_t header;
+    uint8_t bus;                // Always 0 (ISA)
+    uint8_t source;             // ISA IRQ
+    uint32_t gsi;               // Global system interrupt it maps to
+    uint16_t flags;             // MADT_ISO_*
+} __attribute__((packed)) madt_iso_t;
+
+typedef struct madt_lapic_override {
+    madt_entry_header_t header;
+    uint16_t reserved;
+    uint64_t address;
+} __attribute__((packed)) madt_lapic_override_t;
+
+/**
+ * PCI Express memory-mapped configuration table ("MCFG")
+ */
+typedef struct acpi_mcfg_entry {
+    uint64_t base;              // ECAM base for start_bus
+    uint16_t segment;           // PCI segment group
+    uint8_t start_bus;
+    uint8_t end_bus;
+    uint32_t reserved;
+} __attribute__((packed)) acpi_mcfg_entry_t;
+
+typedef struct acpi_mcfg {
+    acpi_sdt_header_t header;
+    uint64_t reserved;
+    acpi_mcfg_entry_t entries[];
+} __attribute__((packed)) acpi_mcfg_t;
+
+/**
+ * Locate the ACPI tables
+ *
+ * Uses the RSDP from the multiboot information if present, otherwise
+ * scans the EBDA and the BIOS ROM area.
+ *
+ * @return 0 on success, -1 if no valid RSDP was found
+ */
+int acpi_init(void);
+
+/**
+ * Find a system description table by signature
+ *
+ * @param signature Four-character table signature (e.g. "APIC")
+ * @return Mapped table with a valid checksum, or NULL
+ */
+const acpi_sdt_header_t *acpi_find_table(const char *signature);
+
+#endif // KERNEL_ACPI_H
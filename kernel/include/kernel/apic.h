@@ -0,0 +1,203 @@
+/**
+ * Local APIC and I/O APIC
+ *
+ * The local APIC receives interrupts for its CPU and takes EOIs through
+ * a single MMIO store (or an MSR write in x2APIC mode). I/O APICs route
+ * global system interrupts (GSIs) to a vector on a chosen CPU.
+ */
+
+#ifndef KERNEL_APIC_H
+#define KERNEL_APIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Local APIC registers (MMIO offsets; x2APIC MSR = 0x800 + offset / 16)
+#define LAPIC_REG_ID            0x020   // Local APIC ID
+#define LAPIC_REG_VERSION       0x030   // Version
+#define LAPIC_REG_TPR           0x080   // Task priority
+#define LAPIC_REG_EOI           0x0B0   // End of interrupt
+#define LAPIC_REG_SVR           0x0F0   // Spurious interrupt vector
+#define LAPIC_REG_ESR           0x280   // Error status
+#define LAPIC_REG_ICR_LOW       0x300   // Interrupt command (low)
+#define LAPIC_REG_ICR_HIGH      0x310   // Interrupt command (high, xAPIC only)
+#define LAPIC_REG_LVT_TIMER     0x320   // LVT timer
+#define LAPIC_REG_LVT_PERF      0x340   // LVT performance counter
+#define LAPIC_REG_LVT_LINT0     0x350   // LVT LINT0
+#define LAPIC_REG_LVT_LINT1     0x360   // LVT LINT1
+#define LAPIC_REG_LVT_ERROR     0x370   // LVT error
+#define LAPIC_REG_TIMER_INIT    0x380   // Timer initial count
+#define LAPIC_REG_TIMER_CURRENT 0x390   // Timer current count
+#define LAPIC_REG_TIMER_DIV     0x3E0   // Timer divide configuration
+
+// IA32_APIC_BASE MSR
+#define MSR_IA32_APIC_BASE      0x1B
+#define APIC_BASE_X2APIC        (1 << 10)   // x2APIC mode enable
+#define APIC_BASE_ENABLE        (1 << 11)   // Global APIC enable
+#define APIC_BASE_ADDR_MASK     0xFFFFFF000ULL
+
+// x2APIC MSR range
+#define X2APIC_MSR_BASE         0x800
+
+// Spurious interrupt vector register
+#define LAPIC_SVR_ENABLE        0x100       // APIC software enable
+
+// LVT bits
+#define LAPIC_LVT_NMI           0x400       // Delivery mode: NMI
+#define LAPIC_LVT_MASKED        (1 << 16)
+#define LAPIC_LVT_PERIODIC      (1 << 17)   // Timer mode: periodic
+
+// Timer divide configuration
+#define LAPIC_TIMER_DIV_16      0x3
+
+// ICR bits
+#define LAPIC_ICR_FIXED         0x000
+#define LAPIC_ICR_INIT          0x500
+#define LAPIC_ICR_STARTUP       0x600
+#define LAPIC_ICR_PENDING       (1 << 12)   // Delivery status (xAPIC)
+#define LAPIC_ICR_ASSERT        (1 << 14)
+#define LAPIC_ICR_SELF          (1 << 18)   // Destination shorthand: self
+
+// Vectors owned by the local APIC
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+
+// I/O APIC registers (indirect through IOREGSEL/IOWIN)
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WINDOW           0x10
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VERSION      0x01
+#define IOAPIC_REG_REDTBL       0x10        // Two registers per entry
+
+// Redirection entry bits
+#define IOAPIC_RTE_LOW_ACTIVE   (1 << 13)   // Active-low polarity
+#define IOAPIC_RTE_LEVEL        (1 << 15)   // Level triggered
+#define IOAPIC_RTE_MASKED       (1 << 16)
+#define IOAPIC_RTE_DEST_SHIFT   56
+
+// Maximum number of I/O APICs
+#define IOAPIC_MAX              4
+
+/**
+ * Initialize the local APIC of the current CPU
+ *
+ * Uses x2APIC mode when the CPU supports it.
+ *
+ * @param phys Physical MMIO address from the MADT
+ * @return 0 on success, -1 if there is no local APIC
+ */
+int lapic_init(uint64_t phys);
+
+/**
+ * Check whether the local APIC is up
+ *
+ * @return true after a successful lapic_init()
+ */
+bool lapic_enabled(void);
+
+/**
+ * Check whether the local APIC runs in x2APIC mode
+ *
+ * @return true in x2APIC mode
+ */
+bool lapic_x2apic(void);
+
+/**
+ * Get the APIC ID of the current CPU
+ *
+ * @return Local APIC ID
+ */
+uint32_t lapic_id(void);
+
+/**
+ * Signal end of interrupt to the local APIC
+ */
+void lapic_eoi(void);
+
+/**
+ * Send an inter-processor interrupt
+ *
+ * @param apic_id Destination APIC ID
+ * @param icr Delivery mode and vector (LAPIC_ICR_* | vector)
+ */
+void lapic_send_ipi(uint32_t apic_id, uint32_t icr);
+
+/**
+ * Program a local vector table entry
+ *
+ * @param reg LAPIC_REG_LVT_*
+ * @param value Vector, delivery mode and LAPIC_LVT_* bits
+ */
+void lapic_set_lvt(uint32_t reg, uint32_t value);
+
+/**
+ * Measure the local APIC timer rate
+ *
+ * Counts timer ticks (divide by 16) across a TSC-timed interval, so the
+ * TSC must already be calibrated.
+ *
+ * @return Timer ticks per millisecond, or 0 if unknown
+ */
+uint32_t lapic_timer_calibrate(void);
+
+/**
+ * Start the local APIC timer
+ *
+ * @param vector IDT vector to raise
+ * @param count Initial count (divide by 16)
+ * @param periodic true to reload automatically
+ */
+void lapic_timer_start(uint8_t vector, uint32_t count, bool periodic);
+
+/**
+ * Stop the local APIC timer
+ */
+void lapic_timer_stop(void);
+
+/**
+ * Register an I/O APIC from the MADT
+ *
+ * Masks all of its redirection entries.
+ *
+ * @param id I/O APIC ID
+ * @param phys Physical MMIO address
+ * @param gsi_base First GSI it handles
+ * @return 0 on success, -1 if the table is full or mapping failed
+ */
+int ioapic_add(uint8_t id, uint64_t phys, uint32_t gsi_base);
+
+/**
+ * Program the redirection entry of a GSI
+ *
+ * @param gsi Global system interrupt
+ * @param vector IDT vector to deliver
+ * @param apic_id Destination local APIC ID
+ * @param flags IOAPIC_RTE_* polarity/trigger/mask bits
+ * @return 0 on success, -1 if no I/O APIC handles the GSI
+ */
+int ioapic_route(uint32_t gsi, uint8_t vector, uint32_t apic_id, uint32_t flags);
+
+/**
+ * Mask or unmask a GSI
+ *
+ * @param gsi Global system interrupt
+ * @param masked true to mask
+ */
+void ioapic_set_masked(uint32_t gsi, bool masked);
+
+/**
+ * Change the destination CPU of a GSI
+ *
+ * @param gsi Global system interrupt
+ * @param apic_id Destination local APIC ID
+ * @return 0 on success, -1 if no I/O APIC handles the GSI
+ */
+int ioapic_set_destination(uint32_t gsi, uint32_t apic_id);
+
+/**
+ * Get the number of registered I/O APICs
+ *
+ * @return I/O APIC count
+ */
+uint32_t ioapic_count(void);
+
+#endif // KERNEL_APIC_H
@@ -54,6 +54,9 @@
 #define ATA_CMD_CACHE_FLUSH     0xE7
 #define ATA_CMD_IDENTIFY        0xEC
 
+// Largest LBA28 READ/WRITE SECTORS transfer (a count of 0 means 256)
+#define ATA_MAX_SECTORS         256
+
 // ATA drive types
 #define ATA_DRIVE_MASTER        0
 #define ATA_DRIVE_SLAVE         1
@@ -18,6 +18,9 @@
 // Standard block size (most disks use 512 bytes)
 #define BLOCK_SIZE 512
 
+// Maximum number of registered block devices
+#define MAX_BLOCK_DEVICES 16
+
 /**
  * Block device structure
  */
@@ -41,6 +44,8 @@ typedef struct block_device {
 void block_init(void);
 int block_register_device(block_device_t *dev);
 block_device_t *block_get_device(const char *name);
+block_device_t *block_get_device_by_index(uint32_t index);
+uint32_t block_get_device_count(void);
 
 // Helper functions for reading/writing
 int block_read(block_device_t *dev, uint64_t offset, uint64_t size, void *buffer);
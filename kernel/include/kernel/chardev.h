@@ -0,0 +1,40 @@
+/**
+ * Character Device Interface
+ *
+ * Byte-stream devices (console, serial ports, null, zero) register here
+ * and are exposed under /dev by devfs.
+ */
+
+#ifndef KERNEL_CHARDEV_H
+#define KERNEL_CHARDEV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Maximum number of registered character devices
+#define MAX_CHAR_DEVICES 16
+
+/**
+ * Character device structure
+ *
+ * read and write receive the caller's whole buffer so drivers can move
+ * data in bulk rather than one byte per call.
+ */
+typedef struct char_device {
+    char name[32];               // Device name (e.g., "console", "ttyS0")
+
+    // Operations (return bytes transferred, or -1 on error)
+    int (*read)(struct char_device *dev, void *buffer, size_t size);
+    int (*write)(struct char_device *dev, const void *buffer, size_t size);
+
+    void *driver_data;           // Driver-specific data
+} char_device_t;
+
+// Character device management
+void chardev_init(void);
+int chardev_register(char_device_t *dev);
+char_device_t *chardev_get(const char *name);
+char_device_t *chardev_get_by_index(uint32_t index);
+uint32_t chardev_count(void);
+
+#endif // KERNEL_CHARDEV_H
@@ -0,0 +1,37 @@
+/**
+ * CRC32C (Castagnoli) Checksum
+ *
+ * Uses the SSE4.2 crc32 instruction when the CPU supports it and a
+ * slice-by-8 table implementation otherwise.
+ */
+
+#ifndef KERNEL_CRC32C_H
+#define KERNEL_CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Detect hardware support and build the software tables
+ */
+void crc32c_init(void);
+
+/**
+ * Compute or extend a CRC32C
+ *
+ * @param crc Previous CRC (0 to start a new checksum)
+ * @param data Data to checksum
+ * @param len Length in bytes
+ * @return Updated CRC
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/**
+ * Check whether the SSE4.2 instruction is in use
+ *
+ * @return true if crc32c() uses the crc32 instruction
+ */
+bool crc32c_hw_available(void);
+
+#endif // KERNEL_CRC32C_H
@@ -0,0 +1,25 @@
+/**
+ * Device Filesystem (devfs)
+ *
+ * Exposes registered character and block devices as nodes under /dev.
+ */
+
+#ifndef KERNEL_DEVFS_H
+#define KERNEL_DEVFS_H
+
+#include <kernel/vfs.h>
+
+// Maximum number of device nodes devfs can expose
+#define DEVFS_MAX_NODES 32
+
+/**
+ * Register devfs and mount it at /dev
+ *
+ * Character and block devices registered before or after this call
+ * appear in the directory; nodes are created on first lookup.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int devfs_init(void);
+
+#endif // KERNEL_DEVFS_H
@@ -0,0 +1,65 @@
+/**
+ * Framebuffer Console
+ *
+ * Text console on the linear framebuffer handed over by a multiboot2
+ * loader. Text is kept as VGA-style cells in a shadow line ring; dirty
+ * cells are rendered from cached glyph rows with 64-bit stores, and
+ * scrolling re-renders from the shadow instead of reading back VRAM.
+ */
+
+#ifndef KERNEL_FBCON_H
+#define KERNEL_FBCON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/multiboot.h>
+
+// Virtual address the framebuffer is mapped at
+#define FBCON_VIRT_BASE     0xFFFFC00000000000ULL
+
+// Largest text grid (1920x1080 with an 8x8 font)
+#define FBCON_MAX_COLS      240
+#define FBCON_MAX_ROWS      135
+
+// Number of color pairs with expanded glyph rows cached
+#define FBCON_CACHE_SLOTS   4
+
+/**
+ * Initialize the framebuffer console
+ *
+ * Maps the framebuffer (write-combining when PAT is available) and
+ * loads the built-in font.
+ *
+ * @param fb Framebuffer from the boot information
+ * @return 0 on success, -1 if the framebuffer cannot be used
+ */
+int fbcon_init(const multiboot_framebuffer_t *fb);
+
+/**
+ * Check whether the framebuffer console is up
+ *
+ * @return true once fbcon_init() succeeded
+ */
+bool fbcon_active(void);
+
+/**
+ * Put a character into the shadow buffer
+ *
+ * @param c Character (control characters as in VGA text mode)
+ * @param color VGA attribute (foreground | background << 4)
+ */
+void fbcon_putchar(char c, uint8_t color);
+
+/**
+ * Render dirty cells to the framebuffer
+ */
+void fbcon_flush(void);
+
+/**
+ * Clear the console
+ *
+ * @param color VGA attribute used for the blank cells
+ */
+void fbcon_clear(uint8_t color);
+
+#endif // KERNEL_FBCON_H
@@ -0,0 +1,32 @@
+/**
+ * Bitmap Fonts
+ *
+ * PSF1 font images used by the framebuffer console.
+ */
+
+#ifndef KERNEL_FONT_H
+#define KERNEL_FONT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// PSF1 format
+#define PSF1_MAGIC0     0x36
+#define PSF1_MAGIC1     0x04
+#define PSF1_MODE512    0x01    // 512 glyphs instead of 256
+#define PSF1_WIDTH      8       // PSF1 glyphs are always 8 pixels wide
+
+/**
+ * PSF1 file header (followed by glyph bitmaps)
+ */
+typedef struct psf1_header {
+    uint8_t magic[2];           // PSF1_MAGIC0, PSF1_MAGIC1
+    uint8_t mode;               // PSF1_MODE* flags
+    uint8_t charsize;           // Bytes per glyph (= height)
+} __attribute__((packed)) psf1_header_t;
+
+// Built-in 8x8 font
+extern const uint8_t font_default_psf[];
+extern const size_t font_default_psf_size;
+
+#endif // KERNEL_FONT_H
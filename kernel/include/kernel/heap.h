@@ -15,6 +15,9 @@
 /**
  * Initialize kernel heap
  *
+ * The heap grows past initial_size on demand and is never trimmed
+ * below it.
+ *
  * @param start_addr Virtual address where heap should start
  * @param initial_size Initial heap size in bytes
  */
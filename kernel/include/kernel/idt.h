@@ -73,6 +73,9 @@ typedef struct idt_ptr {
 
 // Software interrupt numbers
 #define INT_SYSCALL     0x80    // System call interrupt
+#define INT_RESCHED     0x81    // Reschedule (yield, sleep, block)
+#define INT_NOP         0xF0    // No-op vector for entry path benchmarks
+#define INT_PROFILE     0xF1    // Profiler sampling (local APIC timer)
 
 /**
  * Initialize IDT
@@ -88,6 +91,14 @@ void idt_init(void);
  */
 void idt_set_gate(uint8_t num, uint64_t handler, uint8_t type_attr);
 
+/**
+ * Switch an IDT entry to an Interrupt Stack Table stack
+ *
+ * @param num Interrupt number (0-255)
+ * @param ist IST slot (1-7, see kernel/tss.h), or 0 for none
+ */
+void idt_set_ist(uint8_t num, uint8_t ist);
+
 /**
  * Enable interrupts
  */
@@ -111,4 +122,22 @@ static inline int interrupts_enabled(void) {
     return flags & (1 << 9);
 }
 
+/**
+ * Disable interrupts and return previous RFLAGS
+ */
+static inline uint64_t interrupts_save(void) {
+    uint64_t flags;
+    __asm__ volatile("pushfq; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+/**
+ * Restore interrupt state saved by interrupts_save()
+ */
+static inline void interrupts_restore(uint64_t flags) {
+    if (flags & (1 << 9)) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
 #endif // KERNEL_IDT_H
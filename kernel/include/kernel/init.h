@@ -0,0 +1,116 @@
+/**
+ * Boot-time Initialization
+ *
+ * Subsystems are brought up from a table of stages, each naming the
+ * stages it depends on. The runner always starts the first stage in
+ * table order whose dependencies have finished, and takes a TSC
+ * timestamp before and after each one for the boot timeline.
+ *
+ * Stages marked INIT_DEFERRED (slow device probing), and every stage
+ * that depends on one, are left to a background kernel task that runs
+ * them once the scheduler is up. Boot carries on to user space while
+ * they run; the task prints the timeline when it is done.
+ */
+
+#ifndef KERNEL_INIT_H
+#define KERNEL_INIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Limits (dependencies are a bitmask of stage indices)
+#define INIT_MAX_STAGES     32
+
+// Stage flags
+#define INIT_DEFERRED       (1U << 0)   // Run in the probe task, not during boot
+
+// Stage result: nothing to do (e.g. no framebuffer); not shown, not a failure
+#define INIT_SKIPPED        1
+
+// Priority of the deferred probe task
+#define INIT_PROBE_PRIORITY 5
+
+// Dependency on the stage at index i of the table
+#define INIT_DEP(i)         (1U << (i))
+
+/**
+ * Initialization stage
+ */
+typedef struct init_stage {
+    const char *name;            // Shown in the status list and timeline
+    int (*init)(void);           // 0, INIT_SKIPPED, or -1 on failure
+    uint32_t deps;               // INIT_DEP() of each stage that must finish first
+    uint32_t flags;              // INIT_DEFERRED
+
+    // Filled in by the runner
+    bool deferred;               // Deferred itself or through a dependency
+    bool done;
+    int status;
+    uint64_t start_tsc;
+    uint64_t end_tsc;
+} init_stage_t;
+
+/**
+ * Run every stage that is not deferred
+ *
+ * A stage whose dependency failed is not run and fails too. Deferred
+ * stages are only marked; init_start_deferred() runs them.
+ *
+ * @param stages Stage table (must stay valid until the probe task is done)
+ * @param count Number of stages (at most INIT_MAX_STAGES)
+ * @return Number of stages that failed
+ */
+int init_run(init_stage_t *stages, uint32_t count);
+
+/**
+ * Create the probe task that runs the deferred stages
+ *
+ * @return 0 on success (or nothing deferred), -1 if the task could not be created
+ */
+int init_start_deferred(void);
+
+/**
+ * Run the deferred stages in the current context and print the timeline
+ *
+ * The probe task calls this; boot does too if the task cannot be created.
+ *
+ * @return Number of stages that failed
+ */
+int init_run_deferred(void);
+
+/**
+ * Check whether all deferred stages have finished
+ */
+bool init_deferred_done(void);
+
+/**
+ * Sleep until all deferred stages have finished (process context only)
+ */
+void init_wait_deferred(void);
+
+/**
+ * Rename the running stage (e.g. to show which variant was set up)
+ *
+ * @param name New name (must stay valid)
+ */
+void init_set_name(const char *name);
+
+/**
+ * Record the moment boot hands over to the scheduler
+ */
+void init_mark_scheduler_start(void);
+
+/**
+ * Print an [ OK ] / [FAIL] line for a component
+ *
+ * @param component Name shown
+ * @param status 0 for OK, anything else for FAIL
+ */
+void init_display_status(const char *component, int status);
+
+/**
+ * Print the boot timeline: start offset and duration of every stage
+ */
+void init_print_timeline(void);
+
+#endif // KERNEL_INIT_H
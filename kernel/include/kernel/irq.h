@@ -0,0 +1,130 @@
+/**
+ * Interrupt Controller Abstraction
+ *
+ * Drivers request, mask and acknowledge IRQs through this layer, which
+ * uses the local APIC and I/O APICs described by the ACPI MADT when
+ * available and falls back to the 8259 PIC otherwise.
+ *
+ * IRQ numbers 0-15 are ISA IRQs (remapped through MADT interrupt source
+ * overrides); numbers 16 and up are I/O APIC GSIs. IRQ n is always
+ * delivered on vector IRQ_BASE + n.
+ */
+
+#ifndef KERNEL_IRQ_H
+#define KERNEL_IRQ_H
+
+#include <stdint.h>
+#include <kernel/isr.h>
+
+// Number of IRQs (vectors IRQ_BASE .. IRQ_BASE + IRQ_COUNT - 1)
+#define IRQ_COUNT       64
+
+// Legacy ISA IRQs
+#define IRQ_ISA_COUNT   16
+
+// Vectors handed out to MSI/MSI-X (above the IRQ range, below system vectors;
+// INT_SYSCALL and INT_RESCHED inside the window are reserved)
+#define IRQ_VECTOR_DYN_FIRST    (IRQ_BASE + IRQ_COUNT)
+#define IRQ_VECTOR_DYN_LAST     0xEF
+
+/**
+ * Interrupt controller in use
+ */
+typedef enum {
+    IRQ_MODE_PIC,               // Legacy 8259 pair
+    IRQ_MODE_APIC,              // Local APIC + I/O APIC
+} irq_mode_t;
+
+/**
+ * Initialize interrupt routing
+ *
+ * Remaps the PIC, then switches to the APIC if the MADT describes one,
+ * in which case the PIC is disabled. All IRQs start masked in APIC mode.
+ *
+ * @return Mode in use
+ */
+irq_mode_t irq_init(void);
+
+/**
+ * Get the interrupt controller in use
+ *
+ * @return IRQ_MODE_PIC or IRQ_MODE_APIC
+ */
+irq_mode_t irq_get_mode(void);
+
+/**
+ * Install the handler for an IRQ
+ *
+ * @param irq IRQ number
+ * @param handler Handler (must call irq_eoi)
+ */
+void irq_register_handler(uint8_t irq, isr_handler_t handler);
+
+/**
+ * Acknowledge an IRQ
+ *
+ * One MMIO store (or MSR write in x2APIC mode) in APIC mode.
+ *
+ * @param irq IRQ number
+ */
+void irq_eoi(uint8_t irq);
+
+/**
+ * Mask an IRQ
+ *
+ * @param irq IRQ number
+ */
+void irq_mask(uint8_t irq);
+
+/**
+ * Unmask an IRQ
+ *
+ * @param irq IRQ number
+ */
+void irq_unmask(uint8_t irq);
+
+/**
+ * Steer an IRQ to a CPU
+ *
+ * @param irq IRQ number
+ * @param cpu CPU index (0 = boot CPU)
+ * @return 0 on success, -1 in PIC mode or for an unknown CPU
+ */
+int irq_set_affinity(uint8_t irq, uint32_t cpu);
+
+/**
+ * Allocate a block of interrupt vectors for MSI/MSI-X
+ *
+ * Multi-message MSI needs the block aligned to its size because the
+ * device ORs the message number into the low bits of the vector.
+ *
+ * @param count Number of vectors
+ * @param align Alignment of the first vector (power of two)
+ * @return First vector, or 0 if none are free or not in APIC mode
+ */
+uint8_t irq_alloc_vectors(uint32_t count, uint32_t align);
+
+/**
+ * Release vectors from irq_alloc_vectors
+ *
+ * @param first First vector
+ * @param count Number of vectors
+ */
+void irq_free_vectors(uint8_t first, uint32_t count);
+
+/**
+ * Get the number of usable CPUs listed in the MADT
+ *
+ * @return CPU count (1 in PIC mode)
+ */
+uint32_t irq_cpu_count(void);
+
+/**
+ * Get the local APIC ID of a CPU
+ *
+ * @param cpu CPU index
+ * @return APIC ID, or 0 if unknown
+ */
+uint32_t irq_cpu_apic_id(uint32_t cpu);
+
+#endif // KERNEL_IRQ_H
@@ -36,6 +36,18 @@ typedef struct registers {
 // Interrupt handler function type
 typedef void (*isr_handler_t)(registers_t *regs);
 
+/**
+ * Interrupt statistics for one vector (summed over CPUs)
+ */
+typedef struct isr_stat {
+    uint32_t vector;
+    uint32_t reserved;
+    uint64_t count;             // Interrupts taken
+    uint64_t cycles;            // TSC cycles spent in the handler
+    uint64_t max_cycles;        // Longest single handler run
+    uint64_t max_latency;       // Worst lateness past the expected period, in cycles
+} isr_stat_t;
+
 /**
  * Initialize ISRs
  */
@@ -56,11 +68,46 @@ void isr_register_handler(uint8_t num, isr_handler_t handler);
  */
 void isr_unregister_handler(uint8_t num);
 
+/**
+ * Declare a vector periodic so its entry lateness is tracked
+ *
+ * @param num Interrupt number
+ * @param cycles Expected TSC cycles between interrupts (0 to stop)
+ */
+void isr_set_period(uint8_t num, uint64_t cycles);
+
+/**
+ * Copy statistics for every vector that has fired
+ *
+ * Syscall cycles are not recorded, since a syscall can switch away and
+ * resume much later inside the same handler.
+ *
+ * @param buf Output array
+ * @param max Capacity of buf
+ * @return Number of entries written
+ */
+uint32_t isr_get_stats(isr_stat_t *buf, uint32_t max);
+
+/**
+ * Print interrupt statistics (like /proc/interrupts)
+ */
+void isr_print_stats(void);
+
 /**
  * Common interrupt handler (called from assembly stubs)
  */
 void isr_common_handler(registers_t *regs);
 
+/**
+ * Hardware interrupt handler (called from the IRQ stub)
+ *
+ * Handlers for IRQ vectors get a frame whose callee-saved register
+ * slots (RBX, RBP, R12-R15) are not filled in.
+ *
+ * @return Nonzero if the stub must take the full exit path
+ */
+int irq_common_handler(registers_t *regs);
+
 // Exception handlers (implemented in assembly)
 extern void isr0(void);   // Divide by zero
 extern void isr1(void);   // Debug
@@ -104,4 +151,8 @@ extern void irq15(void);  // Secondary ATA
 // Syscall handler
 extern void isr128(void); // Syscall (int 0x80)
 
+// Generic stubs for vectors 48-255 (entry = vector - ISR_VECTOR_STUB_BASE)
+#define ISR_VECTOR_STUB_BASE 48
+extern const uint64_t vector_stub_table[256 - ISR_VECTOR_STUB_BASE];
+
 #endif // KERNEL_ISR_H
@@ -0,0 +1,97 @@
+/**
+ * In-Kernel Benchmarks
+ *
+ * Cases are declared anywhere in the kernel with KBENCH() and collected
+ * from the .kbench section at run time. Each iteration is timed with
+ * the TSC after a warmup; results are reported as min/median/p99/max
+ * cycles on the console and as one JSON object per line on the serial
+ * port:
+ *
+ *   KBENCH-BEGIN {"tsc_khz":2400000,"overhead":24,"cases":8}
+ *   KBENCH {"name":"pmm_alloc_free","iterations":10000,"min":61,...}
+ *   KBENCH-END {"passed":8,"skipped":0}
+ *
+ * The suite runs instead of the demo tasks when the kernel command line
+ * contains "bench"; with "bench=exit" the kernel then powers QEMU off
+ * through the isa-debug-exit device, for unattended runs (make perf).
+ */
+
+#ifndef KERNEL_KBENCH_H
+#define KERNEL_KBENCH_H
+
+#include <stdint.h>
+
+// Limits
+#define KBENCH_MAX_ITERATIONS   10000
+#define KBENCH_WARMUP           100     // Untimed iterations before measuring
+
+// Scratch virtual address for mapping benchmarks
+#define KBENCH_MAP_VIRT         0xFFFFC80000000000ULL
+
+// QEMU isa-debug-exit device (-device isa-debug-exit,iobase=0xf4,iosize=0x04)
+#define KBENCH_EXIT_PORT        0xF4
+
+/**
+ * Benchmark case
+ */
+typedef struct kbench_case {
+    const char *name;
+    uint32_t iterations;        // Timed iterations (<= KBENCH_MAX_ITERATIONS)
+    int (*setup)(void);         // Optional; -1 skips the case
+    void (*run)(uint32_t iteration);
+    void (*teardown)(void);     // Optional; runs only after a successful setup
+} kbench_case_t;
+
+/**
+ * Benchmark summary in cycles, TSC read overhead removed
+ */
+typedef struct kbench_result {
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t mean;
+} kbench_result_t;
+
+/**
+ * Declare a benchmark case
+ *
+ * The body that follows is one timed operation; `iteration` counts from
+ * 0 within the warmup and again within the timed run.
+ *
+ *   KBENCH(kmalloc_kfree, 10000, NULL, NULL) {
+ *       kfree(kmalloc(64));
+ *   }
+ */
+#define KBENCH(name_, iterations_, setup_, teardown_)                          \
+    static void kbench_run_##name_(uint32_t iteration __attribute__((unused))); \
+    static const kbench_case_t kbench_case_##name_                              \
+        __attribute__((used, section(".kbench"), aligned(8))) = {               \
+        .name = #name_,                                                         \
+        .iterations = (iterations_),                                            \
+        .setup = (setup_),                                                      \
+        .run = kbench_run_##name_,                                              \
+        .teardown = (teardown_),                                                \
+    };                                                                          \
+    static void kbench_run_##name_(uint32_t iteration __attribute__((unused)))
+
+/**
+ * Run every registered case and report the results
+ *
+ * Some cases need the scheduler running, so call this from a task.
+ *
+ * @return Number of cases that ran
+ */
+uint32_t kbench_run_all(void);
+
+/**
+ * Leave QEMU through the isa-debug-exit device
+ *
+ * QEMU exits with status (code << 1) | 1. Returns if the device is not
+ * present (real hardware, or QEMU started without it).
+ *
+ * @param code Exit code, 0 for success
+ */
+void kbench_exit(uint8_t code);
+
+#endif // KERNEL_KBENCH_H
@@ -0,0 +1,116 @@
+/**
+ * Early Boot Memory Allocator (memblock)
+ *
+ * Before the PMM exists, physical memory is described by two sorted
+ * lists of ranges: usable RAM (from the loader's memory map) and
+ * reservations (kernel image, boot data, early allocations). Early
+ * allocations are carved top-down out of RAM that is not reserved,
+ * within the boot direct map.
+ *
+ * pmm_init() sizes itself from these lists and then takes over; the
+ * lists stay around for reporting, but nothing may be allocated from
+ * them afterwards.
+ */
+
+#ifndef KERNEL_MEMBLOCK_H
+#define KERNEL_MEMBLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Limits
+#define MEMBLOCK_MAX_REGIONS    64
+
+/**
+ * Physical address range
+ */
+typedef struct memblock_region {
+    uint64_t base;
+    uint64_t size;
+} memblock_region_t;
+
+/**
+ * Sorted list of non-overlapping, non-adjacent ranges
+ */
+typedef struct memblock_type {
+    const char *name;
+    uint32_t count;
+    memblock_region_t regions[MEMBLOCK_MAX_REGIONS];
+} memblock_type_t;
+
+/**
+ * Add a range of usable RAM
+ *
+ * Overlapping and adjacent ranges are merged.
+ *
+ * @param base Physical start
+ * @param size Length in bytes
+ * @return 0 on success, -1 if the list is full
+ */
+int memblock_add(uint64_t base, uint64_t size);
+
+/**
+ * Reserve a range so it is neither allocated early nor freed to the PMM
+ *
+ * @param base Physical start
+ * @param size Length in bytes
+ * @return 0 on success, -1 if the list is full
+ */
+int memblock_reserve(uint64_t base, uint64_t size);
+
+/**
+ * Allocate physical memory before the PMM is up
+ *
+ * Taken from the highest free RAM below the end of the direct map.
+ *
+ * @param size Bytes wanted
+ * @param align Alignment (a power of two)
+ * @return Physical address, or 0 if no free range is large enough
+ */
+uint64_t memblock_phys_alloc(uint64_t size, uint64_t align);
+
+/**
+ * Allocate zeroed memory before the PMM is up
+ *
+ * @param size Bytes wanted
+ * @param align Alignment (a power of two)
+ * @return Direct-map pointer, or NULL if no free range is large enough
+ */
+void *memblock_alloc(uint64_t size, uint64_t align);
+
+/**
+ * Get the end of the highest range of usable RAM
+ *
+ * @return Physical address, 0 if no RAM was added
+ */
+uint64_t memblock_end_of_ram(void);
+
+/**
+ * Get the total size of usable RAM
+ *
+ * @return Bytes
+ */
+uint64_t memblock_phys_mem_size(void);
+
+/**
+ * Get the usable RAM ranges
+ */
+const memblock_type_t *memblock_memory(void);
+
+/**
+ * Get the reserved ranges
+ */
+const memblock_type_t *memblock_reserved(void);
+
+/**
+ * Forget all ranges
+ */
+void memblock_reset(void);
+
+/**
+ * Print the usable and reserved ranges
+ */
+void memblock_dump(void);
+
+#endif // KERNEL_MEMBLOCK_H
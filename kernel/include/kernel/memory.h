@@ -31,6 +31,7 @@
 #define PAGE_ACCESSED   (1ULL << 5)   // Page has been accessed
 #define PAGE_DIRTY      (1ULL << 6)   // Page has been written to
 #define PAGE_HUGE       (1ULL << 7)   // Huge page (2MB/1GB)
+#define PAGE_PAT        (1ULL << 7)   // PAT index bit (4KB page table entries)
 #define PAGE_GLOBAL     (1ULL << 8)   // Global page (not flushed on CR3 reload)
 #define PAGE_NX         (1ULL << 63)  // No execute
 
@@ -41,6 +42,7 @@
 // Memory regions
 #define KERNEL_PHYSICAL_START 0x100000  // 1MB
 #define KERNEL_VIRTUAL_BASE   0xFFFF800000000000ULL  // Higher half
+#define DIRECT_MAP_SIZE       (1ULL << 30)  // 1GB, mapped by boot.S at both bases
 
 // Extract page table indices from virtual address
 #define PML4_INDEX(addr) (((addr) >> 39) & 0x1FF)
@@ -0,0 +1,57 @@
+/**
+ * Model-Specific Registers
+ *
+ * Access helpers and numbers for the MSRs the kernel programs.
+ */
+
+#ifndef KERNEL_MSR_H
+#define KERNEL_MSR_H
+
+#include <stdint.h>
+
+// MSR numbers
+#define MSR_IA32_PMC0                   0x0C1   // General-purpose counter 0
+#define MSR_IA32_PERFEVTSEL0            0x186   // Event select for PMC0
+#define MSR_IA32_PAT                    0x277   // Page attribute table
+#define MSR_IA32_PERF_GLOBAL_STATUS     0x38E   // Counter overflow status (v2+)
+#define MSR_IA32_PERF_GLOBAL_CTRL       0x38F   // Counter enables (v2+)
+#define MSR_IA32_PERF_GLOBAL_OVF_CTRL   0x390   // Overflow status clear (v2+)
+
+// IA32_PERFEVTSELx bits
+#define PERFEVTSEL_USR      (1 << 16)   // Count in ring 3
+#define PERFEVTSEL_OS       (1 << 17)   // Count in ring 0
+#define PERFEVTSEL_INT      (1 << 20)   // Interrupt on overflow
+#define PERFEVTSEL_EN       (1 << 22)   // Enable
+
+// PAT memory types
+#define PAT_TYPE_UC         0x00    // Uncacheable
+#define PAT_TYPE_WC         0x01    // Write-combining
+#define PAT_TYPE_WT         0x04    // Write-through
+#define PAT_TYPE_WP         0x05    // Write-protected
+#define PAT_TYPE_WB         0x06    // Write-back
+#define PAT_TYPE_UC_MINUS   0x07    // Uncached (overridable by MTRR)
+
+/**
+ * Read a model-specific register
+ *
+ * @param msr MSR number
+ * @return 64-bit MSR value
+ */
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Write a model-specific register
+ *
+ * @param msr MSR number
+ * @param value 64-bit value to write
+ */
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"((uint32_t)value),
+                     "d"((uint32_t)(value >> 32)) : "memory");
+}
+
+#endif // KERNEL_MSR_H
@@ -0,0 +1,150 @@
+/**
+ * Multiboot2 Boot Information
+ *
+ * Parses the information structure GRUB hands to the kernel. The data
+ * that is needed later is copied out at boot, since the structure lives
+ * in memory the physical allocator will eventually reuse.
+ */
+
+#ifndef KERNEL_MULTIBOOT_H
+#define KERNEL_MULTIBOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Value in EAX when loaded by a multiboot2 loader
+#define MULTIBOOT2_BOOTLOADER_MAGIC 0x36d76289
+
+// Tag types
+#define MULTIBOOT_TAG_END           0
+#define MULTIBOOT_TAG_CMDLINE       1
+#define MULTIBOOT_TAG_LOADER_NAME   2
+#define MULTIBOOT_TAG_BASIC_MEMINFO 4
+#define MULTIBOOT_TAG_MMAP          6
+#define MULTIBOOT_TAG_FRAMEBUFFER   8
+#define MULTIBOOT_TAG_ACPI_OLD      14
+#define MULTIBOOT_TAG_ACPI_NEW      15
+
+// Framebuffer types
+#define MULTIBOOT_FB_TYPE_INDEXED   0
+#define MULTIBOOT_FB_TYPE_RGB       1
+#define MULTIBOOT_FB_TYPE_EGA_TEXT  2
+
+// Maximum saved command line length
+#define MULTIBOOT_CMDLINE_MAX 256
+
+// Maximum saved ACPI RSDP size (ACPI 2.0+ RSDP is 36 bytes)
+#define MULTIBOOT_RSDP_MAX 36
+
+/**
+ * Generic tag header
+ */
+typedef struct multiboot_tag {
+    uint32_t type;
+    uint32_t size;
+} __attribute__((packed)) multiboot_tag_t;
+
+// Memory map entry types
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+/**
+ * Memory map tag (entries of entry_size bytes follow)
+ */
+typedef struct multiboot_tag_mmap {
+    uint32_t type;
+    uint32_t size;
+    uint32_t entry_size;
+    uint32_t entry_version;
+} __attribute__((packed)) multiboot_tag_mmap_t;
+
+/**
+ * Memory map entry
+ */
+typedef struct multiboot_mmap_entry {
+    uint64_t addr;              // Physical start
+    uint64_t len;               // Length in bytes
+    uint32_t type;              // MULTIBOOT_MEMORY_*
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+/**
+ * Framebuffer tag (common part plus RGB field layout)
+ */
+typedef struct multiboot_tag_framebuffer {
+    uint32_t type;
+    uint32_t size;
+    uint64_t addr;              // Physical address
+    uint32_t pitch;             // Bytes per scanline
+    uint32_t width;             // Pixels
+    uint32_t height;            // Pixels
+    uint8_t bpp;                // Bits per pixel
+    uint8_t fb_type;            // MULTIBOOT_FB_TYPE_*
+    uint16_t reserved;
+    uint8_t red_pos;
+    uint8_t red_size;
+    uint8_t green_pos;
+    uint8_t green_size;
+    uint8_t blue_pos;
+    uint8_t blue_size;
+} __attribute__((packed)) multiboot_tag_framebuffer_t;
+
+/**
+ * Framebuffer description saved from the boot information
+ */
+typedef struct multiboot_framebuffer {
+    uint64_t addr;              // Physical address
+    uint32_t pitch;             // Bytes per scanline
+    uint32_t width;             // Pixels
+    uint32_t height;            // Pixels
+    uint8_t bpp;                // Bits per pixel
+    uint8_t red_pos, red_size;
+    uint8_t green_pos, green_size;
+    uint8_t blue_pos, blue_size;
+} multiboot_framebuffer_t;
+
+/**
+ * Parse the multiboot2 information structure
+ *
+ * Usable ranges of the memory map are handed to memblock.
+ *
+ * @param info_phys Physical address of the information structure
+ * @param magic Value the loader left in EAX
+ * @return 0 on success, -1 if not booted by a multiboot2 loader
+ */
+int multiboot_init(uint64_t info_phys, uint32_t magic);
+
+/**
+ * Get the linear framebuffer handed over by the loader
+ *
+ * @return Framebuffer description, or NULL if there is no RGB framebuffer
+ */
+const multiboot_framebuffer_t *multiboot_get_framebuffer(void);
+
+/**
+ * Get the copy of the ACPI RSDP the loader passed
+ *
+ * @return RSDP copy, or NULL if the loader provided none
+ */
+const void *multiboot_get_rsdp(void);
+
+/**
+ * Get the kernel command line
+ *
+ * @return Command line (empty string if none)
+ */
+const char *multiboot_get_cmdline(void);
+
+/**
+ * Look up a command line option
+ *
+ * Options are space separated words, either "name" or "name=value".
+ *
+ * @param name Option name
+ * @param value Receives the value ("" for a bare flag), may be NULL
+ * @param size Size of value
+ * @return true if the option is present
+ */
+bool multiboot_cmdline_option(const char *name, char *value, size_t size);
+
+#endif // KERNEL_MULTIBOOT_H
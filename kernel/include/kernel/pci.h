@@ -0,0 +1,315 @@
+/**
+ * PCI Bus Layer
+ *
+ * Enumerates PCI functions through ECAM (from the ACPI MCFG table) or
+ * the legacy 0xCF8/0xCFC ports, matches them against registered
+ * drivers, maps BARs and hands out MSI/MSI-X vectors so each device
+ * queue can have its own interrupt.
+ */
+
+#ifndef KERNEL_PCI_H
+#define KERNEL_PCI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/isr.h>
+
+// Legacy configuration mechanism #1
+#define PCI_CONFIG_ADDRESS      0xCF8
+#define PCI_CONFIG_DATA         0xCFC
+#define PCI_CONFIG_ENABLE       0x80000000
+
+// Configuration space header
+#define PCI_VENDOR_ID           0x00
+#define PCI_DEVICE_ID           0x02
+#define PCI_COMMAND             0x04
+#define PCI_STATUS              0x06
+#define PCI_REVISION            0x08
+#define PCI_PROG_IF             0x09
+#define PCI_SUBCLASS            0x0A
+#define PCI_CLASS               0x0B
+#define PCI_HEADER_TYPE         0x0E
+#define PCI_BAR0                0x10
+#define PCI_SECONDARY_BUS       0x19    // Type 1 (bridge) header
+#define PCI_CAP_PTR             0x34
+#define PCI_INTERRUPT_LINE      0x3C
+#define PCI_INTERRUPT_PIN       0x3D
+
+// Command register bits
+#define PCI_COMMAND_IO          0x0001
+#define PCI_COMMAND_MEMORY      0x0002
+#define PCI_COMMAND_MASTER      0x0004
+#define PCI_COMMAND_INTX_DISABLE 0x0400
+
+// Status register bits
+#define PCI_STATUS_CAP_LIST     0x0010
+
+// Header type
+#define PCI_HEADER_TYPE_MASK    0x7F
+#define PCI_HEADER_BRIDGE       0x01
+#define PCI_HEADER_MULTIFUNC    0x80
+
+// Classes used during enumeration
+#define PCI_CLASS_BRIDGE        0x06
+#define PCI_SUBCLASS_PCI_BRIDGE 0x04
+
+// BAR bits
+#define PCI_BAR_IO              0x1
+#define PCI_BAR_TYPE_MASK       0x6
+#define PCI_BAR_TYPE_64         0x4
+#define PCI_BAR_PREFETCH        0x8
+#define PCI_BAR_COUNT           6
+
+// Capability IDs
+#define PCI_CAP_ID_MSI          0x05
+#define PCI_CAP_ID_MSIX         0x11
+
+// MSI capability
+#define PCI_MSI_CTRL            0x02
+#define PCI_MSI_ADDR_LO         0x04
+#define PCI_MSI_ADDR_HI         0x08
+#define PCI_MSI_CTRL_ENABLE     0x0001
+#define PCI_MSI_CTRL_MMC_SHIFT  1       // Multiple message capable (log2)
+#define PCI_MSI_CTRL_MME_SHIFT  4       // Multiple message enable (log2)
+#define PCI_MSI_CTRL_64BIT      0x0080
+#define PCI_MSI_CTRL_MASKABLE   0x0100
+
+// MSI-X capability
+#define PCI_MSIX_CTRL           0x02
+#define PCI_MSIX_TABLE          0x04
+#define PCI_MSIX_CTRL_SIZE_MASK 0x07FF  // Table size - 1
+#define PCI_MSIX_CTRL_MASKALL   0x4000
+#define PCI_MSIX_CTRL_ENABLE    0x8000
+#define PCI_MSIX_BIR_MASK       0x7     // BAR indicator in PCI_MSIX_TABLE
+#define PCI_MSIX_ENTRY_SIZE     16
+#define PCI_MSIX_ENTRY_ADDR_LO  0x0
+#define PCI_MSIX_ENTRY_ADDR_HI  0x4
+#define PCI_MSIX_ENTRY_DATA     0x8
+#define PCI_MSIX_ENTRY_CTRL     0xC
+#define PCI_MSIX_ENTRY_MASKED   0x1
+
+// MSI message address (fixed delivery, physical destination)
+#define PCI_MSI_ADDR_BASE       0xFEE00000
+#define PCI_MSI_ADDR_DEST_SHIFT 12
+
+// Matches any vendor/device/class field in a pci_device_id_t
+#define PCI_ANY_ID              0xFFFF
+
+// Limits
+#define PCI_MAX_DEVICES         64
+#define PCI_MAX_VECTORS         32      // MSI/MSI-X vectors per device
+
+/**
+ * Interrupt mode of a device
+ */
+typedef enum {
+    PCI_IRQ_NONE,
+    PCI_IRQ_LEGACY,             // INTx pin through the interrupt controller
+    PCI_IRQ_MSI,
+    PCI_IRQ_MSIX,
+} pci_irq_mode_t;
+
+struct pci_driver;
+
+/**
+ * PCI function
+ */
+typedef struct pci_device {
+    uint16_t segment;
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t revision;
+    uint8_t header_type;
+    uint8_t irq_line;           // Legacy IRQ from firmware (0xFF = none)
+
+    uint64_t bar_phys[PCI_BAR_COUNT];
+    uint64_t bar_size[PCI_BAR_COUNT];
+    uint32_t bar_flags[PCI_BAR_COUNT];   // PCI_BAR_* bits of the BAR
+
+    uint8_t msi_cap;            // Capability offsets (0 = absent)
+    uint8_t msix_cap;
+
+    pci_irq_mode_t irq_mode;
+    uint8_t vector_base;        // First vector (MSI: contiguous block)
+    uint8_t vector_count;
+    uint8_t msix_vectors[PCI_MAX_VECTORS];
+    volatile uint8_t *msix_table;
+
+    volatile uint8_t *ecam;     // Configuration space mapping (NULL = CF8)
+
+    struct pci_driver *driver;
+    void *driver_data;
+} pci_device_t;
+
+/**
+ * Driver match entry (table ends with vendor_id == 0)
+ */
+typedef struct pci_device_id {
+    uint16_t vendor_id;         // PCI_ANY_ID for any
+    uint16_t device_id;
+    uint16_t class_code;        // PCI_ANY_ID for any
+    uint16_t subclass;
+} pci_device_id_t;
+
+/**
+ * PCI driver
+ */
+typedef struct pci_driver {
+    const char *name;
+    const pci_device_id_t *id_table;
+
+    /**
+     * Bind to a matching device
+     *
+     * @return 0 if the driver took the device, -1 otherwise
+     */
+    int (*probe)(pci_device_t *dev, const pci_device_id_t *id);
+
+    struct pci_driver *next;
+} pci_driver_t;
+
+/**
+ * Enumerate all PCI buses
+ *
+ * @return Number of functions found, or -1 if there is no PCI bus
+ */
+int pci_init(void);
+
+/**
+ * Check whether configuration space is accessed through ECAM
+ *
+ * @return true for ECAM, false for the legacy ports
+ */
+bool pci_using_ecam(void);
+
+// Configuration space access
+uint8_t pci_config_read8(pci_device_t *dev, uint16_t offset);
+uint16_t pci_config_read16(pci_device_t *dev, uint16_t offset);
+uint32_t pci_config_read32(pci_device_t *dev, uint16_t offset);
+void pci_config_write8(pci_device_t *dev, uint16_t offset, uint8_t value);
+void pci_config_write16(pci_device_t *dev, uint16_t offset, uint16_t value);
+void pci_config_write32(pci_device_t *dev, uint16_t offset, uint32_t value);
+
+/**
+ * Register a driver and probe it against unclaimed devices
+ *
+ * @param driver Driver (must stay valid)
+ * @return Number of devices bound
+ */
+int pci_register_driver(pci_driver_t *driver);
+
+/**
+ * Find the next device of a class
+ *
+ * @param class_code Class
+ * @param subclass Subclass, or PCI_ANY_ID
+ * @param from Previous result, or NULL to start
+ * @return Device, or NULL
+ */
+pci_device_t *pci_find_class(uint8_t class_code, uint16_t subclass, pci_device_t *from);
+
+/**
+ * Get a device by index
+ *
+ * @param index Index (0 .. pci_device_count() - 1)
+ * @return Device, or NULL
+ */
+pci_device_t *pci_get_device(uint32_t index);
+
+/**
+ * Get the number of enumerated functions
+ */
+uint32_t pci_device_count(void);
+
+/**
+ * Enable memory/I/O decoding and bus mastering
+ *
+ * @param dev Device
+ */
+void pci_enable_device(pci_device_t *dev);
+
+/**
+ * Map a memory BAR
+ *
+ * Register BARs are mapped uncached, prefetchable BARs write-combining.
+ *
+ * @param dev Device
+ * @param bar BAR index
+ * @return Virtual address, or NULL for I/O or unimplemented BARs
+ */
+volatile void *pci_map_bar(pci_device_t *dev, uint32_t bar);
+
+/**
+ * Find a capability in the capability list
+ *
+ * @param dev Device
+ * @param cap_id PCI_CAP_ID_*
+ * @return Configuration space offset, or 0 if absent
+ */
+uint8_t pci_find_capability(pci_device_t *dev, uint8_t cap_id);
+
+/**
+ * Allocate message-signalled interrupt vectors
+ *
+ * Prefers MSI-X (one vector per queue), then MSI. Handlers are not
+ * installed and every vector starts masked at the device for MSI-X.
+ *
+ * @param dev Device
+ * @param min_vecs Fewest vectors the driver can work with
+ * @param max_vecs Vectors wanted
+ * @return Vectors allocated, or -1 (driver should fall back to INTx)
+ */
+int pci_alloc_irq_vectors(pci_device_t *dev, uint32_t min_vecs, uint32_t max_vecs);
+
+/**
+ * Get the CPU vector of an allocated interrupt
+ *
+ * @param dev Device
+ * @param index Interrupt index (0 .. allocated - 1)
+ * @return Vector, or 0 if out of range
+ */
+uint8_t pci_irq_vector(pci_device_t *dev, uint32_t index);
+
+/**
+ * Install the handler for an allocated interrupt and unmask it
+ *
+ * Handlers acknowledge with lapic_eoi().
+ *
+ * @param dev Device
+ * @param index Interrupt index
+ * @param handler Handler
+ * @return 0 on success, -1 on error
+ */
+int pci_request_irq(pci_device_t *dev, uint32_t index, isr_handler_t handler);
+
+/**
+ * Steer one interrupt to a CPU
+ *
+ * @param dev Device
+ * @param index Interrupt index (MSI-X only; MSI moves all vectors)
+ * @param cpu CPU index
+ * @return 0 on success, -1 on error
+ */
+int pci_set_irq_affinity(pci_device_t *dev, uint32_t index, uint32_t cpu);
+
+/**
+ * Disable MSI/MSI-X and release the vectors
+ *
+ * @param dev Device
+ */
+void pci_free_irq_vectors(pci_device_t *dev);
+
+/**
+ * Print all enumerated functions
+ */
+void pci_dump(void);
+
+#endif // KERNEL_PCI_H
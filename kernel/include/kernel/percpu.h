@@ -0,0 +1,27 @@
+/**
+ * Per-CPU Data
+ *
+ * Helpers for data that is replicated per processor so hot paths can
+ * avoid shared cache lines and locks.
+ */
+
+#ifndef KERNEL_PERCPU_H
+#define KERNEL_PERCPU_H
+
+#include <stdint.h>
+
+// Maximum number of CPUs with per-CPU state
+#define MAX_CPUS 4
+
+/**
+ * Get the index of the executing CPU
+ *
+ * Always 0 until application processors are brought up.
+ *
+ * @return CPU index in [0, MAX_CPUS)
+ */
+static inline uint32_t cpu_id(void) {
+    return 0;
+}
+
+#endif // KERNEL_PERCPU_H
@@ -0,0 +1,110 @@
+/**
+ * Pipes and FIFOs
+ *
+ * Anonymous pipes and named FIFOs built on a ring of physical pages.
+ * Readers and writers block on wait queues. Whole pages can be handed
+ * to and taken from a pipe without copying.
+ */
+
+#ifndef KERNEL_PIPE_H
+#define KERNEL_PIPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/vfs.h>
+#include <kernel/waitqueue.h>
+
+// Number of page slots in a pipe ring (64KB of buffered data)
+#define PIPE_RING_PAGES 16
+
+// Maximum number of named FIFOs
+#define MAX_FIFOS 16
+
+/**
+ * One page slot in the pipe ring
+ */
+typedef struct pipe_buffer {
+    uint64_t page;               // Physical page (0 = slot empty)
+    uint32_t offset;             // Offset of first unread byte
+    uint32_t len;                // Number of unread bytes
+} pipe_buffer_t;
+
+/**
+ * Pipe state shared by both ends
+ */
+typedef struct pipe {
+    pipe_buffer_t bufs[PIPE_RING_PAGES];  // Page ring
+    uint32_t head;               // Slot to read from next
+    uint32_t count;              // Number of slots in use
+    uint32_t readers;            // Open read ends
+    uint32_t writers;            // Open write ends
+    int had_writer;              // A writer has opened this pipe
+    int named;                   // Backs a named FIFO (never freed)
+    wait_queue_t read_wait;      // Readers waiting for data
+    wait_queue_t write_wait;     // Writers waiting for space
+} pipe_t;
+
+// Initialize pipe subsystem
+void pipe_init(void);
+
+/**
+ * Create an anonymous pipe
+ *
+ * @param read_fd Receives the read end descriptor
+ * @param write_fd Receives the write end descriptor
+ * @return 0 on success, -1 on failure
+ */
+int pipe_create(int *read_fd, int *write_fd);
+
+/**
+ * Create a named FIFO
+ *
+ * @param path Absolute path of the FIFO
+ * @return 0 on success, -1 on failure
+ */
+int pipe_mkfifo(const char *path);
+
+/**
+ * Look up a named FIFO by path
+ *
+ * @param path Absolute path
+ * @return FIFO node, or NULL if no FIFO has that path
+ */
+vfs_node_t *pipe_lookup_fifo(const char *path);
+
+/**
+ * Open one end of a named FIFO
+ *
+ * @param fifo Node returned by pipe_lookup_fifo()
+ * @param flags Open flags (O_RDONLY opens the read end)
+ * @return Per-open end node, or NULL on failure
+ */
+vfs_node_t *pipe_open_fifo(vfs_node_t *fifo, uint32_t flags);
+
+/**
+ * Hand a full page to a pipe without copying
+ *
+ * Ownership of the physical page passes to the pipe. Blocks while the
+ * ring is full.
+ *
+ * @param pipe Pipe to write to
+ * @param page Physical page address
+ * @param len Number of valid bytes in the page
+ * @return 0 on success, -1 if there are no readers
+ */
+int pipe_give_page(pipe_t *pipe, uint64_t page, uint32_t len);
+
+/**
+ * Take the next page out of a pipe without copying
+ *
+ * Ownership of the returned page passes to the caller, who must free
+ * it with pmm_free_page(). Blocks while the pipe is empty.
+ *
+ * @param pipe Pipe to read from
+ * @param page Receives the physical page address
+ * @param offset Receives the offset of the data within the page
+ * @return Number of bytes in the page, 0 at end of file, -1 on error
+ */
+int pipe_take_page(pipe_t *pipe, uint64_t *page, uint32_t *offset);
+
+#endif // KERNEL_PIPE_H
@@ -3,6 +3,11 @@
  *
  * Manages physical memory pages using a bitmap allocator.
  * Each bit in the bitmap represents one 4KB page.
+ *
+ * Every page also has a struct page recording who owns it, so memory
+ * can be broken down by subsystem and by process. Allocations start out
+ * as PAGE_OWNER_KERNEL; callers that know better retag them with
+ * pmm_set_owner().
  */
 
 #ifndef KERNEL_PMM_H
@@ -12,17 +17,47 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+/**
+ * Page owners
+ */
+typedef enum {
+    PAGE_OWNER_FREE,
+    PAGE_OWNER_RESERVED,        // Firmware, kernel image, boot-time reservations
+    PAGE_OWNER_KERNEL,          // Kernel allocations not tagged otherwise
+    PAGE_OWNER_HEAP,            // Backing the kernel heap
+    PAGE_OWNER_PAGETABLE,       // Page tables (pid set for process address spaces)
+    PAGE_OWNER_STACK,           // Kernel stacks (pid of the task)
+    PAGE_OWNER_USER,            // Mapped into a process (pid set)
+    PAGE_OWNER_PIPE,            // Pipe buffers
+    PAGE_OWNER_CACHE,           // Block and page caches
+    PAGE_OWNER_COUNT,
+} page_owner_t;
+
+/**
+ * Per-page metadata
+ */
+typedef struct page {
+    uint32_t pid;               // Owning process, 0 for the kernel
+    uint8_t owner;              // page_owner_t
+    uint8_t reserved[3];
+} page_t;
+
 /**
  * Initialize physical memory manager
  *
- * @param mem_size Total physical memory size in bytes
+ * Takes over from memblock: manages RAM up to memblock_end_of_ram()
+ * (at most the direct map), frees the usable ranges and keeps every
+ * memblock reservation. Page 0 and the kernel image are reserved here.
+ *
  * @param kernel_end End address of kernel in physical memory
  */
-void pmm_init(uint64_t mem_size, uint64_t kernel_end);
+void pmm_init(uint64_t kernel_end);
 
 /**
  * Allocate a single physical page (4KB)
  *
+ * Runs direct reclaim (see reclaim.h) before giving up.
+ *
  * @return Physical address of allocated page, or 0 if out of memory
  */
 uint64_t pmm_alloc_page(void);
@@ -100,6 +135,20 @@ uint64_t pmm_get_total_memory(void);
  */
 uint64_t pmm_get_free_memory(void);
 
+/**
+ * Get the free page count below which kswapd is woken
+ *
+ * @return Number of 4KB pages
+ */
+uint32_t pmm_get_low_watermark(void);
+
+/**
+ * Get the free page count kswapd reclaims up to
+ *
+ * @return Number of 4KB pages
+ */
+uint32_t pmm_get_high_watermark(void);
+
 /**
  * Check if a physical page is free
  *
@@ -108,4 +157,45 @@ uint64_t pmm_get_free_memory(void);
  */
 bool pmm_is_free(uint64_t addr);
 
+/**
+ * Get the metadata of a physical page
+ *
+ * @param addr Physical address
+ * @return struct page, or NULL if addr is beyond managed memory
+ */
+page_t *pmm_get_page(uint64_t addr);
+
+/**
+ * Retag allocated pages
+ *
+ * Free pages are left alone.
+ *
+ * @param addr Physical address of first page
+ * @param count Number of pages
+ * @param owner New owner
+ * @param pid Owning process, or 0
+ */
+void pmm_set_owner(uint64_t addr, size_t count, page_owner_t owner, uint32_t pid);
+
+/**
+ * Get number of pages with a given owner
+ *
+ * @param owner Owner to count (PAGE_OWNER_FREE counts free pages)
+ * @return Number of 4KB pages
+ */
+uint32_t pmm_get_owner_pages(page_owner_t owner);
+
+/**
+ * Get the name of an owner ("heap", "pagetable", ...)
+ *
+ * @param owner Owner
+ * @return Name, or "?" if out of range
+ */
+const char *pmm_owner_name(page_owner_t owner);
+
+/**
+ * Print physical memory use broken down by owner
+ */
+void pmm_dump_usage(void);
+
 #endif // KERNEL_PMM_H
@@ -0,0 +1,102 @@
+/**
+ * Kernel Log (printk)
+ *
+ * Lock-free per-CPU log ring. Callers format a record into the ring and
+ * return immediately; a low-priority console task drains records to VGA
+ * and serial. Messages above the compile-time level are removed by the
+ * preprocessor, and messages above the runtime level return early.
+ */
+
+#ifndef KERNEL_PRINTK_H
+#define KERNEL_PRINTK_H
+
+#include <stdint.h>
+
+// Log levels (lower is more severe)
+#define LOG_EMERG   0   // System is unusable
+#define LOG_ALERT   1   // Action must be taken immediately
+#define LOG_CRIT    2   // Critical condition
+#define LOG_ERR     3   // Error
+#define LOG_WARNING 4   // Warning
+#define LOG_NOTICE  5   // Normal but significant
+#define LOG_INFO    6   // Informational
+#define LOG_DEBUG   7   // Debug
+
+// Messages above this level are compiled out (override with -D)
+#ifndef PRINTK_COMPILE_LEVEL
+#define PRINTK_COMPILE_LEVEL LOG_DEBUG
+#endif
+
+// Default runtime level
+#define PRINTK_DEFAULT_LEVEL LOG_INFO
+
+// Ring geometry (records per CPU, bytes per record)
+#define PRINTK_RING_RECORDS 256
+#define PRINTK_RECORD_SIZE  128
+
+#define pr_level(level, ...)                        \
+    do {                                            \
+        if ((level) <= PRINTK_COMPILE_LEVEL) {      \
+            printk((level), __VA_ARGS__);           \
+        }                                           \
+    } while (0)
+
+#define pr_err(...)    pr_level(LOG_ERR, __VA_ARGS__)
+#define pr_warn(...)   pr_level(LOG_WARNING, __VA_ARGS__)
+#define pr_notice(...) pr_level(LOG_NOTICE, __VA_ARGS__)
+#define pr_info(...)   pr_level(LOG_INFO, __VA_ARGS__)
+#define pr_debug(...)  pr_level(LOG_DEBUG, __VA_ARGS__)
+
+/**
+ * Initialize the log ring
+ *
+ * Until the console task is started, every message is drained
+ * synchronously so early boot output is not delayed.
+ */
+void printk_init(void);
+
+/**
+ * Log a formatted message
+ *
+ * Safe from any context, including interrupt handlers. If the ring is
+ * full the message is dropped and counted.
+ *
+ * @param level Log level (LOG_*)
+ * @param format Format string (see vsnprintf)
+ */
+void printk(int level, const char *format, ...);
+
+/**
+ * Set the runtime log level
+ *
+ * @param level Messages with a level above this are discarded
+ */
+void printk_set_level(int level);
+
+/**
+ * Get the runtime log level
+ *
+ * @return Current runtime log level
+ */
+int printk_get_level(void);
+
+/**
+ * Drain all committed records to the console synchronously
+ *
+ * Used on panic and before the console task exists.
+ */
+void printk_flush(void);
+
+/**
+ * Start the low-priority console task (klogd)
+ */
+void printk_start_console_task(void);
+
+/**
+ * Get the number of messages dropped because the ring was full
+ *
+ * @return Dropped message count
+ */
+uint64_t printk_get_dropped(void);
+
+#endif // KERNEL_PRINTK_H
@@ -58,6 +58,12 @@ typedef struct process {
     uint64_t kernel_stack;      // Kernel stack pointer
     uint64_t user_stack;        // User stack pointer
 
+    // Memory accounting, in pages
+    uint64_t rss_pages;         // User pages mapped
+    uint64_t swap_pages;        // User pages swapped out
+    uint64_t pagetable_pages;   // Page tables of the address space
+    uint64_t kstack_pages;      // Kernel stack
+
     // Scheduling
     uint32_t priority;          // Priority level (0 = highest)
     uint32_t time_slice;        // Time slice in ticks
@@ -70,6 +76,8 @@ typedef struct process {
     // Linked list
     struct process *next;       // Next process in queue
     struct process *prev;       // Previous process in queue
+    struct process *wait_next;  // Next process on a wait queue
+    struct wait_queue *wait_queue; // Wait queue it is blocked on, if any
 } process_t;
 
 /**
@@ -104,6 +112,27 @@ process_t *process_create_user(uint64_t entry, const char *name, uint32_t priori
  */
 void process_exit(int exit_code);
 
+/**
+ * Terminate another process
+ *
+ * Takes it off the ready queue or the wait queue it is blocked on, so
+ * nothing can schedule it again, and frees its address space and kernel
+ * stack. It stays in the table as a zombie until process_reap_zombies().
+ * Does not touch the heap, so it is safe inside an allocation.
+ *
+ * @param proc Process (not the current one)
+ * @param exit_code Exit code
+ */
+void process_terminate(process_t *proc, int exit_code);
+
+/**
+ * Reap every process left by process_terminate()
+ *
+ * Closes their files and frees their table slots. Uses the heap, so it
+ * must not run inside an allocation.
+ */
+void process_reap_zombies(void);
+
 /**
  * Sleep current process
  *
@@ -114,7 +143,8 @@ void process_sleep(uint64_t ticks);
 /**
  * Wake up sleeping processes
  *
- * Called by timer interrupt to check for sleeping processes.
+ * Called from the timer softirq; only walks the process table when the
+ * earliest sleeper is due.
  */
 void process_wakeup_sleeping(void);
 
@@ -146,4 +176,10 @@ int process_kill(uint32_t pid);
  */
 void process_list(void);
 
+/**
+ * Print per-process memory use: resident user pages, page tables and
+ * kernel stack, largest first
+ */
+void process_dump_memory(void);
+
 #endif // KERNEL_PROCESS_H
@@ -0,0 +1,97 @@
+/**
+ * Sampling Profiler
+ *
+ * Periodically records the interrupted RIP and a frame-pointer call
+ * chain into a per-CPU buffer. Samples come from a performance counter
+ * overflowing into an NMI when the CPU has an architectural PMU, so
+ * code running with interrupts disabled is profiled too; otherwise from
+ * the local APIC timer, or the PIT tick as a last resort.
+ *
+ * profile_dump() writes the samples to the serial port as folded
+ * stacks of raw addresses; scripts/profile-symbolize.py turns them into
+ * function names using build/kernel.elf, ready for flamegraph.pl.
+ */
+
+#ifndef KERNEL_PROFILE_H
+#define KERNEL_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Limits
+#define PROFILE_MAX_DEPTH       16      // Frames per sample, including RIP
+#define PROFILE_SAMPLES         1024    // Samples per CPU
+#define PROFILE_STACK_WINDOW    16384   // Frame pointers must lie this close to RSP
+
+// Defaults
+#define PROFILE_DEFAULT_PERIOD  1000000 // Events between PMU samples
+#define PROFILE_TIMER_HZ        997     // Timer sampling rate (avoids lockstep with ticks)
+
+/**
+ * What to sample on
+ */
+typedef enum {
+    PROFILE_EVENT_CYCLES,           // Unhalted core cycles
+    PROFILE_EVENT_INSTRUCTIONS,     // Instructions retired
+    PROFILE_EVENT_LLC_MISSES,       // Last-level cache misses
+    PROFILE_EVENT_TIMER,            // Wall-clock timer, no PMU needed
+    PROFILE_EVENT_COUNT,
+} profile_event_t;
+
+/**
+ * Where samples actually come from
+ */
+typedef enum {
+    PROFILE_SOURCE_NONE,
+    PROFILE_SOURCE_PMU,             // Counter overflow NMI
+    PROFILE_SOURCE_LAPIC,           // Local APIC timer on INT_PROFILE
+    PROFILE_SOURCE_PIT,             // PIT tick (RIP only)
+} profile_source_t;
+
+/**
+ * One sample
+ */
+typedef struct profile_sample {
+    uint64_t ip[PROFILE_MAX_DEPTH]; // ip[0] = RIP, then return addresses
+    uint8_t depth;
+    bool user;                      // Interrupted ring 3
+} profile_sample_t;
+
+/**
+ * Start sampling
+ *
+ * Falls back to a timer source when the requested PMU event is not
+ * available.
+ *
+ * @param event Event to sample on
+ * @param period Events between samples (PMU only; 0 for the default)
+ * @return Source in use, or PROFILE_SOURCE_NONE on error
+ */
+profile_source_t profile_start(profile_event_t event, uint64_t period);
+
+/**
+ * Stop sampling
+ */
+void profile_stop(void);
+
+/**
+ * Write folded stacks to the serial port and clear the buffers
+ */
+void profile_dump(void);
+
+/**
+ * Check whether the profiler is running
+ *
+ * @return true between profile_start() and profile_stop()
+ */
+bool profile_active(void);
+
+/**
+ * Parse an event name ("cycles", "instructions", "llc", "timer")
+ *
+ * @param name Event name
+ * @return Event, or PROFILE_EVENT_COUNT if unknown
+ */
+profile_event_t profile_parse_event(const char *name);
+
+#endif // KERNEL_PROFILE_H
@@ -0,0 +1,103 @@
+/**
+ * Memory Reclaim
+ *
+ * Caches that can give memory back register a shrinker. When free pages
+ * fall below the PMM's low watermark, kswapd is woken and shrinks caches
+ * in the background until the high watermark is reached. An allocation
+ * that still finds nothing runs the shrinkers itself (direct reclaim),
+ * and only if that fails too does the OOM killer pick a victim.
+ */
+
+#ifndef KERNEL_RECLAIM_H
+#define KERNEL_RECLAIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Limits
+#define MAX_SHRINKERS       16
+
+// Priority of the kswapd thread
+#define KSWAPD_PRIORITY     10
+
+struct shrinker;
+
+/**
+ * Cache shrinker
+ *
+ * Both callbacks run with interrupts disabled and must not sleep. A
+ * scan that does I/O should do a bounded amount and return; it is
+ * called again on the next pass if more pages are still wanted.
+ */
+typedef struct shrinker {
+    const char *name;
+
+    /**
+     * Count pages the cache could free right now
+     *
+     * @return Number of freeable pages
+     */
+    size_t (*count)(struct shrinker *shrinker);
+
+    /**
+     * Free up to nr_pages pages
+     *
+     * @return Number of pages returned to the PMM
+     */
+    size_t (*scan)(struct shrinker *shrinker, size_t nr_pages);
+
+    void *private_data;
+} shrinker_t;
+
+/**
+ * Register a cache shrinker
+ *
+ * @param shrinker Shrinker (must stay valid until unregistered)
+ * @return 0 on success, -1 if the table is full
+ */
+int shrinker_register(shrinker_t *shrinker);
+
+/**
+ * Unregister a cache shrinker
+ *
+ * @param shrinker Shrinker passed to shrinker_register()
+ */
+void shrinker_unregister(shrinker_t *shrinker);
+
+/**
+ * Run the shrinkers until nr_pages pages are freed or none frees more
+ *
+ * @param nr_pages Pages wanted
+ * @return Pages freed
+ */
+size_t shrink_caches(size_t nr_pages);
+
+/**
+ * Start kswapd
+ *
+ * @return 0 on success, -1 if the thread could not be created
+ */
+int reclaim_init(void);
+
+/**
+ * Wake kswapd (safe from any context, a no-op before reclaim_init())
+ */
+void reclaim_wake_kswapd(void);
+
+/**
+ * Free memory for an allocation that found none
+ *
+ * Shrinks caches first; if fewer than count pages are free afterwards
+ * the OOM killer frees a process's memory.
+ *
+ * @param count Pages the caller needs
+ * @return Pages freed, 0 if nothing could be reclaimed
+ */
+size_t reclaim_direct(size_t count);
+
+/**
+ * Print reclaim statistics
+ */
+void reclaim_print_stats(void);
+
+#endif // KERNEL_RECLAIM_H
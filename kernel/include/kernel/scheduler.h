@@ -64,6 +64,29 @@ void scheduler_remove_process(process_t *process);
  */
 void scheduler_schedule(registers_t *regs);
 
+/**
+ * Request a reschedule at the next interrupt exit
+ *
+ * Safe from hard IRQ and softirq context.
+ */
+void scheduler_set_need_resched(void);
+
+/**
+ * Check whether a reschedule is pending on this CPU
+ *
+ * @return true if scheduler_preempt() would switch tasks
+ */
+bool scheduler_need_resched(void);
+
+/**
+ * Preempt the interrupted task if a reschedule was requested
+ *
+ * Called by hardirq_exit() on the outermost interrupt exit.
+ *
+ * @param regs Interrupt frame to switch
+ */
+void scheduler_preempt(registers_t *regs);
+
 /**
  * Yield CPU to another process
  *
@@ -0,0 +1,118 @@
+/**
+ * Serial Port (UART) Driver
+ *
+ * Interrupt-driven 16550 driver for the first PC serial port, registered
+ * as ttyS0. Output is queued in a transmit ring and fed to the UART FIFO
+ * from the THR-empty interrupt on IRQ4; input is collected by the
+ * receive interrupt. A polled mode bypasses the rings for panics.
+ */
+
+#ifndef KERNEL_SERIAL_H
+#define KERNEL_SERIAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// COM1 base I/O port
+#define SERIAL_COM1     0x3F8
+
+// UART registers (offset from base I/O port)
+#define SERIAL_REG_DATA         0x00    // Data (DLAB=0)
+#define SERIAL_REG_IER          0x01    // Interrupt enable (DLAB=0)
+#define SERIAL_REG_IIR          0x02    // Interrupt identification (read)
+#define SERIAL_REG_DLL          0x00    // Divisor latch low (DLAB=1)
+#define SERIAL_REG_DLH          0x01    // Divisor latch high (DLAB=1)
+#define SERIAL_REG_FCR          0x02    // FIFO control
+#define SERIAL_REG_LCR          0x03    // Line control
+#define SERIAL_REG_MCR          0x04    // Modem control
+#define SERIAL_REG_LSR          0x05    // Line status
+
+// Interrupt enable bits
+#define SERIAL_IER_RX           0x01    // Received data available
+#define SERIAL_IER_THRE         0x02    // Transmit holding register empty
+
+// Interrupt identification
+#define SERIAL_IIR_NONE         0x01    // No interrupt pending
+#define SERIAL_IIR_ID_MASK      0x0E    // Interrupt source
+#define SERIAL_IIR_THRE         0x02    // THR empty
+#define SERIAL_IIR_RX           0x04    // Received data available
+#define SERIAL_IIR_LINE         0x06    // Receiver line status
+#define SERIAL_IIR_TIMEOUT      0x0C    // Character timeout (FIFO)
+
+// Modem control bits
+#define SERIAL_MCR_DTR          0x01    // Data terminal ready
+#define SERIAL_MCR_RTS          0x02    // Request to send
+#define SERIAL_MCR_OUT1         0x04    // Auxiliary output 1
+#define SERIAL_MCR_OUT2         0x08    // Routes UART interrupts to the PIC
+#define SERIAL_MCR_LOOPBACK     0x10    // Loopback test mode
+
+// Line status bits
+#define SERIAL_LSR_DATA_READY   0x01    // Received byte available
+#define SERIAL_LSR_THR_EMPTY    0x20    // Transmit holding register empty
+#define SERIAL_LSR_TX_IDLE      0x40    // Holding and shift registers empty
+
+// UART input clock divided by 16 (divisor 1)
+#define SERIAL_MAX_BAUD         115200
+
+// Default and panic baud rates
+#define SERIAL_BAUD             115200
+#define SERIAL_PANIC_BAUD       SERIAL_MAX_BAUD
+
+// Transmit FIFO depth of a 16550A
+#define SERIAL_FIFO_SIZE        16
+
+// Ring sizes (powers of two)
+#define SERIAL_TX_RING_SIZE     8192
+#define SERIAL_RX_RING_SIZE     256
+
+/**
+ * Initialize serial port and register ttyS0
+ */
+void serial_init(void);
+
+/**
+ * Write a single byte
+ *
+ * @param c Byte to write
+ */
+void serial_putchar(char c);
+
+/**
+ * Write a buffer
+ *
+ * Queues into the transmit ring and returns; only stalls if the ring is
+ * full. In polled mode the bytes are written out before returning.
+ *
+ * @param data Bytes to write
+ * @param size Number of bytes
+ */
+void serial_write(const char *data, size_t size);
+
+/**
+ * Read whatever input is available without blocking
+ *
+ * @param buffer Destination buffer
+ * @param size Maximum number of bytes
+ * @return Number of bytes read (0 if none available)
+ */
+int serial_read(uint8_t *buffer, size_t size);
+
+/**
+ * Switch to polled output
+ *
+ * Masks the UART interrupt, pushes out whatever is still queued and
+ * writes all further output synchronously. Used on panic, when
+ * interrupts may never fire again.
+ *
+ * @param baud New baud rate, or 0 to keep the current one
+ */
+void serial_enter_polled_mode(uint32_t baud);
+
+/**
+ * Get the number of bytes waiting in the transmit ring
+ *
+ * @return Queued byte count
+ */
+size_t serial_tx_pending(void);
+
+#endif // KERNEL_SERIAL_H
@@ -5,7 +5,12 @@
  * Layout:
  * - Block 0: Superblock
  * - Block 1-N: Inode table
- * - Block N+1-M: Data blocks
+ * - Block N+1-M: Block allocation bitmap
+ * - Block M+1-: Data blocks
+ *
+ * Every metadata block (superblock, inode table, bitmap, directory
+ * blocks) ends in a simplefs_block_tail_t holding the block's own
+ * number and a CRC32C of the rest of the block.
  */
 
 #ifndef KERNEL_SIMPLEFS_H
@@ -16,17 +21,41 @@
 #include <kernel/block.h>
 
 #define SIMPLEFS_MAGIC 0x53494D50   // "SIMP"
-#define SIMPLEFS_VERSION 1
+#define SIMPLEFS_VERSION 2
 
 #define SIMPLEFS_MAX_FILENAME 56
 #define SIMPLEFS_MAX_INODES 256
-#define SIMPLEFS_INODE_BLOCKS 2      // 2 blocks for inode table
 #define SIMPLEFS_MAX_FILE_BLOCKS 12  // Direct blocks per inode
 
 // File types
 #define SIMPLEFS_TYPE_FILE      1
 #define SIMPLEFS_TYPE_DIR       2
 
+// Superblock state
+#define SIMPLEFS_STATE_CLEAN    1    // Cleanly unmounted
+#define SIMPLEFS_STATE_DIRTY    2    // Mounted or not cleanly unmounted
+
+// Feature flags
+#define SIMPLEFS_FEATURE_METADATA_CSUM  0x0001  // CRC32C on metadata blocks
+#define SIMPLEFS_FEATURE_INLINE_DATA    0x0002  // Small files stored in the inode
+
+// Inode flags
+#define SIMPLEFS_INODE_INLINE   0x0001  // Data lives in inline_data, not blocks
+
+// Bytes of file data that fit inside an inode
+#define SIMPLEFS_INLINE_SIZE    224
+
+/**
+ * Metadata block tail (last 8 bytes of every metadata block)
+ */
+typedef struct simplefs_block_tail {
+    uint32_t block;                  // Block number (catches misdirected writes)
+    uint32_t checksum;               // CRC32C of the block up to this field
+} __attribute__((packed)) simplefs_block_tail_t;
+
+// Usable bytes in a metadata block
+#define SIMPLEFS_META_SIZE (BLOCK_SIZE - sizeof(simplefs_block_tail_t))
+
 /**
  * Superblock (512 bytes, fits in one block)
  */
@@ -40,20 +69,34 @@ typedef struct simplefs_superblock {
     uint32_t first_data_block;       // First data block
     uint32_t free_blocks;            // Number of free blocks
     uint32_t free_inodes;            // Number of free inodes
-    uint8_t  reserved[476];          // Reserved for future use
+    uint32_t first_bitmap_block;     // First block of allocation bitmap
+    uint32_t bitmap_blocks;          // Number of bitmap blocks
+    uint32_t state;                  // SIMPLEFS_STATE_*
+    uint32_t features;               // SIMPLEFS_FEATURE_*
+    uint32_t inode_size;             // Size of an on-disk inode in bytes
+    uint8_t  reserved[448];          // Reserved for future use
+    simplefs_block_tail_t tail;      // Checksum
 } __attribute__((packed)) simplefs_superblock_t;
 
 /**
- * Inode (64 bytes)
+ * Inode (252 bytes, two per block)
+ *
+ * Files of up to SIMPLEFS_INLINE_SIZE bytes keep their data in the
+ * inode itself, so reading them costs no block read beyond the inode.
+ * Larger files use the direct block pointers, which share the space.
  */
 typedef struct simplefs_inode {
     uint32_t number;                 // Inode number
-    uint32_t type;                   // File type (file, directory)
+    uint32_t type;                   // File type (0 = free, file, directory)
     uint32_t size;                   // File size in bytes
     uint32_t blocks;                 // Number of blocks used
-    uint32_t direct[SIMPLEFS_MAX_FILE_BLOCKS];  // Direct block pointers
+    uint32_t flags;                  // SIMPLEFS_INODE_*
     uint32_t created;                // Creation time
     uint32_t modified;               // Modification time
+    union {
+        uint32_t direct[SIMPLEFS_MAX_FILE_BLOCKS];  // Direct block pointers
+        uint8_t inline_data[SIMPLEFS_INLINE_SIZE];  // Inline file data
+    };
 } __attribute__((packed)) simplefs_inode_t;
 
 /**
@@ -65,15 +108,27 @@ typedef struct simplefs_direntry {
     uint32_t type;                   // File type
 } __attribute__((packed)) simplefs_direntry_t;
 
+// Records per metadata block (the tail takes the remainder)
+#define SIMPLEFS_INODES_PER_BLOCK   (SIMPLEFS_META_SIZE / sizeof(simplefs_inode_t))
+#define SIMPLEFS_DIRENTS_PER_BLOCK  (SIMPLEFS_META_SIZE / sizeof(simplefs_direntry_t))
+#define SIMPLEFS_BITS_PER_BITMAP_BLOCK (SIMPLEFS_META_SIZE * 8)
+
+// Blocks needed for the inode table
+#define SIMPLEFS_INODE_BLOCKS \
+    ((SIMPLEFS_MAX_INODES + SIMPLEFS_INODES_PER_BLOCK - 1) / SIMPLEFS_INODES_PER_BLOCK)
+
 /**
  * SimpleFS state
  */
 typedef struct simplefs {
     block_device_t *device;          // Block device
     simplefs_superblock_t superblock;  // Cached superblock
-    simplefs_inode_t *inode_cache;   // Cached inodes
-    uint8_t *block_bitmap;           // Block allocation bitmap
-    uint8_t *inode_bitmap;           // Inode allocation bitmap
+    simplefs_inode_t *inode_cache;   // Cached inodes (write-through)
+    uint8_t *inode_cached;           // Which inode_cache entries are valid
+    uint8_t *block_bitmap;           // Block allocation bitmap (SIMPLEFS_META_SIZE per block)
+    uint32_t csum_errors;            // Checksum mismatches seen since mount
+    uint64_t blocks_read;            // Block reads issued since mount
+    uint32_t scrub_inode;            // Next inode the scrubber will verify
 } simplefs_t;
 
 // Initialize SimpleFS
@@ -109,4 +164,13 @@ uint32_t simplefs_alloc_inode(simplefs_t *fs);
 // Free inode
 void simplefs_free_inode(simplefs_t *fs, uint32_t inode_num);
 
+// Forget cached inodes so the next lookups read them from disk (benchmarks)
+void simplefs_drop_inode_cache(simplefs_t *fs);
+
+// Full consistency check (returns number of problems found and repaired)
+int simplefs_check(simplefs_t *fs);
+
+// Start the background scrubber task for a mounted filesystem
+void simplefs_start_scrubber(filesystem_t *fs);
+
 #endif // KERNEL_SIMPLEFS_H
@@ -0,0 +1,95 @@
+/**
+ * Softirqs (Interrupt Bottom Halves)
+ *
+ * Hard IRQ handlers acknowledge the device, raise a softirq and return.
+ * Raised softirqs run on the way out of the outermost hardware
+ * interrupt, with interrupts enabled, before any preemption. Work that
+ * may block or run long belongs on a workqueue instead.
+ */
+
+#ifndef KERNEL_SOFTIRQ_H
+#define KERNEL_SOFTIRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/isr.h>
+
+/**
+ * Softirq vectors, run in this order
+ */
+typedef enum {
+    SOFTIRQ_TIMER,              // Tick bookkeeping and sleeper wakeups
+    SOFTIRQ_BLOCK,              // Block I/O completion
+    SOFTIRQ_COUNT
+} softirq_t;
+
+// Passes over the pending mask before leaving the rest for the next IRQ
+#define SOFTIRQ_MAX_RESTART 4
+
+/**
+ * Install the handler for a softirq vector
+ *
+ * @param nr Softirq vector
+ * @param handler Handler (runs with interrupts enabled, must not block)
+ */
+void softirq_register(softirq_t nr, void (*handler)(void));
+
+/**
+ * Mark a softirq pending on the current CPU
+ *
+ * Safe from hard IRQ context.
+ *
+ * @param nr Softirq vector
+ */
+void softirq_raise(softirq_t nr);
+
+/**
+ * Run pending softirqs on the current CPU
+ *
+ * Called from hardirq_exit(); may also be called from process context
+ * with interrupts enabled.
+ */
+void softirq_run(void);
+
+/**
+ * Check whether the current CPU is inside a hardware interrupt
+ *
+ * @return true in hard IRQ or softirq context
+ */
+bool in_interrupt(void);
+
+/**
+ * Enter hardware interrupt context (called by the ISR dispatcher)
+ */
+void hardirq_enter(void);
+
+/**
+ * Leave hardware interrupt context (called by the ISR dispatcher)
+ *
+ * On the outermost exit, runs pending softirqs and then preempts the
+ * interrupted task if a reschedule was requested.
+ *
+ * @param regs Interrupt frame of the outermost interrupt
+ */
+void hardirq_exit(registers_t *regs);
+
+/**
+ * Leave hardware interrupt context if there is nothing else to do
+ *
+ * Lets the IRQ stub skip saving a full frame for interrupts that
+ * neither leave softirqs pending nor request a reschedule.
+ *
+ * @return true if IRQ context was left, false if the caller must build
+ *         a full frame and call hardirq_exit()
+ */
+bool hardirq_exit_fast(void);
+
+/**
+ * Get how many times a softirq vector has run
+ *
+ * @param nr Softirq vector
+ * @return Run count (all CPUs)
+ */
+uint64_t softirq_get_count(softirq_t nr);
+
+#endif // KERNEL_SOFTIRQ_H
@@ -0,0 +1,97 @@
+/**
+ * Static Keys
+ *
+ * Branches that are almost always off and cost a single 5-byte NOP
+ * while they are. Each static_key_false() site records its address, its
+ * out-of-line target and its key in the __jump_table section; enabling
+ * the key rewrites every recorded NOP into a JMP to the target, and
+ * disabling it writes the NOP back.
+ *
+ *     static static_key_t slow_path = STATIC_KEY_INIT_FALSE;
+ *
+ *     if (static_key_false(&slow_path)) {
+ *         rarely_wanted_work();
+ *     }
+ *
+ * Keys are flipped with interrupts disabled on the only running CPU, so
+ * no other context can execute a half-written instruction.
+ */
+
+#ifndef KERNEL_STATIC_KEY_H
+#define KERNEL_STATIC_KEY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Size of the patched instruction (NOPL / JMP rel32)
+#define STATIC_KEY_INSN_SIZE 5
+
+/**
+ * Static key
+ */
+typedef struct static_key {
+    int enabled;
+} static_key_t;
+
+#define STATIC_KEY_INIT_FALSE { 0 }
+
+/**
+ * One patch site, emitted into __jump_table by static_key_false()
+ */
+typedef struct jump_entry {
+    uint64_t code;              // Address of the NOP / JMP
+    uint64_t target;            // Where the JMP goes when the key is on
+    uint64_t key;               // static_key_t the site belongs to
+} jump_entry_t;
+
+/**
+ * Test a key that is normally disabled
+ *
+ * Compiles to a NOP that falls through to the "false" path; the branch
+ * is only taken once static_key_enable() has patched the site.
+ *
+ * @param key Key to test
+ * @return true while the key is enabled
+ */
+static inline __attribute__((always_inline)) bool static_key_false(static_key_t *key) {
+    __asm__ goto(
+        "1: .byte 0x0f, 0x1f, 0x44, 0x00, 0x00\n\t"
+        ".pushsection __jump_table, \"aw\"\n\t"
+        ".balign 8\n\t"
+        ".quad 1b, %l[l_yes], %P0\n\t"
+        ".popsection\n\t"
+        :
+        : "i"(key)
+        :
+        : l_yes
+    );
+    return false;
+l_yes:
+    return true;
+}
+
+/**
+ * Check a key's state without a patch site
+ *
+ * @param key Key to check
+ * @return true if enabled
+ */
+static inline bool static_key_enabled(static_key_t *key) {
+    return key->enabled != 0;
+}
+
+/**
+ * Turn a key on, patching its sites into jumps
+ *
+ * @param key Key to enable
+ */
+void static_key_enable(static_key_t *key);
+
+/**
+ * Turn a key off, patching its sites back into NOPs
+ *
+ * @param key Key to disable
+ */
+void static_key_disable(static_key_t *key);
+
+#endif // KERNEL_STATIC_KEY_H
@@ -135,4 +135,15 @@ char *strrchr(const char *str, int c);
  */
 int snprintf(char *str, size_t size, const char *format, ...);
 
+/**
+ * Format string with size limit from a va_list
+ *
+ * @param str Destination buffer
+ * @param size Maximum size of buffer
+ * @param format Format string
+ * @param args Variable argument list
+ * @return Number of characters written (excluding null terminator)
+ */
+int vsnprintf(char *str, size_t size, const char *format, __builtin_va_list args);
+
 #endif // KERNEL_STRING_H
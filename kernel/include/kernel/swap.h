@@ -0,0 +1,100 @@
+/**
+ * Swap
+ *
+ * User pages can be written out to a swap area on a block device and
+ * read back when touched. The area is prepared like a Linux swap
+ * partition: its first page is a header ending in "SWAPSPACE2", and
+ * each following page of the device is one swap slot.
+ *
+ * A swapped-out page leaves a swap entry in its page table entry: the
+ * present bit is clear, PTE_SWAP is set and the slot number sits where
+ * the physical address would be. The access bits are kept so the page
+ * comes back with the same permissions.
+ *
+ * Pages are chosen by a clock over every process's page tables using
+ * the PAGE_ACCESSED bit, written out in clusters of neighbouring cold
+ * pages with one large write, and read back with the rest of their
+ * cluster when one of them faults.
+ */
+
+#ifndef KERNEL_SWAP_H
+#define KERNEL_SWAP_H
+
+#include <kernel/memory.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct process;
+
+// Software-available PTE bit marking a swap entry
+#define PTE_SWAP            (1ULL << 9)
+
+// Neighbouring pages written or read together (one I/O)
+#define SWAP_CLUSTER        8
+
+// Signature at the end of the header page
+#define SWAP_SIGNATURE      "SWAPSPACE2"
+
+/**
+ * Check whether a page table entry is a swap entry
+ */
+static inline bool pte_is_swap(pte_t pte) {
+    return !(pte & PAGE_PRESENT) && (pte & PTE_SWAP);
+}
+
+/**
+ * Build the swap entry replacing a present PTE
+ *
+ * @param slot Swap slot holding the page
+ * @param pte The present entry (its write and user bits are kept)
+ */
+static inline pte_t swap_pte(uint32_t slot, pte_t pte) {
+    return ((uint64_t)slot << 12) | PTE_SWAP | (pte & (PAGE_WRITE | PAGE_USER));
+}
+
+/**
+ * Get the swap slot of a swap entry
+ */
+static inline uint32_t swap_pte_slot(pte_t pte) {
+    return (uint32_t)((pte & 0x000FFFFFFFFFF000ULL) >> 12);
+}
+
+/**
+ * Start swapping to a block device
+ *
+ * @param name Block device name ("hdb")
+ * @return 0 on success, -1 if the device is missing, too small or has
+ *         no swap signature, or swap is already on
+ */
+int swap_on(const char *name);
+
+/**
+ * Enable swap on the device named by "swap=" on the command line
+ *
+ * @return 0 on success or when no swap is configured, -1 on failure
+ */
+int swap_init(void);
+
+/**
+ * Read a swapped-out page (and its swapped neighbours) back in
+ *
+ * @param proc Process the fault happened in
+ * @param virt Faulting virtual address
+ * @return 0 if the page is present again, -1 if it is not a swap entry
+ *         or could not be read
+ */
+int swap_in(struct process *proc, uint64_t virt);
+
+/**
+ * Release the swap slot of a swap entry (the process is going away)
+ *
+ * @param pte Swap entry
+ */
+void swap_free_entry(pte_t pte);
+
+/**
+ * Print swap usage and I/O statistics
+ */
+void swap_print_stats(void);
+
+#endif // KERNEL_SWAP_H
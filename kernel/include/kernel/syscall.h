@@ -29,8 +29,12 @@
 #define SYS_TIME        13  // Get current time
 #define SYS_GETCHAR     14  // Get character from keyboard
 #define SYS_PUTCHAR     15  // Put character to console
+#define SYS_GETDENTS    16  // Read batch of directory entries
+#define SYS_PIPE        17  // Create anonymous pipe
+#define SYS_MKFIFO      18  // Create named FIFO
+#define SYS_IRQSTATS    19  // Per-vector interrupt statistics
 
-#define SYSCALL_COUNT   16  // Total number of syscalls
+#define SYSCALL_COUNT   20  // Total number of syscalls
 
 /**
  * System call handler function type
@@ -70,5 +74,9 @@ int64_t sys_yield(void);
 int64_t sys_time(void);
 int64_t sys_putchar(char c);
 int64_t sys_getchar(void);
+int64_t sys_getdents(int fd, void *buf, size_t count);
+int64_t sys_pipe(int *fds);
+int64_t sys_mkfifo(const char *path);
+int64_t sys_irqstats(isr_stat_t *buf, size_t count);
 
 #endif // KERNEL_SYSCALL_H
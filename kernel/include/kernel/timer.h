@@ -8,6 +8,7 @@
 #define KERNEL_TIMER_H
 
 #include <stdint.h>
+#include <kernel/isr.h>
 
 // PIT I/O ports
 #define PIT_CHANNEL0    0x40    // Channel 0 data port (IRQ0)
@@ -35,6 +36,15 @@
 #define PIT_CMD_CHAN1   0x40    // Select channel 1
 #define PIT_CMD_CHAN2   0x80    // Select channel 2
 
+// PC speaker control port (channel 2 gate and output)
+#define PIT_SPEAKER_PORT  0x61
+#define PIT_SPEAKER_GATE  0x01  // Channel 2 gate input
+#define PIT_SPEAKER_DATA  0x02  // Speaker data enable
+#define PIT_SPEAKER_OUT   0x20  // Channel 2 output state
+
+// TSC calibration window
+#define TIMER_TSC_CALIBRATE_MS 10
+
 /**
  * Initialize PIT
  *
@@ -77,4 +87,22 @@ void timer_sleep_ms(uint64_t ms);
  */
 void timer_register_callback(void (*callback)(void));
 
+/**
+ * Register a hook that sees the interrupted context of each tick
+ *
+ * IRQ frames only carry RIP, RSP and the scratch registers.
+ *
+ * @param hook Function to call on each tick, or NULL to remove
+ */
+void timer_register_sample_hook(void (*hook)(registers_t *regs));
+
+/**
+ * Get the calibrated TSC frequency
+ *
+ * Measured against PIT channel 2 during timer_init().
+ *
+ * @return TSC frequency in kHz, or 0 if not yet calibrated
+ */
+uint64_t timer_get_tsc_khz(void);
+
 #endif // KERNEL_TIMER_H
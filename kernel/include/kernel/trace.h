@@ -0,0 +1,111 @@
+/**
+ * Kernel Tracepoints
+ *
+ * Typed events (see trace_events.h) recorded into per-CPU binary ring
+ * buffers. Every trace_<name>() call sits behind a static key, so a
+ * disabled tracepoint costs one NOP; the record is only built on the
+ * out-of-line path.
+ *
+ * Records are read back in binary through /dev/trace (which also takes
+ * "+name", "-name", "+all" and "-all" writes to switch events) or
+ * dumped hex-encoded to the serial port by trace_dump().
+ * scripts/trace-decode.py decodes either form using trace_events.h.
+ */
+
+#ifndef KERNEL_TRACE_H
+#define KERNEL_TRACE_H
+
+#include <kernel/static_key.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Limits
+#define TRACE_BUFFER_SIZE   65536   // Bytes per CPU (power of two)
+#define TRACE_RECORD_ALIGN  16      // Records start and end on this boundary
+#define TRACE_RECORD_MAX    64      // Largest record, header included
+
+// Record ID of the filler that pads the end of a ring buffer
+#define TRACE_ID_PAD        0
+
+/**
+ * Record header, followed by the event's payload
+ */
+typedef struct trace_record {
+    uint64_t tsc;               // Timestamp (TSC cycles)
+    uint16_t id;                // Event ID (TRACE_ID_*)
+    uint8_t size;               // Whole record including header and padding
+    uint8_t cpu;
+    uint32_t pid;               // Current process, 0 before the scheduler runs
+} trace_record_t;
+
+#define TP_PROTO(...)   __VA_ARGS__
+#define TP_ARGS(...)    __VA_ARGS__
+#define TP_STRUCT(...)  __VA_ARGS__
+#define TP_ASSIGN(...)  __VA_ARGS__
+
+/**
+ * Event IDs
+ */
+enum {
+    TRACE_ID_FIRST = TRACE_ID_PAD,
+#define TRACE_EVENT(name, proto, args, fields, assign) TRACE_ID_##name,
+#include <kernel/trace_events.h>
+#undef TRACE_EVENT
+    TRACE_ID_COUNT
+};
+
+/**
+ * trace_<name>() for every event
+ */
+#define TRACE_EVENT(name, proto, args, fields, assign)                        \
+    extern static_key_t trace_key_##name;                                     \
+    void trace_emit_##name(proto);                                            \
+    static inline __attribute__((always_inline)) void trace_##name(proto) {   \
+        if (static_key_false(&trace_key_##name)) {                            \
+            trace_emit_##name(args);                                          \
+        }                                                                     \
+    }
+#include <kernel/trace_events.h>
+#undef TRACE_EVENT
+
+/**
+ * Register /dev/trace and enable the events named by "trace=" on the
+ * command line ("trace=kmalloc,sched_switch", or "trace" for all)
+ *
+ * @return 0 on success, -1 if the device could not be registered
+ */
+int trace_init(void);
+
+/**
+ * Enable or disable an event by name ("all" for every event)
+ *
+ * @param name Event name
+ * @param enable true to enable
+ * @return 0 on success, -1 for an unknown name
+ */
+int trace_set_event(const char *name, bool enable);
+
+/**
+ * Check whether any event is enabled
+ *
+ * @return true if at least one tracepoint is live
+ */
+bool trace_active(void);
+
+/**
+ * Copy whole records out of the buffers, consuming them
+ *
+ * @param buffer Destination
+ * @param size Size of buffer in bytes
+ * @return Bytes copied (a multiple of TRACE_RECORD_ALIGN)
+ */
+size_t trace_read(void *buffer, size_t size);
+
+/**
+ * Write the buffered records to the serial port as hex, one per line,
+ * and clear the buffers
+ */
+void trace_dump(void);
+
+#endif // KERNEL_TRACE_H
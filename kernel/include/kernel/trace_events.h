@@ -0,0 +1,62 @@
+/**
+ * Tracepoint Definitions
+ *
+ * Each TRACE_EVENT gives the event name, the typed arguments of its
+ * trace_<name>() call, the record payload and how the arguments fill it:
+ *
+ *     TRACE_EVENT(name,
+ *         TP_PROTO(type arg, ...),         // trace_<name>() parameters
+ *         TP_ARGS(arg, ...),
+ *         TP_STRUCT(type field; ...),      // Payload after the record header
+ *         TP_ASSIGN(entry->field = ...;))
+ *
+ * Payload fields are fixed-width integers (uint8_t to uint64_t and
+ * their signed forms). Event IDs follow the order of this list starting
+ * at 1, and scripts/trace-decode.py reads this file to decode records,
+ * so append new events rather than reordering.
+ *
+ * Included several times with different TRACE_EVENT definitions; no
+ * include guard on purpose.
+ */
+
+TRACE_EVENT(kmalloc,
+    TP_PROTO(size_t size, void *ptr),
+    TP_ARGS(size, ptr),
+    TP_STRUCT(uint64_t size; uint64_t ptr;),
+    TP_ASSIGN(entry->size = size; entry->ptr = (uint64_t)ptr;))
+
+TRACE_EVENT(pmm_alloc_page,
+    TP_PROTO(uint64_t phys),
+    TP_ARGS(phys),
+    TP_STRUCT(uint64_t phys;),
+    TP_ASSIGN(entry->phys = phys;))
+
+TRACE_EVENT(vmm_map_page,
+    TP_PROTO(uint64_t virt, uint64_t phys, uint64_t flags),
+    TP_ARGS(virt, phys, flags),
+    TP_STRUCT(uint64_t virt; uint64_t phys; uint64_t flags;),
+    TP_ASSIGN(entry->virt = virt; entry->phys = phys; entry->flags = flags;))
+
+TRACE_EVENT(sched_switch,
+    TP_PROTO(uint32_t prev_pid, uint32_t next_pid),
+    TP_ARGS(prev_pid, next_pid),
+    TP_STRUCT(uint32_t prev_pid; uint32_t next_pid;),
+    TP_ASSIGN(entry->prev_pid = prev_pid; entry->next_pid = next_pid;))
+
+TRACE_EVENT(ata_read,
+    TP_PROTO(uint8_t drive, uint64_t lba, uint32_t count),
+    TP_ARGS(drive, lba, count),
+    TP_STRUCT(uint64_t lba; uint32_t count; uint8_t drive;),
+    TP_ASSIGN(entry->lba = lba; entry->count = count; entry->drive = drive;))
+
+TRACE_EVENT(syscall_enter,
+    TP_PROTO(uint64_t nr, uint64_t arg0, uint64_t arg1, uint64_t arg2),
+    TP_ARGS(nr, arg0, arg1, arg2),
+    TP_STRUCT(uint64_t nr; uint64_t arg0; uint64_t arg1; uint64_t arg2;),
+    TP_ASSIGN(entry->nr = nr; entry->arg0 = arg0; entry->arg1 = arg1; entry->arg2 = arg2;))
+
+TRACE_EVENT(syscall_exit,
+    TP_PROTO(uint64_t nr, int64_t result),
+    TP_ARGS(nr, result),
+    TP_STRUCT(uint64_t nr; int64_t result;),
+    TP_ASSIGN(entry->nr = nr; entry->result = result;))
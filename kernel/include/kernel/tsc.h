@@ -0,0 +1,23 @@
+/**
+ * Time Stamp Counter
+ *
+ * Cycle counter used for fine-grained timing and benchmarks.
+ */
+
+#ifndef KERNEL_TSC_H
+#define KERNEL_TSC_H
+
+#include <stdint.h>
+
+/**
+ * Read the time stamp counter
+ *
+ * @return Current TSC value in cycles
+ */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif // KERNEL_TSC_H
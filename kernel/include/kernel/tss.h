@@ -7,6 +7,15 @@
 
 #include <stdint.h>
 
+// Interrupt Stack Table slots used by IDT gates (0 = no stack switch)
+#define IST_DOUBLE_FAULT    1
+#define IST_NMI             2
+#define IST_MACHINE_CHECK   3
+#define IST_COUNT           3
+
+// Size of each IST stack
+#define IST_STACK_SIZE      8192
+
 /**
  * Initialize TSS
  */
@@ -17,6 +26,15 @@ void tss_init(void);
  */
 void tss_set_kernel_stack(uint64_t stack);
 
+/**
+ * Get the top of an IST stack
+ *
+ * @param cpu CPU index
+ * @param ist IST slot (IST_*)
+ * @return Initial stack pointer, or 0 if out of range
+ */
+uint64_t tss_get_ist_stack(uint32_t cpu, uint32_t ist);
+
 /**
  * Get TSS address for GDT
  */
@@ -21,6 +21,7 @@
 #define FILE_TYPE_DIRECTORY 0x02
 #define FILE_TYPE_DEVICE    0x04
 #define FILE_TYPE_SYMLINK   0x08
+#define FILE_TYPE_FIFO      0x10
 
 // File flags
 #define O_RDONLY    0x0000
@@ -65,6 +66,7 @@ typedef struct vfs_node {
     void (*close)(struct vfs_node *node);
     struct vfs_node *(*readdir)(struct vfs_node *node, uint32_t index);
     struct vfs_node *(*finddir)(struct vfs_node *node, const char *name);
+    int (*getdents)(struct vfs_node *node, uint64_t *cookie, void *buffer, size_t size);
 } vfs_node_t;
 
 /**
@@ -97,6 +99,7 @@ typedef struct file_descriptor {
     uint32_t flags;              // Open flags (O_RDONLY, etc.)
     uint32_t ref_count;          // Reference count
     int in_use;                  // Is this FD in use?
+    uint32_t owner_pid;          // Process that opened it (0 = boot context)
 } file_descriptor_t;
 
 /**
@@ -118,12 +121,32 @@ typedef struct dirent {
     uint32_t type;               // File type
 } dirent_t;
 
+/**
+ * Packed directory entry filled in by getdents
+ *
+ * Records are variable length: the name follows the header and is
+ * null-terminated, and reclen is rounded up to 8 bytes so the next
+ * record starts aligned.
+ */
+typedef struct vfs_dirent64 {
+    uint32_t inode;              // Inode number
+    uint16_t reclen;             // Length of this record in bytes
+    uint8_t type;                // File type
+    uint8_t namelen;             // Name length (excluding null terminator)
+    char name[];                 // File name
+} __attribute__((packed)) vfs_dirent64_t;
+
+// Record length for a name of the given length
+#define VFS_DIRENT64_RECLEN(namelen) \
+    ((sizeof(vfs_dirent64_t) + (namelen) + 1 + 7) & ~(size_t)7)
+
 // VFS initialization
 void vfs_init(void);
 
 // File operations
 int vfs_open(const char *path, uint32_t flags);
 int vfs_close(int fd);
+void vfs_close_all(uint32_t pid);
 int vfs_read(int fd, void *buffer, size_t size);
 int vfs_write(int fd, const void *buffer, size_t size);
 int vfs_seek(int fd, int64_t offset, int whence);
@@ -132,6 +155,9 @@ int vfs_stat(const char *path, vfs_node_t *stat_buf);
 // Directory operations
 int vfs_mkdir(const char *path, uint32_t permissions);
 int vfs_readdir(int fd, dirent_t *dirent, uint32_t index);
+int vfs_getdents(int fd, void *buffer, size_t size);
+int vfs_fill_dirent64(void *buffer, size_t size, uint32_t inode,
+                      uint32_t type, const char *name);
 
 // Filesystem operations
 int vfs_mount(const char *path, filesystem_t *fs);
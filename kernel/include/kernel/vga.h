@@ -33,6 +33,14 @@ enum vga_color {
  */
 void vga_init(void);
 
+/**
+ * Route all further output to the framebuffer console
+ *
+ * Replays the current text screen into fbcon. No-op unless
+ * fbcon_init() succeeded.
+ */
+void vga_use_framebuffer(void);
+
 /**
  * Clear the screen
  */
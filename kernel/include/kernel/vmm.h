@@ -13,6 +13,8 @@
 #include <stdbool.h>
 #include <kernel/memory.h>
 
+struct process;
+
 /**
  * Initialize virtual memory manager
  *
@@ -75,6 +77,111 @@ uint64_t vmm_get_physical(uint64_t virt);
  */
 bool vmm_is_mapped(uint64_t virt);
 
+/**
+ * Map device memory (MMIO) into the direct map
+ *
+ * Pages that are not mapped yet are mapped uncached; pages already
+ * covered by the boot direct map are left alone.
+ *
+ * @param phys Physical address
+ * @param size Size in bytes
+ * @return Virtual address corresponding to phys, or 0 on failure
+ */
+uint64_t vmm_map_mmio(uint64_t phys, size_t size);
+
+/**
+ * Map prefetchable device memory into the direct map, write-combining
+ *
+ * For framebuffers and prefetchable BARs; falls back to write-through
+ * on CPUs without a PAT.
+ *
+ * @param phys Physical address
+ * @param size Size in bytes
+ * @return Virtual address corresponding to phys, or 0 on failure
+ */
+uint64_t vmm_map_mmio_wc(uint64_t phys, size_t size);
+
+/**
+ * Get page table flags selecting write-combining
+ *
+ * Programs a spare PAT entry on first use.
+ *
+ * @return PAGE_PAT | PAGE_WRITETHROUGH, or PAGE_WRITETHROUGH without PAT
+ */
+uint64_t vmm_wc_flags(void);
+
+/**
+ * Map a page into a process's address space
+ *
+ * Works on proc->page_directory without switching to it. The page is
+ * tagged PAGE_OWNER_USER and counted in proc->rss_pages; page tables
+ * created on the way are tagged and counted in proc->pagetable_pages.
+ *
+ * @param proc Process owning the address space
+ * @param virt Virtual address to map
+ * @param phys Physical address to map to
+ * @param flags Page table entry flags (normally PAGE_FLAGS_USER)
+ * @return 0 on success, -1 on failure
+ */
+int vmm_map_user_page(struct process *proc, uint64_t virt, uint64_t phys, uint64_t flags);
+
+/**
+ * Unmap a page from a process's address space
+ *
+ * The physical page is not freed; it is handed back to the kernel
+ * (PAGE_OWNER_KERNEL) for the caller to free or reuse.
+ *
+ * @param proc Process owning the address space
+ * @param virt Virtual address to unmap
+ * @return Physical address that was mapped, or 0 if none
+ */
+uint64_t vmm_unmap_user_page(struct process *proc, uint64_t virt);
+
+/**
+ * Free every user page mapped in a process's address space
+ *
+ * Swapped-out pages give back their swap slots. Page tables are left
+ * in place for vmm_destroy_address_space().
+ *
+ * @param proc Process owning the address space
+ * @return Number of pages freed
+ */
+size_t vmm_free_user_pages(struct process *proc);
+
+/**
+ * Find the page table entry for a user address without creating tables
+ *
+ * @param proc Process owning the address space
+ * @param virt User virtual address
+ * @return Pointer to the PTE (present or not), or NULL if no page
+ *         table covers virt
+ */
+pte_t *vmm_get_user_pte(struct process *proc, uint64_t virt);
+
+/**
+ * Find the next present user page at or after *virt
+ *
+ * Walks the process's own part of the lower half, skipping entries
+ * shared with the kernel.
+ *
+ * @param proc Process owning the address space
+ * @param virt In: where to start; out: address of the page found
+ * @return Pointer to its PTE, or NULL (with *virt at the end of user
+ *         space) if there are no more
+ */
+pte_t *vmm_next_user_pte(struct process *proc, uint64_t *virt);
+
+/**
+ * Resolve a page fault, if it is one the kernel can fix
+ *
+ * Currently this means reading a swapped-out page back in.
+ *
+ * @param addr Faulting address (CR2)
+ * @param err_code Page fault error code
+ * @return 0 if the access can be retried, -1 for a real fault
+ */
+int vmm_handle_page_fault(uint64_t addr, uint64_t err_code);
+
 /**
  * Create a new page directory (for new process)
  *
@@ -85,6 +192,9 @@ uint64_t vmm_create_address_space(void);
 /**
  * Destroy a page directory (for exiting process)
  *
+ * Frees the PML4 and the process's own page tables; entries shared with
+ * the kernel's page directory are left alone.
+ *
  * @param pml4_phys Physical address of PML4 to destroy
  */
 void vmm_destroy_address_space(uint64_t pml4_phys);
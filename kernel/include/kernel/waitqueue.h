@@ -0,0 +1,63 @@
+/**
+ * Wait Queues
+ *
+ * Lets a process block until another context signals an event
+ * (data arriving in a pipe, space freed, I/O completion, ...).
+ */
+
+#ifndef KERNEL_WAITQUEUE_H
+#define KERNEL_WAITQUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/process.h>
+
+/**
+ * Wait queue (FIFO list of blocked processes)
+ */
+typedef struct wait_queue {
+    process_t *head;            // First waiter
+    process_t *tail;            // Last waiter
+} wait_queue_t;
+
+/**
+ * Initialize a wait queue
+ *
+ * @param wq Wait queue to initialize
+ */
+void wait_queue_init(wait_queue_t *wq);
+
+/**
+ * Block the current process on a wait queue
+ *
+ * Callers re-check their condition after this returns, since a wakeup
+ * does not guarantee the condition still holds.
+ *
+ * @param wq Wait queue to sleep on
+ * @return true if the process slept, false if there is no process context
+ */
+bool wait_queue_sleep(wait_queue_t *wq);
+
+/**
+ * Wake the first process waiting on a queue
+ *
+ * @param wq Wait queue
+ */
+void wait_queue_wake_one(wait_queue_t *wq);
+
+/**
+ * Wake every process waiting on a queue
+ *
+ * @param wq Wait queue
+ */
+void wait_queue_wake_all(wait_queue_t *wq);
+
+/**
+ * Take a process off a wait queue without waking it
+ *
+ * @param wq Wait queue
+ * @param proc Process blocked on it
+ */
+void wait_queue_remove(wait_queue_t *wq, process_t *proc);
+
+#endif // KERNEL_WAITQUEUE_H
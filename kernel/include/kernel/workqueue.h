@@ -0,0 +1,100 @@
+/**
+ * Workqueues
+ *
+ * Deferred work that may block or take a while runs in dedicated kernel
+ * threads. Items can be queued from any context, including hard IRQ
+ * handlers and softirqs.
+ */
+
+#ifndef KERNEL_WORKQUEUE_H
+#define KERNEL_WORKQUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/process.h>
+#include <kernel/waitqueue.h>
+
+// Limits
+#define WORKQUEUE_MAX           8
+#define WORKQUEUE_MAX_WORKERS   4
+
+// Priority of the shared "events" workqueue's worker
+#define WORKQUEUE_SYSTEM_PRIORITY 20
+
+struct work;
+
+/**
+ * Work item
+ *
+ * Embedded in the caller's own structure; an item is queued at most
+ * once until its function starts running.
+ */
+typedef struct work {
+    void (*func)(struct work *work);
+    struct work *next;
+    bool pending;
+} work_t;
+
+/**
+ * Workqueue (FIFO of work items served by worker threads)
+ */
+typedef struct workqueue {
+    char name[16];
+    work_t *head;
+    work_t *tail;
+    wait_queue_t wait;          // Idle workers
+    process_t *workers[WORKQUEUE_MAX_WORKERS];
+    uint32_t nr_workers;
+    uint64_t executed;          // Items completed
+} workqueue_t;
+
+/**
+ * Initialize a work item
+ *
+ * @param work Work item
+ * @param func Function to run in a worker thread
+ */
+void work_init(work_t *work, void (*func)(work_t *work));
+
+/**
+ * Create the shared workqueue
+ *
+ * Must be called after scheduler_init().
+ *
+ * @return 0 on success, -1 on error
+ */
+int workqueue_init(void);
+
+/**
+ * Create a workqueue with its own worker threads
+ *
+ * @param name Name (also used for the worker threads)
+ * @param nr_workers Number of worker threads (1 .. WORKQUEUE_MAX_WORKERS)
+ * @param priority Worker thread priority
+ * @return Workqueue, or NULL on error
+ */
+workqueue_t *workqueue_create(const char *name, uint32_t nr_workers, uint32_t priority);
+
+/**
+ * Queue a work item
+ *
+ * @param wq Workqueue
+ * @param work Work item
+ * @return true if queued, false if it was already pending
+ */
+bool queue_work(workqueue_t *wq, work_t *work);
+
+/**
+ * Queue a work item on the shared workqueue
+ *
+ * @param work Work item
+ * @return true if queued, false if it was already pending
+ */
+bool schedule_work(work_t *work);
+
+/**
+ * Print per-workqueue statistics
+ */
+void workqueue_print_stats(void);
+
+#endif // KERNEL_WORKQUEUE_H
@@ -0,0 +1,349 @@
+/**
+ * Boot-time Initialization
+ *
+ * Runs the stage table built by kernel_main(): the immediate stages
+ * during boot, the deferred ones in a probe task once multitasking has
+ * started, and prints how long each took.
+ */
+
+#include <kernel/init.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/waitqueue.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <kernel/idt.h>
+#include <kernel/vga.h>
+#include <kernel/string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Timeline columns
+#define TIMELINE_NAME_WIDTH     34
+#define TIMELINE_NUMBER_WIDTH   10
+
+static init_stage_t *stage_table = NULL;
+static uint32_t stage_count = 0;
+
+// Stage being run, for init_set_name()
+static init_stage_t *current_stage = NULL;
+
+// TSC when the first stage started and when the scheduler took over
+static uint64_t boot_tsc = 0;
+static uint64_t scheduler_tsc = 0;
+
+// Deferred stages still to run, and the tasks waiting for them
+static volatile uint32_t deferred_pending = 0;
+static wait_queue_t deferred_wait;
+
+/**
+ * Print an [ OK ] / [FAIL] line for a component
+ */
+void init_display_status(const char *component, int status) {
+    vga_printf("  [");
+    if (status == 0) {
+        vga_setcolor(VGA_COLOR_LIGHT_GREEN | (VGA_COLOR_BLACK << 4));
+        vga_puts(" OK ");
+    } else {
+        vga_setcolor(VGA_COLOR_LIGHT_RED | (VGA_COLOR_BLACK << 4));
+        vga_puts("FAIL");
+    }
+    vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
+    vga_printf("] %s\n", component);
+}
+
+/**
+ * Mark stages deferred through their dependencies
+ *
+ * Dependencies may point forward in the table, so this repeats until
+ * nothing changes.
+ */
+static void propagate_deferred(void) {
+    uint32_t deferred = 0;
+    for (uint32_t i = 0; i < stage_count; i++) {
+        stage_table[i].deferred = (stage_table[i].flags & INIT_DEFERRED) != 0;
+        if (stage_table[i].deferred) {
+            deferred |= INIT_DEP(i);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < stage_count; i++) {
+            if (!stage_table[i].deferred && (stage_table[i].deps & deferred)) {
+                stage_table[i].deferred = true;
+                deferred |= INIT_DEP(i);
+                changed = true;
+            }
+        }
+    }
+}
+
+/**
+ * Find the first stage of one kind whose dependencies have all finished
+ *
+ * @return Stage index, or stage_count if none is runnable
+ */
+static uint32_t next_runnable(bool deferred) {
+    uint32_t finished = 0;
+    for (uint32_t i = 0; i < stage_count; i++) {
+        if (stage_table[i].done) {
+            finished |= INIT_DEP(i);
+        }
+    }
+
+    for (uint32_t i = 0; i < stage_count; i++) {
+        init_stage_t *stage = &stage_table[i];
+        if (!stage->done && stage->deferred == deferred &&
+            (stage->deps & finished) == stage->deps) {
+            return i;
+        }
+    }
+    return stage_count;
+}
+
+/**
+ * Run one stage, or fail it if a dependency failed
+ */
+static void run_stage(init_stage_t *stage) {
+    bool deps_ok = true;
+    for (uint32_t i = 0; i < stage_count; i++) {
+        if ((stage->deps & INIT_DEP(i)) && stage_table[i].status < 0) {
+            deps_ok = false;
+        }
+    }
+
+    current_stage = stage;
+    stage->start_tsc = rdtsc();
+    stage->status = deps_ok ? stage->init() : -1;
+    stage->end_tsc = rdtsc();
+    stage->done = true;
+    current_stage = NULL;
+
+    if (stage->status != INIT_SKIPPED) {
+        init_display_status(stage->name, stage->status);
+    }
+}
+
+/**
+ * Run all stages of one kind in dependency order
+ *
+ * @return Number of stages that failed
+ */
+static int run_stages(bool deferred) {
+    int failed = 0;
+    uint32_t index;
+
+    while ((index = next_runnable(deferred)) < stage_count) {
+        run_stage(&stage_table[index]);
+        if (stage_table[index].status < 0) {
+            failed++;
+        }
+    }
+
+    // Whatever is left waits on itself or on a stage that does not exist
+    for (uint32_t i = 0; i < stage_count; i++) {
+        init_stage_t *stage = &stage_table[i];
+        if (!stage->done && stage->deferred == deferred) {
+            vga_printf("  Init: Unresolvable dependencies for %s\n", stage->name);
+            stage->status = -1;
+            stage->done = true;
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+/**
+ * Run every stage that is not deferred
+ */
+int init_run(init_stage_t *stages, uint32_t count) {
+    if (count > INIT_MAX_STAGES) {
+        vga_printf("  Init: %u stages, only %u supported\n", count, INIT_MAX_STAGES);
+        count = INIT_MAX_STAGES;
+    }
+
+    stage_table = stages;
+    stage_count = count;
+    boot_tsc = rdtsc();
+    wait_queue_init(&deferred_wait);
+
+    propagate_deferred();
+    deferred_pending = 0;
+    for (uint32_t i = 0; i < stage_count; i++) {
+        stage_table[i].done = false;
+        stage_table[i].status = 0;
+        if (stage_table[i].deferred) {
+            deferred_pending++;
+        }
+    }
+
+    return run_stages(false);
+}
+
+/**
+ * Run the deferred stages in the current context, then report
+ */
+int init_run_deferred(void) {
+    int failed = run_stages(true);
+
+    uint64_t flags = interrupts_save();
+    deferred_pending = 0;
+    wait_queue_wake_all(&deferred_wait);
+    interrupts_restore(flags);
+
+    init_print_timeline();
+    return failed;
+}
+
+/**
+ * Probe task: run the deferred stages once multitasking is up
+ */
+static void init_probe_task(void) {
+    init_run_deferred();
+    process_exit(0);
+}
+
+/**
+ * Create the probe task that runs the deferred stages
+ */
+int init_start_deferred(void) {
+    if (deferred_pending == 0) {
+        return 0;
+    }
+
+    process_t *task = process_create_kernel_task(init_probe_task, "probe", INIT_PROBE_PRIORITY);
+    if (!task) {
+        return -1;
+    }
+    scheduler_add_process(task);
+    return 0;
+}
+
+/**
+ * Check whether all deferred stages have finished
+ */
+bool init_deferred_done(void) {
+    return deferred_pending == 0;
+}
+
+/**
+ * Sleep until all deferred stages have finished
+ */
+void init_wait_deferred(void) {
+    uint64_t flags = interrupts_save();
+    while (deferred_pending != 0) {
+        wait_queue_sleep(&deferred_wait);
+    }
+    interrupts_restore(flags);
+}
+
+/**
+ * Rename the running stage
+ */
+void init_set_name(const char *name) {
+    if (current_stage) {
+        current_stage->name = name;
+    }
+}
+
+/**
+ * Record the moment boot hands over to the scheduler
+ */
+void init_mark_scheduler_start(void) {
+    scheduler_tsc = rdtsc();
+}
+
+/**
+ * Print text padded with spaces to a column width
+ */
+static void print_column(const char *text, size_t width, bool right) {
+    size_t len = strlen(text);
+    size_t pad = len < width ? width - len : 0;
+
+    if (!right) {
+        vga_puts(text);
+    }
+    for (size_t i = 0; i < pad; i++) {
+        vga_putchar(' ');
+    }
+    if (right) {
+        vga_puts(text);
+    }
+}
+
+/**
+ * Print a TSC interval in microseconds (cycles if the TSC is uncalibrated)
+ */
+static void print_interval(uint64_t cycles, uint64_t tsc_khz) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lu", tsc_khz ? cycles * 1000 / tsc_khz : cycles);
+    print_column(buf, TIMELINE_NUMBER_WIDTH, true);
+}
+
+/**
+ * Print the boot timeline
+ */
+void init_print_timeline(void) {
+    uint64_t tsc_khz = timer_get_tsc_khz();
+    const char *unit = tsc_khz ? "us" : "cycles";
+
+    vga_setcolor(VGA_COLOR_LIGHT_BLUE | (VGA_COLOR_BLACK << 4));
+    vga_puts("\nBoot Timeline:\n");
+    vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
+
+    vga_puts("  ");
+    print_column("Stage", TIMELINE_NAME_WIDTH, false);
+    print_column("Start", TIMELINE_NUMBER_WIDTH, true);
+    print_column("Time", TIMELINE_NUMBER_WIDTH, true);
+    vga_printf("  (%s)\n", unit);
+
+    uint64_t serial_cycles = 0;
+    uint64_t deferred_cycles = 0;
+
+    for (uint32_t i = 0; i < stage_count; i++) {
+        init_stage_t *stage = &stage_table[i];
+        if (!stage->done || stage->status == INIT_SKIPPED) {
+            continue;
+        }
+
+        uint64_t cycles = stage->end_tsc - stage->start_tsc;
+        if (stage->deferred) {
+            deferred_cycles += cycles;
+        } else {
+            serial_cycles += cycles;
+        }
+
+        vga_puts("  ");
+        print_column(stage->name, TIMELINE_NAME_WIDTH, false);
+        print_interval(stage->start_tsc - boot_tsc, tsc_khz);
+        print_interval(cycles, tsc_khz);
+        if (stage->status < 0) {
+            vga_puts("  failed");
+        } else if (stage->deferred) {
+            vga_puts("  deferred");
+        }
+        vga_puts("\n");
+    }
+
+    vga_puts("  ");
+    print_column("Boot stages", TIMELINE_NAME_WIDTH, false);
+    print_column("", TIMELINE_NUMBER_WIDTH, true);
+    print_interval(serial_cycles, tsc_khz);
+    vga_puts("\n  ");
+    print_column("Deferred stages (background)", TIMELINE_NAME_WIDTH, false);
+    print_column("", TIMELINE_NUMBER_WIDTH, true);
+    print_interval(deferred_cycles, tsc_khz);
+    vga_puts("\n");
+
+    if (scheduler_tsc) {
+        vga_puts("  ");
+        print_column("Scheduler started", TIMELINE_NAME_WIDTH, false);
+        print_interval(scheduler_tsc - boot_tsc, tsc_khz);
+        vga_puts("\n");
+    }
+    vga_puts("\n");
+}
@@ -8,38 +8,44 @@
 #include <kernel/vga.h>
 #include <kernel/memory.h>
 #include <kernel/pmm.h>
+#include <kernel/memblock.h>
 #include <kernel/vmm.h>
 #include <kernel/heap.h>
 #include <kernel/string.h>
 #include <kernel/idt.h>
 #include <kernel/isr.h>
-#include <kernel/pic.h>
+#include <kernel/irq.h>
+#include <kernel/pci.h>
 #include <kernel/timer.h>
 #include <kernel/process.h>
 #include <kernel/scheduler.h>
+#include <kernel/workqueue.h>
+#include <kernel/reclaim.h>
+#include <kernel/swap.h>
+#include <kernel/printk.h>
 #include <kernel/gdt.h>
 #include <kernel/syscall.h>
 #include <kernel/block.h>
 #include <kernel/ata.h>
 #include <kernel/vfs.h>
 #include <kernel/simplefs.h>
+#include <kernel/crc32c.h>
+#include <kernel/tsc.h>
+#include <kernel/pipe.h>
+#include <kernel/chardev.h>
+#include <kernel/serial.h>
+#include <kernel/devfs.h>
+#include <kernel/multiboot.h>
+#include <kernel/fbcon.h>
+#include <kernel/profile.h>
+#include <kernel/kbench.h>
+#include <kernel/trace.h>
+#include <kernel/init.h>
 #include <stdint.h>
 #include <stddef.h>
 
-// Assume 512MB of RAM for now (can be detected from multiboot later)
-#define TOTAL_MEMORY (512 * 1024 * 1024)
-
-// Multiboot2 information structure
-struct multiboot_tag {
-    uint32_t type;
-    uint32_t size;
-};
-
-struct multiboot_info {
-    uint32_t total_size;
-    uint32_t reserved;
-    struct multiboot_tag tags[];
-};
+// RAM assumed when the loader passes no memory map
+#define FALLBACK_MEMORY (512 * 1024 * 1024)
 
 // External symbols from linker script
 extern uint8_t _kernel_start[];
@@ -105,100 +111,254 @@ static void display_memory_info(void) {
 /**
  * Display boot information
  */
-static void display_boot_info(void) {
+static void display_boot_info(int multiboot_status) {
     vga_setcolor(VGA_COLOR_YELLOW | (VGA_COLOR_BLACK << 4));
     vga_puts("Boot Information:\n");
     vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
 
-    vga_puts("  Bootloader:   GRUB2 (Multiboot2)\n");
+    if (multiboot_status == 0) {
+        vga_puts("  Bootloader:   GRUB2 (Multiboot2)\n");
+    } else {
+        vga_puts("  Bootloader:   Unknown (no Multiboot2 information)\n");
+    }
+
+    const multiboot_framebuffer_t *fb = multiboot_get_framebuffer();
+    if (fb) {
+        vga_printf("  Display:      %ux%u framebuffer, %u bpp\n", fb->width, fb->height, fb->bpp);
+    } else {
+        vga_puts("  Display:      VGA text mode\n");
+    }
     vga_puts("  CPU Mode:     Long Mode (64-bit)\n");
     vga_puts("  Paging:       Enabled\n");
     vga_puts("  Interrupts:   Disabled\n");
     vga_puts("\n");
 }
 
-/**
- * Display initialization status
- */
-static void display_init_status(const char *component, int status) {
-    vga_printf("  [");
-    if (status == 0) {
-        vga_setcolor(VGA_COLOR_LIGHT_GREEN | (VGA_COLOR_BLACK << 4));
-        vga_puts(" OK ");
-    } else {
-        vga_setcolor(VGA_COLOR_LIGHT_RED | (VGA_COLOR_BLACK << 4));
-        vga_puts("FAIL");
-    }
-    vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
-    vga_printf("] %s\n", component);
-}
+// Forward declarations
+static int test_filesystem(void);
 
 /**
- * Initialize kernel subsystems
+ * Initialization stages, in the order they are listed at boot
  */
-static void init_subsystems(void) {
-    vga_setcolor(VGA_COLOR_LIGHT_BLUE | (VGA_COLOR_BLACK << 4));
-    vga_puts("Initializing Kernel Subsystems:\n");
-    vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
+enum {
+    STAGE_PMM,
+    STAGE_VMM,
+    STAGE_FBCON,
+    STAGE_HEAP,
+    STAGE_CRC32C,
+    STAGE_GDT,
+    STAGE_IDT,
+    STAGE_IRQ,
+    STAGE_PCI,
+    STAGE_TIMER,
+    STAGE_PROCESS,
+    STAGE_SCHEDULER,
+    STAGE_WORKQUEUE,
+    STAGE_RECLAIM,
+    STAGE_SYSCALL,
+    STAGE_BLOCK,
+    STAGE_CHARDEV,
+    STAGE_SERIAL,
+    STAGE_TRACE,
+    STAGE_ATA,
+    STAGE_SWAP,
+    STAGE_VFS,
+    STAGE_PIPE,
+    STAGE_DEVFS,
+    STAGE_STDIO,
+    STAGE_ROOTFS,
+    STAGE_COUNT
+};
 
-    // VGA is already initialized
-    display_init_status("VGA Text Mode", 0);
+// Sized from the multiboot memory map (collected by memblock)
+static int init_pmm(void) {
+    if (memblock_phys_mem_size() == 0) {
+        vga_puts("  PMM: No memory map from the loader, assuming 512 MB\n");
+        memblock_add(0, FALLBACK_MEMORY);
+    }
 
-    // Initialize memory management
-    // PMM: Physical Memory Manager
-    uint64_t kernel_end = (uint64_t)_kernel_end;
-    pmm_init(TOTAL_MEMORY, kernel_end);
-    display_init_status("Physical Memory Manager (PMM)", 0);
+    pmm_init((uint64_t)_kernel_end);
+    memblock_dump();
+    return pmm_get_total_pages() > 0 ? 0 : -1;
+}
 
-    // VMM: Virtual Memory Manager
+static int init_vmm(void) {
     vmm_init();
-    display_init_status("Virtual Memory Manager (VMM)", 0);
+    return 0;
+}
+
+// Framebuffer console, if the loader set up a graphics mode
+static int init_fbcon(void) {
+    const multiboot_framebuffer_t *fb = multiboot_get_framebuffer();
+    if (!fb) {
+        return INIT_SKIPPED;
+    }
+
+    int status = fbcon_init(fb);
+    vga_use_framebuffer();
+    return status;
+}
 
-    // Heap: Kernel heap allocator
+// Starts small and grows on demand
+static int init_heap(void) {
     uint64_t heap_start = 0xFFFF800200000000ULL;  // Start of heap in higher half
-    size_t heap_size = 16 * 1024 * 1024;  // 16MB initial size
+    size_t heap_size = 1024 * 1024;  // 1MB initial size
     heap_init(heap_start, heap_size);
-    display_init_status("Kernel Heap Allocator", 0);
+    return 0;
+}
+
+// SSE4.2 instruction or slice-by-8 tables
+static int init_crc32c(void) {
+    crc32c_init();
+    init_set_name(crc32c_hw_available() ? "CRC32C (SSE4.2)" : "CRC32C (slice-by-8)");
+    return 0;
+}
 
-    // GDT: Global Descriptor Table
+static int init_gdt(void) {
     gdt_init();
-    display_init_status("Global Descriptor Table (GDT)", 0);
+    return 0;
+}
 
-    // IDT: Interrupt Descriptor Table
+static int init_idt(void) {
     idt_init();
-    display_init_status("Interrupt Descriptor Table (IDT)", 0);
+    return 0;
+}
 
-    // PIC: Programmable Interrupt Controller
-    pic_init(0x20, 0x28);  // Remap PIC to 0x20-0x2F
-    display_init_status("Programmable Interrupt Controller (PIC)", 0);
+// Local APIC + I/O APIC, or the 8259 PIC
+static int init_irq(void) {
+    if (irq_init() == IRQ_MODE_APIC) {
+        init_set_name("Interrupt Controller (APIC)");
+    } else {
+        init_set_name("Interrupt Controller (PIC)");
+    }
+    return 0;
+}
+
+// Enumerate functions and their BARs/MSI capabilities
+static int init_pci(void) {
+    int status = pci_init();
+    init_set_name(pci_using_ecam() ? "PCI Bus (ECAM)" : "PCI Bus (port 0xCF8)");
+    return status < 0 ? -1 : 0;
+}
 
-    // Timer: Programmable Interval Timer
+static int init_timer(void) {
     timer_init(100);  // 100Hz = 10ms ticks
-    display_init_status("Timer (PIT)", 0);
+    return 0;
+}
 
-    // Process Management
+static int init_process(void) {
     process_init();
-    display_init_status("Process Management", 0);
+    return 0;
+}
 
-    // Scheduler
+static int init_scheduler(void) {
     scheduler_init(SCHED_ROUND_ROBIN);
-    display_init_status("Scheduler", 0);
+    return 0;
+}
 
-    // Syscall: System call interface
+static int init_syscall(void) {
     syscall_init();
-    display_init_status("System Call Interface", 0);
+    return 0;
+}
 
-    // Block Devices
+static int init_block(void) {
     block_init();
-    display_init_status("Block Device Layer", 0);
+    return 0;
+}
 
-    // ATA: Disk driver
+static int init_chardev(void) {
+    chardev_init();
+    return 0;
+}
+
+static int init_serial(void) {
+    serial_init();
+    return 0;
+}
+
+static int init_ata(void) {
     ata_init();
-    display_init_status("ATA Disk Driver", 0);
+    return 0;
+}
 
-    // VFS: Virtual Filesystem
+static int init_vfs(void) {
     vfs_init();
-    display_init_status("Virtual Filesystem (VFS)", 0);
+    return 0;
+}
+
+static int init_pipe(void) {
+    pipe_init();
+    return 0;
+}
+
+// stdin, stdout, stderr on the console
+static int init_stdio(void) {
+    int status = 0;
+    for (int fd = 0; fd < 3; fd++) {
+        if (vfs_open("/dev/console", fd == 0 ? O_RDONLY : O_WRONLY) != fd) {
+            status = -1;
+        }
+    }
+    return status;
+}
+
+/**
+ * Stage table
+ *
+ * Device probing (PCI, ATA and what needs the disks) is deferred to the
+ * probe task: an empty ATA position alone can spin for milliseconds.
+ */
+static init_stage_t init_stages[STAGE_COUNT] = {
+    [STAGE_PMM]       = { "Physical Memory Manager (PMM)", init_pmm, 0, 0 },
+    [STAGE_VMM]       = { "Virtual Memory Manager (VMM)", init_vmm, INIT_DEP(STAGE_PMM), 0 },
+    [STAGE_FBCON]     = { "Framebuffer Console", init_fbcon, INIT_DEP(STAGE_VMM), 0 },
+    [STAGE_HEAP]      = { "Kernel Heap Allocator", init_heap, INIT_DEP(STAGE_VMM), 0 },
+    [STAGE_CRC32C]    = { "CRC32C", init_crc32c, 0, 0 },
+    [STAGE_GDT]       = { "Global Descriptor Table (GDT)", init_gdt, 0, 0 },
+    [STAGE_IDT]       = { "Interrupt Descriptor Table (IDT)", init_idt, INIT_DEP(STAGE_GDT), 0 },
+    [STAGE_IRQ]       = { "Interrupt Controller", init_irq,
+                          INIT_DEP(STAGE_IDT) | INIT_DEP(STAGE_VMM), 0 },
+    [STAGE_PCI]       = { "PCI Bus", init_pci,
+                          INIT_DEP(STAGE_IRQ) | INIT_DEP(STAGE_HEAP), INIT_DEFERRED },
+    [STAGE_TIMER]     = { "Timer (PIT)", init_timer, INIT_DEP(STAGE_IRQ), 0 },
+    [STAGE_PROCESS]   = { "Process Management", init_process,
+                          INIT_DEP(STAGE_HEAP) | INIT_DEP(STAGE_GDT), 0 },
+    [STAGE_SCHEDULER] = { "Scheduler", init_scheduler,
+                          INIT_DEP(STAGE_PROCESS) | INIT_DEP(STAGE_TIMER), 0 },
+    [STAGE_WORKQUEUE] = { "Workqueues", workqueue_init, INIT_DEP(STAGE_SCHEDULER), 0 },
+    [STAGE_RECLAIM]   = { "Memory Reclaim (kswapd)", reclaim_init,
+                          INIT_DEP(STAGE_WORKQUEUE) | INIT_DEP(STAGE_HEAP), 0 },
+    [STAGE_SYSCALL]   = { "System Call Interface", init_syscall,
+                          INIT_DEP(STAGE_GDT) | INIT_DEP(STAGE_IDT), 0 },
+    [STAGE_BLOCK]     = { "Block Device Layer", init_block, INIT_DEP(STAGE_HEAP), 0 },
+    [STAGE_CHARDEV]   = { "Character Device Layer", init_chardev, INIT_DEP(STAGE_HEAP), 0 },
+    [STAGE_SERIAL]    = { "Serial Port", init_serial,
+                          INIT_DEP(STAGE_CHARDEV) | INIT_DEP(STAGE_IRQ), 0 },
+    [STAGE_TRACE]     = { "Tracepoints", trace_init,
+                          INIT_DEP(STAGE_CHARDEV) | INIT_DEP(STAGE_SERIAL), 0 },
+    [STAGE_ATA]       = { "ATA Disk Driver", init_ata, INIT_DEP(STAGE_BLOCK), INIT_DEFERRED },
+    [STAGE_SWAP]      = { "Swap", swap_init, INIT_DEP(STAGE_ATA) | INIT_DEP(STAGE_RECLAIM), 0 },
+    [STAGE_VFS]       = { "Virtual Filesystem (VFS)", init_vfs, INIT_DEP(STAGE_HEAP), 0 },
+    [STAGE_PIPE]      = { "Pipes and FIFOs", init_pipe, INIT_DEP(STAGE_VFS), 0 },
+    [STAGE_DEVFS]     = { "Device Filesystem (/dev)", devfs_init,
+                          INIT_DEP(STAGE_VFS) | INIT_DEP(STAGE_CHARDEV) | INIT_DEP(STAGE_BLOCK), 0 },
+    [STAGE_STDIO]     = { "Standard Streams (/dev/console)", init_stdio, INIT_DEP(STAGE_DEVFS), 0 },
+    [STAGE_ROOTFS]    = { "Root Filesystem (hda)", test_filesystem,
+                          INIT_DEP(STAGE_ATA) | INIT_DEP(STAGE_DEVFS), 0 },
+};
+
+/**
+ * Initialize kernel subsystems
+ */
+static void init_subsystems(void) {
+    vga_setcolor(VGA_COLOR_LIGHT_BLUE | (VGA_COLOR_BLACK << 4));
+    vga_puts("Initializing Kernel Subsystems:\n");
+    vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
+
+    // VGA is already initialized
+    init_display_status("VGA Text Mode", 0);
+
+    init_run(init_stages, STAGE_COUNT);
 
     vga_puts("\n");
 }
@@ -274,13 +434,18 @@ static void test_memory_management(void) {
         pmm_free_page(test_phys);
     }
 
+    // Where physical memory went during boot
+    pmm_dump_usage();
+
     vga_puts("\n");
 }
 
 /**
- * Test filesystem
+ * Test filesystem: format hda and mount it at '/'
+ *
+ * Runs in the probe task, after the ATA drives have been identified.
  */
-static void test_filesystem(void) {
+static int test_filesystem(void) {
     vga_setcolor(VGA_COLOR_LIGHT_MAGENTA | (VGA_COLOR_BLACK << 4));
     vga_puts("Testing Filesystem:\n");
     vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
@@ -290,7 +455,7 @@ static void test_filesystem(void) {
     if (!disk) {
         vga_puts("  No disk found (hda). Skipping filesystem tests.\n");
         vga_puts("  Note: Add -drive with QEMU to test filesystem.\n\n");
-        return;
+        return INIT_SKIPPED;
     }
 
     vga_printf("  Found disk: %s (%llu MB)\n", disk->name, disk->size / (1024 * 1024));
@@ -299,7 +464,7 @@ static void test_filesystem(void) {
     vga_puts("  Formatting disk with SimpleFS...\n");
     if (simplefs_format(disk) != 0) {
         vga_puts("  ERROR: Failed to format disk!\n\n");
-        return;
+        return -1;
     }
 
     // Create filesystem
@@ -307,7 +472,7 @@ static void test_filesystem(void) {
     filesystem_t *fs = simplefs_create(disk);
     if (!fs) {
         vga_puts("  ERROR: Failed to create filesystem!\n\n");
-        return;
+        return -1;
     }
 
     // Register filesystem
@@ -317,11 +482,15 @@ static void test_filesystem(void) {
     vga_puts("  Mounting filesystem at '/'...\n");
     if (vfs_mount("/", fs) != 0) {
         vga_puts("  ERROR: Failed to mount filesystem!\n\n");
-        return;
+        return -1;
     }
 
     vga_puts("  Filesystem mounted successfully!\n");
+
+    // Verify metadata in the background
+    simplefs_start_scrubber(fs);
     vga_puts("  Note: File operations available via syscalls.\n\n");
+    return 0;
 }
 
 /**
@@ -400,6 +569,124 @@ static void user_mode_entry(void) {
     }
 }
 
+/**
+ * Memory statistics task - Reports memory use once swap is set up
+ *
+ * Swap and the root filesystem come up in the probe task, so reclaim
+ * and swap figures mean nothing before the deferred stages are done.
+ */
+static void memstat_task(void) {
+    init_wait_deferred();
+    process_dump_memory();
+    reclaim_print_stats();
+    swap_print_stats();
+    process_exit(0);
+}
+
+/**
+ * Profiler task - Dumps the samples once the boot workload has run
+ */
+#define PROFILE_RUN_TICKS 500   // 5 seconds at 100 Hz
+
+static void profile_task(void) {
+    process_sleep(PROFILE_RUN_TICKS);
+    profile_dump();
+    process_exit(0);
+}
+
+/**
+ * Trace task - Dumps the trace buffers once the boot workload has run
+ */
+#define TRACE_RUN_TICKS 500     // 5 seconds at 100 Hz
+
+static void trace_task(void) {
+    process_sleep(TRACE_RUN_TICKS);
+    trace_dump();
+    process_exit(0);
+}
+
+/**
+ * Start the profiler for "profile" or "profile=<event>" on the command line
+ */
+static void profile_from_cmdline(void) {
+    char name[16];
+
+    if (!multiboot_cmdline_option("profile", name, sizeof(name))) {
+        return;
+    }
+
+    profile_event_t event = name[0] ? profile_parse_event(name) : PROFILE_EVENT_CYCLES;
+    if (event == PROFILE_EVENT_COUNT) {
+        vga_printf("  Profiler: Unknown event '%s'\n", name);
+        return;
+    }
+
+    profile_start(event, 0);
+}
+
+/**
+ * Benchmark task - Runs the KBENCH suite once probing is done, then idles
+ *
+ * With "bench=exit" it leaves QEMU instead, so a runner on the host
+ * sees the end of the run as the emulator exiting.
+ */
+static void kbench_task(void) {
+    char mode[8];
+
+    // Disk and filesystem cases need the probed drives
+    init_wait_deferred();
+
+    vga_setcolor(VGA_COLOR_LIGHT_MAGENTA | (VGA_COLOR_BLACK << 4));
+    vga_puts("Running Benchmarks:\n");
+    vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
+
+    uint32_t passed = kbench_run_all();
+
+    if (multiboot_cmdline_option("bench", mode, sizeof(mode)) && strcmp(mode, "exit") == 0) {
+        kbench_exit(passed > 0 ? 0 : 1);
+    }
+
+    while (1) {
+        __asm__ volatile("hlt");
+    }
+}
+
+/**
+ * Hand the deferred stages to the probe task
+ *
+ * Without a task they run here instead, so the devices are still there.
+ */
+static void start_deferred_probing(void) {
+    if (init_start_deferred() != 0) {
+        vga_puts("  ERROR: Failed to create probe task, probing now\n");
+        init_run_deferred();
+    }
+    init_mark_scheduler_start();
+}
+
+/**
+ * Run the benchmark suite in place of the demo tasks
+ *
+ * Only the benchmark task (and whatever it creates) is runnable, so
+ * scheduler cases measure switches between exactly two tasks.
+ */
+static void run_benchmarks(void) {
+    process_t *bench = process_create_kernel_task(kbench_task, "kbench", 0);
+    if (!bench) {
+        vga_puts("  ERROR: Failed to create benchmark task!\n");
+        return;
+    }
+
+    scheduler_add_process(bench);
+    start_deferred_probing();
+    scheduler_start();
+    interrupts_enable();
+
+    while (1) {
+        __asm__ volatile("hlt");
+    }
+}
+
 /**
  * Test multitasking
  */
@@ -443,6 +730,34 @@ static void test_multitasking(void) {
     scheduler_add_process(task3);
     scheduler_add_process(idle);
 
+    // Report memory use after the deferred stages have enabled swap
+    process_t *memstat = process_create_kernel_task(memstat_task, "memstat", 0);
+    if (memstat) {
+        scheduler_add_process(memstat);
+    }
+
+    // Collect the profile after the tasks have run for a while
+    if (profile_active()) {
+        process_t *profiler = process_create_kernel_task(profile_task, "profile", 0);
+        if (profiler) {
+            scheduler_add_process(profiler);
+        }
+    }
+
+    // Same for tracepoints enabled on the command line
+    if (trace_active()) {
+        process_t *tracer = process_create_kernel_task(trace_task, "trace", 0);
+        if (tracer) {
+            scheduler_add_process(tracer);
+        }
+    }
+
+    // Hand console output for printk to the low-priority log task
+    printk_start_console_task();
+
+    // PCI, ATA and the root filesystem come up in the background
+    start_deferred_probing();
+
     vga_puts("  Added tasks to scheduler\n\n");
 
     // Start scheduler
@@ -465,17 +780,26 @@ static void test_multitasking(void) {
 /**
  * Kernel main entry point
  * Called from boot.S after initial setup
+ *
+ * @param multiboot_info Physical address of the multiboot2 information
+ * @param multiboot_magic Value the loader left in EAX
  */
-void kernel_main(void) {
+void kernel_main(uint64_t multiboot_info, uint32_t multiboot_magic) {
     // Initialize VGA for output
     vga_init();
     vga_clear();
 
+    // Copy out boot information before the PMM can reuse its memory
+    int multiboot_status = multiboot_init(multiboot_info, multiboot_magic);
+
+    // Kernel log is synchronous until klogd starts
+    printk_init();
+
     // Display banner
     display_banner();
 
     // Display boot information
-    display_boot_info();
+    display_boot_info(multiboot_status);
 
     // Display memory information
     display_memory_info();
@@ -483,17 +807,22 @@ void kernel_main(void) {
     // Initialize kernel subsystems
     init_subsystems();
 
+    // Sample the rest of boot if asked to
+    profile_from_cmdline();
+
     // Test memory management
     test_memory_management();
 
-    // Test filesystem
-    test_filesystem();
-
     // Success message
     vga_setcolor(VGA_COLOR_LIGHT_GREEN | (VGA_COLOR_BLACK << 4));
     vga_puts("All subsystems initialized successfully!\n");
     vga_setcolor(VGA_COLOR_WHITE | (VGA_COLOR_BLACK << 4));
-    vga_puts("\n");
+    vga_puts("  (Devices are probed in the background once multitasking starts)\n\n");
+
+    // "bench" on the command line runs the benchmarks instead (never returns)
+    if (multiboot_cmdline_option("bench", NULL, 0)) {
+        run_benchmarks();
+    }
 
     // Test multitasking (this never returns)
     test_multitasking();
@@ -16,7 +16,9 @@
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <kernel/memory.h>
+#include <kernel/reclaim.h>
 #include <kernel/string.h>
+#include <kernel/trace.h>
 #include <kernel/vga.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -24,6 +26,7 @@
 
 #define HEAP_MAGIC 0x48454150  // "HEAP"
 #define MIN_BLOCK_SIZE 32      // Minimum allocation size
+#define HEAP_GROW_MIN (64 * 1024)  // Smallest expansion, so growth is not page by page
 
 // Block header structure
 typedef struct heap_block {
@@ -41,6 +44,12 @@ static size_t heap_size = 0;
 static heap_block_t *first_block = NULL;
 static uint32_t allocation_count = 0;
 
+// The heap never shrinks below its initial size
+static size_t heap_min_size = 0;
+
+// Non-zero while kmalloc()/kfree() are changing the block list
+static volatile uint32_t heap_busy = 0;
+
 /**
  * Expand heap by allocating more pages
  */
@@ -56,6 +65,7 @@ int heap_expand(size_t additional_size) {
             vga_printf("ERROR: Failed to expand heap (out of physical memory)\n");
             return -1;
         }
+        pmm_set_owner(phys, 1, PAGE_OWNER_HEAP, 0);
 
         // Map to virtual address
         uint64_t virt = heap_end + i * PAGE_SIZE;
@@ -72,6 +82,81 @@ int heap_expand(size_t additional_size) {
     return 0;
 }
 
+/**
+ * Find the last block of the heap
+ */
+static heap_block_t *last_block(void) {
+    heap_block_t *block = first_block;
+
+    while (block != NULL && block->next != NULL) {
+        block = block->next;
+    }
+    return block;
+}
+
+/**
+ * Lowest page-aligned end the heap could be cut back to
+ *
+ * Only a free block at the end can give memory back; it keeps room for
+ * its header, and the heap keeps its initial size.
+ */
+static uint64_t heap_trim_floor(heap_block_t *tail) {
+    uint64_t floor = PAGE_ALIGN((uint64_t)tail + sizeof(heap_block_t) + MIN_BLOCK_SIZE);
+
+    if (floor < heap_start + heap_min_size) {
+        floor = heap_start + heap_min_size;
+    }
+    return floor;
+}
+
+/**
+ * Shrinker: count pages the heap could return
+ */
+static size_t heap_shrink_count(shrinker_t *shrinker) {
+    (void)shrinker;
+
+    heap_block_t *tail = last_block();
+    if (heap_busy || tail == NULL || !tail->free) {
+        return 0;
+    }
+
+    uint64_t floor = heap_trim_floor(tail);
+    return floor < heap_end ? BYTES_TO_PAGES(heap_end - floor) : 0;
+}
+
+/**
+ * Shrinker: unmap free pages at the end of the heap
+ */
+static size_t heap_shrink_scan(shrinker_t *shrinker, size_t nr_pages) {
+    size_t available = heap_shrink_count(shrinker);
+    if (available == 0) {
+        return 0;
+    }
+
+    size_t pages = nr_pages < available ? nr_pages : available;
+    uint64_t new_end = heap_end - pages * PAGE_SIZE;
+
+    for (uint64_t virt = new_end; virt < heap_end; virt += PAGE_SIZE) {
+        uint64_t phys = vmm_get_physical(virt);
+        vmm_unmap_page(virt);
+        pmm_free_page(phys);
+    }
+
+    heap_block_t *tail = last_block();
+    tail->size = (uint32_t)(new_end - (uint64_t)tail);
+    heap_size -= heap_end - new_end;
+    heap_end = new_end;
+
+    return pages;
+}
+
+static shrinker_t heap_shrinker = {
+    .name = "heap",
+    .count = heap_shrink_count,
+    .scan = heap_shrink_scan,
+    .private_data = NULL,
+};
+
 /**
  * Initialize kernel heap
  */
@@ -95,6 +180,8 @@ void heap_init(uint64_t start_addr, size_t initial_size) {
     first_block->prev = NULL;
 
     allocation_count = 0;
+    heap_min_size = heap_size;
+    shrinker_register(&heap_shrinker);
 
     vga_printf("  Heap: Initialized at 0x%x, size %u KB\n",
                heap_start, (uint32_t)(heap_size / 1024));
@@ -178,38 +265,47 @@ void *kmalloc(size_t size) {
     }
     total_size = (total_size + 7) & ~7;  // 8-byte alignment
 
+    heap_busy++;
+
     // Find free block
     heap_block_t *block = find_free_block(total_size);
 
     // If no block found, try expanding heap
     if (block == NULL) {
-        size_t expand_size = total_size * 2;  // Expand by at least 2x requested size
-        if (expand_size < PAGE_SIZE) {
-            expand_size = PAGE_SIZE;
+        // A free block at the end only needs the difference
+        heap_block_t *last = last_block();
+        size_t tail_free = (last != NULL && last->free) ? last->size : 0;
+
+        // Expand by at least 2x what is missing
+        size_t expand_size = PAGE_ALIGN((total_size - tail_free) * 2);
+        if (expand_size < HEAP_GROW_MIN) {
+            expand_size = HEAP_GROW_MIN;
         }
 
         if (heap_expand(expand_size) != 0) {
+            heap_busy--;
             return NULL;  // Out of memory
         }
 
-        // Create new block in expanded space
-        block = (heap_block_t *)(heap_end - expand_size);
-        block->magic = HEAP_MAGIC;
-        block->size = expand_size;
-        block->free = true;
-        block->next = NULL;
-        block->prev = NULL;
-
-        // Add to block list
-        if (first_block == NULL) {
-            first_block = block;
+        if (tail_free) {
+            // The free tail now reaches the new end of the heap
+            last->size += expand_size;
+            block = last;
         } else {
-            heap_block_t *last = first_block;
-            while (last->next != NULL) {
-                last = last->next;
-            }
-            last->next = block;
+            // Create new block in expanded space
+            block = (heap_block_t *)(heap_end - expand_size);
+            block->magic = HEAP_MAGIC;
+            block->size = expand_size;
+            block->free = true;
+            block->next = NULL;
             block->prev = last;
+
+            // Add to block list
+            if (last == NULL) {
+                first_block = block;
+            } else {
+                last->next = block;
+            }
         }
     }
 
@@ -219,9 +315,12 @@ void *kmalloc(size_t size) {
     // Mark block as used
     block->free = false;
     allocation_count++;
+    heap_busy--;
 
     // Return pointer to data (after header)
-    return (void *)((uint8_t *)block + sizeof(heap_block_t));
+    void *ptr = (void *)((uint8_t *)block + sizeof(heap_block_t));
+    trace_kmalloc(size, ptr);
+    return ptr;
 }
 
 /**
@@ -275,11 +374,13 @@ void kfree(void *ptr) {
     }
 
     // Mark block as free
+    heap_busy++;
     block->free = true;
     allocation_count--;
 
     // Coalesce adjacent free blocks
     coalesce_blocks();
+    heap_busy--;
 }
 
 /**
@@ -0,0 +1,230 @@
+/**
+ * Early Boot Memory Allocator (memblock)
+ *
+ * Two small sorted arrays of ranges. Adding a range merges it with
+ * every range it overlaps or touches, so each list stays short (a
+ * handful of entries on a PC) and lookups are linear scans.
+ */
+
+#include <kernel/memblock.h>
+#include <kernel/memory.h>
+#include <kernel/vmm.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+static memblock_type_t memory = { .name = "memory" };
+static memblock_type_t reserved = { .name = "reserved" };
+
+/**
+ * Add a range to a list, merging it with its neighbours
+ */
+static int memblock_insert(memblock_type_t *type, uint64_t base, uint64_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    uint64_t end = base + size;
+    uint32_t first = 0;
+
+    // Regions entirely before the new range stay where they are
+    while (first < type->count &&
+           type->regions[first].base + type->regions[first].size < base) {
+        first++;
+    }
+
+    // Swallow every region that overlaps or touches it
+    uint32_t last = first;
+    while (last < type->count && type->regions[last].base <= end) {
+        memblock_region_t *region = &type->regions[last];
+        if (region->base < base) {
+            base = region->base;
+        }
+        if (region->base + region->size > end) {
+            end = region->base + region->size;
+        }
+        last++;
+    }
+
+    uint32_t merged = last - first;
+    if (merged == 0 && type->count >= MEMBLOCK_MAX_REGIONS) {
+        vga_printf("ERROR: memblock: Too many %s regions\n", type->name);
+        return -1;
+    }
+
+    // Replace regions [first, last) by the one merged region
+    uint32_t tail = type->count - last;
+    if (merged != 1) {
+        memmove(&type->regions[first + 1], &type->regions[last],
+                tail * sizeof(memblock_region_t));
+    }
+    type->regions[first].base = base;
+    type->regions[first].size = end - base;
+    type->count = first + 1 + tail;
+
+    return 0;
+}
+
+/**
+ * Add a range of usable RAM
+ */
+int memblock_add(uint64_t base, uint64_t size) {
+    return memblock_insert(&memory, base, size);
+}
+
+/**
+ * Reserve a range
+ */
+int memblock_reserve(uint64_t base, uint64_t size) {
+    return memblock_insert(&reserved, base, size);
+}
+
+/**
+ * Find the reserved region overlapping a range, if any
+ */
+static const memblock_region_t *memblock_find_reserved(uint64_t base, uint64_t size) {
+    for (uint32_t i = 0; i < reserved.count; i++) {
+        const memblock_region_t *region = &reserved.regions[i];
+        if (region->base < base + size && base < region->base + region->size) {
+            return region;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find the highest free, aligned spot for size bytes in [start, end)
+ *
+ * @return Physical address, or 0 if there is none
+ */
+static uint64_t memblock_find_in_range(uint64_t start, uint64_t end,
+                                       uint64_t size, uint64_t align) {
+    while (end >= start + size) {
+        uint64_t candidate = (end - size) & ~(align - 1);
+        if (candidate < start) {
+            return 0;
+        }
+
+        // Step below whatever reservation is in the way
+        const memblock_region_t *busy = memblock_find_reserved(candidate, size);
+        if (busy == NULL) {
+            return candidate;
+        }
+        end = busy->base;
+    }
+
+    return 0;
+}
+
+/**
+ * Allocate physical memory before the PMM is up
+ */
+uint64_t memblock_phys_alloc(uint64_t size, uint64_t align) {
+    if (size == 0) {
+        return 0;
+    }
+    if (align < 8) {
+        align = 8;
+    }
+
+    // Top-down, so low memory stays free for whatever needs it
+    for (uint32_t i = memory.count; i-- > 0;) {
+        uint64_t start = memory.regions[i].base;
+        uint64_t end = start + memory.regions[i].size;
+        if (start >= DIRECT_MAP_SIZE) {
+            continue;
+        }
+        if (end > DIRECT_MAP_SIZE) {
+            end = DIRECT_MAP_SIZE;
+        }
+
+        uint64_t addr = memblock_find_in_range(start, end, size, align);
+        if (addr != 0) {
+            memblock_reserve(addr, size);
+            return addr;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Allocate zeroed memory before the PMM is up
+ */
+void *memblock_alloc(uint64_t size, uint64_t align) {
+    uint64_t phys = memblock_phys_alloc(size, align);
+    if (phys == 0) {
+        return NULL;
+    }
+
+    void *ptr = (void *)vmm_phys_to_virt(phys);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * Get the end of the highest range of usable RAM
+ */
+uint64_t memblock_end_of_ram(void) {
+    if (memory.count == 0) {
+        return 0;
+    }
+
+    const memblock_region_t *last = &memory.regions[memory.count - 1];
+    return last->base + last->size;
+}
+
+/**
+ * Get the total size of usable RAM
+ */
+uint64_t memblock_phys_mem_size(void) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < memory.count; i++) {
+        total += memory.regions[i].size;
+    }
+    return total;
+}
+
+/**
+ * Get the usable RAM ranges
+ */
+const memblock_type_t *memblock_memory(void) {
+    return &memory;
+}
+
+/**
+ * Get the reserved ranges
+ */
+const memblock_type_t *memblock_reserved(void) {
+    return &reserved;
+}
+
+/**
+ * Forget all ranges
+ */
+void memblock_reset(void) {
+    memory.count = 0;
+    reserved.count = 0;
+}
+
+/**
+ * Print one list of ranges
+ */
+static void memblock_dump_type(const memblock_type_t *type) {
+    for (uint32_t i = 0; i < type->count; i++) {
+        const memblock_region_t *region = &type->regions[i];
+        vga_printf("  Memblock: %s 0x%x - 0x%x (%u KB)\n", type->name,
+                   region->base, region->base + region->size,
+                   (uint32_t)(region->size / 1024));
+    }
+}
+
+/**
+ * Print the usable and reserved ranges
+ */
+void memblock_dump(void) {
+    memblock_dump_type(&memory);
+    memblock_dump_type(&reserved);
+}
@@ -4,26 +4,42 @@
  * Bitmap-based physical page allocator. Each bit represents one 4KB page.
  * Bit = 0: Page is free
  * Bit = 1: Page is used
+ *
+ * The bitmap and page array cover RAM up to the end of the memblock
+ * memory map and are themselves allocated from memblock, so a small
+ * machine pays for what it has rather than for 4GB.
  */
 
 #include <kernel/pmm.h>
 #include <kernel/memory.h>
+#include <kernel/memblock.h>
+#include <kernel/vmm.h>
+#include <kernel/reclaim.h>
 #include <kernel/string.h>
+#include <kernel/trace.h>
 #include <kernel/vga.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
-// Bitmap to track page allocation (static for simplicity)
-#define MAX_MEMORY_SIZE (4ULL * 1024 * 1024 * 1024)  // 4GB max
-#define MAX_PAGES (MAX_MEMORY_SIZE / PAGE_SIZE)
-#define BITMAP_SIZE (MAX_PAGES / 8)  // 8 bits per byte
+// Only memory reachable through the boot direct map is managed
+#define MAX_MEMORY_SIZE DIRECT_MAP_SIZE
 
-static uint8_t page_bitmap[BITMAP_SIZE];
+// Bitmap and per-page metadata, sized to total_pages by pmm_init()
+static uint8_t *page_bitmap = NULL;
+static page_t *page_array = NULL;
+static uint32_t owner_pages[PAGE_OWNER_COUNT];
 static uint32_t total_pages = 0;
 static uint32_t used_pages = 0;
 static uint64_t total_memory = 0;
 
+// No page below this one is free, so searches start here
+static uint32_t search_start = 0;
+
+// Free page counts that wake kswapd (low) and let it go back to sleep (high)
+static uint32_t low_watermark = 0;
+static uint32_t high_watermark = 0;
+
 /**
  * Set a bit in the bitmap
  */
@@ -45,15 +61,44 @@ static inline bool bitmap_test(uint32_t bit) {
     return page_bitmap[bit / 8] & (1 << (bit % 8));
 }
 
+static const char *owner_names[PAGE_OWNER_COUNT] = {
+    [PAGE_OWNER_FREE]      = "free",
+    [PAGE_OWNER_RESERVED]  = "reserved",
+    [PAGE_OWNER_KERNEL]    = "kernel",
+    [PAGE_OWNER_HEAP]      = "heap",
+    [PAGE_OWNER_PAGETABLE] = "pagetable",
+    [PAGE_OWNER_STACK]     = "stack",
+    [PAGE_OWNER_USER]      = "user",
+    [PAGE_OWNER_PIPE]      = "pipe",
+    [PAGE_OWNER_CACHE]     = "cache",
+};
+
+/**
+ * Move a page to a new owner, keeping the per-owner counts
+ */
+static inline void page_set_owner(uint32_t page, page_owner_t owner, uint32_t pid) {
+    owner_pages[page_array[page].owner]--;
+    owner_pages[owner]++;
+    page_array[page].owner = (uint8_t)owner;
+    page_array[page].pid = pid;
+}
+
 /**
  * Find first free page in bitmap
  */
 static uint32_t find_free_page(void) {
-    for (uint32_t i = 0; i < total_pages; i++) {
+    for (uint32_t i = search_start; i < total_pages; i++) {
+        // Skip whole bytes of used pages
+        if (i % 8 == 0 && page_bitmap[i / 8] == 0xFF) {
+            i += 7;
+            continue;
+        }
         if (!bitmap_test(i)) {
+            search_start = i;
             return i;
         }
     }
+    search_start = total_pages;
     return (uint32_t)-1;  // No free pages
 }
 
@@ -64,7 +109,9 @@ static uint32_t find_free_pages(size_t count) {
     if (count == 0) return (uint32_t)-1;
     if (count == 1) return find_free_page();
 
-    for (uint32_t i = 0; i < total_pages - count + 1; i++) {
+    if (count > total_pages) return (uint32_t)-1;
+
+    for (uint32_t i = search_start; i < total_pages - count + 1; i++) {
         bool found = true;
         for (size_t j = 0; j < count; j++) {
             if (bitmap_test(i + j)) {
@@ -81,46 +128,110 @@ static uint32_t find_free_pages(size_t count) {
 }
 
 /**
- * Initialize physical memory manager
+ * Find n contiguous free pages, reclaiming memory if there are none
  */
-void pmm_init(uint64_t mem_size, uint64_t kernel_end) {
-    // Calculate total pages
-    total_memory = mem_size;
-    total_pages = mem_size / PAGE_SIZE;
+static uint32_t find_free_pages_reclaim(size_t count) {
+    uint32_t page = find_free_pages(count);
 
-    if (total_pages > MAX_PAGES) {
-        total_pages = MAX_PAGES;
-        total_memory = MAX_PAGES * PAGE_SIZE;
+    while (page == (uint32_t)-1 && reclaim_direct(count) > 0) {
+        page = find_free_pages(count);
     }
+    return page;
+}
 
-    // Clear bitmap (all pages free initially)
-    memset(page_bitmap, 0, BITMAP_SIZE);
-    used_pages = 0;
+/**
+ * Wake kswapd once free memory drops below the low watermark
+ */
+static inline void check_watermark(void) {
+    if (total_pages - used_pages < low_watermark) {
+        reclaim_wake_kswapd();
+    }
+}
 
-    // Mark first page as used (real mode IVT, etc.)
-    pmm_mark_used(0);
+/**
+ * Return a page to the free pool while building the bitmap
+ */
+static void pmm_release_page(uint32_t page) {
+    if (bitmap_test(page)) {
+        bitmap_clear(page);
+        used_pages--;
+        page_set_owner(page, PAGE_OWNER_FREE, 0);
+    }
+}
 
-    // Mark kernel pages as used (from 1MB to kernel_end)
+/**
+ * Initialize physical memory manager
+ */
+void pmm_init(uint64_t kernel_end) {
+    // Page 0 (real mode IVT) and the kernel image are never handed out
     uint64_t kernel_start = KERNEL_PHYSICAL_START;
     uint64_t kernel_size = kernel_end - kernel_start;
     size_t kernel_pages = BYTES_TO_PAGES(kernel_size);
+    memblock_reserve(0, PAGE_SIZE);
+    memblock_reserve(kernel_start, kernel_pages * PAGE_SIZE);
 
-    for (size_t i = 0; i < kernel_pages; i++) {
-        pmm_mark_used(kernel_start + i * PAGE_SIZE);
+    // Cover RAM up to its highest usable address
+    total_memory = PAGE_ALIGN_DOWN(memblock_end_of_ram());
+    if (total_memory > MAX_MEMORY_SIZE) {
+        total_memory = MAX_MEMORY_SIZE;
+    }
+    total_pages = total_memory / PAGE_SIZE;
+
+    // Bitmap and page array in one block, wherever memblock has room
+    size_t bitmap_size = (((size_t)total_pages + 63) / 64) * 8;
+    size_t metadata_size = bitmap_size + (size_t)total_pages * sizeof(page_t);
+    uint8_t *metadata = memblock_alloc(metadata_size, PAGE_SIZE);
+    if (metadata == NULL) {
+        vga_printf("ERROR: PMM: No room for %u KB of page metadata\n",
+                   (uint32_t)(metadata_size / 1024));
+        total_pages = 0;
+        total_memory = 0;
+        return;
     }
+    page_bitmap = metadata;
+    page_array = (page_t *)(metadata + bitmap_size);
 
-    // Mark bitmap itself as used
-    uint64_t bitmap_addr = (uint64_t)page_bitmap;
-    size_t bitmap_pages = BYTES_TO_PAGES(BITMAP_SIZE);
+    // Everything starts out used and reserved (holes stay that way)
+    memset(page_bitmap, 0xFF, bitmap_size);
+    for (uint32_t i = 0; i < total_pages; i++) {
+        page_array[i].owner = PAGE_OWNER_RESERVED;
+    }
+    memset(owner_pages, 0, sizeof(owner_pages));
+    owner_pages[PAGE_OWNER_RESERVED] = total_pages;
+    used_pages = total_pages;
+    search_start = 0;
+
+    // Free whole pages of usable RAM...
+    const memblock_type_t *memory = memblock_memory();
+    for (uint32_t r = 0; r < memory->count; r++) {
+        uint64_t first = PAGE_ALIGN(memory->regions[r].base) / PAGE_SIZE;
+        uint64_t end = PAGE_ALIGN_DOWN(memory->regions[r].base + memory->regions[r].size) / PAGE_SIZE;
+        for (uint64_t page = first; page < end && page < total_pages; page++) {
+            pmm_release_page((uint32_t)page);
+        }
+    }
 
-    for (size_t i = 0; i < bitmap_pages; i++) {
-        pmm_mark_used(bitmap_addr + i * PAGE_SIZE);
+    // ...except what memblock handed out or reserved (including the metadata)
+    const memblock_type_t *reserved = memblock_reserved();
+    for (uint32_t r = 0; r < reserved->count; r++) {
+        uint64_t base = PAGE_ALIGN_DOWN(reserved->regions[r].base);
+        uint64_t end = PAGE_ALIGN(reserved->regions[r].base + reserved->regions[r].size);
+        pmm_mark_used_range(base, (end - base) / PAGE_SIZE);
     }
 
-    vga_printf("  PMM: Managing %u MB (%u pages)\n",
-               (uint32_t)(total_memory / (1024 * 1024)), total_pages);
+    // Keep about 1% of memory free in the background (at least 256KB)
+    uint32_t min_free = total_pages / 256;
+    if (min_free < 32) min_free = 32;
+    low_watermark = min_free * 2;
+    high_watermark = min_free * 3;
+
+    vga_printf("  PMM: Managing %u MB (%u pages), %u MB usable\n",
+               (uint32_t)(total_memory / (1024 * 1024)), total_pages,
+               (uint32_t)(memblock_phys_mem_size() / (1024 * 1024)));
     vga_printf("  PMM: Kernel occupies %u KB (%u pages)\n",
                (uint32_t)(kernel_size / 1024), (uint32_t)kernel_pages);
+    vga_printf("  PMM: Page metadata %u KB at 0x%x\n",
+               (uint32_t)(metadata_size / 1024), vmm_virt_to_phys((uint64_t)metadata));
     vga_printf("  PMM: %u pages used, %u pages free\n",
                used_pages, total_pages - used_pages);
 }
@@ -129,14 +240,17 @@ void pmm_init(uint64_t mem_size, uint64_t kernel_end) {
  * Allocate a single physical page
  */
 uint64_t pmm_alloc_page(void) {
-    uint32_t page = find_free_page();
+    uint32_t page = find_free_pages_reclaim(1);
     if (page == (uint32_t)-1) {
         return 0;  // Out of memory
     }
 
     bitmap_set(page);
     used_pages++;
+    page_set_owner(page, PAGE_OWNER_KERNEL, 0);
+    check_watermark();
 
+    trace_pmm_alloc_page(page * PAGE_SIZE);
     return page * PAGE_SIZE;
 }
 
@@ -146,7 +260,7 @@ uint64_t pmm_alloc_page(void) {
 uint64_t pmm_alloc_pages(size_t count) {
     if (count == 0) return 0;
 
-    uint32_t page = find_free_pages(count);
+    uint32_t page = find_free_pages_reclaim(count);
     if (page == (uint32_t)-1) {
         return 0;  // Out of memory
     }
@@ -154,8 +268,10 @@ uint64_t pmm_alloc_pages(size_t count) {
     // Mark all pages as used
     for (size_t i = 0; i < count; i++) {
         bitmap_set(page + i);
+        page_set_owner(page + i, PAGE_OWNER_KERNEL, 0);
     }
     used_pages += count;
+    check_watermark();
 
     return page * PAGE_SIZE;
 }
@@ -177,6 +293,10 @@ void pmm_free_page(uint64_t addr) {
 
     bitmap_clear(page);
     used_pages--;
+    page_set_owner(page, PAGE_OWNER_FREE, 0);
+    if (page < search_start) {
+        search_start = page;
+    }
 }
 
 /**
@@ -198,6 +318,7 @@ void pmm_mark_used(uint64_t addr) {
     if (!bitmap_test(page)) {
         bitmap_set(page);
         used_pages++;
+        page_set_owner(page, PAGE_OWNER_RESERVED, 0);
     }
 }
 
@@ -245,6 +366,20 @@ uint64_t pmm_get_free_memory(void) {
     return (total_pages - used_pages) * PAGE_SIZE;
 }
 
+/**
+ * Get the free page count below which kswapd is woken
+ */
+uint32_t pmm_get_low_watermark(void) {
+    return low_watermark;
+}
+
+/**
+ * Get the free page count kswapd reclaims up to
+ */
+uint32_t pmm_get_high_watermark(void) {
+    return high_watermark;
+}
+
 /**
  * Check if a physical page is free
  */
@@ -253,3 +388,58 @@ bool pmm_is_free(uint64_t addr) {
     if (page >= total_pages) return false;
     return !bitmap_test(page);
 }
+
+/**
+ * Get the metadata of a physical page
+ */
+page_t *pmm_get_page(uint64_t addr) {
+    uint32_t page = addr / PAGE_SIZE;
+    if (page >= total_pages) return NULL;
+    return &page_array[page];
+}
+
+/**
+ * Retag allocated pages
+ */
+void pmm_set_owner(uint64_t addr, size_t count, page_owner_t owner, uint32_t pid) {
+    uint32_t first = addr / PAGE_SIZE;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t page = first + i;
+        if (page >= total_pages || !bitmap_test(page)) {
+            continue;
+        }
+        page_set_owner(page, owner, pid);
+    }
+}
+
+/**
+ * Get number of pages with a given owner
+ */
+uint32_t pmm_get_owner_pages(page_owner_t owner) {
+    if (owner >= PAGE_OWNER_COUNT) return 0;
+    return owner_pages[owner];
+}
+
+/**
+ * Get the name of an owner
+ */
+const char *pmm_owner_name(page_owner_t owner) {
+    if (owner >= PAGE_OWNER_COUNT) return "?";
+    return owner_names[owner];
+}
+
+/**
+ * Print physical memory use broken down by owner
+ */
+void pmm_dump_usage(void) {
+    vga_printf("  PMM: %u / %u pages used\n", used_pages, total_pages);
+
+    for (uint32_t owner = PAGE_OWNER_RESERVED; owner < PAGE_OWNER_COUNT; owner++) {
+        if (owner_pages[owner] == 0) {
+            continue;
+        }
+        vga_printf("    %s: %u pages (%u KB)\n", owner_names[owner], owner_pages[owner],
+                   owner_pages[owner] * (PAGE_SIZE / 1024));
+    }
+}
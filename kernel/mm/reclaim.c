@@ -0,0 +1,293 @@
+/**
+ * Memory Reclaim: shrinkers, kswapd and the OOM killer
+ *
+ * kswapd sleeps until an allocation leaves fewer free pages than the
+ * low watermark, then asks every shrinker in turn for pages until the
+ * high watermark is reached or a full pass frees nothing. Allocations
+ * therefore rarely see an empty PMM; when one does, reclaim_direct()
+ * runs the same shrinkers synchronously and falls back to killing the
+ * process with the largest resident set.
+ */
+
+#include <kernel/reclaim.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/waitqueue.h>
+#include <kernel/workqueue.h>
+#include <kernel/memory.h>
+#include <kernel/idt.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+extern process_t **_process_get_table(void);
+extern uint32_t _process_get_max(void);
+
+// Exit code of a process killed for memory (as if by SIGKILL)
+#define OOM_EXIT_CODE -9
+
+static shrinker_t *shrinkers[MAX_SHRINKERS];
+static uint32_t shrinker_count = 0;
+
+// kswapd thread and its wakeup
+static process_t *kswapd_task = NULL;
+static wait_queue_t kswapd_wait;
+static volatile bool kswapd_pending = false;
+
+// Frees the table slots of OOM victims
+static work_t oom_reap_work;
+
+// Set while direct reclaim runs, so nested allocations fail instead of recursing
+static bool direct_reclaim_active = false;
+
+/**
+ * Reclaim statistics
+ */
+static struct {
+    uint64_t kswapd_wakeups;
+    uint64_t kswapd_pages;
+    uint64_t direct_reclaims;
+    uint64_t direct_pages;
+    uint64_t oom_kills;
+    uint64_t oom_pages;
+} stats;
+
+/**
+ * Register a cache shrinker
+ */
+int shrinker_register(shrinker_t *shrinker) {
+    uint64_t flags = interrupts_save();
+
+    if (shrinker_count >= MAX_SHRINKERS) {
+        interrupts_restore(flags);
+        return -1;
+    }
+    shrinkers[shrinker_count++] = shrinker;
+
+    interrupts_restore(flags);
+    return 0;
+}
+
+/**
+ * Unregister a cache shrinker
+ */
+void shrinker_unregister(shrinker_t *shrinker) {
+    uint64_t flags = interrupts_save();
+
+    for (uint32_t i = 0; i < shrinker_count; i++) {
+        if (shrinkers[i] == shrinker) {
+            shrinkers[i] = shrinkers[--shrinker_count];
+            break;
+        }
+    }
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Run the shrinkers until nr_pages pages are freed or none frees more
+ *
+ * Each pass asks every cache for its share of what is still wanted,
+ * weighted by how much it could free, so one large cache does not get
+ * emptied while small ones are left untouched.
+ */
+size_t shrink_caches(size_t nr_pages) {
+    size_t freed = 0;
+
+    while (freed < nr_pages) {
+        size_t pass = 0;
+        uint64_t flags = interrupts_save();
+
+        size_t total = 0;
+        for (uint32_t i = 0; i < shrinker_count; i++) {
+            total += shrinkers[i]->count(shrinkers[i]);
+        }
+
+        for (uint32_t i = 0; i < shrinker_count && total > 0 && freed + pass < nr_pages; i++) {
+            size_t freeable = shrinkers[i]->count(shrinkers[i]);
+            if (freeable == 0) {
+                continue;
+            }
+
+            size_t want = (nr_pages - freed) * freeable / total;
+            if (want == 0) {
+                want = 1;
+            }
+            pass += shrinkers[i]->scan(shrinkers[i], want);
+        }
+
+        interrupts_restore(flags);
+
+        if (pass == 0) {
+            break;
+        }
+        freed += pass;
+    }
+
+    return freed;
+}
+
+/**
+ * Pick the process to kill: the largest user address space
+ *
+ * Size counts swapped-out pages too, but a process with nothing left in
+ * RAM would free nothing. Kernel tasks (no user pages) and the process
+ * asking for memory are never chosen.
+ */
+static process_t *oom_select_victim(void) {
+    process_t **table = _process_get_table();
+    process_t *current = process_get_current();
+    process_t *victim = NULL;
+    uint64_t victim_pages = 0;
+
+    for (uint32_t i = 0; i < _process_get_max(); i++) {
+        process_t *proc = table[i];
+        if (!proc || proc == current || proc->rss_pages == 0 ||
+            proc->state == PROCESS_STATE_ZOMBIE || proc->state == PROCESS_STATE_DEAD) {
+            continue;
+        }
+
+        uint64_t pages = proc->rss_pages + proc->swap_pages + proc->pagetable_pages;
+        if (pages > victim_pages) {
+            victim = proc;
+            victim_pages = pages;
+        }
+    }
+
+    return victim;
+}
+
+/**
+ * Reap OOM victims once the allocation that killed them is over
+ */
+static void oom_reap(work_t *work) {
+    (void)work;
+    process_reap_zombies();
+}
+
+/**
+ * Kill the OOM victim and free its memory
+ *
+ * process_terminate() takes the victim off every queue and frees its
+ * user pages, page tables and kernel stack on the spot. Closing its
+ * files and freeing its slot use the heap, which may be what is
+ * allocating right now, so that is left to a work item.
+ */
+static size_t oom_kill(void) {
+    process_t *victim = oom_select_victim();
+    if (!victim) {
+        return 0;
+    }
+
+    uint32_t free_before = pmm_get_free_pages();
+    process_terminate(victim, OOM_EXIT_CODE);
+    schedule_work(&oom_reap_work);
+
+    size_t freed = pmm_get_free_pages() - free_before;
+    stats.oom_kills++;
+    stats.oom_pages += freed;
+
+    vga_printf("OOM: Killed PID %u (%s), freed %u KB\n",
+               victim->pid, victim->name, (uint32_t)(freed * (PAGE_SIZE / 1024)));
+    return freed;
+}
+
+/**
+ * Free memory for an allocation that found none
+ */
+size_t reclaim_direct(size_t count) {
+    uint64_t flags = interrupts_save();
+
+    if (direct_reclaim_active) {
+        interrupts_restore(flags);
+        return 0;
+    }
+    direct_reclaim_active = true;
+
+    // Aim for the high watermark so the next allocations do not land here too
+    size_t freed = shrink_caches(count + pmm_get_high_watermark());
+
+    // Caches gave back too little: only a kill can help
+    if (pmm_get_free_pages() < count) {
+        freed += oom_kill();
+    }
+
+    stats.direct_reclaims++;
+    stats.direct_pages += freed;
+
+    direct_reclaim_active = false;
+    interrupts_restore(flags);
+    return freed;
+}
+
+/**
+ * Wake kswapd
+ */
+void reclaim_wake_kswapd(void) {
+    if (!kswapd_task || kswapd_pending) {
+        return;
+    }
+
+    kswapd_pending = true;
+    wait_queue_wake_one(&kswapd_wait);
+}
+
+/**
+ * kswapd: reclaim in the background up to the high watermark
+ */
+static void kswapd(void) {
+    while (1) {
+        uint64_t flags = interrupts_save();
+        while (!kswapd_pending) {
+            wait_queue_sleep(&kswapd_wait);
+        }
+
+        // Clear before sampling: a request made during the pass sets it
+        // again and gets another pass instead of being lost
+        kswapd_pending = false;
+        interrupts_restore(flags);
+
+        stats.kswapd_wakeups++;
+
+        uint32_t free_pages = pmm_get_free_pages();
+        uint32_t high = pmm_get_high_watermark();
+        if (free_pages < high) {
+            stats.kswapd_pages += shrink_caches(high - free_pages);
+        }
+    }
+}
+
+/**
+ * Start kswapd
+ */
+int reclaim_init(void) {
+    wait_queue_init(&kswapd_wait);
+    work_init(&oom_reap_work, oom_reap);
+
+    process_t *task = process_create_kernel_task(kswapd, "kswapd", KSWAPD_PRIORITY);
+    if (!task) {
+        return -1;
+    }
+    scheduler_add_process(task);
+    kswapd_task = task;
+
+    vga_printf("  Reclaim: %u shrinkers, watermarks low %u / high %u pages\n",
+               shrinker_count, pmm_get_low_watermark(), pmm_get_high_watermark());
+    return 0;
+}
+
+/**
+ * Print reclaim statistics
+ */
+void reclaim_print_stats(void) {
+    vga_printf("\nReclaim Statistics:\n");
+    vga_printf("  kswapd: %u wakeups, %u pages\n",
+               (uint32_t)stats.kswapd_wakeups, (uint32_t)stats.kswapd_pages);
+    vga_printf("  Direct: %u reclaims, %u pages\n",
+               (uint32_t)stats.direct_reclaims, (uint32_t)stats.direct_pages);
+    vga_printf("  OOM:    %u kills, %u pages\n",
+               (uint32_t)stats.oom_kills, (uint32_t)stats.oom_pages);
+}
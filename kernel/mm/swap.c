@@ -0,0 +1,457 @@
+/**
+ * Swap Implementation
+ *
+ * One swap area, one byte of state per slot. Swap-out is a shrinker:
+ * kswapd and direct reclaim ask it for pages like any cache, and it
+ * runs a clock hand over the processes' page tables. A page with
+ * PAGE_ACCESSED set has its bit cleared and is passed over; a page
+ * still clear when the hand comes round again is cold. Cold pages that
+ * follow it in the same page table go with it, up to SWAP_CLUSTER
+ * pages in consecutive slots, so the cluster is one write and comes
+ * back as one read.
+ *
+ * Slots are released as soon as a page is read back; there is no swap
+ * cache, so a page swapped out twice is written twice.
+ */
+
+#include <kernel/swap.h>
+#include <kernel/reclaim.h>
+#include <kernel/process.h>
+#include <kernel/block.h>
+#include <kernel/multiboot.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/heap.h>
+#include <kernel/memory.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+extern process_t **_process_get_table(void);
+extern uint32_t _process_get_max(void);
+
+#define PTE_ADDR_MASK 0x000FFFFFFFFFF000ULL
+
+/**
+ * Swap area
+ */
+typedef struct swap_area {
+    block_device_t *dev;
+    uint8_t *map;               // Per slot: 0 free, 1 in use (slot 0 is the header)
+    uint32_t nr_slots;
+    uint32_t free_slots;
+    uint32_t next;              // Where the next slot search starts
+    uint8_t *buffer;            // SWAP_CLUSTER pages for clustered I/O
+} swap_area_t;
+
+static swap_area_t swap_area;
+
+// Clock hand: process table index and the address within it
+static uint32_t hand_index = 0;
+static uint64_t hand_virt = 0;
+
+/**
+ * Swap statistics
+ */
+static struct {
+    uint64_t pages_out;
+    uint64_t writes;
+    uint64_t pages_in;
+    uint64_t reads;
+    uint64_t readahead;         // Pages read in without being faulted on
+    uint64_t errors;
+} stats;
+
+/**
+ * Allocate a run of consecutive free slots
+ *
+ * Next-fit from where the last run ended. Tries count slots, then
+ * fewer, down to one.
+ *
+ * @param count In: slots wanted; out: slots allocated
+ * @return First slot, or 0 if the area is full
+ */
+static uint32_t slots_alloc(uint32_t *count) {
+    swap_area_t *area = &swap_area;
+
+    for (uint32_t want = *count; want > 0; want /= 2) {
+        if (area->free_slots < want) {
+            continue;
+        }
+
+        uint32_t run = 0;
+        uint32_t slot = area->next;
+        for (uint32_t scanned = 0; scanned < area->nr_slots; scanned++, slot++) {
+            if (slot >= area->nr_slots) {
+                slot = 1;
+                run = 0;
+            }
+
+            run = area->map[slot] ? 0 : run + 1;
+            if (run == want) {
+                uint32_t first = slot + 1 - want;
+                memset(&area->map[first], 1, want);
+                area->free_slots -= want;
+                area->next = slot + 1 < area->nr_slots ? slot + 1 : 1;
+                *count = want;
+                return first;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Release slots
+ */
+static void slots_free(uint32_t first, uint32_t count) {
+    for (uint32_t slot = first; slot < first + count && slot < swap_area.nr_slots; slot++) {
+        if (slot > 0 && swap_area.map[slot]) {
+            swap_area.map[slot] = 0;
+            swap_area.free_slots++;
+        }
+    }
+}
+
+/**
+ * Check whether a process has pages the clock may take
+ */
+static bool swappable(process_t *proc) {
+    return proc && proc->rss_pages > 0 && proc->page_directory &&
+           proc->state != PROCESS_STATE_ZOMBIE && proc->state != PROCESS_STATE_DEAD;
+}
+
+/**
+ * Drop a stale TLB entry if the process's address space is loaded
+ */
+static void flush_user_page(process_t *proc, uint64_t virt) {
+    if ((uint64_t)proc->page_directory == vmm_get_current_page_directory()) {
+        vmm_invlpg(virt);
+    }
+}
+
+/**
+ * Write out consecutive present pages of one page table
+ *
+ * @param proc Owning process
+ * @param virt Address of the first page
+ * @param ptes Their entries (consecutive in the page table)
+ * @param count Number of pages (at most SWAP_CLUSTER)
+ * @return Pages swapped out
+ */
+static size_t swap_out_cluster(process_t *proc, uint64_t virt, pte_t *ptes, uint32_t count) {
+    uint32_t slot = slots_alloc(&count);
+    if (slot == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(swap_area.buffer + i * PAGE_SIZE,
+               (void *)vmm_phys_to_virt(ptes[i] & PTE_ADDR_MASK), PAGE_SIZE);
+    }
+
+    if (block_write(swap_area.dev, (uint64_t)slot * PAGE_SIZE,
+                    (uint64_t)count * PAGE_SIZE, swap_area.buffer) < 0) {
+        slots_free(slot, count);
+        stats.errors++;
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t phys = ptes[i] & PTE_ADDR_MASK;
+        ptes[i] = swap_pte(slot + i, ptes[i]);
+        flush_user_page(proc, virt + i * PAGE_SIZE);
+        pmm_free_page(phys);
+    }
+
+    proc->rss_pages -= count;
+    proc->swap_pages += count;
+    stats.pages_out += count;
+    stats.writes++;
+    return count;
+}
+
+/**
+ * Count user pages the clock could swap out
+ */
+static size_t swappable_pages(void) {
+    process_t **table = _process_get_table();
+    size_t pages = 0;
+
+    for (uint32_t i = 0; i < _process_get_max(); i++) {
+        if (swappable(table[i])) {
+            pages += table[i]->rss_pages;
+        }
+    }
+    return pages;
+}
+
+/**
+ * Shrinker: user pages there is swap space for
+ */
+static size_t swap_shrink_count(shrinker_t *shrinker) {
+    (void)shrinker;
+
+    if (!swap_area.dev || swap_area.free_slots == 0) {
+        return 0;
+    }
+
+    size_t pages = swappable_pages();
+    return pages < swap_area.free_slots ? pages : swap_area.free_slots;
+}
+
+/**
+ * Shrinker: advance the clock, swapping out cold pages
+ *
+ * Gives up after two laps' worth of pages (one to clear access bits,
+ * one to find pages that stayed unused) or when the area is full.
+ * Shrinkers run with interrupts disabled, so a scan stops after one
+ * cluster write; shrink_caches() lets interrupts in between passes and
+ * calls again if it still needs pages.
+ */
+static size_t swap_shrink_scan(shrinker_t *shrinker, size_t nr_pages) {
+    process_t **table = _process_get_table();
+    uint32_t max = _process_get_max();
+    size_t budget = 2 * swappable_pages() + SWAP_CLUSTER;
+    size_t scanned = 0;
+    size_t freed = 0;
+    uint32_t moves = 0;
+
+    (void)shrinker;
+
+    while (freed < nr_pages && scanned < budget && moves <= 2 * max) {
+        process_t *proc = table[hand_index];
+        pte_t *pte = swappable(proc) ? vmm_next_user_pte(proc, &hand_virt) : NULL;
+        if (!pte) {
+            hand_index = (hand_index + 1) % max;
+            hand_virt = 0;
+            moves++;
+            continue;
+        }
+
+        scanned++;
+        if (*pte & PAGE_ACCESSED) {
+            *pte &= ~PAGE_ACCESSED;
+            flush_user_page(proc, hand_virt);
+            hand_virt += PAGE_SIZE;
+            continue;
+        }
+
+        // Cold: take the cold pages right after it in the same table along
+        uint32_t count = 1;
+        uint32_t room = 512 - PT_INDEX(hand_virt);
+        while (count < SWAP_CLUSTER && count < room &&
+               (pte[count] & (PAGE_PRESENT | PAGE_USER | PAGE_ACCESSED)) == (PAGE_PRESENT | PAGE_USER)) {
+            count++;
+        }
+
+        size_t written = swap_out_cluster(proc, hand_virt, pte, count);
+        if (written == 0) {
+            break;
+        }
+        freed += written;
+        hand_virt += written * PAGE_SIZE;
+        break;      // At most one write per scan
+    }
+
+    return freed;
+}
+
+static shrinker_t swap_shrinker = {
+    .name = "swap",
+    .count = swap_shrink_count,
+    .scan = swap_shrink_scan,
+    .private_data = NULL,
+};
+
+/**
+ * Read a swapped-out page (and its swapped neighbours) back in
+ *
+ * The readahead window is the run of swap entries around the fault
+ * whose slots are consecutive in step with their addresses: usually the
+ * cluster the page was written out with.
+ */
+int swap_in(process_t *proc, uint64_t virt) {
+    uint64_t phys[SWAP_CLUSTER];
+
+    if (!swap_area.dev) {
+        return -1;
+    }
+
+    pte_t *pte = vmm_get_user_pte(proc, virt);
+    if (!pte || !pte_is_swap(*pte)) {
+        return -1;
+    }
+
+    uint32_t index = PT_INDEX(virt);
+    pte_t *pt = pte - index;
+    uint32_t slot = swap_pte_slot(*pte);
+
+    // Forward first: pages after a fault are the likelier next ones
+    uint32_t hi = index;
+    while (hi < 511 && hi - index < SWAP_CLUSTER - 1 && pte_is_swap(pt[hi + 1]) &&
+           swap_pte_slot(pt[hi + 1]) == slot + (hi + 1 - index)) {
+        hi++;
+    }
+    uint32_t lo = index;
+    while (lo > 0 && hi - lo < SWAP_CLUSTER - 1 && pte_is_swap(pt[lo - 1]) &&
+           swap_pte_slot(pt[lo - 1]) == slot - (index - lo + 1)) {
+        lo--;
+    }
+
+    // The faulting page must come in; readahead is dropped if memory is short
+    phys[index - lo] = pmm_alloc_page();
+    if (phys[index - lo] == 0) {
+        vga_printf("ERROR: Swap: no memory to read back page 0x%x of PID %u\n", virt, proc->pid);
+        return -1;
+    }
+    for (uint32_t i = lo; i <= hi; i++) {
+        if (i != index && (phys[i - lo] = pmm_alloc_page()) == 0) {
+            for (uint32_t j = lo; j < i; j++) {
+                if (j != index) {
+                    pmm_free_page(phys[j - lo]);
+                }
+            }
+            phys[0] = phys[index - lo];
+            lo = hi = index;
+            break;
+        }
+    }
+
+    uint32_t count = hi - lo + 1;
+    uint32_t first_slot = slot - (index - lo);
+    if (block_read(swap_area.dev, (uint64_t)first_slot * PAGE_SIZE,
+                   (uint64_t)count * PAGE_SIZE, swap_area.buffer) < 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            pmm_free_page(phys[i]);
+        }
+        stats.errors++;
+        vga_printf("ERROR: Swap: read of slot %u failed\n", first_slot);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        pte_t *entry = &pt[lo + i];
+        memcpy((void *)vmm_phys_to_virt(phys[i]), swap_area.buffer + i * PAGE_SIZE, PAGE_SIZE);
+        pmm_set_owner(phys[i], 1, PAGE_OWNER_USER, proc->pid);
+        *entry = phys[i] | PAGE_PRESENT | (*entry & (PAGE_WRITE | PAGE_USER));
+        flush_user_page(proc, PAGE_ALIGN_DOWN(virt) + ((int64_t)(lo + i) - (int64_t)index) * PAGE_SIZE);
+    }
+    slots_free(first_slot, count);
+
+    proc->rss_pages += count;
+    proc->swap_pages -= count;
+    stats.pages_in += count;
+    stats.readahead += count - 1;
+    stats.reads++;
+    return 0;
+}
+
+/**
+ * Release the swap slot of a swap entry
+ */
+void swap_free_entry(pte_t pte) {
+    if (pte_is_swap(pte)) {
+        slots_free(swap_pte_slot(pte), 1);
+    }
+}
+
+/**
+ * Start swapping to a block device
+ */
+int swap_on(const char *name) {
+    swap_area_t *area = &swap_area;
+
+    if (area->dev) {
+        return -1;
+    }
+
+    block_device_t *dev = block_get_device(name);
+    if (!dev || dev->size / PAGE_SIZE < 1 + SWAP_CLUSTER) {
+        return -1;
+    }
+
+    uint64_t buffer_phys = pmm_alloc_pages(SWAP_CLUSTER);
+    if (buffer_phys == 0) {
+        return -1;
+    }
+    uint8_t *buffer = (uint8_t *)vmm_phys_to_virt(buffer_phys);
+
+    // Only a prepared area is used, never a disk that happens to be attached
+    size_t sig_len = sizeof(SWAP_SIGNATURE) - 1;
+    if (block_read(dev, 0, PAGE_SIZE, buffer) < 0 ||
+        memcmp(buffer + PAGE_SIZE - sig_len, SWAP_SIGNATURE, sig_len) != 0) {
+        pmm_free_pages(buffer_phys, SWAP_CLUSTER);
+        return -1;
+    }
+
+    uint64_t nr_slots = dev->size / PAGE_SIZE;
+    if (nr_slots > UINT32_MAX) {
+        nr_slots = UINT32_MAX;
+    }
+
+    uint8_t *map = (uint8_t *)kzalloc(nr_slots);
+    if (!map) {
+        pmm_free_pages(buffer_phys, SWAP_CLUSTER);
+        return -1;
+    }
+    map[0] = 1;                 // Header
+
+    area->map = map;
+    area->nr_slots = (uint32_t)nr_slots;
+    area->free_slots = (uint32_t)nr_slots - 1;
+    area->next = 1;
+    area->buffer = buffer;
+    area->dev = dev;
+
+    if (shrinker_register(&swap_shrinker) != 0) {
+        area->dev = NULL;
+        kfree(map);
+        pmm_free_pages(buffer_phys, SWAP_CLUSTER);
+        return -1;
+    }
+
+    vga_printf("  Swap: %s, %u MB (%u slots), clusters of %u pages\n",
+               dev->name, (uint32_t)(nr_slots * PAGE_SIZE / (1024 * 1024)),
+               area->free_slots, (uint32_t)SWAP_CLUSTER);
+    return 0;
+}
+
+/**
+ * Enable swap on the device named by "swap=" on the command line
+ */
+int swap_init(void) {
+    char name[32];
+
+    if (!multiboot_cmdline_option("swap", name, sizeof(name)) || name[0] == '\0') {
+        return 0;
+    }
+
+    if (swap_on(name) != 0) {
+        vga_printf("  Swap: Cannot use '%s' (missing, too small or no %s signature)\n",
+                   name, SWAP_SIGNATURE);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Print swap usage and I/O statistics
+ */
+void swap_print_stats(void) {
+    if (!swap_area.dev) {
+        return;
+    }
+
+    uint32_t used = swap_area.nr_slots - 1 - swap_area.free_slots;
+    vga_printf("\nSwap Statistics (%s):\n", swap_area.dev->name);
+    vga_printf("  Used:     %u / %u pages\n", used, swap_area.nr_slots - 1);
+    vga_printf("  Out:      %u pages in %u writes\n",
+               (uint32_t)stats.pages_out, (uint32_t)stats.writes);
+    vga_printf("  In:       %u pages in %u reads (%u read ahead)\n",
+               (uint32_t)stats.pages_in, (uint32_t)stats.reads, (uint32_t)stats.readahead);
+    vga_printf("  Errors:   %u\n", (uint32_t)stats.errors);
+}
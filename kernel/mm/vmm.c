@@ -12,26 +12,48 @@
  */
 
 #include <kernel/vmm.h>
+#include <kernel/printk.h>
 #include <kernel/pmm.h>
+#include <kernel/process.h>
 #include <kernel/memory.h>
+#include <kernel/msr.h>
 #include <kernel/string.h>
+#include <kernel/swap.h>
+#include <kernel/trace.h>
 #include <kernel/vga.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
+// CPUID.1:EDX page attribute table support
+#define CPUID_EDX_PAT (1 << 16)
+
+// PAT entry repurposed for write-combining (selected by PAT | PWT)
+#define VMM_PAT_WC_INDEX 5
+
 // Current page directory (kernel)
 static uint64_t *current_pml4 = NULL;
 
+// Boot page directory, whose entries every address space shares
+static uint64_t *kernel_pml4 = NULL;
+
+// End of the lower half, where user address spaces live
+#define USER_SPACE_END 0x0000800000000000ULL
+
+// Cache flags selecting write-combining (0 until the PAT is programmed)
+static uint64_t wc_flags = 0;
+
 /**
  * Get or create page table at given index
  *
  * @param table Parent table
  * @param index Index in parent table
  * @param flags Flags to set if creating new table
+ * @param owner Process charged for a new table, or NULL for the kernel
  * @return Physical address of page table, or 0 on failure
  */
-static uint64_t get_or_create_table(uint64_t *table, uint32_t index, uint64_t flags) {
+static uint64_t get_or_create_table(uint64_t *table, uint32_t index, uint64_t flags,
+                                    process_t *owner) {
     pte_t entry = table[index];
 
     if (entry & PAGE_PRESENT) {
@@ -49,6 +71,11 @@ static uint64_t get_or_create_table(uint64_t *table, uint32_t index, uint64_t fl
     uint64_t virt = vmm_phys_to_virt(phys);
     memset((void *)virt, 0, PAGE_SIZE);
 
+    pmm_set_owner(phys, 1, PAGE_OWNER_PAGETABLE, owner ? owner->pid : 0);
+    if (owner) {
+        owner->pagetable_pages++;
+    }
+
     // Set entry in parent table
     table[index] = phys | flags;
 
@@ -65,6 +92,7 @@ void vmm_init(void) {
 
     // Convert to virtual address for kernel access
     current_pml4 = (uint64_t *)vmm_phys_to_virt(cr3);
+    kernel_pml4 = current_pml4;
 
     vga_printf("  VMM: Current PML4 at 0x%x (phys: 0x%x)\n",
                (uint64_t)current_pml4, cr3);
@@ -104,6 +132,8 @@ int vmm_map_page(uint64_t virt, uint64_t phys, uint64_t flags) {
     virt = PAGE_ALIGN_DOWN(virt);
     phys = PAGE_ALIGN_DOWN(phys);
 
+    trace_vmm_map_page(virt, phys, flags);
+
     // Extract indices
     uint32_t pml4_idx = PML4_INDEX(virt);
     uint32_t pdpt_idx = PDPT_INDEX(virt);
@@ -115,17 +145,17 @@ int vmm_map_page(uint64_t virt, uint64_t phys, uint64_t flags) {
     uint64_t table_flags = (flags & PAGE_USER) ? PAGE_FLAGS_USER : PAGE_FLAGS_KERNEL;
 
     // Get or create PDPT
-    uint64_t pdpt_phys = get_or_create_table(current_pml4, pml4_idx, table_flags);
+    uint64_t pdpt_phys = get_or_create_table(current_pml4, pml4_idx, table_flags, NULL);
     if (pdpt_phys == 0) return -1;
     uint64_t *pdpt = (uint64_t *)vmm_phys_to_virt(pdpt_phys);
 
     // Get or create PD
-    uint64_t pd_phys = get_or_create_table(pdpt, pdpt_idx, table_flags);
+    uint64_t pd_phys = get_or_create_table(pdpt, pdpt_idx, table_flags, NULL);
     if (pd_phys == 0) return -1;
     uint64_t *pd = (uint64_t *)vmm_phys_to_virt(pd_phys);
 
     // Get or create PT
-    uint64_t pt_phys = get_or_create_table(pd, pd_idx, table_flags);
+    uint64_t pt_phys = get_or_create_table(pd, pd_idx, table_flags, NULL);
     if (pt_phys == 0) return -1;
     uint64_t *pt = (uint64_t *)vmm_phys_to_virt(pt_phys);
 
@@ -185,6 +215,187 @@ int vmm_map_pages(uint64_t virt, uint64_t phys, size_t count, uint64_t flags) {
     return 0;
 }
 
+/**
+ * Map a page into a process's address space
+ */
+int vmm_map_user_page(process_t *proc, uint64_t virt, uint64_t phys, uint64_t flags) {
+    virt = PAGE_ALIGN_DOWN(virt);
+    phys = PAGE_ALIGN_DOWN(phys);
+
+    uint64_t *pml4 = (uint64_t *)vmm_phys_to_virt((uint64_t)proc->page_directory);
+    uint64_t table_flags = (flags & PAGE_USER) ? PAGE_FLAGS_USER : PAGE_FLAGS_KERNEL;
+
+    uint64_t pdpt_phys = get_or_create_table(pml4, PML4_INDEX(virt), table_flags, proc);
+    if (pdpt_phys == 0) return -1;
+    uint64_t *pdpt = (uint64_t *)vmm_phys_to_virt(pdpt_phys);
+
+    uint64_t pd_phys = get_or_create_table(pdpt, PDPT_INDEX(virt), table_flags, proc);
+    if (pd_phys == 0) return -1;
+    uint64_t *pd = (uint64_t *)vmm_phys_to_virt(pd_phys);
+
+    uint64_t pt_phys = get_or_create_table(pd, PD_INDEX(virt), table_flags, proc);
+    if (pt_phys == 0) return -1;
+    uint64_t *pt = (uint64_t *)vmm_phys_to_virt(pt_phys);
+
+    if (!(pt[PT_INDEX(virt)] & PAGE_PRESENT)) {
+        proc->rss_pages++;
+    }
+    pt[PT_INDEX(virt)] = phys | flags | PAGE_PRESENT;
+    pmm_set_owner(phys, 1, PAGE_OWNER_USER, proc->pid);
+
+    if (current_pml4 == pml4) {
+        vmm_invlpg(virt);
+    }
+    return 0;
+}
+
+/**
+ * Unmap a page from a process's address space
+ */
+uint64_t vmm_unmap_user_page(process_t *proc, uint64_t virt) {
+    virt = PAGE_ALIGN_DOWN(virt);
+
+    uint64_t *table = (uint64_t *)vmm_phys_to_virt((uint64_t)proc->page_directory);
+    uint32_t indices[3] = { PML4_INDEX(virt), PDPT_INDEX(virt), PD_INDEX(virt) };
+
+    for (int level = 0; level < 3; level++) {
+        pte_t entry = table[indices[level]];
+        if (!(entry & PAGE_PRESENT)) return 0;
+        table = (uint64_t *)vmm_phys_to_virt(entry & ~0xFFF);
+    }
+
+    pte_t entry = table[PT_INDEX(virt)];
+    if (!(entry & PAGE_PRESENT)) return 0;
+
+    table[PT_INDEX(virt)] = 0;
+    proc->rss_pages--;
+
+    uint64_t phys = entry & 0x000FFFFFFFFFF000ULL;
+    pmm_set_owner(phys, 1, PAGE_OWNER_KERNEL, 0);
+
+    if (current_pml4 == (uint64_t *)vmm_phys_to_virt((uint64_t)proc->page_directory)) {
+        vmm_invlpg(virt);
+    }
+    return phys;
+}
+
+/**
+ * Free every user page mapped in a process's address space
+ */
+size_t vmm_free_user_pages(process_t *proc) {
+    uint64_t *pml4 = (uint64_t *)vmm_phys_to_virt((uint64_t)proc->page_directory);
+    size_t freed = 0;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        if (!(pml4[i] & PAGE_PRESENT) || pml4[i] == kernel_pml4[i]) {
+            continue;
+        }
+
+        uint64_t *pdpt = (uint64_t *)vmm_phys_to_virt(pml4[i] & ~0xFFF);
+        for (uint32_t j = 0; j < 512; j++) {
+            if (!(pdpt[j] & PAGE_PRESENT)) continue;
+
+            uint64_t *pd = (uint64_t *)vmm_phys_to_virt(pdpt[j] & ~0xFFF);
+            for (uint32_t k = 0; k < 512; k++) {
+                if (!(pd[k] & PAGE_PRESENT)) continue;
+
+                uint64_t *pt = (uint64_t *)vmm_phys_to_virt(pd[k] & ~0xFFF);
+                for (uint32_t l = 0; l < 512; l++) {
+                    if (pte_is_swap(pt[l])) {
+                        swap_free_entry(pt[l]);
+                        pt[l] = 0;
+                        continue;
+                    }
+                    if ((pt[l] & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+                        continue;
+                    }
+                    pmm_free_page(pt[l] & 0x000FFFFFFFFFF000ULL);
+                    pt[l] = 0;
+                    freed++;
+                }
+            }
+        }
+    }
+
+    proc->rss_pages = 0;
+    proc->swap_pages = 0;
+    return freed;
+}
+
+/**
+ * Find the page table entry for a user address without creating tables
+ */
+pte_t *vmm_get_user_pte(process_t *proc, uint64_t virt) {
+    uint64_t *table = (uint64_t *)vmm_phys_to_virt((uint64_t)proc->page_directory);
+    uint32_t indices[3] = { PML4_INDEX(virt), PDPT_INDEX(virt), PD_INDEX(virt) };
+
+    if (virt >= USER_SPACE_END) return NULL;
+
+    for (int level = 0; level < 3; level++) {
+        pte_t entry = table[indices[level]];
+        if (!(entry & PAGE_PRESENT) || (entry & PAGE_HUGE)) return NULL;
+        table = (uint64_t *)vmm_phys_to_virt(entry & ~0xFFF);
+    }
+
+    return &table[PT_INDEX(virt)];
+}
+
+/**
+ * Find the next present user page at or after *virt
+ *
+ * Skips whole tables that are missing, so a sparse address space costs
+ * one step per populated page table rather than per page.
+ */
+pte_t *vmm_next_user_pte(process_t *proc, uint64_t *virt) {
+    uint64_t *pml4 = (uint64_t *)vmm_phys_to_virt((uint64_t)proc->page_directory);
+    uint64_t addr = PAGE_ALIGN_DOWN(*virt);
+
+    while (addr < USER_SPACE_END) {
+        pte_t entry = pml4[PML4_INDEX(addr)];
+        if (!(entry & PAGE_PRESENT) || entry == kernel_pml4[PML4_INDEX(addr)]) {
+            addr = (addr | ((1ULL << 39) - 1)) + 1;
+            continue;
+        }
+
+        uint64_t *pdpt = (uint64_t *)vmm_phys_to_virt(entry & ~0xFFF);
+        entry = pdpt[PDPT_INDEX(addr)];
+        if (!(entry & PAGE_PRESENT) || (entry & PAGE_HUGE)) {
+            addr = (addr | ((1ULL << 30) - 1)) + 1;
+            continue;
+        }
+
+        uint64_t *pd = (uint64_t *)vmm_phys_to_virt(entry & ~0xFFF);
+        entry = pd[PD_INDEX(addr)];
+        if ((entry & PAGE_PRESENT) && !(entry & PAGE_HUGE)) {
+            uint64_t *pt = (uint64_t *)vmm_phys_to_virt(entry & ~0xFFF);
+            for (uint32_t i = PT_INDEX(addr); i < 512; i++) {
+                if ((pt[i] & (PAGE_PRESENT | PAGE_USER)) == (PAGE_PRESENT | PAGE_USER)) {
+                    *virt = (addr & ~((1ULL << 21) - 1)) + (uint64_t)i * PAGE_SIZE;
+                    return &pt[i];
+                }
+            }
+        }
+        addr = (addr | ((1ULL << 21) - 1)) + 1;
+    }
+
+    *virt = USER_SPACE_END;
+    return NULL;
+}
+
+/**
+ * Resolve a page fault, if it is one the kernel can fix
+ */
+int vmm_handle_page_fault(uint64_t addr, uint64_t err_code) {
+    process_t *proc = process_get_current();
+
+    // Protection violations are real faults; only missing pages are resolvable
+    if ((err_code & PAGE_PRESENT) || !proc || !proc->page_directory) {
+        return -1;
+    }
+
+    return swap_in(proc, addr);
+}
+
 /**
  * Unmap a range of virtual pages
  */
@@ -215,10 +426,20 @@ uint64_t vmm_get_physical(uint64_t virt) {
     pte_t pdpt_entry = pdpt[pdpt_idx];
     if (!(pdpt_entry & PAGE_PRESENT)) return 0;
 
+    // 1GB page
+    if (pdpt_entry & PAGE_HUGE) {
+        return (pdpt_entry & 0x000FFFFFC0000000ULL) + (virt & 0x3FFFFFFF) + page_offset;
+    }
+
     uint64_t *pd = (uint64_t *)vmm_phys_to_virt(pdpt_entry & ~0xFFF);
     pte_t pd_entry = pd[pd_idx];
     if (!(pd_entry & PAGE_PRESENT)) return 0;
 
+    // 2MB page (the boot direct map uses these)
+    if (pd_entry & PAGE_HUGE) {
+        return (pd_entry & 0x000FFFFFFFE00000ULL) + (virt & 0x1FFFFF) + page_offset;
+    }
+
     uint64_t *pt = (uint64_t *)vmm_phys_to_virt(pd_entry & ~0xFFF);
     pte_t pt_entry = pt[pt_idx];
     if (!(pt_entry & PAGE_PRESENT)) return 0;
@@ -234,6 +455,65 @@ bool vmm_is_mapped(uint64_t virt) {
     return vmm_get_physical(virt) != 0;
 }
 
+/**
+ * Map unmapped direct-map pages of a device range with the given caching
+ */
+static uint64_t vmm_map_mmio_cache(uint64_t phys, size_t size, uint64_t cache) {
+    uint64_t start = PAGE_ALIGN_DOWN(phys);
+    uint64_t end = PAGE_ALIGN(phys + size);
+
+    for (uint64_t page = start; page < end; page += PAGE_SIZE) {
+        uint64_t virt = vmm_phys_to_virt(page);
+        if (vmm_is_mapped(virt)) {
+            continue;
+        }
+        if (vmm_map_page(virt, page, PAGE_FLAGS_KERNEL | cache) != 0) {
+            return 0;
+        }
+    }
+
+    return vmm_phys_to_virt(phys);
+}
+
+/**
+ * Map device memory (MMIO) into the direct map, uncached
+ */
+uint64_t vmm_map_mmio(uint64_t phys, size_t size) {
+    return vmm_map_mmio_cache(phys, size, PAGE_CACHE_DISABLE | PAGE_WRITETHROUGH);
+}
+
+/**
+ * Map device memory into the direct map, write-combining
+ */
+uint64_t vmm_map_mmio_wc(uint64_t phys, size_t size) {
+    return vmm_map_mmio_cache(phys, size, vmm_wc_flags());
+}
+
+/**
+ * Get page flags selecting write-combining
+ */
+uint64_t vmm_wc_flags(void) {
+    if (wc_flags != 0) {
+        return wc_flags;
+    }
+
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_EDX_PAT)) {
+        wc_flags = PAGE_WRITETHROUGH;
+        return wc_flags;
+    }
+
+    // No mapping uses the upper PAT entries, so this is safe to change
+    uint64_t pat = rdmsr(MSR_IA32_PAT);
+    pat &= ~(0xFFULL << (VMM_PAT_WC_INDEX * 8));
+    pat |= (uint64_t)PAT_TYPE_WC << (VMM_PAT_WC_INDEX * 8);
+    wrmsr(MSR_IA32_PAT, pat);
+
+    wc_flags = PAGE_PAT | PAGE_WRITETHROUGH;
+    return wc_flags;
+}
+
 /**
  * Create a new page directory (for new process)
  */
@@ -255,9 +535,9 @@ uint64_t vmm_create_address_space(void) {
     // - Kernel pages have KERNEL-only flags, so user mode can't access them
     // - CPU needs access to GDT/IDT which are in low memory
     // - User code will use different PML4 entries for their own mappings
-    vga_printf("[VMM] Copying PML4[0]: 0x%x from current_pml4\n", current_pml4[0]);
+    pr_debug("[VMM] Copying PML4[0]: 0x%lx from current_pml4\n", current_pml4[0]);
     pml4[0] = current_pml4[0];
-    vga_printf("[VMM] New PML4 at phys=0x%x, PML4[0]=0x%x\n", pml4_phys, pml4[0]);
+    pr_debug("[VMM] New PML4 at phys=0x%lx, PML4[0]=0x%lx\n", pml4_phys, pml4[0]);
 
     return pml4_phys;
 }
@@ -268,9 +548,9 @@ uint64_t vmm_create_address_space(void) {
 void vmm_destroy_address_space(uint64_t pml4_phys) {
     uint64_t *pml4 = (uint64_t *)vmm_phys_to_virt(pml4_phys);
 
-    // Free user-space page tables (lower half only)
+    // Free user-space page tables (lower half only, not the shared identity map)
     for (uint32_t i = 0; i < 256; i++) {
-        if (pml4[i] & PAGE_PRESENT) {
+        if ((pml4[i] & PAGE_PRESENT) && pml4[i] != kernel_pml4[i]) {
             uint64_t *pdpt = (uint64_t *)vmm_phys_to_virt(pml4[i] & ~0xFFF);
 
             for (uint32_t j = 0; j < 512; j++) {
@@ -3,6 +3,12 @@
  */
 
 #include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/waitqueue.h>
+#include <kernel/vfs.h>
+#include <kernel/timer.h>
+#include <kernel/idt.h>
+#include <kernel/printk.h>
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <kernel/heap.h>
@@ -19,6 +25,9 @@ static uint32_t process_count = 0;
 // Current running process
 static process_t *current_process = NULL;
 
+// Earliest sleep_until of any sleeping process
+static uint64_t next_wakeup = UINT64_MAX;
+
 /**
  * Initialize process management
  */
@@ -92,6 +101,8 @@ process_t *process_create_kernel_task(void (*entry)(void), const char *name, uin
 
     uint64_t stack_virt = vmm_phys_to_virt(stack_phys);
     proc->kernel_stack = stack_virt + (4 * PAGE_SIZE);  // Stack grows down
+    pmm_set_owner(stack_phys, 4, PAGE_OWNER_STACK, proc->pid);
+    proc->kstack_pages = 4;
 
     // Set up initial context
     memset(&proc->context, 0, sizeof(cpu_context_t));
@@ -114,45 +125,6 @@ process_t *process_create_kernel_task(void (*entry)(void), const char *name, uin
     return proc;
 }
 
-/**
- * Helper: Manually map a page in a specific page directory
- * (without switching CR3)
- */
-static void manual_map_page(uint64_t *pml4, uint64_t virt, uint64_t phys, uint64_t flags) {
-    // Extract indices
-    uint32_t pml4_idx = (virt >> 39) & 0x1FF;
-    uint32_t pdpt_idx = (virt >> 30) & 0x1FF;
-    uint32_t pd_idx = (virt >> 21) & 0x1FF;
-    uint32_t pt_idx = (virt >> 12) & 0x1FF;
-
-    // Get or create PDPT
-    if (!(pml4[pml4_idx] & PAGE_PRESENT)) {
-        uint64_t pdpt_phys = pmm_alloc_page();
-        memset((void *)vmm_phys_to_virt(pdpt_phys), 0, PAGE_SIZE);
-        pml4[pml4_idx] = pdpt_phys | PAGE_FLAGS_USER;
-    }
-    uint64_t *pdpt = (uint64_t *)vmm_phys_to_virt(pml4[pml4_idx] & ~0xFFF);
-
-    // Get or create PD
-    if (!(pdpt[pdpt_idx] & PAGE_PRESENT)) {
-        uint64_t pd_phys = pmm_alloc_page();
-        memset((void *)vmm_phys_to_virt(pd_phys), 0, PAGE_SIZE);
-        pdpt[pdpt_idx] = pd_phys | PAGE_FLAGS_USER;
-    }
-    uint64_t *pd = (uint64_t *)vmm_phys_to_virt(pdpt[pdpt_idx] & ~0xFFF);
-
-    // Get or create PT
-    if (!(pd[pd_idx] & PAGE_PRESENT)) {
-        uint64_t pt_phys = pmm_alloc_page();
-        memset((void *)vmm_phys_to_virt(pt_phys), 0, PAGE_SIZE);
-        pd[pd_idx] = pt_phys | PAGE_FLAGS_USER;
-    }
-    uint64_t *pt = (uint64_t *)vmm_phys_to_virt(pd[pd_idx] & ~0xFFF);
-
-    // Map the page
-    pt[pt_idx] = phys | flags | PAGE_PRESENT;
-}
-
 /**
  * Create a new user mode process
  */
@@ -180,6 +152,8 @@ process_t *process_create_user(uint64_t entry, const char *name, uint32_t priori
 
     uint64_t kstack_virt = vmm_phys_to_virt(kstack_phys);
     proc->kernel_stack = kstack_virt + (4 * PAGE_SIZE);
+    pmm_set_owner(kstack_phys, 4, PAGE_OWNER_STACK, proc->pid);
+    proc->kstack_pages = 4;
 
     // Allocate user stack (16KB)
     uint64_t ustack_phys = pmm_alloc_pages(4);
@@ -204,6 +178,8 @@ process_t *process_create_user(uint64_t entry, const char *name, uint32_t priori
         return NULL;
     }
     proc->page_directory = (uint64_t *)pml4_phys;
+    pmm_set_owner(pml4_phys, 1, PAGE_OWNER_PAGETABLE, proc->pid);
+    proc->pagetable_pages = 1;
 
     // Allocate and map user pages WITHOUT switching page directories
     // (Switching is dangerous as kernel code might be in PML4[0])
@@ -219,22 +195,30 @@ process_t *process_create_user(uint64_t entry, const char *name, uint32_t priori
         return NULL;
     }
 
-    // Manually map pages in the user page directory (without switching CR3)
-    uint64_t *user_pml4 = (uint64_t *)vmm_phys_to_virt(pml4_phys);
+    // Map pages in the user page directory (without switching CR3)
+    int map_status = 0;
 
     // Map user stack pages (at 0x7FFFFFFFFFF0 - 16KB)
     for (int i = 0; i < 4; i++) {
         uint64_t virt = ustack_virt_base + (i * PAGE_SIZE);
         uint64_t phys = ustack_phys + (i * PAGE_SIZE);
-        // Manually create page tables and map
-        manual_map_page(user_pml4, virt, phys, PAGE_FLAGS_USER);
+        map_status |= vmm_map_user_page(proc, virt, phys, PAGE_FLAGS_USER);
     }
 
     // Map user code pages (at 0x400000)
     for (int i = 0; i < 4; i++) {
         uint64_t virt = user_code_virt + (i * PAGE_SIZE);
         uint64_t phys = user_code_phys + (i * PAGE_SIZE);
-        manual_map_page(user_pml4, virt, phys, PAGE_FLAGS_USER);
+        map_status |= vmm_map_user_page(proc, virt, phys, PAGE_FLAGS_USER);
+    }
+
+    if (map_status != 0) {
+        vmm_destroy_address_space(pml4_phys);
+        pmm_free_pages(user_code_phys, 4);
+        pmm_free_pages(kstack_phys, 4);
+        pmm_free_pages(ustack_phys, 4);
+        kfree(proc);
+        return NULL;
     }
 
     // Copy user code from kernel space to user code pages
@@ -253,8 +237,8 @@ process_t *process_create_user(uint64_t entry, const char *name, uint32_t priori
     proc->context.fs = 0x23;       // User data segment
     proc->context.gs = 0x23;       // User data segment
 
-    vga_printf("[PROC] User process RIP=0x%x RSP=0x%x CS=0x%x SS=0x%x\n",
-               user_code_virt, ustack_virt, proc->context.cs, proc->context.ss);
+    pr_debug("[PROC] User process RIP=0x%lx RSP=0x%lx CS=0x%lx SS=0x%lx\n",
+             user_code_virt, ustack_virt, proc->context.cs, proc->context.ss);
 
     // Add to process table
     if (add_process(proc) != 0) {
@@ -281,41 +265,118 @@ void process_exit(int exit_code) {
     // TODO: Wake up parent if waiting
 
     // Yield to scheduler
-    __asm__ volatile("int $0x20");  // Force timer interrupt
+    scheduler_yield();
 
     // Should never reach here
     while (1) __asm__ volatile("hlt");
 }
 
+/**
+ * Terminate another process
+ */
+void process_terminate(process_t *proc, int exit_code) {
+    if (!proc || proc == current_process ||
+        proc->state == PROCESS_STATE_ZOMBIE || proc->state == PROCESS_STATE_DEAD) {
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+
+    // Blocked processes sit on a wait queue, all others on the ready queue
+    if (proc->state == PROCESS_STATE_BLOCKED) {
+        if (proc->wait_queue) {
+            wait_queue_remove(proc->wait_queue, proc);
+        }
+    } else {
+        scheduler_remove_process(proc);
+    }
+
+    proc->state = PROCESS_STATE_ZOMBIE;
+    proc->exit_code = exit_code;
+
+    // Kernel tasks share the kernel address space; only user processes own one
+    if (proc->user_stack && proc->page_directory) {
+        uint64_t pml4_phys = (uint64_t)proc->page_directory;
+        vmm_free_user_pages(proc);
+        vmm_destroy_address_space(pml4_phys);
+        proc->page_directory = NULL;
+        proc->pagetable_pages = 0;
+    }
+
+    // A zombie without a kernel stack is what process_reap_zombies() looks for
+    if (proc->kernel_stack && proc->kstack_pages) {
+        uint64_t stack_phys = vmm_virt_to_phys(proc->kernel_stack - proc->kstack_pages * PAGE_SIZE);
+        pmm_free_pages(stack_phys, proc->kstack_pages);
+        proc->kernel_stack = 0;
+        proc->kstack_pages = 0;
+    }
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Reap every process left by process_terminate()
+ */
+void process_reap_zombies(void) {
+    for (uint32_t i = 0; i < MAX_PROCESSES; i++) {
+        uint64_t flags = interrupts_save();
+
+        process_t *proc = process_table[i];
+        if (!proc || proc->state != PROCESS_STATE_ZOMBIE || proc->kernel_stack) {
+            interrupts_restore(flags);
+            continue;
+        }
+        remove_process(proc);
+        interrupts_restore(flags);
+
+        vfs_close_all(proc->pid);
+        kfree(proc);
+    }
+}
+
 /**
  * Sleep current process
  */
 void process_sleep(uint64_t ticks) {
     if (!current_process) return;
 
-    extern uint64_t timer_get_ticks(void);
+    uint64_t flags = interrupts_save();
+
     current_process->sleep_until = timer_get_ticks() + ticks;
     current_process->state = PROCESS_STATE_SLEEPING;
+    if (current_process->sleep_until < next_wakeup) {
+        next_wakeup = current_process->sleep_until;
+    }
 
     // Yield to scheduler
-    __asm__ volatile("int $0x20");
+    scheduler_yield();
+
+    interrupts_restore(flags);
 }
 
 /**
  * Wake up sleeping processes
  */
 void process_wakeup_sleeping(void) {
-    extern uint64_t timer_get_ticks(void);
     uint64_t now = timer_get_ticks();
 
+    // Most ticks have nothing due; skip the table walk
+    if (now < next_wakeup) {
+        return;
+    }
+
+    uint64_t earliest = UINT64_MAX;
     for (uint32_t i = 0; i < MAX_PROCESSES; i++) {
         process_t *proc = process_table[i];
         if (proc && proc->state == PROCESS_STATE_SLEEPING) {
             if (now >= proc->sleep_until) {
                 proc->state = PROCESS_STATE_READY;
+            } else if (proc->sleep_until < earliest) {
+                earliest = proc->sleep_until;
             }
         }
     }
+    next_wakeup = earliest;
 }
 
 /**
@@ -374,6 +435,54 @@ void process_list(void) {
     vga_printf("\n");
 }
 
+/**
+ * Print per-process memory use
+ *
+ * Repeatedly picks the largest process not printed yet; the table is
+ * small and this only runs on request.
+ */
+void process_dump_memory(void) {
+    bool printed[MAX_PROCESSES] = { false };
+    uint64_t total = 0;
+
+    vga_printf("\nMemory by Process:\n");
+
+    while (1) {
+        process_t *largest = NULL;
+        uint32_t largest_index = 0;
+
+        for (uint32_t i = 0; i < MAX_PROCESSES; i++) {
+            process_t *proc = process_table[i];
+            if (!proc || printed[i]) {
+                continue;
+            }
+
+            uint64_t pages = proc->rss_pages + proc->pagetable_pages + proc->kstack_pages;
+            if (!largest || pages > largest->rss_pages + largest->pagetable_pages +
+                                    largest->kstack_pages) {
+                largest = proc;
+                largest_index = i;
+            }
+        }
+
+        if (!largest) {
+            break;
+        }
+        printed[largest_index] = true;
+
+        vga_printf("  PID %u %s: RSS %u KB, swap %u KB, page tables %u KB, kernel stack %u KB\n",
+                   largest->pid,
+                   largest->name,
+                   (uint32_t)(largest->rss_pages * (PAGE_SIZE / 1024)),
+                   (uint32_t)(largest->swap_pages * (PAGE_SIZE / 1024)),
+                   (uint32_t)(largest->pagetable_pages * (PAGE_SIZE / 1024)),
+                   (uint32_t)(largest->kstack_pages * (PAGE_SIZE / 1024)));
+        total += largest->rss_pages + largest->pagetable_pages + largest->kstack_pages;
+    }
+
+    vga_printf("  Total: %u KB in processes\n\n", (uint32_t)(total * (PAGE_SIZE / 1024)));
+}
+
 // Internal function used by scheduler
 void _process_set_current(process_t *proc) {
     current_process = proc;
@@ -5,10 +5,14 @@
  */
 
 #include <kernel/scheduler.h>
+#include <kernel/printk.h>
 #include <kernel/process.h>
 #include <kernel/timer.h>
 #include <kernel/isr.h>
 #include <kernel/idt.h>
+#include <kernel/percpu.h>
+#include <kernel/softirq.h>
+#include <kernel/trace.h>
 #include <kernel/vga.h>
 #include <kernel/string.h>
 #include <stdint.h>
@@ -28,6 +32,9 @@ static sched_algorithm_t algorithm = SCHED_ROUND_ROBIN;
 static bool scheduler_running = false;
 static uint32_t total_switches = 0;
 
+// Reschedule requested at the next interrupt exit (per CPU)
+static bool need_resched[MAX_CPUS];
+
 // Ready queue (simple circular queue for round-robin)
 static process_t *ready_queue_head = NULL;
 static process_t *ready_queue_tail = NULL;
@@ -82,23 +89,33 @@ void scheduler_remove_process(process_t *process) {
 
 /**
  * Get next process to run (round-robin)
+ *
+ * Sleeping processes stay queued and are skipped until the timer
+ * softirq marks them ready again; zombies are dropped from the queue.
  */
 static process_t *scheduler_pick_next(void) {
-    // Wake up sleeping processes
-    process_wakeup_sleeping();
+    for (uint32_t n = ready_count; n > 0; n--) {
+        process_t *next = ready_queue_head;
+
+        // Move to tail (circular queue) without touching its state
+        if (next != ready_queue_tail) {
+            ready_queue_head = next->next;
+            ready_queue_head->prev = NULL;
+            next->prev = ready_queue_tail;
+            next->next = NULL;
+            ready_queue_tail->next = next;
+            ready_queue_tail = next;
+        }
 
-    // Round-robin: pick head of ready queue
-    if (ready_queue_head == NULL) {
-        return NULL;
+        if (next->state == PROCESS_STATE_READY || next->state == PROCESS_STATE_RUNNING) {
+            return next;
+        }
+        if (next->state == PROCESS_STATE_ZOMBIE) {
+            scheduler_remove_process(next);
+        }
     }
 
-    process_t *next = ready_queue_head;
-
-    // Move to tail (circular queue)
-    scheduler_remove_process(next);
-    scheduler_add_process(next);
-
-    return next;
+    return NULL;
 }
 
 /**
@@ -159,6 +176,8 @@ void scheduler_schedule(registers_t *regs) {
         current->time_used = 0;
     }
 
+    trace_sched_switch(current ? current->pid : 0, next->pid);
+
     // Switch to next process
     next->state = PROCESS_STATE_RUNNING;
     next->total_time++;
@@ -191,8 +210,8 @@ void scheduler_schedule(registers_t *regs) {
     regs->fs = next->context.fs;
     regs->gs = next->context.gs;
 
-    vga_printf("[SCHED] Restoring to RIP=0x%x RSP=0x%x CS=0x%x\n",
-               regs->rip, regs->rsp, regs->cs);
+    pr_debug("[SCHED] Restoring to RIP=0x%lx RSP=0x%lx CS=0x%lx\n",
+             regs->rip, regs->rsp, regs->cs);
 
     // Switch page directory if needed
     if (next->page_directory) {
@@ -201,19 +220,66 @@ void scheduler_schedule(registers_t *regs) {
         uint64_t next_cr3 = (uint64_t)next->page_directory;
 
         if (current_cr3 != next_cr3) {
-            vga_printf("[SCHED] Switching CR3: 0x%x -> 0x%x\n", current_cr3, next_cr3);
+            pr_debug("[SCHED] Switching CR3: 0x%lx -> 0x%lx\n", current_cr3, next_cr3);
             __asm__ volatile("mov %0, %%cr3" :: "r"(next_cr3) : "memory");
-            vga_printf("[SCHED] CR3 switched successfully\n");
+            pr_debug("[SCHED] CR3 switched successfully\n");
         }
     }
 }
 
 /**
  * Timer callback for scheduling
+ *
+ * Runs in the hard timer IRQ; the switch itself happens in
+ * scheduler_preempt() once the interrupt is acknowledged and the
+ * softirqs have run.
  */
 static void scheduler_timer_callback(void) {
-    // This will be called from timer interrupt handler
-    // The actual scheduling happens in the IRQ handler
+    need_resched[cpu_id()] = true;
+}
+
+/**
+ * Timer softirq: wake sleepers outside the hard IRQ
+ */
+static void scheduler_timer_softirq(void) {
+    process_wakeup_sleeping();
+}
+
+/**
+ * Reschedule vector (yield, sleep, block)
+ *
+ * A software interrupt, so there is nothing to acknowledge.
+ */
+static void scheduler_resched_interrupt(registers_t *regs) {
+    need_resched[cpu_id()] = false;
+    scheduler_schedule(regs);
+}
+
+/**
+ * Request a reschedule at the next interrupt exit
+ */
+void scheduler_set_need_resched(void) {
+    need_resched[cpu_id()] = true;
+}
+
+/**
+ * Check whether a reschedule is pending on this CPU
+ */
+bool scheduler_need_resched(void) {
+    return scheduler_running && need_resched[cpu_id()];
+}
+
+/**
+ * Preempt the interrupted task if a reschedule was requested
+ */
+void scheduler_preempt(registers_t *regs) {
+    uint32_t cpu = cpu_id();
+    if (!need_resched[cpu]) {
+        return;
+    }
+
+    need_resched[cpu] = false;
+    scheduler_schedule(regs);
 }
 
 /**
@@ -227,8 +293,10 @@ void scheduler_init(sched_algorithm_t algo) {
     ready_count = 0;
     total_switches = 0;
 
-    // Register scheduler with timer interrupt
-    isr_register_handler(32, scheduler_schedule);  // IRQ0 = interrupt 32
+    // The timer IRQ requests preemption; yields use their own vector
+    timer_register_callback(scheduler_timer_callback);
+    softirq_register(SOFTIRQ_TIMER, scheduler_timer_softirq);
+    isr_register_handler(INT_RESCHED, scheduler_resched_interrupt);
 
     const char *algo_name = "Unknown";
     switch (algorithm) {
@@ -260,8 +328,7 @@ void scheduler_stop(void) {
  * Yield CPU to another process
  */
 void scheduler_yield(void) {
-    // Trigger timer interrupt to force rescheduling
-    __asm__ volatile("int $32");
+    __asm__ volatile("int %0" :: "i"(INT_RESCHED));
 }
 
 /**
@@ -283,6 +350,7 @@ void scheduler_unblock(process_t *process) {
     if (process && process->state == PROCESS_STATE_BLOCKED) {
         process->state = PROCESS_STATE_READY;
         scheduler_add_process(process);
+        need_resched[cpu_id()] = true;
     }
 }
 
@@ -321,6 +389,7 @@ void scheduler_print_stats(void) {
     vga_printf("  Ready processes: %u\n", ready_count);
     vga_printf("  Total processes: %u\n", scheduler_get_total_count());
     vga_printf("  Context switches: %u\n", total_switches);
+    vga_printf("  Timer softirqs: %u\n", (uint32_t)softirq_get_count(SOFTIRQ_TIMER));
     vga_printf("  Uptime:         %u ms\n", (uint32_t)timer_get_uptime_ms());
     vga_puts("\n");
 }
@@ -0,0 +1,129 @@
+/**
+ * Softirq Implementation
+ */
+
+#include <kernel/softirq.h>
+#include <kernel/scheduler.h>
+#include <kernel/percpu.h>
+#include <kernel/idt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+static void (*softirq_handlers[SOFTIRQ_COUNT])(void);
+static uint64_t softirq_counts[SOFTIRQ_COUNT];
+
+// Per-CPU state
+static uint32_t softirq_pending[MAX_CPUS];
+static uint32_t hardirq_depth[MAX_CPUS];
+static bool softirq_active[MAX_CPUS];
+
+/**
+ * Install the handler for a softirq vector
+ */
+void softirq_register(softirq_t nr, void (*handler)(void)) {
+    if (nr < SOFTIRQ_COUNT) {
+        softirq_handlers[nr] = handler;
+    }
+}
+
+/**
+ * Mark a softirq pending on the current CPU
+ */
+void softirq_raise(softirq_t nr) {
+    __atomic_fetch_or(&softirq_pending[cpu_id()], 1u << nr, __ATOMIC_RELAXED);
+}
+
+/**
+ * Run pending softirqs on the current CPU
+ *
+ * Interrupts are enabled while handlers run, so a new hard IRQ can
+ * raise more work; the pending mask is re-read a bounded number of
+ * times and anything left waits for the next interrupt exit.
+ */
+void softirq_run(void) {
+    uint32_t cpu = cpu_id();
+
+    uint64_t flags = interrupts_save();
+    if (softirq_active[cpu]) {
+        interrupts_restore(flags);
+        return;
+    }
+    softirq_active[cpu] = true;
+
+    for (int pass = 0; pass < SOFTIRQ_MAX_RESTART; pass++) {
+        uint32_t pending = __atomic_exchange_n(&softirq_pending[cpu], 0, __ATOMIC_RELAXED);
+        if (!pending) {
+            break;
+        }
+
+        interrupts_enable();
+        for (uint32_t nr = 0; nr < SOFTIRQ_COUNT; nr++) {
+            if ((pending & (1u << nr)) && softirq_handlers[nr]) {
+                softirq_handlers[nr]();
+                softirq_counts[nr]++;
+            }
+        }
+        interrupts_disable();
+    }
+
+    softirq_active[cpu] = false;
+    interrupts_restore(flags);
+}
+
+/**
+ * Check whether the current CPU is inside a hardware interrupt
+ */
+bool in_interrupt(void) {
+    uint32_t cpu = cpu_id();
+    return hardirq_depth[cpu] > 0 || softirq_active[cpu];
+}
+
+/**
+ * Enter hardware interrupt context
+ */
+void hardirq_enter(void) {
+    hardirq_depth[cpu_id()]++;
+}
+
+/**
+ * Leave hardware interrupt context
+ */
+void hardirq_exit(registers_t *regs) {
+    uint32_t cpu = cpu_id();
+
+    // Softirqs run at depth 1 so nested interrupts neither run them
+    // again nor preempt the task from underneath them
+    if (hardirq_depth[cpu] == 1 && softirq_pending[cpu]) {
+        softirq_run();
+    }
+
+    hardirq_depth[cpu]--;
+
+    if (hardirq_depth[cpu] == 0 && !softirq_active[cpu]) {
+        scheduler_preempt(regs);
+    }
+}
+
+/**
+ * Leave hardware interrupt context if there is nothing else to do
+ */
+bool hardirq_exit_fast(void) {
+    uint32_t cpu = cpu_id();
+
+    // Same conditions under which hardirq_exit() would do real work
+    if (hardirq_depth[cpu] == 1 && !softirq_active[cpu] &&
+        (softirq_pending[cpu] || scheduler_need_resched())) {
+        return false;
+    }
+
+    hardirq_depth[cpu]--;
+    return true;
+}
+
+/**
+ * Get how many times a softirq vector has run
+ */
+uint64_t softirq_get_count(softirq_t nr) {
+    return nr < SOFTIRQ_COUNT ? softirq_counts[nr] : 0;
+}
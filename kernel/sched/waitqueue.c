@@ -0,0 +1,112 @@
+/**
+ * Wait Queue Implementation
+ */
+
+#include <kernel/waitqueue.h>
+#include <kernel/scheduler.h>
+#include <kernel/idt.h>
+#include <stddef.h>
+
+/**
+ * Initialize a wait queue
+ */
+void wait_queue_init(wait_queue_t *wq) {
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+/**
+ * Block the current process on a wait queue
+ */
+bool wait_queue_sleep(wait_queue_t *wq) {
+    process_t *current = process_get_current();
+    if (!current) {
+        return false;  // Boot context cannot block
+    }
+
+    uint64_t flags = interrupts_save();
+
+    current->wait_next = NULL;
+    if (wq->tail) {
+        wq->tail->wait_next = current;
+    } else {
+        wq->head = current;
+    }
+    wq->tail = current;
+    current->wait_queue = wq;
+
+    // Removes us from the ready queue and switches away until woken
+    scheduler_block();
+
+    interrupts_restore(flags);
+    return true;
+}
+
+/**
+ * Wake the first process waiting on a queue
+ */
+void wait_queue_wake_one(wait_queue_t *wq) {
+    uint64_t flags = interrupts_save();
+
+    process_t *proc = wq->head;
+    if (proc) {
+        wq->head = proc->wait_next;
+        if (!wq->head) {
+            wq->tail = NULL;
+        }
+        proc->wait_next = NULL;
+        proc->wait_queue = NULL;
+        scheduler_unblock(proc);
+    }
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Wake every process waiting on a queue
+ */
+void wait_queue_wake_all(wait_queue_t *wq) {
+    uint64_t flags = interrupts_save();
+
+    process_t *proc = wq->head;
+    wq->head = NULL;
+    wq->tail = NULL;
+
+    while (proc) {
+        process_t *next = proc->wait_next;
+        proc->wait_next = NULL;
+        proc->wait_queue = NULL;
+        scheduler_unblock(proc);
+        proc = next;
+    }
+
+    interrupts_restore(flags);
+}
+
+/**
+ * Take a process off a wait queue without waking it
+ */
+void wait_queue_remove(wait_queue_t *wq, process_t *proc) {
+    uint64_t flags = interrupts_save();
+
+    process_t *prev = NULL;
+    for (process_t *p = wq->head; p; prev = p, p = p->wait_next) {
+        if (p != proc) {
+            continue;
+        }
+
+        if (prev) {
+            prev->wait_next = p->wait_next;
+        } else {
+            wq->head = p->wait_next;
+        }
+        if (wq->tail == p) {
+            wq->tail = prev;
+        }
+        break;
+    }
+
+    proc->wait_next = NULL;
+    proc->wait_queue = NULL;
+    interrupts_restore(flags);
+}
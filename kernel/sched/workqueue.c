@@ -0,0 +1,169 @@
+/**
+ * Workqueue Implementation
+ */
+
+#include <kernel/workqueue.h>
+#include <kernel/scheduler.h>
+#include <kernel/process.h>
+#include <kernel/idt.h>
+#include <kernel/string.h>
+#include <kernel/vga.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+static workqueue_t workqueues[WORKQUEUE_MAX];
+static uint32_t workqueue_count = 0;
+
+// Shared "events" workqueue
+static workqueue_t *system_wq = NULL;
+
+/**
+ * Initialize a work item
+ */
+void work_init(work_t *work, void (*func)(work_t *work)) {
+    work->func = func;
+    work->next = NULL;
+    work->pending = false;
+}
+
+/**
+ * Find the workqueue served by the calling worker thread
+ */
+static workqueue_t *workqueue_of_current(void) {
+    process_t *current = process_get_current();
+
+    for (uint32_t i = 0; i < workqueue_count; i++) {
+        for (uint32_t j = 0; j < workqueues[i].nr_workers; j++) {
+            if (workqueues[i].workers[j] == current) {
+                return &workqueues[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Worker thread: run items in FIFO order, sleep when the queue is empty
+ */
+static void workqueue_worker(void) {
+    workqueue_t *wq = workqueue_of_current();
+    if (!wq) {
+        process_exit(-1);
+    }
+
+    while (1) {
+        uint64_t flags = interrupts_save();
+
+        while (!wq->head) {
+            wait_queue_sleep(&wq->wait);
+        }
+
+        work_t *work = wq->head;
+        wq->head = work->next;
+        if (!wq->head) {
+            wq->tail = NULL;
+        }
+        work->next = NULL;
+        work->pending = false;      // May be requeued while it runs
+
+        interrupts_restore(flags);
+
+        work->func(work);
+        wq->executed++;
+    }
+}
+
+/**
+ * Create a workqueue with its own worker threads
+ */
+workqueue_t *workqueue_create(const char *name, uint32_t nr_workers, uint32_t priority) {
+    if (workqueue_count >= WORKQUEUE_MAX || nr_workers == 0 || nr_workers > WORKQUEUE_MAX_WORKERS) {
+        return NULL;
+    }
+
+    workqueue_t *wq = &workqueues[workqueue_count];
+    memset(wq, 0, sizeof(*wq));
+    strncpy(wq->name, name, sizeof(wq->name) - 1);
+    wait_queue_init(&wq->wait);
+
+    // Workers look themselves up by process, so publish the queue first
+    workqueue_count++;
+
+    for (uint32_t i = 0; i < nr_workers; i++) {
+        process_t *worker = process_create_kernel_task(workqueue_worker, wq->name, priority);
+        if (!worker) {
+            break;
+        }
+        wq->workers[wq->nr_workers++] = worker;
+        scheduler_add_process(worker);
+    }
+
+    if (wq->nr_workers == 0) {
+        workqueue_count--;
+        return NULL;
+    }
+
+    return wq;
+}
+
+/**
+ * Create the shared workqueue
+ */
+int workqueue_init(void) {
+    system_wq = workqueue_create("events", 1, WORKQUEUE_SYSTEM_PRIORITY);
+    if (!system_wq) {
+        return -1;
+    }
+
+    vga_printf("  Workqueue: 'events' with %u worker\n", system_wq->nr_workers);
+    return 0;
+}
+
+/**
+ * Queue a work item
+ */
+bool queue_work(workqueue_t *wq, work_t *work) {
+    if (!wq || !work || !work->func) {
+        return false;
+    }
+
+    uint64_t flags = interrupts_save();
+
+    if (work->pending) {
+        interrupts_restore(flags);
+        return false;
+    }
+
+    work->pending = true;
+    work->next = NULL;
+    if (wq->tail) {
+        wq->tail->next = work;
+    } else {
+        wq->head = work;
+    }
+    wq->tail = work;
+
+    wait_queue_wake_one(&wq->wait);
+
+    interrupts_restore(flags);
+    return true;
+}
+
+/**
+ * Queue a work item on the shared workqueue
+ */
+bool schedule_work(work_t *work) {
+    return queue_work(system_wq, work);
+}
+
+/**
+ * Print per-workqueue statistics
+ */
+void workqueue_print_stats(void) {
+    for (uint32_t i = 0; i < workqueue_count; i++) {
+        const workqueue_t *wq = &workqueues[i];
+        vga_printf("  %s: %u worker(s), %u items run%s\n", wq->name, wq->nr_workers,
+                   (uint32_t)wq->executed, wq->head ? ", busy" : "");
+    }
+}
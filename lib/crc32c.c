@@ -0,0 +1,134 @@
+/**
+ * CRC32C (Castagnoli) Checksum Implementation
+ *
+ * The crc32 instruction is a general purpose integer instruction, so
+ * it is usable even though the kernel is built without SSE registers.
+ */
+
+#include <kernel/crc32c.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Reflected Castagnoli polynomial
+#define CRC32C_POLY 0x82F63B78
+
+// CPUID.01H:ECX bit 20
+#define CPUID_ECX_SSE42 (1 << 20)
+
+// Unaligned 64-bit load
+typedef uint64_t __attribute__((may_alias, aligned(1))) unaligned_u64_t;
+
+static uint32_t crc32c_table[8][256];
+static bool crc32c_hw = false;
+static bool crc32c_ready = false;
+
+/**
+ * Build slice-by-8 lookup tables
+ */
+static void crc32c_build_tables(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        }
+        crc32c_table[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = crc32c_table[k - 1][i];
+            crc32c_table[k][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xFF];
+        }
+    }
+}
+
+/**
+ * Initialize CRC32C
+ */
+void crc32c_init(void) {
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    crc32c_hw = (ecx & CPUID_ECX_SSE42) != 0;
+
+    crc32c_build_tables();
+    crc32c_ready = true;
+}
+
+/**
+ * Hardware path: 8 bytes per crc32q
+ */
+static uint32_t crc32c_hw_update(uint32_t crc, const uint8_t *p, size_t len) {
+    uint64_t crc64 = crc;
+
+    while (len >= 8) {
+        uint64_t v = *(const unaligned_u64_t *)p;
+        __asm__("crc32q %1, %0" : "+r"(crc64) : "rm"(v));
+        p += 8;
+        len -= 8;
+    }
+
+    crc = (uint32_t)crc64;
+    while (len--) {
+        __asm__("crc32b %1, %0" : "+r"(crc) : "rm"(*p));
+        p++;
+    }
+
+    return crc;
+}
+
+/**
+ * Software path: slice-by-8
+ */
+static uint32_t crc32c_sw_update(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                             ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        uint32_t hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8) |
+                      ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+
+        crc = crc32c_table[7][lo & 0xFF] ^
+              crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^
+              crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xFF] ^
+              crc32c_table[2][(hi >> 8) & 0xFF] ^
+              crc32c_table[1][(hi >> 16) & 0xFF] ^
+              crc32c_table[0][hi >> 24];
+
+        p += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return crc;
+}
+
+/**
+ * Compute or extend a CRC32C
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+    if (!crc32c_ready) {
+        crc32c_init();
+    }
+
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+
+    if (crc32c_hw) {
+        crc = crc32c_hw_update(crc, p, len);
+    } else {
+        crc = crc32c_sw_update(crc, p, len);
+    }
+
+    return ~crc;
+}
+
+/**
+ * Check whether the SSE4.2 instruction is in use
+ */
+bool crc32c_hw_available(void) {
+    return crc32c_hw;
+}
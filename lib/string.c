@@ -176,88 +176,101 @@ char *strrchr(const char *str, int c) {
 }
 
 /**
- * Simple snprintf implementation
- * Supports: %s, %d, %u, %x, %X, %c, %%
+ * Format string into a buffer with a va_list
+ *
+ * Supports %s %c %d %i %u %x %X %p %% and the l/ll length modifiers.
  */
-int snprintf(char *str, size_t size, const char *format, ...) {
+int vsnprintf(char *str, size_t size, const char *format, __builtin_va_list args) {
     if (!str || size == 0) {
         return 0;
     }
 
-    __builtin_va_list args;
-    __builtin_va_start(args, format);
-
     size_t written = 0;
     const char *p = format;
 
     while (*p && written < size - 1) {
-        if (*p == '%') {
+        if (*p != '%') {
+            str[written++] = *p++;
+            continue;
+        }
+
+        p++;
+
+        // Length modifier: l and ll both mean 64-bit here
+        int is_long = 0;
+        while (*p == 'l') {
+            is_long = 1;
             p++;
-            if (*p == '%') {
-                str[written++] = '%';
-            } else if (*p == 's') {
-                const char *s = __builtin_va_arg(args, const char *);
-                if (!s) s = "(null)";
-                while (*s && written < size - 1) {
-                    str[written++] = *s++;
-                }
-            } else if (*p == 'c') {
-                char c = (char)__builtin_va_arg(args, int);
-                str[written++] = c;
+        }
+
+        if (*p == '%') {
+            str[written++] = '%';
+        } else if (*p == 's') {
+            const char *s = __builtin_va_arg(args, const char *);
+            if (!s) s = "(null)";
+            while (*s && written < size - 1) {
+                str[written++] = *s++;
+            }
+        } else if (*p == 'c') {
+            char c = (char)__builtin_va_arg(args, int);
+            str[written++] = c;
+        } else if (*p == 'd' || *p == 'i' || *p == 'u' ||
+                   *p == 'x' || *p == 'X' || *p == 'p') {
+            uint64_t num;
+            int is_negative = 0;
+
+            if (*p == 'p') {
+                num = (uint64_t)__builtin_va_arg(args, void *);
+                is_long = 1;
             } else if (*p == 'd' || *p == 'i') {
-                int num = __builtin_va_arg(args, int);
-                char buf[32];
-                int i = 0;
-                int is_negative = (num < 0);
-                if (is_negative) num = -num;
-
-                do {
-                    buf[i++] = '0' + (num % 10);
-                    num /= 10;
-                } while (num > 0);
-
-                if (is_negative && written < size - 1) {
-                    str[written++] = '-';
-                }
-
-                while (i > 0 && written < size - 1) {
-                    str[written++] = buf[--i];
-                }
-            } else if (*p == 'u') {
-                unsigned int num = __builtin_va_arg(args, unsigned int);
-                char buf[32];
-                int i = 0;
-
-                do {
-                    buf[i++] = '0' + (num % 10);
-                    num /= 10;
-                } while (num > 0);
-
-                while (i > 0 && written < size - 1) {
-                    str[written++] = buf[--i];
-                }
-            } else if (*p == 'x' || *p == 'X') {
-                unsigned int num = __builtin_va_arg(args, unsigned int);
-                char buf[32];
-                int i = 0;
-                const char *hex_digits = (*p == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
-
-                do {
-                    buf[i++] = hex_digits[num % 16];
-                    num /= 16;
-                } while (num > 0);
-
-                while (i > 0 && written < size - 1) {
-                    str[written++] = buf[--i];
-                }
+                int64_t v = is_long ? __builtin_va_arg(args, int64_t)
+                                    : __builtin_va_arg(args, int);
+                is_negative = (v < 0);
+                num = is_negative ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+            } else {
+                num = is_long ? __builtin_va_arg(args, uint64_t)
+                              : __builtin_va_arg(args, unsigned int);
             }
-            p++;
-        } else {
-            str[written++] = *p++;
+
+            unsigned int base = (*p == 'x' || *p == 'X' || *p == 'p') ? 16 : 10;
+            const char *digits = (*p == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+            char buf[32];
+            int i = 0;
+
+            do {
+                buf[i++] = digits[num % base];
+                num /= base;
+            } while (num > 0);
+
+            if (*p == 'p') {
+                buf[i++] = 'x';
+                buf[i++] = '0';
+            }
+
+            if (is_negative && written < size - 1) {
+                str[written++] = '-';
+            }
+
+            while (i > 0 && written < size - 1) {
+                str[written++] = buf[--i];
+            }
+        } else if (*p == '\0') {
+            break;
         }
+        p++;
     }
 
     str[written] = '\0';
+    return written;
+}
+
+/**
+ * Simple snprintf implementation
+ */
+int snprintf(char *str, size_t size, const char *format, ...) {
+    __builtin_va_list args;
+    __builtin_va_start(args, format);
+    int written = vsnprintf(str, size, format, args);
     __builtin_va_end(args);
     return written;
 }
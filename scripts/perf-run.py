@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""Run the NovaeOS benchmark suite in headless QEMU and check for regressions.
+
+Boots an ISO whose GRUB entry passes "bench=exit", once per accelerator
+(TCG always, KVM when /dev/kvm is usable), with a scratch copy of the
+disk image attached as hda. The KBENCH JSON lines written to the serial
+port are collected into a results file:
+
+    {"accels": {"tcg": {"tsc_khz": ..., "cases": {"kmalloc_kfree":
+        {"median_ns": ..., "p99_ns": ..., ...}, ...}}, ...}}
+
+and each case's median is compared with the baseline. A case regresses
+when it is slower than the baseline by more than its threshold, or when
+it no longer runs. Thresholds default per accelerator (TCG is noisy) and
+can be overridden in the baseline:
+
+    "thresholds": {"tcg": 0.25, "kvm": 0.10, "cases": {"context_switch": 0.30}}
+
+Exit status: 0 clean, 1 regressions, 2 the run itself failed.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+DEFAULT_THRESHOLDS = {"tcg": 0.25, "kvm": 0.10}
+
+# isa-debug-exit turns the kernel's exit code c into (c << 1) | 1
+EXIT_SUCCESS = 1
+
+
+def kvm_available():
+    return os.access("/dev/kvm", os.R_OK | os.W_OK)
+
+
+def qemu_command(args, accel, iso, disk, serial):
+    cmd = [args.qemu, "-m", args.memory, "-display", "none", "-no-reboot",
+           "-cdrom", iso,
+           "-drive", "file=%s,format=raw,if=ide,index=0,media=disk" % disk,
+           "-serial", "file:%s" % serial,
+           "-device", "isa-debug-exit,iobase=0xf4,iosize=0x04"]
+    if accel == "kvm":
+        cmd += ["-accel", "kvm", "-cpu", "host"]
+    else:
+        cmd += ["-accel", "tcg"]
+    return cmd
+
+
+def parse_serial(path):
+    """Return (header, cases, footer) from the KBENCH lines of a serial log."""
+    header, footer, cases = None, None, {}
+    with open(path, errors="replace") as log:
+        for raw in log:
+            line = raw.strip().replace("\r", "")
+            tag, _, payload = line.partition(" ")
+            try:
+                if tag == "KBENCH-BEGIN":
+                    header, cases = json.loads(payload), {}
+                elif tag == "KBENCH":
+                    case = json.loads(payload)
+                    cases[case.pop("name")] = case
+                elif tag == "KBENCH-END":
+                    footer = json.loads(payload)
+            except ValueError:
+                continue        # Console noise interleaved with a line
+    return header, cases, footer
+
+
+def run_once(args, accel, workdir):
+    """Boot once and return (header, cases), or raise RuntimeError."""
+    disk = os.path.join(workdir, "disk.img")
+    serial = os.path.join(workdir, "serial-%s.log" % accel)
+    shutil.copyfile(args.disk, disk)    # The kernel formats hda on boot
+
+    cmd = qemu_command(args, accel, args.iso, disk, serial)
+    start = time.monotonic()
+    try:
+        proc = subprocess.run(cmd, stdin=subprocess.DEVNULL, capture_output=True,
+                              text=True, timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        raise RuntimeError("%s: no exit after %ds (serial log: %s)" % (accel, args.timeout, serial))
+
+    header, cases, footer = parse_serial(serial)
+    if header is None or footer is None:
+        raise RuntimeError("%s: incomplete KBENCH output, QEMU exited %d (serial log: %s)\n%s"
+                           % (accel, proc.returncode, serial, proc.stderr.strip()))
+    if proc.returncode != EXIT_SUCCESS:
+        raise RuntimeError("%s: kernel reported failure (QEMU exit %d)" % (accel, proc.returncode))
+
+    print("  %s: %d passed, %d skipped in %.0fs" % (accel, footer["passed"], footer["skipped"],
+                                                     time.monotonic() - start))
+    return header, cases
+
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) // 2]
+
+
+def summarize(header, runs):
+    """Merge the runs of one accelerator: per-field median across runs, in ns."""
+    tsc_khz = header["tsc_khz"]
+    cases = {}
+    for name in runs[0]:
+        samples = [run.get(name, {"skipped": True}) for run in runs]
+        if any(s.get("skipped") for s in samples):
+            cases[name] = {"skipped": True}
+            continue
+
+        result = {"iterations": samples[0]["iterations"]}
+        for field in ("min", "median", "p99", "max", "mean"):
+            cycles = median([s[field] for s in samples])
+            result[field + "_cycles"] = cycles
+            result[field + "_ns"] = round(cycles * 1e6 / tsc_khz, 1) if tsc_khz else None
+        cases[name] = result
+
+    return {"tsc_khz": tsc_khz, "overhead": header["overhead"], "runs": len(runs), "cases": cases}
+
+
+def threshold_for(baseline, accel, name, override):
+    if override is not None:
+        return override
+    thresholds = baseline.get("thresholds", {})
+    if name in thresholds.get("cases", {}):
+        return thresholds["cases"][name]
+    return thresholds.get(accel, DEFAULT_THRESHOLDS.get(accel, 0.10))
+
+
+def compare(baseline, results, override):
+    """Print a comparison table and return the number of regressions."""
+    regressions = 0
+    for accel, current in results["accels"].items():
+        base = baseline.get("accels", {}).get(accel)
+        if base is None:
+            print("\n%s: not in baseline, skipped" % accel)
+            continue
+
+        print("\n%s: median ns, baseline -> current" % accel)
+        for name, before in sorted(base["cases"].items()):
+            if before.get("skipped"):
+                continue
+
+            after = current["cases"].get(name)
+            if after is None or after.get("skipped"):
+                print("  %-24s %12.1f -> %12s  REGRESSED (did not run)" % (name, before["median_ns"], "-"))
+                regressions += 1
+                continue
+
+            limit = threshold_for(baseline, accel, name, override)
+            change = after["median_ns"] / before["median_ns"] - 1 if before["median_ns"] else 0.0
+            status = "ok"
+            if change > limit:
+                status = "REGRESSED (limit +%.0f%%)" % (limit * 100)
+                regressions += 1
+            elif change < -limit:
+                status = "improved"
+            print("  %-24s %12.1f -> %12.1f  %+6.1f%%  %s"
+                  % (name, before["median_ns"], after["median_ns"], change * 100, status))
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--iso", default="build/perf/novae-perf.iso",
+                        help="ISO booting with bench=exit (default: %(default)s)")
+    parser.add_argument("--disk", default="disk.img",
+                        help="disk image template, copied per run (default: %(default)s)")
+    parser.add_argument("--baseline", default="perf/baseline.json",
+                        help="baseline results (default: %(default)s)")
+    parser.add_argument("--output", default="build/perf/results.json",
+                        help="where to write results (default: %(default)s)")
+    parser.add_argument("--accel", action="append", choices=("tcg", "kvm"),
+                        help="accelerator to run (repeatable; default: tcg, plus kvm if usable)")
+    parser.add_argument("--runs", type=int, default=1,
+                        help="boots per accelerator; medians are taken across runs")
+    parser.add_argument("--threshold", type=float,
+                        help="allowed slowdown for every case, e.g. 0.15 (overrides the baseline)")
+    parser.add_argument("--timeout", type=int, default=600, help="seconds per boot")
+    parser.add_argument("--memory", default="512M", help="guest memory (default: %(default)s)")
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="write these results as the new baseline instead of comparing")
+    args = parser.parse_args()
+
+    accels = args.accel or (["tcg", "kvm"] if kvm_available() else ["tcg"])
+    for path in (args.iso, args.disk):
+        if not os.path.exists(path):
+            sys.exit("perf: %s not found" % path)
+
+    results = {"timestamp": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()), "accels": {}}
+    with tempfile.TemporaryDirectory(prefix="novae-perf-") as workdir:
+        for accel in accels:
+            runs, header = [], None
+            for _ in range(args.runs):
+                try:
+                    header, cases = run_once(args, accel, workdir)
+                except RuntimeError as err:
+                    print("perf: %s" % err, file=sys.stderr)
+                    sys.exit(2)
+                runs.append(cases)
+            results["accels"][accel] = summarize(header, runs)
+
+    os.makedirs(os.path.dirname(args.output) or ".", exist_ok=True)
+    with open(args.output, "w") as out:
+        json.dump(results, out, indent=2, sort_keys=True)
+        out.write("\n")
+    print("Results written to %s" % args.output)
+
+    if args.update_baseline:
+        baseline = {}
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        # Keep hand-tuned thresholds; merge accelerators not run this time
+        merged = dict(baseline.get("accels", {}))
+        merged.update(results["accels"])
+        baseline.update(results)
+        baseline["accels"] = merged
+        os.makedirs(os.path.dirname(args.baseline) or ".", exist_ok=True)
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Baseline updated: %s" % args.baseline)
+        return
+
+    if not os.path.exists(args.baseline):
+        print("No baseline at %s; record one with 'make perf-baseline'" % args.baseline)
+        return
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    regressions = compare(baseline, results, args.threshold)
+    if regressions:
+        print("\n%d regression(s)" % regressions)
+        sys.exit(1)
+    print("\nNo regressions")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Symbolize NovaeOS profiler output into folded stacks.
+
+Reads a serial log containing a PROFILE BEGIN/END block written by
+profile_dump(), maps each address to a function in kernel.elf and
+prints one "func;func;func count" line per distinct stack, ready for
+flamegraph.pl:
+
+    scripts/profile-symbolize.py serial.log | flamegraph.pl > profile.svg
+
+Frames are root first; all but the last are return addresses, so they
+are looked up one byte back to land inside the calling instruction.
+"""
+
+import argparse
+import bisect
+import re
+import subprocess
+import sys
+from collections import Counter
+
+BEGIN = re.compile(r"=== PROFILE BEGIN (.*) ===")
+END = "=== PROFILE END ==="
+
+
+def load_symbols(elf):
+    """Return sorted (address, name) pairs of the text symbols in elf."""
+    out = subprocess.run(["nm", "-n", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            symbols.append((int(parts[0], 16), parts[2]))
+    return symbols
+
+
+def symbolize(symbols, addrs, addr):
+    i = bisect.bisect_right(addrs, addr) - 1
+    if i < 0:
+        return "0x%x" % addr
+    return symbols[i][1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("-k", "--kernel", default="build/kernel.elf",
+                        help="kernel ELF with symbols (default: %(default)s)")
+    args = parser.parse_args()
+
+    symbols = load_symbols(args.kernel)
+    addrs = [a for a, _ in symbols]
+
+    stream = open(args.log, errors="replace") if args.log else sys.stdin
+    folded = Counter()
+    header = None
+
+    for raw in stream:
+        line = raw.strip().replace("\r", "")
+        m = BEGIN.search(line)
+        if m:
+            header = m.group(1)
+            folded.clear()
+            continue
+        if header is None:
+            continue
+        if line == END:
+            break
+
+        try:
+            stack, count = line.rsplit(" ", 1)
+            count = int(count)
+        except ValueError:
+            continue        # Console noise interleaved with the dump
+
+        frames = []
+        if stack == "[user]":
+            frames.append("[user]")
+        else:
+            ips = stack.split(";")
+            for n, ip in enumerate(ips):
+                addr = int(ip, 16)
+                if n != len(ips) - 1:
+                    addr -= 1
+                frames.append(symbolize(symbols, addrs, addr))
+        folded[";".join(frames)] += count
+
+    if header is None:
+        sys.exit("no profile found in input")
+
+    print("# " + header, file=sys.stderr)
+    for stack, count in folded.most_common():
+        print("%s %d" % (stack, count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Decode NovaeOS tracepoint records into text.
+
+Reads either a serial log containing a TRACE BEGIN/END block written by
+trace_dump(), or the raw bytes read from /dev/trace (--binary), and
+prints one line per record in timestamp order:
+
+    12.345678 cpu0 pid 3 kmalloc size=64 ptr=0xffff800000a41020
+
+Event layouts come from kernel/include/kernel/trace_events.h: IDs follow
+the order of the TRACE_EVENT list starting at 1, and each payload is
+laid out after the 16-byte record header with natural C alignment.
+Timestamps are seconds since the first record when the TSC rate is
+known (from the serial header or --tsc-khz), raw cycles otherwise.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HEADER = struct.Struct("<QHBBI")     # tsc, id, size, cpu, pid
+ID_PAD = 0
+
+BEGIN = re.compile(r"=== TRACE BEGIN (.*) ===")
+END = re.compile(r"=== TRACE END")
+
+TYPES = {
+    "uint8_t": "B", "int8_t": "b",
+    "uint16_t": "H", "int16_t": "h",
+    "uint32_t": "I", "int32_t": "i",
+    "uint64_t": "Q", "int64_t": "q",
+}
+
+EVENT = re.compile(r"^TRACE_EVENT\(\s*(\w+)\s*,.*?TP_STRUCT\((.*?)\)\s*,\s*TP_ASSIGN",
+                   re.S | re.M)
+
+
+def load_events(path):
+    """Return {id: (name, [(field, format, offset)])} from trace_events.h."""
+    with open(path) as f:
+        text = re.sub(r"/\*.*?\*/", "", f.read(), flags=re.S)
+
+    events = {}
+    for event_id, match in enumerate(EVENT.finditer(text), start=1):
+        name, body = match.group(1), match.group(2)
+        fields, offset = [], HEADER.size
+        for decl in filter(None, (d.strip() for d in body.split(";"))):
+            ctype, field = decl.split()
+            fmt = TYPES.get(ctype)
+            if fmt is None:
+                sys.exit("trace-decode: %s.%s: unsupported type %s" % (name, field, ctype))
+            size = struct.calcsize("<" + fmt)
+            offset = (offset + size - 1) // size * size
+            fields.append((field, fmt, offset))
+            offset += size
+        events[event_id] = (name, fields)
+    return events
+
+
+def split_records(data):
+    """Yield each record's bytes from a concatenated stream."""
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        size = data[pos + 10]
+        if size < HEADER.size or pos + size > len(data):
+            print("trace-decode: truncated record at offset %d" % pos, file=sys.stderr)
+            return
+        yield data[pos:pos + size]
+        pos += size
+
+
+def read_serial(path):
+    """Return (header options, records) from the first TRACE block of a serial log."""
+    options, records, inside = {}, [], False
+    with open(path, errors="replace") as log:
+        for raw in log:
+            line = raw.strip().replace("\r", "")
+            begin = BEGIN.match(line)
+            if begin:
+                options = dict(kv.split("=", 1) for kv in begin.group(1).split() if "=" in kv)
+                inside = True
+            elif inside and END.match(line):
+                break
+            elif inside:
+                try:
+                    records.append(bytes.fromhex(line))
+                except ValueError:
+                    continue        # Console noise interleaved with the dump
+    if not inside:
+        sys.exit("trace-decode: no TRACE BEGIN block in %s" % path)
+    return options, records
+
+
+def format_value(field, fmt, value):
+    if fmt in "QI" and value > 0xFFFF and field not in ("size", "count", "nr"):
+        return "%s=0x%x" % (field, value)
+    return "%s=%d" % (field, value)
+
+
+def main():
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial log, or a /dev/trace dump with --binary")
+    parser.add_argument("--binary", action="store_true", help="input holds raw /dev/trace records")
+    parser.add_argument("--events", default=os.path.join(root, "kernel/include/kernel/trace_events.h"),
+                        help="event definitions (default: %(default)s)")
+    parser.add_argument("--tsc-khz", type=int, help="TSC rate, for binary input")
+    args = parser.parse_args()
+
+    events = load_events(args.events)
+
+    if args.binary:
+        with open(args.input, "rb") as f:
+            records = list(split_records(f.read()))
+        options = {}
+    else:
+        options, records = read_serial(args.input)
+
+    tsc_khz = args.tsc_khz or int(options.get("tsc_khz", 0))
+    if int(options.get("dropped", 0)):
+        print("# %s records dropped (buffer full)" % options["dropped"])
+
+    decoded = []
+    for record in records:
+        tsc, event_id, size, cpu, pid = HEADER.unpack_from(record)
+        if event_id == ID_PAD:
+            continue
+        name, fields = events.get(event_id, ("event%d" % event_id, []))
+        values = [format_value(field, fmt, struct.unpack_from("<" + fmt, record, offset)[0])
+                  for field, fmt, offset in fields if offset < size]
+        decoded.append((tsc, cpu, pid, name, values))
+
+    decoded.sort(key=lambda r: r[0])
+    start = decoded[0][0] if decoded else 0
+    for tsc, cpu, pid, name, values in decoded:
+        when = "%.6f" % ((tsc - start) / (tsc_khz * 1e3)) if tsc_khz else "%d" % (tsc - start)
+        print("%s cpu%d pid %d %s %s" % (when, cpu, pid, name, " ".join(values)))
+
+
+if __name__ == "__main__":
+    main()
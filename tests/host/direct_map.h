@@ -0,0 +1,23 @@
+/**
+ * Hosted Direct Map
+ *
+ * Force-included when building kernel/mm/memblock.c for the host, in
+ * place of <kernel/vmm.h>: "physical" address p is byte p of the buffer
+ * set up by shim_direct_map(), so early allocations can be written to.
+ */
+
+#ifndef HOSTTEST_DIRECT_MAP_H
+#define HOSTTEST_DIRECT_MAP_H
+
+// Keep the kernel's direct map out
+#define KERNEL_VMM_H
+
+#include <stdint.h>
+
+extern uint8_t *shim_direct_map_base;
+
+static inline uint64_t vmm_phys_to_virt(uint64_t phys) {
+    return (uint64_t)(shim_direct_map_base + phys);
+}
+
+#endif // HOSTTEST_DIRECT_MAP_H
@@ -0,0 +1,242 @@
+/**
+ * Host Test Harness
+ *
+ * Test runner, checks, random numbers and the benchmark loop. The
+ * benchmark loop follows Google Benchmark: grow the iteration count
+ * until one run takes at least --min-time, then report that run.
+ */
+
+#include "hosttest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Test and benchmark tables, collected by the linker
+extern const hosttest_case_t __start_hosttest_cases[] __attribute__((weak));
+extern const hosttest_case_t __stop_hosttest_cases[] __attribute__((weak));
+extern const hostbench_t __start_hosttest_benches[] __attribute__((weak));
+extern const hostbench_t __stop_hosttest_benches[] __attribute__((weak));
+
+#define BENCH_MAX_ITERATIONS 1000000000ULL
+
+uint32_t hosttest_kernel_errors = 0;
+bool hosttest_verbose = false;
+
+static uint64_t run_seed;
+static uint64_t rng_state;
+static uint32_t check_failures;
+static uint32_t allowed_kernel_errors;
+
+/**
+ * Seed for one test: the run seed mixed with an FNV-1a hash of its name
+ */
+static void hosttest_reseed(const char *name) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 0x100000001B3ULL;
+    }
+    rng_state = (run_seed ^ hash) | 1;
+}
+
+uint64_t hosttest_rand(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+uint64_t hosttest_rand_below(uint64_t bound) {
+    return bound ? hosttest_rand() % bound : 0;
+}
+
+void hosttest_rand_fill(void *buffer, size_t size) {
+    uint8_t *p = (uint8_t *)buffer;
+    for (size_t i = 0; i < size; i++) {
+        p[i] = (uint8_t)hosttest_rand();
+    }
+}
+
+bool hosttest_check(bool ok, const char *expr, const char *file, int line) {
+    if (!ok) {
+        printf("    %s:%d: CHECK failed: %s\n", file, line, expr);
+        check_failures++;
+    }
+    return ok;
+}
+
+bool hosttest_check_eq(uint64_t a, uint64_t b, const char *expr, const char *file, int line) {
+    if (a != b) {
+        printf("    %s:%d: CHECK failed: %s (%llu vs %llu)\n", file, line, expr,
+               (unsigned long long)a, (unsigned long long)b);
+        check_failures++;
+    }
+    return a == b;
+}
+
+void hosttest_expect_kernel_errors(uint32_t count) {
+    allowed_kernel_errors += count;
+}
+
+/**
+ * Monotonic time in seconds
+ */
+static double hosttest_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Run every test that matches the filter
+ *
+ * @return Number of failed tests
+ */
+static uint32_t hosttest_run_tests(const char *filter) {
+    uint32_t passed = 0;
+    uint32_t failed = 0;
+
+    for (const hosttest_case_t *test = __start_hosttest_cases;
+         test < __stop_hosttest_cases; test++) {
+        if (filter && !strstr(test->name, filter)) {
+            continue;
+        }
+
+        hosttest_reseed(test->name);
+        check_failures = 0;
+        allowed_kernel_errors = 0;
+        uint32_t errors_before = hosttest_kernel_errors;
+
+        double start = hosttest_now();
+        test->run();
+        double elapsed = hosttest_now() - start;
+
+        uint32_t kernel_errors = hosttest_kernel_errors - errors_before;
+        if (kernel_errors > allowed_kernel_errors) {
+            printf("    %u unexpected kernel error(s), rerun with -v\n",
+                   kernel_errors - allowed_kernel_errors);
+            check_failures++;
+        }
+
+        if (check_failures) {
+            printf("FAIL %s (seed %llu)\n", test->name, (unsigned long long)run_seed);
+            failed++;
+        } else {
+            printf("ok   %s (%.0f ms)\n", test->name, elapsed * 1e3);
+            passed++;
+        }
+    }
+
+    printf("%u passed, %u failed\n", passed, failed);
+    return failed;
+}
+
+/**
+ * Time one benchmark argument and print a result line
+ */
+static void hosttest_measure(const hostbench_t *bench, uint64_t arg, double min_time) {
+    uint64_t iterations = 1;
+    double elapsed;
+
+    while (1) {
+        double start = hosttest_now();
+        bench->run(iterations, arg);
+        elapsed = hosttest_now() - start;
+
+        if (elapsed >= min_time || iterations >= BENCH_MAX_ITERATIONS) {
+            break;
+        }
+
+        // Aim 40% past the minimum; grow by at most 10x per step
+        double multiplier = elapsed > 0 ? min_time * 1.4 / elapsed : 10.0;
+        if (multiplier > 10.0) {
+            multiplier = 10.0;
+        }
+        uint64_t next = (uint64_t)(iterations * multiplier);
+        iterations = next > iterations ? next : iterations + 1;
+        if (iterations > BENCH_MAX_ITERATIONS) {
+            iterations = BENCH_MAX_ITERATIONS;
+        }
+    }
+
+    char name[96];
+    snprintf(name, sizeof(name), "%s/%llu", bench->name, (unsigned long long)arg);
+    printf("%-40s %12.1f ns %14llu\n", name, elapsed * 1e9 / iterations,
+           (unsigned long long)iterations);
+}
+
+/**
+ * Run every benchmark that matches the filter
+ */
+static void hosttest_run_benches(const char *filter, double min_time) {
+    if (__stop_hosttest_benches - __start_hosttest_benches == 0) {
+        return;
+    }
+
+    printf("%-40s %15s %14s\n", "Benchmark", "Time", "Iterations");
+    printf("-----------------------------------------------------------------------\n");
+
+    for (const hostbench_t *bench = __start_hosttest_benches;
+         bench < __stop_hosttest_benches; bench++) {
+        if (filter && !strstr(bench->name, filter)) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < bench->num_args; i++) {
+            uint64_t arg = bench->args[i];
+            hosttest_reseed(bench->name);
+
+            if (bench->setup && bench->setup(arg) != 0) {
+                printf("%s/%llu: skipped\n", bench->name, (unsigned long long)arg);
+                continue;
+            }
+
+            hosttest_measure(bench, arg, min_time);
+
+            if (bench->teardown) {
+                bench->teardown();
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    bool run_tests = true;
+    bool run_benches = true;
+    double min_time = 0.2;
+
+    run_seed = (uint64_t)time(NULL);
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--seed=", 7) == 0) {
+            run_seed = strtoull(argv[i] + 7, NULL, 0);
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (strcmp(argv[i], "--no-bench") == 0) {
+            run_benches = false;
+        } else if (strcmp(argv[i], "--bench-only") == 0) {
+            run_tests = false;
+        } else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            min_time = strtod(argv[i] + 11, NULL);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            hosttest_verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [--seed=N] [--filter=STR] [--no-bench] "
+                    "[--bench-only] [--min-time=S] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("== %s (seed %llu)\n", argv[0], (unsigned long long)run_seed);
+
+    uint32_t failed = 0;
+    if (run_tests) {
+        failed = hosttest_run_tests(filter);
+    }
+    if (run_benches && failed == 0) {
+        hosttest_run_benches(filter, min_time);
+    }
+
+    return failed ? 1 : 0;
+}
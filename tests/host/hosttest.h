@@ -0,0 +1,146 @@
+/**
+ * Host Test Harness
+ *
+ * Runs pure kernel code (allocators, string routines, filesystem) as an
+ * ordinary Linux program. Tests and benchmarks are declared anywhere in
+ * a test binary with HOSTTEST() and HOSTBENCH() and collected from
+ * their own sections, the same way KBENCH() cases are in the kernel.
+ *
+ * Every test gets its own random seed derived from the run seed and the
+ * test name, so a failure reported as
+ *
+ *   FAIL heap_random_stress (seed 1234)
+ *
+ * reproduces with --seed=1234 --filter=heap_random_stress.
+ *
+ * Options:
+ *   --seed=N       Run seed (default: time based, always printed)
+ *   --filter=STR   Only run tests and benchmarks whose name contains STR
+ *   --no-bench     Skip benchmarks
+ *   --bench-only   Skip tests
+ *   --min-time=S   Minimum measured time per benchmark (default 0.2)
+ *   -v             Show kernel console output
+ */
+
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Test case
+ */
+typedef struct hosttest_case {
+    const char *name;
+    void (*run)(void);
+} hosttest_case_t;
+
+/**
+ * Benchmark
+ *
+ * run() performs `iterations` operations and is timed as a whole;
+ * setup() runs untimed once per argument and may return -1 to skip.
+ */
+typedef struct hostbench {
+    const char *name;
+    void (*run)(uint64_t iterations, uint64_t arg);
+    int (*setup)(uint64_t arg);     // Optional
+    void (*teardown)(void);         // Optional; runs only after a successful setup
+    const uint64_t *args;
+    uint32_t num_args;
+} hostbench_t;
+
+/**
+ * Declare a test
+ *
+ *   HOSTTEST(kmalloc_zero_size) {
+ *       CHECK(kmalloc(0) == NULL);
+ *   }
+ */
+#define HOSTTEST(name_)                                                     \
+    static void hosttest_run_##name_(void);                                 \
+    static const hosttest_case_t hosttest_case_##name_                      \
+        __attribute__((used, section("hosttest_cases"), aligned(8))) = {    \
+        .name = #name_,                                                     \
+        .run = hosttest_run_##name_,                                        \
+    };                                                                      \
+    static void hosttest_run_##name_(void)
+
+/**
+ * Declare a benchmark, run once for each argument that follows
+ *
+ * Results are reported per argument as name/arg:
+ *
+ *   HOSTBENCH(kmalloc_kfree, heap_setup, NULL, 16, 64, 512) {
+ *       for (uint64_t i = 0; i < iterations; i++) {
+ *           kfree(kmalloc(arg));
+ *       }
+ *   }
+ */
+#define HOSTBENCH(name_, setup_, teardown_, ...)                            \
+    static void hostbench_run_##name_(uint64_t iterations, uint64_t arg);   \
+    static const hostbench_t hostbench_##name_                              \
+        __attribute__((used, section("hosttest_benches"), aligned(8))) = {  \
+        .name = #name_,                                                     \
+        .run = hostbench_run_##name_,                                       \
+        .setup = (setup_),                                                  \
+        .teardown = (teardown_),                                            \
+        .args = (const uint64_t[]){ __VA_ARGS__ },                          \
+        .num_args = sizeof((const uint64_t[]){ __VA_ARGS__ }) / sizeof(uint64_t), \
+    };                                                                      \
+    static void hostbench_run_##name_(uint64_t iterations __attribute__((unused)), \
+                                      uint64_t arg __attribute__((unused)))
+
+/**
+ * Keep a value (and everything it points to) alive across the timed loop
+ */
+#define HOSTBENCH_KEEP(value) __asm__ volatile("" :: "g"(value) : "memory")
+
+/**
+ * Checks
+ *
+ * CHECK() records a failure and carries on; REQUIRE() also returns from
+ * the test, for when later checks would only crash.
+ */
+#define CHECK(cond) \
+    hosttest_check((cond), #cond, __FILE__, __LINE__)
+
+#define CHECK_EQ(a, b) \
+    hosttest_check_eq((uint64_t)(a), (uint64_t)(b), #a " == " #b, __FILE__, __LINE__)
+
+#define REQUIRE(cond) do {                                                  \
+        if (!CHECK(cond)) return;                                           \
+    } while (0)
+
+bool hosttest_check(bool ok, const char *expr, const char *file, int line);
+bool hosttest_check_eq(uint64_t a, uint64_t b, const char *expr, const char *file, int line);
+
+/**
+ * Random numbers (xorshift64*), reseeded for every test and benchmark
+ */
+uint64_t hosttest_rand(void);
+
+/**
+ * Random number in [0, bound)
+ */
+uint64_t hosttest_rand_below(uint64_t bound);
+
+/**
+ * Fill a buffer with random bytes
+ */
+void hosttest_rand_fill(void *buffer, size_t size);
+
+/**
+ * Kernel console accounting
+ *
+ * The shim counts ERROR/WARNING lines printed by kernel code; a test
+ * fails if it provokes more of them than it announced.
+ */
+extern uint32_t hosttest_kernel_errors;
+extern bool hosttest_verbose;
+
+void hosttest_expect_kernel_errors(uint32_t count);
+
+#endif // HOSTTEST_H
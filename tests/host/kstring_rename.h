@@ -0,0 +1,27 @@
+/**
+ * Kernel String Routine Names
+ *
+ * Force-included when building lib/string.c for the host so its
+ * functions come out as kmemcpy(), kstrlen() and so on, and can be
+ * tested and timed against the C library's.
+ */
+
+#ifndef HOSTTEST_KSTRING_RENAME_H
+#define HOSTTEST_KSTRING_RENAME_H
+
+#define memset      kmemset
+#define memcpy      kmemcpy
+#define memmove     kmemmove
+#define memcmp      kmemcmp
+#define strlen      kstrlen
+#define strcpy      kstrcpy
+#define strncpy     kstrncpy
+#define strcmp      kstrcmp
+#define strncmp     kstrncmp
+#define strcat      kstrcat
+#define strchr      kstrchr
+#define strrchr     kstrrchr
+#define snprintf    ksnprintf
+#define vsnprintf   kvsnprintf
+
+#endif // HOSTTEST_KSTRING_RENAME_H
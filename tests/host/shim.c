@@ -0,0 +1,276 @@
+/**
+ * Hosted Kernel Shim: console, scheduler, VFS helper, block device and
+ * the direct map seen by memblock.c
+ */
+
+#include "shim.h"
+#include "hosttest.h"
+#include <kernel/vga.h>
+#include <kernel/vfs.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/trace.h>
+#include <kernel/reclaim.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**
+ * Backing file of a shim block device
+ */
+typedef struct shim_block {
+    int fd;
+    uint64_t reads;
+    uint64_t writes;
+} shim_block_t;
+
+/**
+ * Kernel console
+ *
+ * Output is only shown with -v, but ERROR and WARNING lines are always
+ * counted so the runner can fail tests that provoke them.
+ */
+void vga_printf(const char *format, ...) {
+    char line[512];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    const char *text = line;
+    while (*text == ' ' || *text == '\n') {
+        text++;
+    }
+    if (strncmp(text, "ERROR", 5) == 0 || strncmp(text, "WARNING", 7) == 0) {
+        hosttest_kernel_errors++;
+    }
+
+    if (hosttest_verbose) {
+        fputs(line, stdout);
+    }
+}
+
+/**
+ * Scheduler stubs: there are no tasks on the host
+ */
+process_t *process_create_kernel_task(void (*entry)(void), const char *name, uint32_t priority) {
+    (void)entry;
+    (void)name;
+    (void)priority;
+    return NULL;
+}
+
+void scheduler_add_process(process_t *process) {
+    (void)process;
+}
+
+void process_sleep(uint64_t ticks) {
+    (void)ticks;
+}
+
+/**
+ * Tracepoints: keys exist so the call sites link, but are never enabled
+ */
+#define TRACE_EVENT(name, proto, args, fields, assign)                        \
+    static_key_t trace_key_##name = STATIC_KEY_INIT_FALSE;                    \
+    void trace_emit_##name(proto) {}
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include <kernel/trace_events.h>
+#pragma GCC diagnostic pop
+#undef TRACE_EVENT
+
+/**
+ * Reclaim: no kswapd and no direct reclaim, but shrinkers are recorded
+ * so tests can drive them
+ */
+static shrinker_t *shim_shrinkers[MAX_SHRINKERS];
+static uint32_t shim_shrinker_count = 0;
+
+int shrinker_register(shrinker_t *shrinker) {
+    for (uint32_t i = 0; i < shim_shrinker_count; i++) {
+        if (shim_shrinkers[i] == shrinker) {
+            return 0;       // Re-registered by a fresh heap_init()
+        }
+    }
+    if (shim_shrinker_count >= MAX_SHRINKERS) {
+        return -1;
+    }
+    shim_shrinkers[shim_shrinker_count++] = shrinker;
+    return 0;
+}
+
+shrinker_t *shim_shrinker(const char *name) {
+    for (uint32_t i = 0; i < shim_shrinker_count; i++) {
+        if (strcmp(shim_shrinkers[i]->name, name) == 0) {
+            return shim_shrinkers[i];
+        }
+    }
+    return NULL;
+}
+
+size_t reclaim_direct(size_t count) {
+    (void)count;
+    return 0;
+}
+
+void reclaim_wake_kswapd(void) {
+}
+
+/**
+ * Direct map: "physical" memory is a lazily committed anonymous mapping
+ */
+uint8_t *shim_direct_map_base = NULL;
+static uint64_t shim_direct_map_size = 0;
+
+void shim_direct_map(uint64_t size) {
+    if (shim_direct_map_base) {
+        munmap(shim_direct_map_base, shim_direct_map_size);
+    }
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("shim_direct_map");
+        exit(1);
+    }
+    shim_direct_map_base = base;
+    shim_direct_map_size = size;
+}
+
+/**
+ * Fill one getdents64 record (same as kernel/fs/vfs.c)
+ */
+int vfs_fill_dirent64(void *buffer, size_t size, uint32_t inode,
+                      uint32_t type, const char *name) {
+    size_t namelen = strlen(name);
+    if (namelen > 255) {
+        namelen = 255;
+    }
+
+    size_t reclen = VFS_DIRENT64_RECLEN(namelen);
+    if (reclen > size) {
+        return 0;
+    }
+
+    vfs_dirent64_t *d = (vfs_dirent64_t *)buffer;
+    d->inode = inode;
+    d->reclen = (uint16_t)reclen;
+    d->type = (uint8_t)type;
+    d->namelen = (uint8_t)namelen;
+    memcpy(d->name, name, namelen);
+    memset(d->name + namelen, 0, reclen - sizeof(vfs_dirent64_t) - namelen);
+
+    return (int)reclen;
+}
+
+/**
+ * File-backed block device operations
+ */
+static int shim_read_blocks(block_device_t *dev, uint64_t start_block, uint32_t count,
+                            uint8_t *buffer) {
+    shim_block_t *blk = (shim_block_t *)dev->driver_data;
+    if (start_block + count > dev->num_blocks) {
+        return -1;
+    }
+
+    size_t bytes = (size_t)count * BLOCK_SIZE;
+    blk->reads += count;
+    return pread(blk->fd, buffer, bytes, start_block * BLOCK_SIZE) == (ssize_t)bytes ? 0 : -1;
+}
+
+static int shim_write_blocks(block_device_t *dev, uint64_t start_block, uint32_t count,
+                             const uint8_t *buffer) {
+    shim_block_t *blk = (shim_block_t *)dev->driver_data;
+    if (start_block + count > dev->num_blocks) {
+        return -1;
+    }
+
+    size_t bytes = (size_t)count * BLOCK_SIZE;
+    blk->writes += count;
+    return pwrite(blk->fd, buffer, bytes, start_block * BLOCK_SIZE) == (ssize_t)bytes ? 0 : -1;
+}
+
+static int shim_read_block(block_device_t *dev, uint64_t block, uint8_t *buffer) {
+    return shim_read_blocks(dev, block, 1, buffer);
+}
+
+static int shim_write_block(block_device_t *dev, uint64_t block, const uint8_t *buffer) {
+    return shim_write_blocks(dev, block, 1, buffer);
+}
+
+block_device_t *shim_block_create(const char *name, uint64_t num_blocks) {
+    const char *tmpdir = getenv("TMPDIR");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/hosttest-XXXXXX", tmpdir ? tmpdir : "/tmp");
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return NULL;
+    }
+    unlink(path);
+
+    if (ftruncate(fd, (off_t)(num_blocks * BLOCK_SIZE)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    block_device_t *dev = calloc(1, sizeof(block_device_t));
+    shim_block_t *blk = calloc(1, sizeof(shim_block_t));
+    if (!dev || !blk) {
+        free(dev);
+        free(blk);
+        close(fd);
+        return NULL;
+    }
+
+    blk->fd = fd;
+    snprintf(dev->name, sizeof(dev->name), "%s", name);
+    dev->type = BLOCK_TYPE_RAMDISK;
+    dev->block_size = BLOCK_SIZE;
+    dev->num_blocks = num_blocks;
+    dev->size = num_blocks * BLOCK_SIZE;
+    dev->read_block = shim_read_block;
+    dev->write_block = shim_write_block;
+    dev->read_blocks = shim_read_blocks;
+    dev->write_blocks = shim_write_blocks;
+    dev->driver_data = blk;
+
+    return dev;
+}
+
+void shim_block_destroy(block_device_t *dev) {
+    if (!dev) {
+        return;
+    }
+
+    shim_block_t *blk = (shim_block_t *)dev->driver_data;
+    close(blk->fd);
+    free(blk);
+    free(dev);
+}
+
+void shim_block_corrupt(block_device_t *dev, uint64_t block, uint32_t offset) {
+    shim_block_t *blk = (shim_block_t *)dev->driver_data;
+    off_t pos = (off_t)(block * BLOCK_SIZE + offset);
+    uint8_t byte;
+
+    if (pread(blk->fd, &byte, 1, pos) == 1) {
+        byte ^= 0x5A;
+        if (pwrite(blk->fd, &byte, 1, pos) != 1) {
+            abort();
+        }
+    }
+}
+
+uint64_t shim_block_reads(block_device_t *dev) {
+    return ((shim_block_t *)dev->driver_data)->reads;
+}
+
+uint64_t shim_block_writes(block_device_t *dev) {
+    return ((shim_block_t *)dev->driver_data)->writes;
+}
@@ -0,0 +1,84 @@
+/**
+ * Hosted Kernel Shim
+ *
+ * Just enough of the kernel for pmm.c, memblock.c, heap.c and
+ * simplefs.c to link into a Linux program:
+ *
+ *   shim.c     vga_printf, scheduler/process/reclaim stubs,
+ *              vfs_fill_dirent64, a block device backed by a
+ *              temporary file and the direct map (see direct_map.h)
+ *   shim_mm.c  a PMM whose pages come from malloc and a VMM that maps
+ *              heap pages inside a reserved address range
+ */
+
+#ifndef HOSTTEST_SHIM_H
+#define HOSTTEST_SHIM_H
+
+#include <kernel/block.h>
+#include <kernel/reclaim.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Create a block device backed by an unlinked temporary file
+ *
+ * @param name Device name
+ * @param num_blocks Size in BLOCK_SIZE blocks
+ * @return Device, or NULL on failure
+ */
+block_device_t *shim_block_create(const char *name, uint64_t num_blocks);
+
+/**
+ * Close and free a device from shim_block_create()
+ */
+void shim_block_destroy(block_device_t *dev);
+
+/**
+ * Flip bits of one byte on the backing file, behind the driver's back
+ */
+void shim_block_corrupt(block_device_t *dev, uint64_t block, uint32_t offset);
+
+/**
+ * Block reads and writes issued to a device since creation
+ */
+uint64_t shim_block_reads(block_device_t *dev);
+uint64_t shim_block_writes(block_device_t *dev);
+
+/**
+ * Find a shrinker registered with shrinker_register()
+ *
+ * @param name Shrinker name
+ * @return Shrinker, or NULL if none has that name
+ */
+shrinker_t *shim_shrinker(const char *name);
+
+/**
+ * Back "physical" addresses [0, size) with fresh zeroed host memory
+ *
+ * Replaces the previous mapping, so earlier memblock_alloc() pointers
+ * become invalid.
+ */
+void shim_direct_map(uint64_t size);
+
+// Host address of "physical" address 0
+extern uint8_t *shim_direct_map_base;
+
+/**
+ * Start a fresh kernel heap of the given size
+ *
+ * Releases every page of the previous heap, so earlier kmalloc()
+ * pointers become invalid (and fault if touched).
+ */
+void shim_heap_init(size_t initial_size);
+
+/**
+ * Limit the fake PMM to this many more pages (0: unlimited)
+ */
+void shim_pmm_set_limit(uint32_t pages);
+
+/**
+ * Pages currently handed out by the fake PMM
+ */
+uint32_t shim_pmm_pages_in_use(void);
+
+#endif // HOSTTEST_SHIM_H
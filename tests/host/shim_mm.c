@@ -0,0 +1,155 @@
+/**
+ * Hosted Kernel Shim: memory management
+ *
+ * heap.c grows by taking pages from the PMM and mapping them at the end
+ * of its virtual range. Here the PMM hands out malloc'd pages (so leaks
+ * and limits can be accounted for) and the heap's virtual range is a
+ * PROT_NONE reservation that vmm_map_page() opens one page at a time,
+ * so running off the end of the heap faults just like in the kernel.
+ */
+
+#include "shim.h"
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/heap.h>
+#include <kernel/memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Virtual range reserved for the kernel heap
+#define SHIM_HEAP_RESERVE (256ULL * 1024 * 1024)
+
+static uint8_t *heap_region = NULL;
+
+// "Physical" page behind each mapped page of the reservation
+static uint64_t heap_phys[SHIM_HEAP_RESERVE / PAGE_SIZE];
+
+// Pages handed out by the fake PMM
+static void **pages = NULL;
+static uint32_t page_count = 0;
+static uint32_t page_capacity = 0;
+static uint32_t page_limit = 0;
+
+/**
+ * Allocate a "physical" page
+ */
+uint64_t pmm_alloc_page(void) {
+    if (page_limit && page_count >= page_limit) {
+        return 0;
+    }
+
+    if (page_count == page_capacity) {
+        uint32_t capacity = page_capacity ? page_capacity * 2 : 256;
+        void **grown = realloc(pages, capacity * sizeof(void *));
+        if (!grown) {
+            return 0;
+        }
+        pages = grown;
+        page_capacity = capacity;
+    }
+
+    void *page = aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+    if (!page) {
+        return 0;
+    }
+
+    pages[page_count++] = page;
+    return (uint64_t)page;
+}
+
+/**
+ * Free a "physical" page
+ */
+void pmm_free_page(uint64_t addr) {
+    for (uint32_t i = page_count; i > 0; i--) {
+        if ((uint64_t)pages[i - 1] == addr) {
+            free(pages[i - 1]);
+            pages[i - 1] = pages[--page_count];
+            return;
+        }
+    }
+}
+
+/**
+ * Page ownership is not tracked on the host
+ */
+void pmm_set_owner(uint64_t addr, size_t count, page_owner_t owner, uint32_t pid) {
+    (void)addr;
+    (void)count;
+    (void)owner;
+    (void)pid;
+}
+
+/**
+ * Map a heap page: open it up inside the reservation
+ *
+ * The physical page only backs the accounting; the memory the heap
+ * touches is the reservation's own.
+ */
+int vmm_map_page(uint64_t virt, uint64_t phys, uint64_t flags) {
+    (void)flags;
+
+    uint8_t *page = (uint8_t *)virt;
+    if (page < heap_region || page + PAGE_SIZE > heap_region + SHIM_HEAP_RESERVE) {
+        return -1;
+    }
+
+    heap_phys[(page - heap_region) / PAGE_SIZE] = phys;
+    return mprotect(page, PAGE_SIZE, PROT_READ | PROT_WRITE);
+}
+
+/**
+ * Unmap a heap page: close it again and drop its contents
+ */
+void vmm_unmap_page(uint64_t virt) {
+    uint8_t *page = (uint8_t *)virt;
+    if (page < heap_region || page + PAGE_SIZE > heap_region + SHIM_HEAP_RESERVE) {
+        return;
+    }
+
+    heap_phys[(page - heap_region) / PAGE_SIZE] = 0;
+    madvise(page, PAGE_SIZE, MADV_DONTNEED);
+    mprotect(page, PAGE_SIZE, PROT_NONE);
+}
+
+uint64_t vmm_get_physical(uint64_t virt) {
+    uint8_t *page = (uint8_t *)virt;
+    if (page < heap_region || page >= heap_region + SHIM_HEAP_RESERVE) {
+        return 0;
+    }
+
+    return heap_phys[(page - heap_region) / PAGE_SIZE] + (virt & (PAGE_SIZE - 1));
+}
+
+void shim_heap_init(size_t initial_size) {
+    if (!heap_region) {
+        heap_region = mmap(NULL, SHIM_HEAP_RESERVE, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (heap_region == MAP_FAILED) {
+            perror("shim: heap reservation");
+            abort();
+        }
+    } else {
+        // Drop the old heap's contents and close the range again
+        madvise(heap_region, SHIM_HEAP_RESERVE, MADV_DONTNEED);
+        mprotect(heap_region, SHIM_HEAP_RESERVE, PROT_NONE);
+    }
+
+    memset(heap_phys, 0, sizeof(heap_phys));
+    while (page_count) {
+        free(pages[--page_count]);
+    }
+    page_limit = 0;
+
+    heap_init((uint64_t)heap_region, initial_size);
+}
+
+void shim_pmm_set_limit(uint32_t count) {
+    page_limit = count ? page_count + count : 0;
+}
+
+uint32_t shim_pmm_pages_in_use(void) {
+    return page_count;
+}
@@ -0,0 +1,275 @@
+/**
+ * Kernel heap (kernel/mm/heap.c)
+ *
+ * Random allocation traces checked for overlap, content corruption and
+ * list integrity, on top of the shim's malloc-backed PMM.
+ */
+
+#include "hosttest.h"
+#include "shim.h"
+#include <kernel/heap.h>
+#include <kernel/memory.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEAP_INITIAL_SIZE   (64 * 1024)
+#define MAX_LIVE            512
+
+typedef struct allocation {
+    uint8_t *ptr;
+    size_t size;
+    uint8_t fill;
+} allocation_t;
+
+static allocation_t live[MAX_LIVE];
+static uint32_t live_count;
+
+/**
+ * Random allocation size: mostly small, sometimes large
+ */
+static size_t random_size(void) {
+    switch (hosttest_rand_below(8)) {
+    case 0:  return 1 + hosttest_rand_below(8192);
+    case 1:  return 1 + hosttest_rand_below(1024);
+    default: return 1 + hosttest_rand_below(128);
+    }
+}
+
+static bool contents_intact(const allocation_t *a) {
+    for (size_t i = 0; i < a->size; i++) {
+        if (a->ptr[i] != a->fill) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int compare_ptr(const void *x, const void *y) {
+    const allocation_t *a = x, *b = y;
+    return (a->ptr > b->ptr) - (a->ptr < b->ptr);
+}
+
+/**
+ * No two live allocations may overlap
+ */
+static bool no_overlap(void) {
+    allocation_t sorted[MAX_LIVE];
+    memcpy(sorted, live, live_count * sizeof(allocation_t));
+    qsort(sorted, live_count, sizeof(allocation_t), compare_ptr);
+
+    for (uint32_t i = 1; i < live_count; i++) {
+        if (sorted[i - 1].ptr + sorted[i - 1].size > sorted[i].ptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+HOSTTEST(heap_random_stress) {
+    shim_heap_init(HEAP_INITIAL_SIZE);
+    live_count = 0;
+
+    for (int op = 0; op < 20000; op++) {
+        if (live_count == MAX_LIVE || (live_count && hosttest_rand_below(100) < 45)) {
+            uint32_t i = (uint32_t)hosttest_rand_below(live_count);
+            CHECK(contents_intact(&live[i]));
+            kfree(live[i].ptr);
+            live[i] = live[--live_count];
+        } else if (live_count && hosttest_rand_below(100) < 10) {
+            // Grow or shrink in place or by moving; the old contents must survive
+            allocation_t *a = &live[hosttest_rand_below(live_count)];
+            size_t size = random_size();
+            uint8_t *ptr = krealloc(a->ptr, size);
+            REQUIRE(ptr != NULL);
+            size_t kept = size < a->size ? size : a->size;
+            for (size_t i = 0; i < kept; i++) {
+                CHECK(ptr[i] == a->fill);
+            }
+            memset(ptr, a->fill, size);
+            a->ptr = ptr;
+            a->size = size;
+        } else {
+            allocation_t a = { NULL, random_size(), (uint8_t)hosttest_rand() };
+            a.ptr = kmalloc(a.size);
+            REQUIRE(a.ptr != NULL);
+            CHECK_EQ((uint64_t)a.ptr % 8, 0);
+            memset(a.ptr, a.fill, a.size);
+            live[live_count++] = a;
+        }
+
+        if (op % 512 == 0) {
+            REQUIRE(heap_validate());
+            REQUIRE(no_overlap());
+            CHECK_EQ(heap_get_allocation_count(), live_count);
+        }
+    }
+
+    for (uint32_t i = 0; i < live_count; i++) {
+        CHECK(contents_intact(&live[i]));
+        kfree(live[i].ptr);
+    }
+    live_count = 0;
+
+    CHECK(heap_validate());
+    CHECK_EQ(heap_get_allocation_count(), 0);
+    CHECK_EQ(heap_get_used_size(), 0);
+    CHECK_EQ(heap_get_free_size(), heap_get_total_size());
+}
+
+HOSTTEST(heap_grows_past_initial_size) {
+    shim_heap_init(HEAP_INITIAL_SIZE);
+    uint32_t pages = shim_pmm_pages_in_use();
+
+    void *big = kmalloc(4 * HEAP_INITIAL_SIZE);
+    REQUIRE(big != NULL);
+    memset(big, 0xA5, 4 * HEAP_INITIAL_SIZE);  // Faults if not mapped
+
+    CHECK(heap_get_total_size() > 4 * HEAP_INITIAL_SIZE);
+    CHECK(shim_pmm_pages_in_use() > pages);
+    CHECK(heap_validate());
+    kfree(big);
+}
+
+HOSTTEST(heap_shrinker_returns_free_tail_pages) {
+    shim_heap_init(HEAP_INITIAL_SIZE);
+    shrinker_t *shrinker = shim_shrinker("heap");
+    REQUIRE(shrinker != NULL);
+    uint32_t pages = shim_pmm_pages_in_use();
+
+    // Nothing above the initial size yet
+    CHECK_EQ(shrinker->count(shrinker), 0);
+
+    // Growth overshoots; the spare tail goes back without touching big
+    void *big = kmalloc(4 * HEAP_INITIAL_SIZE);
+    REQUIRE(big != NULL);
+    size_t spare = shrinker->count(shrinker);
+    CHECK(spare > 0);
+    CHECK_EQ(shrinker->scan(shrinker, spare), spare);
+    memset(big, 0xA5, 4 * HEAP_INITIAL_SIZE);  // Faults if unmapped
+    CHECK(heap_validate());
+    kfree(big);
+
+    size_t freeable = shrinker->count(shrinker);
+    CHECK_EQ(freeable, shim_pmm_pages_in_use() - pages);
+
+    // Partial scan, then the rest
+    CHECK_EQ(shrinker->scan(shrinker, 2), 2);
+    CHECK_EQ(shrinker->scan(shrinker, freeable), freeable - 2);
+    CHECK_EQ(shrinker->count(shrinker), 0);
+    CHECK_EQ(shim_pmm_pages_in_use(), pages);
+    CHECK_EQ(heap_get_total_size(), HEAP_INITIAL_SIZE);
+    CHECK(heap_validate());
+
+    // The heap grows back over the unmapped range
+    big = kmalloc(4 * HEAP_INITIAL_SIZE);
+    REQUIRE(big != NULL);
+    memset(big, 0x5A, 4 * HEAP_INITIAL_SIZE);
+    CHECK(heap_validate());
+    kfree(big);
+}
+
+HOSTTEST(heap_out_of_memory_fails_cleanly) {
+    shim_heap_init(HEAP_INITIAL_SIZE);
+    shim_pmm_set_limit(4);
+
+    hosttest_expect_kernel_errors(1);
+    CHECK(kmalloc(64 * PAGE_SIZE) == NULL);
+
+    void *small = kmalloc(128);
+    CHECK(small != NULL);
+    CHECK(heap_validate());
+    kfree(small);
+}
+
+HOSTTEST(heap_kzalloc_krealloc_and_edges) {
+    shim_heap_init(HEAP_INITIAL_SIZE);
+
+    CHECK(kmalloc(0) == NULL);
+    kfree(NULL);
+
+    uint8_t *dirty = kmalloc(256);
+    REQUIRE(dirty != NULL);
+    memset(dirty, 0xFF, 256);
+    kfree(dirty);
+
+    uint8_t *zeroed = kzalloc(256);
+    REQUIRE(zeroed != NULL);
+    for (int i = 0; i < 256; i++) {
+        CHECK_EQ(zeroed[i], 0);
+    }
+
+    CHECK(krealloc(NULL, 32) != NULL);
+    CHECK(krealloc(zeroed, 0) == NULL);
+
+    for (size_t align = 8; align <= 4096; align *= 2) {
+        CHECK_EQ((uint64_t)kmalloc_aligned(100, align) % align, 0);
+    }
+}
+
+HOSTTEST(heap_bad_frees_are_reported) {
+    shim_heap_init(HEAP_INITIAL_SIZE);
+
+    uint8_t *p = kmalloc(64);
+    REQUIRE(p != NULL);
+    uint32_t count = heap_get_allocation_count();
+
+    hosttest_expect_kernel_errors(2);
+    kfree(p);
+    kfree(p);           // Double free
+    kfree(p + 8);       // Not the start of a block
+
+    CHECK_EQ(heap_get_allocation_count(), count - 1);
+    CHECK(heap_validate());
+}
+
+/**
+ * Benchmarks
+ *
+ * kmalloc is first fit over a list of every block, so its cost depends
+ * on how many blocks sit in front of the first fit: the fragmented
+ * variant leaves `arg` small live blocks between freed holes.
+ */
+static int heap_bench_setup(uint64_t arg) {
+    (void)arg;
+    shim_heap_init(1024 * 1024);
+    return 0;
+}
+
+static int heap_fragment_setup(uint64_t arg) {
+    shim_heap_init(1024 * 1024);
+
+    for (uint64_t i = 0; i < arg; i++) {
+        void *hole = kmalloc(24);
+        kmalloc(24);    // Kept live so the hole cannot coalesce
+        kfree(hole);
+    }
+    return 0;
+}
+
+HOSTBENCH(kmalloc_kfree, heap_bench_setup, NULL, 16, 64, 512, 4096) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        void *p = kmalloc(arg);
+        HOSTBENCH_KEEP(p);
+        kfree(p);
+    }
+}
+
+HOSTBENCH(kmalloc_kfree_fragmented, heap_fragment_setup, NULL, 16, 256, 2048) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        void *p = kmalloc(64);
+        HOSTBENCH_KEEP(p);
+        kfree(p);
+    }
+}
+
+HOSTBENCH(kmalloc_batch_64, heap_bench_setup, NULL, 64, 512) {
+    void *batch[512];
+    for (uint64_t i = 0; i < iterations; i += arg) {
+        for (uint64_t j = 0; j < arg; j++) {
+            batch[j] = kmalloc(64);
+        }
+        for (uint64_t j = 0; j < arg; j++) {
+            kfree(batch[j]);
+        }
+    }
+}
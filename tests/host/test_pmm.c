@@ -0,0 +1,311 @@
+/**
+ * Physical memory manager (kernel/mm/pmm.c) and memblock
+ *
+ * The real bitmap allocator, checked against a shadow copy of which
+ * pages are in use, on top of the real early allocator.
+ */
+
+#include "hosttest.h"
+#include "shim.h"
+#include <kernel/pmm.h>
+#include <kernel/memblock.h>
+#include <kernel/memory.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MB (1024ULL * 1024)
+
+static bool *shadow;
+static uint32_t shadow_pages;
+
+/**
+ * Boot the PMM on mem_size bytes of RAM starting at 0
+ */
+static void pmm_boot(uint64_t mem_size, uint64_t kernel_end) {
+    shim_direct_map(mem_size);
+    memblock_reset();
+    memblock_add(0, mem_size);
+    pmm_init(kernel_end);
+}
+
+/**
+ * Initialize the PMM and take the shadow from it
+ *
+ * pmm_init() also reserves the pages holding its own bitmap (placed
+ * by memblock), so the shadow is read back rather than predicted.
+ */
+static void pmm_reset(uint64_t mem_size, uint64_t kernel_end) {
+    pmm_boot(mem_size, kernel_end);
+
+    free(shadow);
+    shadow_pages = pmm_get_total_pages();
+    shadow = calloc(shadow_pages, sizeof(bool));
+    for (uint32_t i = 0; i < shadow_pages; i++) {
+        shadow[i] = !pmm_is_free((uint64_t)i * PAGE_SIZE);
+    }
+}
+
+static uint32_t shadow_used(void) {
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < shadow_pages; i++) {
+        used += shadow[i];
+    }
+    return used;
+}
+
+static bool shadow_matches(void) {
+    for (uint32_t i = 0; i < shadow_pages; i++) {
+        if (shadow[i] == pmm_is_free((uint64_t)i * PAGE_SIZE)) {
+            return false;
+        }
+    }
+    return pmm_get_used_pages() == shadow_used();
+}
+
+HOSTTEST(pmm_init_reserves_low_memory_and_kernel) {
+    pmm_reset(64 * MB, 3 * MB);
+
+    CHECK_EQ(pmm_get_total_pages(), 64 * MB / PAGE_SIZE);
+    CHECK_EQ(pmm_get_total_memory(), 64 * MB);
+    CHECK(!pmm_is_free(0));
+    for (uint64_t addr = KERNEL_PHYSICAL_START; addr < 3 * MB; addr += PAGE_SIZE) {
+        CHECK(!pmm_is_free(addr));
+    }
+    CHECK(pmm_get_used_pages() >= 1 + 2 * MB / PAGE_SIZE);
+    CHECK_EQ(pmm_get_free_pages() + pmm_get_used_pages(), pmm_get_total_pages());
+    CHECK(!pmm_is_free(64 * MB));  // Past the end
+}
+
+HOSTTEST(pmm_init_follows_memory_map) {
+    // A PC-like map: hole below 1MB, a second hole at 24-32MB
+    shim_direct_map(40 * MB);
+    memblock_reset();
+    memblock_add(0, 640 * 1024);
+    memblock_add(1 * MB, 23 * MB);
+    memblock_add(32 * MB, 8 * MB);
+    memblock_reserve(16 * MB + 100, 3 * PAGE_SIZE);     // Unaligned boot data
+    pmm_init(2 * MB);
+
+    CHECK_EQ(pmm_get_total_pages(), 40 * MB / PAGE_SIZE);
+    CHECK(!pmm_is_free(640 * 1024));
+    CHECK(!pmm_is_free(1 * MB - PAGE_SIZE));
+    CHECK(!pmm_is_free(24 * MB));
+    CHECK(!pmm_is_free(32 * MB - PAGE_SIZE));
+    CHECK(pmm_is_free(2 * MB));
+    CHECK(pmm_is_free(32 * MB));
+    for (uint64_t addr = 16 * MB; addr < 16 * MB + 4 * PAGE_SIZE; addr += PAGE_SIZE) {
+        CHECK(!pmm_is_free(addr));
+    }
+
+    // Metadata went to the top of RAM: the bitmap plus a struct page per page
+    uint32_t pages = 40 * MB / PAGE_SIZE;
+    uint32_t metadata_pages = BYTES_TO_PAGES(pages / 8 + pages * sizeof(page_t));
+    CHECK(!pmm_is_free(40 * MB - PAGE_SIZE));
+    CHECK(pmm_is_free(40 * MB - (metadata_pages + 1) * PAGE_SIZE));
+
+    // Every page handed out is usable RAM
+    uint64_t addr;
+    uint32_t allocated = 0;
+    while ((addr = pmm_alloc_page()) != 0) {
+        CHECK(addr != 0 && (addr < 640 * 1024 || addr >= 2 * MB));
+        CHECK(addr < 24 * MB || addr >= 32 * MB);
+        allocated++;
+    }
+    CHECK_EQ(allocated, 640 * 1024 / PAGE_SIZE - 1 + 22 * MB / PAGE_SIZE - 4 +
+                        8 * MB / PAGE_SIZE - metadata_pages);
+}
+
+HOSTTEST(memblock_merges_ranges_and_allocates_top_down) {
+    shim_direct_map(1 * MB);
+    memblock_reset();
+
+    memblock_add(0x10000, 0x1000);
+    memblock_add(0x30000, 0x1000);
+    memblock_add(0x20000, 0x1000);
+    CHECK_EQ(memblock_memory()->count, 3);
+    memblock_add(0x11000, 0x1F000);     // Fills the gaps, touches both ends
+    CHECK_EQ(memblock_memory()->count, 1);
+    CHECK_EQ(memblock_memory()->regions[0].base, 0x10000);
+    CHECK_EQ(memblock_end_of_ram(), 0x31000);
+    CHECK_EQ(memblock_phys_mem_size(), 0x21000);
+
+    // Highest free spot first, stepping below reservations
+    memblock_reserve(0x2F000, 0x1000);
+    CHECK_EQ(memblock_phys_alloc(0x1000, PAGE_SIZE), 0x30000);
+    CHECK_EQ(memblock_reserved()->count, 1);
+    CHECK_EQ(memblock_phys_alloc(0x1800, PAGE_SIZE), 0x2D000);
+    CHECK_EQ(memblock_reserved()->count, 2);
+    CHECK_EQ(memblock_phys_alloc(0x100000, PAGE_SIZE), 0);
+
+    // Small allocations fill the gap left by alignment; zeroed and writable
+    uint8_t *ptr = memblock_alloc(64, 64);
+    REQUIRE(ptr != NULL);
+    CHECK_EQ((uint64_t)(ptr - shim_direct_map_base), 0x2EFC0);
+    for (int i = 0; i < 64; i++) {
+        CHECK_EQ(ptr[i], 0);
+    }
+}
+
+HOSTTEST(pmm_random_alloc_free_matches_shadow) {
+    pmm_reset(32 * MB, 2 * MB);
+
+    typedef struct { uint64_t addr; uint32_t count; } allocation_t;
+    allocation_t *live = calloc(shadow_pages, sizeof(allocation_t));
+    uint32_t live_count = 0;
+
+    for (int op = 0; op < 20000; op++) {
+        if (live_count && hosttest_rand_below(100) < 45) {
+            uint32_t i = (uint32_t)hosttest_rand_below(live_count);
+            if (live[i].count == 1) {
+                pmm_free_page(live[i].addr);
+            } else {
+                pmm_free_pages(live[i].addr, live[i].count);
+            }
+            for (uint32_t p = 0; p < live[i].count; p++) {
+                shadow[live[i].addr / PAGE_SIZE + p] = false;
+            }
+            live[i] = live[--live_count];
+        } else {
+            uint32_t count = hosttest_rand_below(4) ? 1 : 1 + (uint32_t)hosttest_rand_below(16);
+            uint64_t addr = count == 1 ? pmm_alloc_page() : pmm_alloc_pages(count);
+            if (addr == 0) {
+                continue;  // Fragmented or full; the shadow check below still applies
+            }
+
+            CHECK_EQ(addr % PAGE_SIZE, 0);
+            REQUIRE(addr / PAGE_SIZE + count <= shadow_pages);
+            for (uint32_t p = 0; p < count; p++) {
+                CHECK(!shadow[addr / PAGE_SIZE + p]);
+                shadow[addr / PAGE_SIZE + p] = true;
+            }
+            live[live_count++] = (allocation_t){ addr, count };
+        }
+
+        if (op % 1024 == 0) {
+            REQUIRE(shadow_matches());
+        }
+    }
+
+    CHECK(shadow_matches());
+    free(live);
+}
+
+HOSTTEST(pmm_exhaustion_and_reuse) {
+    pmm_reset(8 * MB, 2 * MB);
+
+    uint32_t available = pmm_get_free_pages();
+    uint32_t allocated = 0;
+    uint64_t addr, last = 0;
+
+    while ((addr = pmm_alloc_page()) != 0) {
+        CHECK(!shadow[addr / PAGE_SIZE]);
+        shadow[addr / PAGE_SIZE] = true;
+        last = addr;
+        allocated++;
+    }
+
+    CHECK_EQ(allocated, available);
+    CHECK_EQ(pmm_get_free_pages(), 0);
+    CHECK_EQ(pmm_alloc_pages(2), 0);
+
+    pmm_free_page(last);
+    CHECK_EQ(pmm_alloc_page(), last);
+}
+
+HOSTTEST(pmm_contiguous_allocation_needs_a_real_run) {
+    pmm_reset(8 * MB, 2 * MB);
+
+    while (pmm_alloc_page() != 0) {
+    }
+
+    // Every other page free: plenty of memory, no two adjacent pages
+    uint64_t base = 4 * MB;
+    for (uint32_t i = 0; i < 64; i += 2) {
+        pmm_free_page(base + i * PAGE_SIZE);
+    }
+    CHECK_EQ(pmm_get_free_pages(), 32);
+    CHECK_EQ(pmm_alloc_pages(2), 0);
+
+    pmm_free_page(base + 11 * PAGE_SIZE);
+    CHECK_EQ(pmm_alloc_pages(3), base + 10 * PAGE_SIZE);
+}
+
+HOSTTEST(pmm_double_free_is_reported) {
+    pmm_reset(8 * MB, 2 * MB);
+
+    uint64_t addr = pmm_alloc_page();
+    REQUIRE(addr != 0);
+    uint32_t free_pages = pmm_get_free_pages();
+
+    hosttest_expect_kernel_errors(1);
+    pmm_free_page(addr);
+    pmm_free_page(addr);
+
+    CHECK_EQ(pmm_get_free_pages(), free_pages + 1);
+    pmm_free_page(0);   // Ignored
+    CHECK_EQ(pmm_get_free_pages(), free_pages + 1);
+}
+
+HOSTTEST(pmm_owner_counts_follow_alloc_retag_free) {
+    pmm_reset(16 * MB, 2 * MB);
+
+    uint32_t reserved = pmm_get_owner_pages(PAGE_OWNER_RESERVED);
+    CHECK_EQ(reserved, pmm_get_used_pages());
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_FREE), pmm_get_free_pages());
+    CHECK_EQ(pmm_get_page(0)->owner, PAGE_OWNER_RESERVED);
+    CHECK(pmm_get_page(16 * MB) == NULL);
+
+    uint64_t run = pmm_alloc_pages(4);
+    uint64_t single = pmm_alloc_page();
+    REQUIRE(run != 0 && single != 0);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_KERNEL), 5);
+
+    pmm_set_owner(run, 4, PAGE_OWNER_USER, 42);
+    pmm_set_owner(single, 1, PAGE_OWNER_PAGETABLE, 42);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_KERNEL), 0);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_USER), 4);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_PAGETABLE), 1);
+    CHECK_EQ(pmm_get_page(run + 3 * PAGE_SIZE)->pid, 42);
+
+    // Free pages cannot be tagged
+    uint32_t free_pages = pmm_get_free_pages();
+    pmm_free_pages(run, 4);
+    pmm_set_owner(run, 4, PAGE_OWNER_HEAP, 0);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_HEAP), 0);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_USER), 0);
+    CHECK_EQ(pmm_get_owner_pages(PAGE_OWNER_FREE), free_pages + 4);
+    CHECK_EQ(pmm_get_page(run)->pid, 0);
+
+    uint32_t total = 0;
+    for (uint32_t owner = 0; owner < PAGE_OWNER_COUNT; owner++) {
+        total += pmm_get_owner_pages((page_owner_t)owner);
+    }
+    CHECK_EQ(total, pmm_get_total_pages());
+}
+
+/**
+ * Benchmarks: allocation cost as the low end of memory fills up
+ *
+ * The argument is the percentage of a 256MB machine already in use,
+ * allocated from the bottom the way a booted kernel's would be.
+ */
+static int pmm_fill_setup(uint64_t percent) {
+    pmm_boot(256 * MB, 2 * MB);
+
+    uint32_t target = (uint32_t)(pmm_get_total_pages() * percent / 100);
+    while (pmm_get_used_pages() < target && pmm_alloc_page() != 0) {
+    }
+    return 0;
+}
+
+HOSTBENCH(pmm_alloc_free, pmm_fill_setup, NULL, 0, 50, 90) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        pmm_free_page(pmm_alloc_page());
+    }
+}
+
+HOSTBENCH(pmm_alloc_free_16_pages, pmm_fill_setup, NULL, 0, 50, 90) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        pmm_free_pages(pmm_alloc_pages(16), 16);
+    }
+}
@@ -0,0 +1,497 @@
+/**
+ * SimpleFS (kernel/fs/simplefs.c)
+ *
+ * Random file contents and directory trees on a file-backed block
+ * device, checked against an in-memory model across remounts, crashes
+ * and on-disk corruption.
+ */
+
+#include "hosttest.h"
+#include "shim.h"
+#include <kernel/simplefs.h>
+#include <kernel/crc32c.h>
+#include <kernel/heap.h>
+#include <kernel/vfs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DISK_BLOCKS     4096
+#define MAX_FILE_SIZE   (SIMPLEFS_MAX_FILE_BLOCKS * BLOCK_SIZE)
+#define MODEL_DIRS      4
+#define MODEL_FILES     48
+
+/**
+ * What a file should contain
+ */
+typedef struct model_file {
+    char dir[16];               // "" for the root
+    char name[24];
+    uint8_t data[MAX_FILE_SIZE];
+    uint32_t size;
+} model_file_t;
+
+static model_file_t model[MODEL_FILES];
+
+static block_device_t *disk;
+static filesystem_t *fs;
+
+/**
+ * Fresh heap, fresh device, formatted and mounted
+ */
+static bool mount_fresh(uint64_t blocks) {
+    shim_heap_init(256 * 1024);
+
+    shim_block_destroy(disk);
+    disk = shim_block_create("hosttest", blocks);
+    if (!disk || simplefs_format(disk) != 0) {
+        return false;
+    }
+
+    fs = simplefs_create(disk);
+    return fs != NULL;
+}
+
+/**
+ * Clean unmount followed by a mount of the same device
+ */
+static bool remount(void) {
+    fs->destroy(fs);
+    kfree(fs);
+    fs = simplefs_create(disk);
+    return fs != NULL;
+}
+
+static simplefs_t *sfs(void) {
+    return (simplefs_t *)fs->fs_data;
+}
+
+/**
+ * Look a file up from the root, one component at a time
+ */
+static vfs_node_t *lookup(const char *dir, const char *name) {
+    vfs_node_t *root = fs->get_root(fs);
+    if (!root) {
+        return NULL;
+    }
+
+    vfs_node_t *parent = root;
+    if (*dir) {
+        parent = root->finddir(root, dir);
+    }
+    vfs_node_t *node = parent ? parent->finddir(parent, name) : NULL;
+
+    if (parent && parent != root) {
+        parent->close(parent);
+    }
+    kfree(root);    // The root node is not freed by close()
+    return node;
+}
+
+/**
+ * Read a whole file back and compare it with the model
+ */
+static bool file_matches(const model_file_t *f) {
+    static uint8_t buffer[MAX_FILE_SIZE + 64];
+
+    vfs_node_t *node = lookup(f->dir, f->name);
+    if (!node) {
+        printf("    %s/%s: not found\n", f->dir, f->name);
+        return false;
+    }
+
+    int n = node->read(node, 0, sizeof(buffer), buffer);
+    bool ok = node->size == f->size && n == (int)f->size && memcmp(buffer, f->data, f->size) == 0;
+    if (!ok) {
+        printf("    %s/%s: size %u, read %d, expected %u\n", f->dir, f->name, node->size, n, f->size);
+    }
+
+    node->close(node);
+    return ok;
+}
+
+/**
+ * Create the model's directories and empty files
+ */
+static bool create_tree(void) {
+    char path[64];
+
+    for (int d = 0; d < MODEL_DIRS; d++) {
+        snprintf(path, sizeof(path), "/dir%d", d);
+        vfs_node_t *node = fs->create_dir(fs, path, 0755);
+        if (!node) {
+            return false;
+        }
+        node->close(node);
+    }
+
+    for (int i = 0; i < MODEL_FILES; i++) {
+        model_file_t *f = &model[i];
+        int d = (int)hosttest_rand_below(MODEL_DIRS + 1);
+        if (d == MODEL_DIRS) {
+            f->dir[0] = '\0';
+        } else {
+            snprintf(f->dir, sizeof(f->dir), "dir%d", d);
+        }
+        snprintf(f->name, sizeof(f->name), "file%d.%x", i, (unsigned)hosttest_rand_below(4096));
+        f->size = 0;
+
+        snprintf(path, sizeof(path), "/%.15s/%.23s", f->dir, f->name);
+        vfs_node_t *node = fs->create_file(fs, path, 0644);
+        if (!node) {
+            return false;
+        }
+        node->close(node);
+    }
+
+    return true;
+}
+
+/**
+ * Write a random extent of a random file, never leaving a hole
+ */
+static bool random_write(void) {
+    model_file_t *f = &model[hosttest_rand_below(MODEL_FILES)];
+    uint8_t data[2048];
+
+    uint32_t offset = (uint32_t)hosttest_rand_below(f->size + 1);
+    uint32_t len = 1 + (uint32_t)hosttest_rand_below(hosttest_rand_below(4) ? 300 : sizeof(data));
+    if (offset + len > MAX_FILE_SIZE) {
+        len = MAX_FILE_SIZE - offset;
+    }
+    if (len == 0) {
+        return true;
+    }
+    hosttest_rand_fill(data, len);
+
+    vfs_node_t *node = lookup(f->dir, f->name);
+    if (!node) {
+        return false;
+    }
+    int n = node->write(node, offset, len, data);
+    node->close(node);
+
+    if (n != (int)len) {
+        printf("    %s/%s: write %u@%u returned %d\n", f->dir, f->name, len, offset, n);
+        return false;
+    }
+
+    memcpy(f->data + offset, data, len);
+    if (offset + len > f->size) {
+        f->size = offset + len;
+    }
+    return true;
+}
+
+HOSTTEST(simplefs_format_and_mount) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+
+    simplefs_superblock_t *sb = &sfs()->superblock;
+    CHECK_EQ(sb->magic, SIMPLEFS_MAGIC);
+    CHECK_EQ(sb->num_blocks, DISK_BLOCKS);
+    CHECK_EQ(sb->free_inodes, SIMPLEFS_MAX_INODES - 1);   // Root directory
+    CHECK_EQ(simplefs_check(sfs()), 0);
+    CHECK_EQ(sfs()->csum_errors, 0);
+
+    block_device_t *tiny = shim_block_create("tiny", 8);
+    REQUIRE(tiny != NULL);
+    CHECK(simplefs_format(tiny) != 0);
+    shim_block_destroy(tiny);
+}
+
+HOSTTEST(simplefs_random_writes_survive_remount) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+    REQUIRE(create_tree());
+
+    for (int op = 0; op < 3000; op++) {
+        REQUIRE(random_write());
+
+        if (op % 500 == 0) {
+            REQUIRE(file_matches(&model[hosttest_rand_below(MODEL_FILES)]));
+        }
+    }
+
+    for (int i = 0; i < MODEL_FILES; i++) {
+        CHECK(file_matches(&model[i]));
+    }
+
+    REQUIRE(remount());
+    for (int i = 0; i < MODEL_FILES; i++) {
+        CHECK(file_matches(&model[i]));
+    }
+    CHECK_EQ(simplefs_check(sfs()), 0);
+    CHECK_EQ(sfs()->csum_errors, 0);
+}
+
+HOSTTEST(simplefs_inline_to_block_transition) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+
+    vfs_node_t *node = fs->create_file(fs, "/grow", 0644);
+    REQUIRE(node != NULL);
+
+    uint8_t data[SIMPLEFS_INLINE_SIZE + 1], back[SIMPLEFS_INLINE_SIZE + 1];
+    hosttest_rand_fill(data, sizeof(data));
+    uint32_t free_blocks = sfs()->superblock.free_blocks;
+
+    CHECK_EQ(node->write(node, 0, SIMPLEFS_INLINE_SIZE, data), SIMPLEFS_INLINE_SIZE);
+    CHECK_EQ(sfs()->superblock.free_blocks, free_blocks);   // Still inline
+
+    uint64_t reads = shim_block_reads(disk);
+    CHECK_EQ(node->read(node, 0, sizeof(back), back), SIMPLEFS_INLINE_SIZE);
+    CHECK_EQ(shim_block_reads(disk), reads);                // Served from the inode
+
+    CHECK_EQ(node->write(node, SIMPLEFS_INLINE_SIZE, 1, data + SIMPLEFS_INLINE_SIZE), 1);
+    CHECK_EQ(sfs()->superblock.free_blocks, free_blocks - 1);
+
+    CHECK_EQ(node->read(node, 0, sizeof(back), back), sizeof(back));
+    CHECK(memcmp(data, back, sizeof(back)) == 0);
+
+    // Truncating open returns the file to inline storage
+    CHECK_EQ(node->open(node, O_WRONLY | O_TRUNC), 0);
+    CHECK_EQ(node->size, 0);
+    CHECK_EQ(sfs()->superblock.free_blocks, free_blocks);
+    node->close(node);
+}
+
+HOSTTEST(simplefs_drop_inode_cache_rereads_inodes) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+    REQUIRE(create_tree());
+    for (int op = 0; op < 200; op++) {
+        REQUIRE(random_write());
+    }
+
+    model_file_t *f = &model[hosttest_rand_below(MODEL_FILES)];
+    REQUIRE(file_matches(f));
+
+    uint64_t reads = shim_block_reads(disk);
+    REQUIRE(file_matches(f));
+    uint64_t warm = shim_block_reads(disk) - reads;
+
+    simplefs_drop_inode_cache(sfs());
+    reads = shim_block_reads(disk);
+    CHECK(file_matches(f));
+    CHECK(shim_block_reads(disk) - reads > warm);           // Inode blocks read again
+
+    for (int i = 0; i < MODEL_FILES; i++) {
+        CHECK(file_matches(&model[i]));
+    }
+    CHECK_EQ(sfs()->csum_errors, 0);
+}
+
+HOSTTEST(simplefs_getdents_lists_every_entry) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+
+    vfs_node_t *dir = fs->create_dir(fs, "/many", 0755);
+    REQUIRE(dir != NULL);
+
+    // Spans several directory blocks; entries per directory are capped
+    uint32_t count = (uint32_t)(SIMPLEFS_MAX_FILE_BLOCKS * SIMPLEFS_DIRENTS_PER_BLOCK);
+    bool seen[SIMPLEFS_MAX_FILE_BLOCKS * SIMPLEFS_DIRENTS_PER_BLOCK] = { false };
+    char path[64];
+
+    for (uint32_t i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "/many/entry-%u", i);
+        vfs_node_t *node = fs->create_file(fs, path, 0644);
+        REQUIRE(node != NULL);
+        node->close(node);
+    }
+    CHECK(fs->create_file(fs, "/many/one-too-many", 0644) == NULL);
+    CHECK(fs->create_file(fs, "/many/entry-0", 0644) == NULL);     // Exists
+
+    // A small buffer forces the cookie to carry across calls
+    uint8_t buffer[96];
+    uint64_t cookie = 0;
+    uint32_t found = 0;
+    int n;
+
+    while ((n = dir->getdents(dir, &cookie, buffer, sizeof(buffer))) > 0) {
+        for (int pos = 0; pos < n; ) {
+            vfs_dirent64_t *d = (vfs_dirent64_t *)(buffer + pos);
+            unsigned index;
+            CHECK_EQ(d->reclen % 8, 0);
+            CHECK_EQ(d->namelen, strlen(d->name));
+            if (CHECK(sscanf(d->name, "entry-%u", &index) == 1 && index < count)) {
+                CHECK(!seen[index]);
+                seen[index] = true;
+                found++;
+            }
+            pos += d->reclen;
+        }
+    }
+
+    CHECK_EQ(n, 0);
+    CHECK_EQ(found, count);
+    dir->close(dir);
+}
+
+HOSTTEST(simplefs_unclean_mount_checks_clean) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+    REQUIRE(create_tree());
+    for (int op = 0; op < 500; op++) {
+        REQUIRE(random_write());
+    }
+
+    // "Crash": drop the mount without writing the superblock back
+    fs = simplefs_create(disk);
+    REQUIRE(fs != NULL);
+
+    // The mount ran a full check; write-through metadata leaves nothing to repair
+    CHECK_EQ(simplefs_check(sfs()), 0);
+    for (int i = 0; i < MODEL_FILES; i++) {
+        CHECK(file_matches(&model[i]));
+    }
+}
+
+HOSTTEST(simplefs_detects_corrupt_inode_block) {
+    REQUIRE(mount_fresh(DISK_BLOCKS));
+
+    // Inodes sharing a table block are lost together, so fillers keep the
+    // victim out of the root's block and the bystander out of the victim's
+    vfs_node_t *victim = NULL, *bystander = NULL;
+    char path[32];
+    for (uint32_t i = 0; i < 2 * SIMPLEFS_INODES_PER_BLOCK; i++) {
+        snprintf(path, sizeof(path), "/filler%u", i);
+        vfs_node_t *node = fs->create_file(fs, path, 0644);
+        REQUIRE(node != NULL);
+        uint32_t block = node->inode / SIMPLEFS_INODES_PER_BLOCK;
+        if (!victim && block == 1) {
+            victim = node;
+        } else if (!bystander && block == 2) {
+            bystander = node;
+        } else {
+            node->close(node);
+        }
+    }
+    REQUIRE(victim && bystander);
+    uint32_t victim_block = sfs()->superblock.first_inode_block + 1;
+    model_file_t ok = { .dir = "", .data = "world", .size = 5 };
+    strcpy(ok.name, bystander->name);
+    char victim_name[32];
+    strcpy(victim_name, victim->name);
+
+    CHECK_EQ(victim->write(victim, 0, 5, "hello"), 5);
+    CHECK_EQ(bystander->write(bystander, 0, 5, "world"), 5);
+    victim->close(victim);
+    bystander->close(bystander);
+
+    REQUIRE(remount());
+    shim_block_corrupt(disk, victim_block, 17);
+
+    CHECK(file_matches(&ok));
+    CHECK(lookup("", victim_name) == NULL);
+    CHECK(sfs()->csum_errors > 0);
+    CHECK(simplefs_check(sfs()) > 0);
+}
+
+HOSTTEST(simplefs_full_disk_fails_cleanly) {
+    // Barely more than the metadata: a few files' worth of data blocks
+    REQUIRE(mount_fresh(1 + SIMPLEFS_INODE_BLOCKS + 1 + 40));
+
+    static uint8_t data[MAX_FILE_SIZE];
+    hosttest_rand_fill(data, sizeof(data));
+
+    char path[32];
+    int full = -1;
+    for (int i = 0; i < 8; i++) {
+        snprintf(path, sizeof(path), "/big%d", i);
+        vfs_node_t *node = fs->create_file(fs, path, 0644);
+        REQUIRE(node != NULL);
+        int n = node->write(node, 0, sizeof(data), data);
+        node->close(node);
+
+        if (n != (int)sizeof(data)) {
+            full = i;
+            break;
+        }
+    }
+
+    CHECK(full > 0);
+    CHECK_EQ(sfs()->superblock.free_blocks, 0);
+    CHECK_EQ(simplefs_check(sfs()), 0);
+
+    model_file_t first = { .dir = "", .name = "big0", .size = sizeof(data) };
+    memcpy(first.data, data, sizeof(data));
+    CHECK(file_matches(&first));
+}
+
+/**
+ * Benchmarks
+ */
+static vfs_node_t *bench_root;
+static vfs_node_t *bench_file;
+static char bench_name[32];
+
+static int bench_dir_setup(uint64_t entries) {
+    if (!mount_fresh(DISK_BLOCKS)) {
+        return -1;
+    }
+
+    char path[64];
+    for (uint64_t i = 0; i < entries; i++) {
+        snprintf(path, sizeof(path), "/entry-%lu", (unsigned long)i);
+        vfs_node_t *node = fs->create_file(fs, path, 0644);
+        if (!node) {
+            return -1;
+        }
+        node->close(node);
+    }
+
+    snprintf(bench_name, sizeof(bench_name), "entry-%lu", (unsigned long)(entries - 1));
+    bench_root = fs->get_root(fs);
+    return bench_root ? 0 : -1;
+}
+
+static int bench_file_setup(uint64_t size) {
+    static uint8_t data[MAX_FILE_SIZE];
+
+    if (!mount_fresh(DISK_BLOCKS)) {
+        return -1;
+    }
+
+    bench_file = fs->create_file(fs, "/data", 0644);
+    if (!bench_file) {
+        return -1;
+    }
+    hosttest_rand_fill(data, size);
+    return bench_file->write(bench_file, 0, size, data) == (int)size ? 0 : -1;
+}
+
+HOSTBENCH(simplefs_lookup, bench_dir_setup, NULL, 1, 16, 84) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        vfs_node_t *node = bench_root->finddir(bench_root, bench_name);
+        node->close(node);
+    }
+}
+
+HOSTBENCH(simplefs_getdents, bench_dir_setup, NULL, 16, 84) {
+    uint8_t buffer[4096];
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint64_t cookie = 0;
+        while (bench_root->getdents(bench_root, &cookie, buffer, sizeof(buffer)) > 0) {
+        }
+    }
+}
+
+HOSTBENCH(simplefs_read, bench_file_setup, NULL, 64, 512, 4096) {
+    uint8_t buffer[MAX_FILE_SIZE];
+    for (uint64_t i = 0; i < iterations; i++) {
+        bench_file->read(bench_file, 0, arg, buffer);
+        HOSTBENCH_KEEP(buffer);
+    }
+}
+
+HOSTBENCH(simplefs_overwrite, bench_file_setup, NULL, 64, 512, 4096) {
+    uint8_t buffer[MAX_FILE_SIZE] = { 0 };
+    for (uint64_t i = 0; i < iterations; i++) {
+        buffer[0] = (uint8_t)i;
+        bench_file->write(bench_file, 0, arg, buffer);
+    }
+}
+
+HOSTBENCH(crc32c_block, NULL, NULL, BLOCK_SIZE) {
+    uint8_t block[BLOCK_SIZE] = { 1, 2, 3 };
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t crc = crc32c(0, block, arg);
+        HOSTBENCH_KEEP(crc);
+    }
+}
@@ -0,0 +1,270 @@
+/**
+ * lib/string.c against the C library
+ *
+ * The kernel routines are built renamed (kmemcpy, kstrlen, ...) so both
+ * implementations can be compared on the same random inputs and timed
+ * side by side.
+ */
+
+#include "hosttest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kstring_rename.h"
+#include <kernel/string.h>
+#undef memset
+#undef memcpy
+#undef memmove
+#undef memcmp
+#undef strlen
+#undef strcpy
+#undef strncpy
+#undef strcmp
+#undef strncmp
+#undef strcat
+#undef strchr
+#undef strrchr
+#undef snprintf
+#undef vsnprintf
+
+#define ROUNDS      2000
+#define MAX_LEN     300
+#define BUF_SIZE    (MAX_LEN + 64)
+
+static int sign(int v) {
+    return (v > 0) - (v < 0);
+}
+
+/**
+ * Random string over a small alphabet, so comparisons often share prefixes
+ */
+static void random_string(char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        s[i] = "abcd\x7f\x80\xff"[hosttest_rand_below(7)];
+    }
+    s[len] = '\0';
+}
+
+HOSTTEST(memset_memcpy_match_libc) {
+    static uint8_t src[BUF_SIZE], a[BUF_SIZE], b[BUF_SIZE];
+
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t len = hosttest_rand_below(MAX_LEN + 1);
+        size_t off = hosttest_rand_below(16);
+        int val = (int)hosttest_rand_below(512) - 256;
+
+        hosttest_rand_fill(a, sizeof(a));
+        memcpy(b, a, sizeof(b));
+        CHECK(kmemset(a + off, val, len) == a + off);
+        memset(b + off, val, len);
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+    }
+
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t len = hosttest_rand_below(MAX_LEN + 1);
+        size_t doff = hosttest_rand_below(16);
+        size_t soff = hosttest_rand_below(16);
+
+        hosttest_rand_fill(src, sizeof(src));
+        hosttest_rand_fill(a, sizeof(a));
+        memcpy(b, a, sizeof(b));
+        CHECK(kmemcpy(a + doff, src + soff, len) == a + doff);
+        memcpy(b + doff, src + soff, len);
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+    }
+}
+
+HOSTTEST(memmove_overlap_matches_libc) {
+    static uint8_t a[BUF_SIZE], b[BUF_SIZE];
+
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t len = hosttest_rand_below(MAX_LEN / 2);
+        size_t src = hosttest_rand_below(BUF_SIZE - len);
+        size_t dst = hosttest_rand_below(BUF_SIZE - len);
+
+        hosttest_rand_fill(a, sizeof(a));
+        memcpy(b, a, sizeof(b));
+        CHECK(kmemmove(a + dst, a + src, len) == a + dst);
+        memmove(b + dst, b + src, len);
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+    }
+}
+
+HOSTTEST(memcmp_sign_matches_libc) {
+    static uint8_t a[BUF_SIZE], b[BUF_SIZE];
+
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t len = hosttest_rand_below(MAX_LEN + 1);
+        hosttest_rand_fill(a, len);
+        memcpy(b, a, len);
+        if (len && hosttest_rand_below(4)) {
+            b[hosttest_rand_below(len)] = (uint8_t)hosttest_rand();
+        }
+        CHECK_EQ(sign(kmemcmp(a, b, len)), sign(memcmp(a, b, len)));
+    }
+}
+
+HOSTTEST(str_routines_match_libc) {
+    static char s1[MAX_LEN + 1], s2[MAX_LEN + 1];
+    static char a[2 * BUF_SIZE], b[2 * BUF_SIZE];
+
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t len1 = hosttest_rand_below(MAX_LEN / 2);
+        size_t len2 = hosttest_rand_below(MAX_LEN / 2);
+        random_string(s1, len1);
+        if (hosttest_rand_below(2)) {
+            random_string(s2, len2);
+        } else {
+            memcpy(s2, s1, len1 + 1);  // Equal, or equal up to a late change
+            if (len1) s2[hosttest_rand_below(len1)] = 'z';
+        }
+
+        CHECK_EQ(kstrlen(s1), strlen(s1));
+        CHECK_EQ(sign(kstrcmp(s1, s2)), sign(strcmp(s1, s2)));
+
+        size_t n = hosttest_rand_below(MAX_LEN / 2 + 8);
+        CHECK_EQ(sign(kstrncmp(s1, s2, n)), sign(strncmp(s1, s2, n)));
+
+        memset(a, 'x', sizeof(a));
+        memset(b, 'x', sizeof(b));
+        CHECK(kstrcpy(a, s1) == a);
+        strcpy(b, s1);
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+
+        CHECK(kstrcat(a, s2) == a);
+        strcat(b, s2);
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+
+        memset(a, 'x', sizeof(a));
+        memset(b, 'x', sizeof(b));
+        CHECK(kstrncpy(a, s1, n) == a);
+        strncpy(b, s1, n);
+        CHECK(memcmp(a, b, sizeof(a)) == 0);
+
+        // Nonzero characters only: kstrchr(s, '\0') returns NULL, not the terminator
+        int c = "abcdz\x80"[hosttest_rand_below(6)];
+        CHECK(kstrchr(s1, c) == strchr(s1, c));
+        CHECK(kstrrchr(s1, c) == strrchr(s1, c));
+    }
+}
+
+HOSTTEST(snprintf_matches_libc) {
+    char kbuf[128], lbuf[128];
+
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t v = hosttest_rand() >> hosttest_rand_below(64);
+        int kret = 0, lret = 0;
+
+        switch (hosttest_rand_below(9)) {
+        case 0:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "<%d>", (int)v);
+            lret = snprintf(lbuf, sizeof(lbuf), "<%d>", (int)v);
+            break;
+        case 1:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "<%i|%u>", (int)v, (unsigned)v);
+            lret = snprintf(lbuf, sizeof(lbuf), "<%i|%u>", (int)v, (unsigned)v);
+            break;
+        case 2:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "%x-%X", (unsigned)v, (unsigned)v);
+            lret = snprintf(lbuf, sizeof(lbuf), "%x-%X", (unsigned)v, (unsigned)v);
+            break;
+        case 3:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "%ld", (long)v);
+            lret = snprintf(lbuf, sizeof(lbuf), "%ld", (long)v);
+            break;
+        case 4:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "%lu %lx", (unsigned long)v, (unsigned long)v);
+            lret = snprintf(lbuf, sizeof(lbuf), "%lu %lx", (unsigned long)v, (unsigned long)v);
+            break;
+        case 5:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "%llu", (unsigned long long)v);
+            lret = snprintf(lbuf, sizeof(lbuf), "%llu", (unsigned long long)v);
+            break;
+        case 6:
+            kret = ksnprintf(kbuf, sizeof(kbuf), "%p", (void *)(uintptr_t)(v | 1));
+            lret = snprintf(lbuf, sizeof(lbuf), "%p", (void *)(uintptr_t)(v | 1));
+            break;
+        case 7: {
+            char s[40];
+            random_string(s, hosttest_rand_below(sizeof(s)));
+            kret = ksnprintf(kbuf, sizeof(kbuf), "[%s]%c%%", s, (char)('A' + v % 26));
+            lret = snprintf(lbuf, sizeof(lbuf), "[%s]%c%%", s, (char)('A' + v % 26));
+            break;
+        }
+        default: {
+            // Truncation: the kernel returns what it wrote, not what it wanted to
+            size_t size = 1 + hosttest_rand_below(12);
+            kret = ksnprintf(kbuf, size, "%lu:%s", (unsigned long)v, "tail");
+            snprintf(lbuf, size, "%lu:%s", (unsigned long)v, "tail");
+            lret = (int)strlen(lbuf);
+            break;
+        }
+        }
+
+        if (!CHECK(strcmp(kbuf, lbuf) == 0)) {
+            printf("    kernel \"%s\", libc \"%s\"\n", kbuf, lbuf);
+        }
+        CHECK_EQ(kret, lret);
+    }
+}
+
+/**
+ * Benchmarks: kernel routine next to the C library's
+ */
+static uint8_t bench_src[65536], bench_dst[65536];
+
+HOSTBENCH(kmemcpy, NULL, NULL, 64, 512, 4096, 65536) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmemcpy(bench_dst, bench_src, arg);
+        HOSTBENCH_KEEP(bench_dst);
+    }
+}
+
+HOSTBENCH(libc_memcpy, NULL, NULL, 64, 512, 4096, 65536) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(bench_dst, bench_src, arg);
+        HOSTBENCH_KEEP(bench_dst);
+    }
+}
+
+HOSTBENCH(kmemset, NULL, NULL, 64, 4096) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmemset(bench_dst, (int)i, arg);
+        HOSTBENCH_KEEP(bench_dst);
+    }
+}
+
+HOSTBENCH(libc_memset, NULL, NULL, 64, 4096) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        memset(bench_dst, (int)i, arg);
+        HOSTBENCH_KEEP(bench_dst);
+    }
+}
+
+HOSTBENCH(kmemcmp, NULL, NULL, 4096) {
+    memset(bench_src, 0, arg);
+    memset(bench_dst, 0, arg);
+    for (uint64_t i = 0; i < iterations; i++) {
+        int r = kmemcmp(bench_dst, bench_src, arg);
+        HOSTBENCH_KEEP(r);
+    }
+}
+
+HOSTBENCH(kstrlen, NULL, NULL, 16, 256) {
+    memset(bench_src, 'a', arg);
+    bench_src[arg] = '\0';
+    for (uint64_t i = 0; i < iterations; i++) {
+        size_t r = kstrlen((const char *)bench_src);
+        HOSTBENCH_KEEP(r);
+    }
+}
+
+HOSTBENCH(ksnprintf, NULL, NULL, 0) {
+    char line[128];
+    for (uint64_t i = 0; i < iterations; i++) {
+        ksnprintf(line, sizeof(line), "KBENCH {\"name\":\"%s\",\"min\":%lu,\"max\":%lx}",
+                  "bench", i, i * 7);
+        HOSTBENCH_KEEP(line);
+    }
+}
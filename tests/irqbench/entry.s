@@ -0,0 +1,10 @@
+/* Process entry: align the stack and run the benchmarks */
+.code64
+.text
+.global _start
+_start:
+    and $-16, %rsp
+    call irqbench_main
+    ud2
+
+.section .note.GNU-stack,"",@progbits
@@ -0,0 +1,148 @@
+/**
+ * Interrupt Entry Benchmark: the kernel's isr.c, softirq.c and kbench.c
+ * run unchanged as a static Linux program
+ *
+ * The stubs are GAS transcriptions of interrupts.S with user selectors
+ * (0x2b for 0x10) and the ring test changed so CS 0x33 takes the
+ * kernel-to-kernel path. Each case pushes the frame the CPU would push
+ * and jumps to the vector stub, whose iretq returns (a same-privilege
+ * iretq is legal in ring 3). Only the hardware's interrupt delivery is
+ * missing, and that costs the same for either stub.
+ */
+
+#include <kernel/kbench.h>
+#include <kernel/isr.h>
+#include <kernel/idt.h>
+#include <kernel/syscall.h>
+#include <kernel/string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#define IRQBENCH_RUNS 7
+
+extern void stub_syscall(void);
+extern void stub_nop(void);
+
+static long irqbench_syscall(long number, long arg1, long arg2, long arg3) {
+    long result;
+    __asm__ volatile("syscall"
+                     : "=a"(result)
+                     : "a"(number), "D"(arg1), "S"(arg2), "d"(arg3)
+                     : "rcx", "r11", "memory");
+    return result;
+}
+
+/**
+ * Console: results go to standard output
+ */
+void serial_write(const char *data, size_t size) {
+    irqbench_syscall(1, 1, (long)data, (long)size);        // write
+}
+
+void vga_puts(const char *str) {
+    serial_write(str, strlen(str));
+}
+
+void vga_setcolor(uint8_t color) {
+    (void)color;
+}
+
+void vga_printf(const char *format, ...) {
+    char line[512];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    vga_puts(line);
+}
+
+void printk_flush(void) {
+}
+
+void serial_enter_polled_mode(uint32_t baud) {
+    (void)baud;
+}
+
+/**
+ * Kernel services isr.c and kbench.c link against
+ */
+uint64_t timer_get_tsc_khz(void) {
+    return 0;       // Results stay in cycles
+}
+
+int vmm_handle_page_fault(uint64_t address, uint64_t error_code) {
+    (void)address;
+    (void)error_code;
+    return -1;
+}
+
+void idt_set_gate(uint8_t num, uint64_t handler, uint8_t flags) {
+    (void)num;
+    (void)handler;
+    (void)flags;
+}
+
+/**
+ * Scheduler as seen while the kbench task runs: nothing to preempt for
+ */
+bool scheduler_need_resched(void) {
+    return false;
+}
+
+void scheduler_preempt(registers_t *regs) {
+    (void)regs;
+}
+
+/**
+ * CPU-pushed frame (SS, RSP, RFLAGS, CS, RIP), then the vector stub
+ */
+#define IRQBENCH_INT(stub)                                              \
+    "mov %%rsp, %%rcx\n\t"                                              \
+    "and $-16, %%rsp\n\t"                                               \
+    "pushq $0x2b\n\t"                                                   \
+    "push %%rcx\n\t"                                                    \
+    "pushfq\n\t"                                                        \
+    "pushq $0x33\n\t"                                                   \
+    "lea 1f(%%rip), %%rcx\n\t"                                          \
+    "push %%rcx\n\t"                                                    \
+    "jmp " #stub "\n"                                                   \
+    "1:\n\t"
+
+static void syscall_handler(registers_t *regs) {
+    regs->rax = 1;      // getpid
+}
+
+KBENCH(null_syscall, KBENCH_MAX_ITERATIONS, NULL, NULL) {
+    uint64_t number = SYS_GETPID;
+    __asm__ volatile(IRQBENCH_INT(stub_syscall) : "+a"(number) : : "rcx", "memory");
+}
+
+static void nop_handler(registers_t *regs) {
+    (void)regs;
+}
+
+static int irq_roundtrip_setup(void) {
+    isr_register_handler(INT_NOP, nop_handler);
+    return 0;
+}
+
+static void irq_roundtrip_teardown(void) {
+    isr_unregister_handler(INT_NOP);
+}
+
+KBENCH(irq_roundtrip, KBENCH_MAX_ITERATIONS, irq_roundtrip_setup, irq_roundtrip_teardown) {
+    __asm__ volatile(IRQBENCH_INT(stub_nop) : : : "rcx", "memory");
+}
+
+/**
+ * Entry point (called from entry.s)
+ */
+void irqbench_main(void) {
+    isr_register_handler(INT_SYSCALL, syscall_handler);
+    for (int run = 0; run < IRQBENCH_RUNS; run++) {
+        kbench_run_all();
+    }
+    irqbench_syscall(60, 0, 0, 0);      // exit
+}
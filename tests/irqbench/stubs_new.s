@@ -0,0 +1,151 @@
+/*
+ * interrupts.S since 3858151: hardware interrupts save a partial frame
+ *
+ * GAS transcription for the irqbench harness. The ring tests check CS
+ * bit 2 (mask 4) instead of the RPL (mask 3), so the CS 0x33 the harness
+ * pushes takes the kernel-to-kernel path.
+ */
+.intel_syntax noprefix
+.code64
+.set FRAME_DS, 0
+.set FRAME_ES, 8
+.set FRAME_FS, 16
+.set FRAME_GS, 24
+.set FRAME_R15, 32
+.set FRAME_R14, 40
+.set FRAME_R13, 48
+.set FRAME_R12, 56
+.set FRAME_RBP, 96
+.set FRAME_RBX, 136
+.set FRAME_CS, 176
+
+.macro ENTER_FROM_USER
+    test byte ptr [rsp + FRAME_CS], 4
+    jz 1f
+    swapgs
+    xor eax, eax
+    mov ax, ds
+    mov [rsp + FRAME_DS], rax
+    mov ax, es
+    mov [rsp + FRAME_ES], rax
+    mov ax, fs
+    mov [rsp + FRAME_FS], rax
+    mov ax, gs
+    mov [rsp + FRAME_GS], rax
+1:
+.endm
+
+.text
+.global isr_common_stub
+isr_common_stub:
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push rbp
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+    sub rsp, 32
+    ENTER_FROM_USER
+    mov rdi, rsp
+    call isr_common_handler
+isr_common_exit:
+    test byte ptr [rsp + FRAME_CS], 4
+    jz 2f
+    mov rax, [rsp + FRAME_DS]
+    mov ds, ax
+    mov rax, [rsp + FRAME_ES]
+    mov es, ax
+2:
+    add rsp, 32
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rbp
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+    add rsp, 16
+    test byte ptr [rsp + 8], 4
+    jz 3f
+    swapgs
+3:
+    iretq
+
+.global irq_common_stub
+irq_common_stub:
+    push rax
+    sub rsp, 8
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    sub rsp, 8
+    push r8
+    push r9
+    push r10
+    push r11
+    sub rsp, 64
+    ENTER_FROM_USER
+    mov rdi, rsp
+    call irq_common_handler
+    test eax, eax
+    jnz 5f
+    add rsp, 64
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    add rsp, 8
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    add rsp, 8
+    pop rax
+    add rsp, 16
+    test byte ptr [rsp + 8], 4
+    jz 4f
+    swapgs
+4:
+    iretq
+5:
+    mov [rsp + FRAME_R15], r15
+    mov [rsp + FRAME_R14], r14
+    mov [rsp + FRAME_R13], r13
+    mov [rsp + FRAME_R12], r12
+    mov [rsp + FRAME_RBP], rbp
+    mov [rsp + FRAME_RBX], rbx
+    mov rdi, rsp
+    call hardirq_exit
+    jmp isr_common_exit
+
+.global stub_syscall
+stub_syscall:
+    push 0
+    push 0x80
+    jmp isr_common_stub
+
+.global stub_nop
+stub_nop:
+    push 0
+    push 0xF0
+    jmp irq_common_stub
+
+.section .note.GNU-stack,"",@progbits
@@ -0,0 +1,81 @@
+/*
+ * interrupts.S before 3858151: every entry saves the full frame
+ *
+ * GAS transcription for the irqbench harness. The kernel data selector
+ * 0x10 is replaced by the user selector 0x2b so the segment loads work
+ * in ring 3.
+ */
+.intel_syntax noprefix
+.code64
+.text
+.global isr_common_stub
+isr_common_stub:
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push rbp
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+    mov rax, ds
+    push rax
+    mov rax, es
+    push rax
+    mov rax, fs
+    push rax
+    mov rax, gs
+    push rax
+    mov ax, 0x2b
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov rdi, rsp
+    call isr_common_handler
+    pop rax
+    mov gs, rax
+    pop rax
+    mov fs, rax
+    pop rax
+    mov es, rax
+    pop rax
+    mov ds, rax
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rbp
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+    add rsp, 16
+    iretq
+
+.global stub_syscall
+stub_syscall:
+    push 0
+    push 0x80
+    jmp isr_common_stub
+
+.global stub_nop
+stub_nop:
+    push 0
+    push 0xF0
+    jmp isr_common_stub
+
+.section .note.GNU-stack,"",@progbits
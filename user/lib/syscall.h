@@ -27,6 +27,29 @@
 #define SYS_TIME        13
 #define SYS_GETCHAR     14
 #define SYS_PUTCHAR     15
+#define SYS_GETDENTS    16
+#define SYS_PIPE        17
+#define SYS_MKFIFO      18
+#define SYS_IRQSTATS    19
+
+// Packed directory entry returned by getdents (must match kernel)
+struct dirent64 {
+    uint32_t inode;
+    uint16_t reclen;
+    uint8_t type;
+    uint8_t namelen;
+    char name[];
+} __attribute__((packed));
+
+// Per-vector interrupt statistics returned by irqstats (must match kernel)
+struct irq_stat {
+    uint32_t vector;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t max_cycles;
+    uint64_t max_latency;
+};
 
 // Generic syscall function
 static inline int64_t syscall(uint64_t num, uint64_t arg1, uint64_t arg2,
@@ -84,6 +107,30 @@ static inline int getchar(void) {
     return (int)syscall(SYS_GETCHAR, 0, 0, 0, 0, 0);
 }
 
+static inline int open(const char *path, uint32_t flags) {
+    return (int)syscall(SYS_OPEN, (uint64_t)path, flags, 0, 0, 0);
+}
+
+static inline int close(int fd) {
+    return (int)syscall(SYS_CLOSE, fd, 0, 0, 0, 0);
+}
+
+static inline int getdents(int fd, void *buf, size_t count) {
+    return (int)syscall(SYS_GETDENTS, fd, (uint64_t)buf, count, 0, 0);
+}
+
+static inline int pipe(int fds[2]) {
+    return (int)syscall(SYS_PIPE, (uint64_t)fds, 0, 0, 0, 0);
+}
+
+static inline int mkfifo(const char *path) {
+    return (int)syscall(SYS_MKFIFO, (uint64_t)path, 0, 0, 0, 0);
+}
+
+static inline int irqstats(struct irq_stat *buf, size_t count) {
+    return (int)syscall(SYS_IRQSTATS, (uint64_t)buf, count, 0, 0, 0);
+}
+
 // Helper functions
 
 static inline void puts(const char *str) {